@@ -12,9 +12,18 @@
 
 !2 = !{ !"World::allocNext", !0 }
 !3 = !{ !"World::allocEnd", !0 }
+!5 = !{ !"World::shadowStackHead", !0 }
+!6 = !{ !"World::gcPollRequested", !0 }
 
-; {allocNext, allocEnd}
-%world = type {%cell*, %cell*}
+!7 = !{ !"ShadowStackEntry::next", !0 }
+!8 = !{ !"ShadowStackEntry::cellRefs", !0 }
+!9 = !{ !"ShadowStackEntry::cellCount", !0 }
+
+; {next, cellRefs, cellCount}
+%shadowStackEntry = type {%shadowStackEntry*, %any**, i64}
+
+; {shadowStackHead, gcPollRequested, allocNext, allocEnd}
+%world = type {%shadowStackEntry*, i8, %cell*, %cell*}
 
 !4 = !{ !"VectorCell::m_elements", !0 }
 
@@ -6,7 +6,10 @@ import llambda.llvmir._
 
 
 private[codegen] object GenCondBranch {
-  def apply(state: GenerationState, genGlobals: GenGlobals)(step: ps.CondBranch): GenResult = step match {
+  def apply(state: GenerationState, genGlobals: GenGlobals)(
+      step: ps.CondBranch,
+      liveAfter: Set[ps.TempValue]
+  ): GenResult = step match {
     case ps.CondBranch(testTemp, trueSteps, falseSteps, valuePhis) =>
       val testIr = state.liveTemps(testTemp)
 
@@ -27,8 +30,8 @@ private[codegen] object GenCondBranch {
         currentBlock=falseStartBlock
       )
 
-      val trueResult = GenPlanSteps(trueStartState, genGlobals)(trueSteps)
-      val falseResult = GenPlanSteps(falseStartState, genGlobals)(falseSteps)
+      val trueResult = GenPlanSteps(trueStartState, genGlobals)(trueSteps, liveAfter ++ valuePhis.map(_.trueValue))
+      val falseResult = GenPlanSteps(falseStartState, genGlobals)(falseSteps, liveAfter ++ valuePhis.map(_.falseValue))
 
       (trueResult, falseResult) match {
         case (BlockTerminated, BlockTerminated) =>
@@ -66,7 +69,17 @@ private[codegen] object GenCondBranch {
           trueEndBlock.uncondBranch(phiBlock)
           falseEndBlock.uncondBranch(phiBlock)
 
-          val phiBlockState = state.copy(currentBlock=phiBlock)
+          // Either branch may have reloaded temp values after a GC safe-point
+          val reloadedTemps = GenSafePoint.genTempPhis(phiBlock)(
+            state.liveTemps.keys,
+            (trueEndState.liveTemps, trueEndBlock),
+            (falseEndState.liveTemps, falseEndBlock)
+          )
+
+          val phiBlockState = state.copy(
+            currentBlock=phiBlock,
+            liveTemps=state.liveTemps ++ reloadedTemps
+          )
 
           valuePhis.foldLeft(phiBlockState) { case (state, valuePhi) =>
             val trueResultIrValue = trueEndState.liveTemps(valuePhi.trueValue)
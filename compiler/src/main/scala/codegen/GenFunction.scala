@@ -44,10 +44,21 @@ private[codegen] object GenFunction {
         liveTemps + (tempValue -> generatedFunction.argumentValues(name))
     }
 
+    // Allocate enough root slots for our largest safe-point
+    val rootSlotCount = GenSafePoint.maximumRootedTemps(argTemps.keySet, plannedFunction.steps)
+
+    val gcRootSlots = if (rootSlotCount > 0) {
+      Some(GenSafePoint.genRootSlots(generatedFunction.entryBlock)(rootSlotCount))
+    }
+    else {
+      None
+    }
+
     val startState = GenerationState(
       currentBlock=generatedFunction.entryBlock,
       currentAllocation=EmptyHeapAllocation(),
-      liveTemps=argTemps
+      liveTemps=argTemps,
+      gcRootSlots=gcRootSlots
     )
 
     // Generate our steps
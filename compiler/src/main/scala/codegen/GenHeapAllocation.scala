@@ -1,12 +1,22 @@
 package io.llambda.compiler.codegen
 import io.llambda
 
+import llambda.compiler.planner.{step => ps}
 import llambda.llvmir._
 
 object GenHeapAllocation {
   private val cellType = UserDefinedType("cell")
 
-  def genAllocation(initialState: GenerationState)(worldPtrIr: IrValue, count: Int): (GenerationState, HeapAllocation)  = {
+  /** Generates a heap allocation
+    *
+    * @param  liveAfter  Temp values used after the allocation. These are rooted if the runtime is called to collect
+    *                    garbage.
+    */
+  def genAllocation(initialState: GenerationState)(
+      worldPtrIr: IrValue,
+      count: Int,
+      liveAfter: Set[ps.TempValue]
+  ): (GenerationState, HeapAllocation)  = {
     val startBlock = initialState.currentBlock
 
     if (count == 0) {
@@ -17,11 +27,16 @@ object GenHeapAllocation {
     val irFunction = initialState.currentBlock.function
     val module = irFunction.module
     val allocCellsDecl = RuntimeFunctions.allocCells
+    val gcPollDecl = RuntimeFunctions.gcPoll
 
     module.unlessDeclared(allocCellsDecl) {
       module.declareFunction(allocCellsDecl)
     }
 
+    module.unlessDeclared(gcPollDecl) {
+      module.declareFunction(gcPollDecl)
+    }
+
     startBlock.comment(s"allocating ${count} cells")
 
     // We need this a few times
@@ -51,8 +66,11 @@ object GenHeapAllocation {
     WorldValue.genStoreToAllocNext(directSuccessBlock)(newAllocNextValue, worldPtrIr)
     directSuccessBlock.uncondBranch(allocFinishedBlock)
 
-    // In the runtime alloc block call the runtime
-    val Some(runtimeAllocValue) = runtimeAllocBlock.callDecl(Some("runtimeAlloc"))(allocCellsDecl, List(worldPtrIr, allocCountValue))
+    // In the runtime alloc block give the runtime a chance to collect before allocating
+    val (runtimeAllocValue, reloadedTemps) = GenSafePoint(runtimeAllocBlock, initialState, liveAfter) {
+      runtimeAllocBlock.callDecl(None)(gcPollDecl, List(worldPtrIr))
+      runtimeAllocBlock.callDecl(Some("runtimeAlloc"))(allocCellsDecl, List(worldPtrIr, allocCountValue)).get
+    }
 
     runtimeAllocBlock.uncondBranch(allocFinishedBlock)
 
@@ -62,9 +80,20 @@ object GenHeapAllocation {
       PhiSource(runtimeAllocValue, runtimeAllocBlock)
     )
 
+    val phiedTemps = GenSafePoint.genTempPhis(allocFinishedBlock)(
+      reloadedTemps.keys,
+      (initialState.liveTemps, directSuccessBlock),
+      (initialState.liveTemps ++ reloadedTemps, runtimeAllocBlock)
+    )
+
     val allocation = new HeapAllocation(allocResultValue, 0, count)
 
-    (initialState.copy(currentBlock=allocFinishedBlock), allocation)
+    val finishedState = initialState.copy(
+      currentBlock=allocFinishedBlock,
+      liveTemps=initialState.liveTemps ++ phiedTemps
+    )
+
+    (finishedState, allocation)
   }
 
   def genDeallocation(state: GenerationState)(worldPtrIr: IrValue) {
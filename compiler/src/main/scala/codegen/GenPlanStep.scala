@@ -29,7 +29,11 @@ object GenPlanStep {
     case ps.CompareCond.LessThanEqual => FComparisonCond.OrderedLessThanEqual
   }
 
-  def apply(state: GenerationState, genGlobals: GenGlobals)(step: ps.Step): GenResult = step match {
+  /** Generates a single step
+    *
+    * @param  liveAfter  Temp values used after this step. These must be preserved across any GC safe-point.
+    */
+  def apply(state: GenerationState, genGlobals: GenGlobals)(step: ps.Step, liveAfter: Set[ps.TempValue]): GenResult = step match {
     case ps.AllocateHeapCells(count) =>
       if (!state.currentAllocation.isEmpty) {
         // This is not only wasteful but dangerous as the previous allocation won't be fully initialized
@@ -38,7 +42,7 @@ object GenPlanStep {
 
       val worldPtrIr = state.liveTemps(ps.WorldPtrValue)
 
-      val (allocState, allocation) = GenHeapAllocation.genAllocation(state)(worldPtrIr, count)
+      val (allocState, allocation) = GenHeapAllocation.genAllocation(state)(worldPtrIr, count, liveAfter)
       allocState.copy(currentAllocation=allocation)
 
     case createConstantStep: ps.CreateConstant =>
@@ -126,7 +130,7 @@ object GenPlanStep {
       state.withTempValue(resultTemp -> resultIr)
 
     case condBranch: ps.CondBranch =>
-      GenCondBranch(state, genGlobals)(condBranch)
+      GenCondBranch(state, genGlobals)(condBranch, liveAfter)
 
     case invokeStep @ ps.Invoke(resultOpt, signature, funcPtrTemp, arguments, _) =>
       val result = ProcedureSignatureToIr(signature)
@@ -145,31 +149,49 @@ object GenPlanStep {
         return BlockTerminated
       }
 
-      // This call can't allocate or throw exceptions - skip the barrier and invoke
-      val irRetOpt = block.call(Some("ret"))(irSignature, irFuncPtr, irArguments, metadata=metadata)
+      val (irRetOpt, reloadedTemps) = if (signature.hasWorldArg) {
+        // This call can collect garbage
+        GenSafePoint(block, state, liveAfter) {
+          block.call(Some("ret"))(irSignature, irFuncPtr, irArguments, metadata=metadata)
+        }
+      }
+      else {
+        // This call can't allocate or throw exceptions - skip the barrier and invoke
+        (block.call(Some("ret"))(irSignature, irFuncPtr, irArguments, metadata=metadata), Map[ps.TempValue, IrValue]())
+      }
+
+      val reloadedState = state.copy(liveTemps=state.liveTemps ++ reloadedTemps)
 
       resultOpt match {
         case Some(resultTemp) =>
-          state.withTempValue(resultTemp -> irRetOpt.get)
+          reloadedState.withTempValue(resultTemp -> irRetOpt.get)
 
         case None =>
-          state
+          reloadedState
       }
 
-    case ps.TailCall(signature, funcPtrTemp, arguments) =>
+    case tailCallStep @ ps.TailCall(signature, funcPtrTemp, arguments) =>
       val result = ProcedureSignatureToIr(signature)
       val irSignature = result.irSignature
       val metadata = result.callMetadata
 
-      val irFuncPtr = state.liveTemps(funcPtrTemp)
-      val irArguments = arguments.map(state.liveTemps)
+      val callState = if (signature.hasWorldArg) {
+        // Poll for garbage collection before looping
+        GenSafePoint.genPoll(state)(tailCallStep.inputValues)
+      }
+      else {
+        state
+      }
+
+      val irFuncPtr = callState.liveTemps(funcPtrTemp)
+      val irArguments = arguments.map(callState.liveTemps)
 
       if (irSignature.result.irType == VoidType) {
-        state.currentBlock.call(None)(irSignature, irFuncPtr, irArguments, tailCall=true)
-        state.currentBlock.retVoid()
+        callState.currentBlock.call(None)(irSignature, irFuncPtr, irArguments, tailCall=true)
+        callState.currentBlock.retVoid()
       }
       else {
-        val block = state.currentBlock
+        val block = callState.currentBlock
         val irRetValueOpt = block.call(Some("ret"))(
           irSignature,
           irFuncPtr,
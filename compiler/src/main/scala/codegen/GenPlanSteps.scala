@@ -4,12 +4,24 @@ import io.llambda
 import llambda.compiler.planner.{step => ps}
 
 object GenPlanSteps {
-  def apply(initialState: GenerationState, genGlobals: GenGlobals)(steps: List[ps.Step]): GenResult =
-    steps match {
-      case step :: stepsTail =>
-        GenPlanStep(initialState, genGlobals)(step) match {
+  /** Generates a list of steps
+    *
+    * @param  liveAfter  Temp values used after the final step. These must be preserved across any GC safe-points.
+    */
+  def apply(initialState: GenerationState, genGlobals: GenGlobals)(
+      steps: List[ps.Step],
+      liveAfter: Set[ps.TempValue] = Set()
+  ): GenResult =
+    genSteps(initialState, genGlobals)(steps.zip(GenSafePoint.liveAfterEachStep(steps, liveAfter)))
+
+  private def genSteps(initialState: GenerationState, genGlobals: GenGlobals)(
+      stepsWithLiveAfter: List[(ps.Step, Set[ps.TempValue])]
+  ): GenResult =
+    stepsWithLiveAfter match {
+      case (step, liveAfterStep) :: stepsTail =>
+        GenPlanStep(initialState, genGlobals)(step, liveAfterStep) match {
           case newState: GenerationState =>
-            apply(newState, genGlobals)(stepsTail)
+            genSteps(newState, genGlobals)(stepsTail)
 
           case BlockTerminated =>
             // We've terminated - don't go bother with the rest of the steps
@@ -10,7 +10,8 @@ sealed abstract class GenResult
 case class GenerationState(
   currentBlock: IrBlockBuilder,
   currentAllocation: HeapAllocation,
-  liveTemps: Map[ps.TempValue, IrValue]
+  liveTemps: Map[ps.TempValue, IrValue],
+  gcRootSlots: Option[GcRootSlots]
 ) extends GenResult {
   def withTempValue(tempTuple: (ps.TempValue, IrValue)) = {
     this.copy(liveTemps=liveTemps + tempTuple)
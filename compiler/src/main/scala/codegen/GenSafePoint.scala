@@ -0,0 +1,261 @@
+package io.llambda.compiler.codegen
+import io.llambda
+
+import llambda.compiler.InternalCompilerErrorException
+import llambda.compiler.planner.{step => ps}
+import llambda.compiler.{celltype => ct}
+import llambda.llvmir._
+
+/** Stack allocated shadow stack entry used to root cells across safe-points
+  *
+  * @param  entry      Pointer to the function's shadow stack entry
+  * @param  cellRefs   Pointer to the function's array of root slots
+  * @param  slotCount  Number of root slots allocated
+  */
+case class GcRootSlots(entry: IrValue, cellRefs: IrValue, slotCount: Int)
+
+/** Generates GC safe-points
+  *
+  * The garbage collector can relocate any heap allocated cell during a safe-point. Cell temp values used after the
+  * safe-point are stored in the function's root slots and its shadow stack entry is pushed on to the World for the
+  * duration of the safe-point. The possibly relocated cells are then reloaded from the root slots.
+  *
+  * Safe-points are calls that take a world pointer, the runtime path of heap allocations and polls before tail calls.
+  * Self tail calls become loop back-edges once optimised.
+  */
+private[codegen] object GenSafePoint {
+  private val anyCellPointerIrType = PointerType(ct.AnyCell.irType)
+
+  private def cellTypeAndSubtypes(cellType: ct.CellType): Set[ct.CellType] =
+    cellType.directSubtypes.flatMap(cellTypeAndSubtypes) + cellType
+
+  private lazy val cellTypesByIrType: Map[IrType, ct.CellType] =
+    cellTypeAndSubtypes(ct.AnyCell).map({ cellType =>
+      PointerType(cellType.irType) -> cellType
+    }).toMap
+
+  /** Returns true if the passed step can collect garbage */
+  def isSafePoint(step: ps.Step): Boolean = step match {
+    case ps.AllocateHeapCells(count) =>
+      count > 0
+
+    case invokeLike: ps.InvokeLike =>
+      invokeLike.signature.hasWorldArg
+
+    case _ =>
+      false
+  }
+
+  /** Returns the temp values used after each of the passed steps
+    *
+    * @param  steps      Steps to calculate the live temp values for
+    * @param  liveAfter  Temp values used after the final step
+    */
+  def liveAfterEachStep(steps: List[ps.Step], liveAfter: Set[ps.TempValue]): List[Set[ps.TempValue]] =
+    steps.scanRight(liveAfter)({ (step, liveAfterStep) =>
+      liveAfterStep ++ step.inputValues
+    }).tail
+
+  /** Returns the maximum number of temp values a safe-point in the passed steps may need to root
+    *
+    * This is an upper bound; temp values that aren't heap allocated cells are included in the count
+    */
+  def maximumRootedTemps(
+      definedTemps: Set[ps.TempValue],
+      steps: List[ps.Step],
+      liveAfter: Set[ps.TempValue] = Set()
+  ): Int = {
+    val liveAfterSteps = liveAfterEachStep(steps, liveAfter)
+
+    val (_, maximum) = steps.zip(liveAfterSteps).foldLeft((definedTemps, 0)) {
+      case ((definedBefore, maximumBefore), (step, liveAfterStep)) =>
+        val stepMaximum = step match {
+          case condBranch: ps.CondBranch =>
+            condBranch.innerBranches.map({ case (branchSteps, branchResults) =>
+              maximumRootedTemps(definedBefore, branchSteps, liveAfterStep ++ branchResults)
+            }).max
+
+          case tailCall: ps.TailCall if isSafePoint(tailCall) =>
+            // We poll before the tail call so its arguments must survive
+            (tailCall.inputValues & definedBefore).size
+
+          case other if isSafePoint(other) =>
+            (liveAfterStep & definedBefore).size
+
+          case _ =>
+            0
+        }
+
+        (definedBefore ++ step.outputValues, Math.max(maximumBefore, stepMaximum))
+    }
+
+    maximum
+  }
+
+  /** Allocates the root slots for a function in its entry block */
+  def genRootSlots(entryBlock: IrEntryBlockBuilder)(slotCount: Int): GcRootSlots = {
+    val entryIr = entryBlock.alloca("gcRootEntry")(ShadowStackEntryValue.irType)
+    val cellRefsIr = entryBlock.alloca("gcRootSlots")(anyCellPointerIrType, IntegerConstant(IntegerType(32), slotCount))
+
+    ShadowStackEntryValue.genStoreToCellRefs(entryBlock)(cellRefsIr, entryIr)
+
+    GcRootSlots(entryIr, cellRefsIr, slotCount)
+  }
+
+  /** Returns the distinct IR values that must be rooted along with their cell type and the temps referencing them
+    *
+    * Constants are never relocated and are excluded. The result is sorted to keep our IR stable.
+    */
+  private def irValuesToRoot(state: GenerationState, liveTemps: Set[ps.TempValue]) =
+    liveTemps.toList.flatMap({ tempValue =>
+      state.liveTemps.get(tempValue) match {
+        case Some(_: IrConstant) | None =>
+          None
+
+        case Some(irValue) =>
+          cellTypesByIrType.get(irValue.irType).map(cellType => (irValue, cellType, tempValue))
+      }
+    }).groupBy(_._1).toList.map({ case (irValue, rootedTemps) =>
+      (irValue, rootedTemps.head._2, rootedTemps.map(_._3))
+    }).sortBy(_._1.toIr)
+
+  private def genPointerToRootSlot(block: IrBlockBuilder)(rootSlots: GcRootSlots, index: Int): IrValue =
+    block.getelementptr("gcRootSlotPtr")(
+      elementType=anyCellPointerIrType,
+      basePointer=rootSlots.cellRefs,
+      indices=List(IntegerConstant(IntegerType(32), index)),
+      inbounds=true
+    )
+
+  /** Generates a safe-point rooting the passed live temp values
+    *
+    * @param  block         Block to generate the safe-point in
+    * @param  state         Generation state before the safe-point
+    * @param  liveTemps     Temp values used after the safe-point
+    * @param  genSafePoint  Generates the code that may collect garbage in block
+    * @return Result of genSafePoint and the temp values reloaded after the safe-point
+    */
+  def apply[T](block: IrBlockBuilder, state: GenerationState, liveTemps: Set[ps.TempValue])(
+      genSafePoint: => T
+  ): (T, Map[ps.TempValue, IrValue]) = {
+    val rootedValues = irValuesToRoot(state, liveTemps)
+
+    if (rootedValues.isEmpty) {
+      // Nothing can be relocated
+      return (genSafePoint, Map())
+    }
+
+    val rootSlots = state.gcRootSlots match {
+      case Some(rootSlots) if rootSlots.slotCount >= rootedValues.length =>
+        rootSlots
+
+      case _ =>
+        throw new InternalCompilerErrorException("Insufficient root slots allocated for safe-point")
+    }
+
+    val worldPtrIr = state.liveTemps(ps.WorldPtrValue)
+
+    block.comment(s"rooting ${rootedValues.length} cells")
+
+    for(((irValue, _, _), index) <- rootedValues.zipWithIndex) {
+      val slotPtrIr = genPointerToRootSlot(block)(rootSlots, index)
+      block.store(ct.AnyCell.genPointerBitcast(block)(irValue), slotPtrIr)
+    }
+
+    val cellCountIr = IntegerConstant(IntegerType(64), rootedValues.length)
+    ShadowStackEntryValue.genStoreToCellCount(block)(cellCountIr, rootSlots.entry)
+
+    // Push our entry on to the shadow stack
+    val prevHeadIr = WorldValue.genLoadFromShadowStackHead(block)(worldPtrIr)
+    ShadowStackEntryValue.genStoreToNext(block)(prevHeadIr, rootSlots.entry)
+    WorldValue.genStoreToShadowStackHead(block)(rootSlots.entry, worldPtrIr)
+
+    val result = genSafePoint
+
+    // Pop our entry and reload our cells
+    // Exceptions skip this; anything catching them is responsible for restoring the shadow stack
+    WorldValue.genStoreToShadowStackHead(block)(prevHeadIr, worldPtrIr)
+
+    val reloadedTemps = rootedValues.zipWithIndex.flatMap({ case ((_, cellType, rootedTemps), index) =>
+      val slotPtrIr = genPointerToRootSlot(block)(rootSlots, index)
+      val reloadedIr = cellType.genPointerBitcast(block)(block.load("reloadedCell")(slotPtrIr))
+
+      rootedTemps.map(_ -> reloadedIr)
+    }).toMap
+
+    (result, reloadedTemps)
+  }
+
+  /** Phis any temp values that differ between the predecessors of a block
+    *
+    * This is used to merge temp values reloaded by a safe-point on only some paths to the block
+    *
+    * @param  phiBlock      Block to phi the temp values in. This must not contain any non-phi instructions.
+    * @param  tempValues    Temp values to consider
+    * @param  predecessors  Live temp values at the end of each predecessor block
+    * @return Phied temp values. Temp values with the same value in every predecessor are not included.
+    */
+  def genTempPhis(phiBlock: IrChildBlockBuilder)(
+      tempValues: Iterable[ps.TempValue],
+      predecessors: (Map[ps.TempValue, IrValue], IrBlockBuilder)*
+  ): Map[ps.TempValue, IrValue] = {
+    val tempsBySources = tempValues.toList.groupBy({ tempValue =>
+      predecessors.toList.map({ case (liveTemps, _) => liveTemps(tempValue) })
+    }).filter(_._1.distinct.length > 1)
+
+    tempsBySources.toList.sortBy(_._1.map(_.toIr).mkString(",")).flatMap({ case (sourceValues, phiedTemps) =>
+      val phiSources = sourceValues.zip(predecessors).map({ case (sourceValue, (_, predBlock)) =>
+        PhiSource(sourceValue, predBlock)
+      })
+
+      val phiIr = phiBlock.phi("reloadedPhi")(phiSources: _*)
+      phiedTemps.map(_ -> phiIr)
+    }).toMap
+  }
+
+  /** Polls for a pending garbage collection
+    *
+    * The World's poll flag is checked inline and the runtime is only called once a collection has been requested
+    *
+    * @param  state      Generation state before the poll
+    * @param  liveTemps  Temp values used after the poll
+    * @return Generation state after the poll
+    */
+  def genPoll(state: GenerationState)(liveTemps: Set[ps.TempValue]): GenerationState = {
+    val block = state.currentBlock
+    val irFunction = block.function
+    val module = irFunction.module
+    val gcPollDecl = RuntimeFunctions.gcPoll
+
+    module.unlessDeclared(gcPollDecl) {
+      module.declareFunction(gcPollDecl)
+    }
+
+    val worldPtrIr = state.liveTemps(ps.WorldPtrValue)
+
+    val pollRequestedIr = WorldValue.genLoadFromGcPollRequested(block)(worldPtrIr)
+    val pollPred = block.icmp("gcPollPred")(IComparisonCond.NotEqual, None, pollRequestedIr, IntegerConstant(IntegerType(8), 0))
+
+    val gcPollBlock = irFunction.startChildBlock("gcPoll")
+    val gcPollDoneBlock = irFunction.startChildBlock("gcPollDone")
+
+    block.condBranch(pollPred, gcPollBlock, gcPollDoneBlock)
+
+    val (_, reloadedTemps) = apply(gcPollBlock, state, liveTemps) {
+      gcPollBlock.callDecl(None)(gcPollDecl, List(worldPtrIr))
+    }
+
+    gcPollBlock.uncondBranch(gcPollDoneBlock)
+
+    val phiedTemps = genTempPhis(gcPollDoneBlock)(
+      reloadedTemps.keys,
+      (state.liveTemps, block),
+      (state.liveTemps ++ reloadedTemps, gcPollBlock)
+    )
+
+    state.copy(
+      currentBlock=gcPollDoneBlock,
+      liveTemps=state.liveTemps ++ phiedTemps
+    )
+  }
+}
@@ -18,6 +18,15 @@ object RuntimeFunctions {
     attributes=Set(NoUnwind, Cold)
   )
 
+  val gcPoll = IrFunctionDecl(
+    result=Result(VoidType),
+    name="llcore_gc_poll",
+    arguments=List(
+      Argument(PointerType(WorldValue.irType))
+    ),
+    attributes=Set(NoUnwind, Cold)
+  )
+
   val signalError = IrFunctionDecl(
     result=IrFunction.Result(VoidType),
     name="llcore_signal_error",
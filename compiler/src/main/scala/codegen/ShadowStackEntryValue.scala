@@ -0,0 +1,33 @@
+package io.llambda.compiler.codegen
+import io.llambda
+
+import llambda.llvmir._
+import llambda.compiler.{celltype => ct}
+
+/** Helper functions related to alloc::ShadowStackEntry in the runtime */
+object ShadowStackEntryValue extends StructureValue("shadowStackEntry") {
+  val nextField = StructureField(
+    name="next",
+    index=0,
+    irType=PointerType(irType),
+    tbaaNode=NumberedMetadata(7)
+  )
+
+  val cellRefsField = StructureField(
+    name="cellRefs",
+    index=1,
+    irType=PointerType(PointerType(ct.AnyCell.irType)),
+    tbaaNode=NumberedMetadata(8)
+  )
+
+  val cellCountField = StructureField(
+    name="cellCount",
+    index=2,
+    irType=IntegerType(64),
+    tbaaNode=NumberedMetadata(9)
+  )
+
+  def genStoreToNext = genStoreToField(nextField)_
+  def genStoreToCellRefs = genStoreToField(cellRefsField)_
+  def genStoreToCellCount = genStoreToField(cellCountField)_
+}
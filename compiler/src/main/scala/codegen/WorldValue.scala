@@ -7,20 +7,39 @@ import llambda.llvmir._
 object WorldValue extends StructureValue("world") {
   val cellPointerIrType = PointerType(UserDefinedType("cell"))
 
+  val shadowStackHeadField = StructureField(
+    name="shadowStackHead",
+    index=0,
+    irType=PointerType(ShadowStackEntryValue.irType),
+    tbaaNode=NumberedMetadata(5)
+  )
+
+  val gcPollRequestedField = StructureField(
+    name="gcPollRequested",
+    index=1,
+    irType=IntegerType(8),
+    tbaaNode=NumberedMetadata(6)
+  )
+
   val allocNextField = StructureField(
     name="allocNext",
-    index=0,
+    index=2,
     irType=cellPointerIrType,
     tbaaNode=NumberedMetadata(2)
   )
 
   val allocEndField = StructureField(
     name="allocEnd",
-    index=1,
+    index=3,
     irType=cellPointerIrType,
     tbaaNode=NumberedMetadata(3)
   )
 
+  def genLoadFromShadowStackHead = genLoadFromField(shadowStackHeadField)_
+  def genStoreToShadowStackHead = genStoreToField(shadowStackHeadField)_
+
+  def genLoadFromGcPollRequested = genLoadFromField(gcPollRequestedField)_
+
   def genPointerToAllocNext = genPointerToField(allocNextField)_
   def genLoadFromAllocNext = genLoadFromField(allocNextField)_
   def genStoreToAllocNext = genStoreToField(allocNextField)_
@@ -25,6 +25,7 @@ object ErrorCategory {
   object ExpiredEscapeProcedure extends ErrorCategory(16)
   object AskTimeout extends ErrorCategory(17)
   object Match extends ErrorCategory(18)
+  object MailboxFull extends ErrorCategory(19)
 
   def fromPredicate: PartialFunction[String, ErrorCategory] = {
     case "default-error?" => Default
@@ -46,5 +47,6 @@ object ErrorCategory {
     case "expired-escape-procedure-error?" => ExpiredEscapeProcedure
     case "ask-timeout-error?" => AskTimeout
     case "match-error?" => Match
+    case "mailbox-full-error?" => MailboxFull
   }
 }
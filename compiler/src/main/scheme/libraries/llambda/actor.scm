@@ -4,9 +4,10 @@
   (import (llambda typed))
   (import (llambda duration))
 
-  (export act tell forward ask self sender stop graceful-stop mailbox? mailbox-open? poison-pill-object
-          poison-pill-object? become set-supervisor-strategy schedule-once <mailbox> <behaviour> <failure-action>
-          <supervisor-strategy> <poison-pill-object>)
+  (export act act-pool act-bounded tell tell! forward ask self sender stop graceful-stop mailbox? mailbox-open?
+          mailbox-queue-depth mailbox-dropped-count poison-pill-object poison-pill-object? become set-supervisor-strategy
+          schedule-once schedule-every cancel-timer <mailbox> <behaviour> <failure-action> <supervisor-strategy> <poison-pill-object>
+          <routing-strategy> <overflow-policy>)
 
   (begin
     (define-native-library llactor (static-library "ll_llambda_actor"))
@@ -20,9 +21,14 @@
     (define stop-enum-value 2)
 
     (define-type <behaviour> (-> <any> <unit>))
+    (define-type <routing-strategy> (U 'round-robin 'random 'least-loaded))
+    (define-type <overflow-policy> (U 'block 'drop-newest 'drop-oldest 'fail))
 
     (define act (world-function llactor "llactor_act" (-> (-> <behaviour>) <mailbox>)))
+    (define act-pool (world-function llactor "llactor_act_pool" (-> <native-int64> (-> <behaviour>) <routing-strategy> <mailbox>)))
+    (define act-bounded (world-function llactor "llactor_act_bounded" (-> <native-int64> (-> <behaviour>) <overflow-policy> <mailbox>)))
     (define tell (world-function llactor "llactor_tell" (-> <mailbox> <any> <unit>)))
+    (define tell! (world-function llactor "llactor_moving_tell" (-> <mailbox> <any> <unit>)))
     (define forward (world-function llactor "llactor_forward" (-> <mailbox> <any> <unit>)))
     (define ask (world-function llactor "llactor_ask" (-> <mailbox> <any> <native-int64> <any>)))
     (define self (world-function llactor "llactor_self" (-> <mailbox>)))
@@ -32,6 +38,8 @@
 
     (define-predicate mailbox? <mailbox>)
     (define mailbox-open? (world-function llactor "llactor_mailbox_is_open" (-> <mailbox> <native-bool>)))
+    (define mailbox-queue-depth (native-function llactor "llactor_mailbox_queue_depth" (-> <mailbox> <native-int64>)))
+    (define mailbox-dropped-count (native-function llactor "llactor_mailbox_dropped_count" (-> <mailbox> <native-int64>)))
 
     (define-type <poison-pill-object> (ExternalRecord (native-function llactor "llactor_is_poison_pill_object" (-> <any> <native-bool>))))
     (define poison-pill-object (native-function llactor "llactor_poison_pill_object" (-> <poison-pill-object>)))
@@ -41,4 +49,6 @@
 
     (define set-supervisor-strategy (world-function llactor "llactor_set_supervisor_strategy" (-> <supervisor-strategy> <unit>)))
 
-    (define schedule-once (world-function llactor "llactor_schedule_once" (-> <native-int64> <mailbox> <any> <unit>)))))
+    (define schedule-once (world-function llactor "llactor_schedule_once" (-> <native-int64> <mailbox> <any> <native-int64>)))
+    (define schedule-every (world-function llactor "llactor_schedule_every" (-> <native-int64> <mailbox> <any> <native-int64>)))
+    (define cancel-timer (native-function llactor "llactor_cancel_timer" (-> <native-int64> <native-bool>)))))
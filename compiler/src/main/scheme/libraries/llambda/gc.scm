@@ -0,0 +1,10 @@
+(define-library (llambda gc)
+  (import (llambda nfi))
+  (import (rename (llambda internal primitives) (define-stdlib-procedure define-stdlib)))
+
+  (export gc-statistics)
+
+  (begin
+    (define-native-library llgc (static-library "ll_llambda_gc"))
+
+    (define-stdlib gc-statistics (world-function llgc "llgc_gc_statistics" (-> (Listof (Pairof <symbol> <integer>)))))))
@@ -6,7 +6,8 @@
 
   (export hash-map? make-hash-map alist->hash-map hash-map-size hash-map-assoc hash-map-delete hash-map-exists?
           hash-map-ref/default hash-map-ref hash-map->alist hash-map-keys hash-map-values hash-map-for-each
-          hash-map-fold hash-map-merge hash)
+          hash-map-fold hash-map-merge hash-map-merge-with hash-map-intersection hash-map-difference hash
+          <transient-hash-map> hash-map-transient transient-hash-map? hash-map-assoc! hash-map-delete! persistent!)
 
   (begin
     (define-native-library llhashmap (static-library "ll_llambda_hashmap"))
@@ -38,6 +39,17 @@
     (define hash-map-for-each (world-function llhashmap "llhashmap_hash_map_for_each" (-> (-> <any> <any> <unit>) AnyHashMap <unit>)))
     (define hash-map-fold (world-function llhashmap "llhashmap_hash_map_fold" (All (A) (-> <any> <any> <any> A) A AnyHashMap A)))
     (define hash-map-merge (world-function llhashmap "llhashmap_hash_map_merge" (All (K V) (-> (HashMap K V) (HashMap K V) (HashMap K V)))))
+    (define hash-map-merge-with (world-function llhashmap "llhashmap_hash_map_merge_with" (All (K V) (-> (-> <any> <any> <any> V) (HashMap K V) (HashMap K V) (HashMap K V)))))
+    (define hash-map-intersection (world-function llhashmap "llhashmap_hash_map_intersection" (All (K V) (-> (HashMap K V) AnyHashMap (HashMap K V)))))
+    (define hash-map-difference (world-function llhashmap "llhashmap_hash_map_difference" (All (K V) (-> (HashMap K V) AnyHashMap (HashMap K V)))))
+
+    (define-type <transient-hash-map> (ExternalRecord (native-function llhashmap "llhashmap_is_transient_hash_map" (-> <any> <native-bool>))))
+    (define-predicate transient-hash-map? <transient-hash-map>)
+
+    (define hash-map-transient (world-function llhashmap "llhashmap_hash_map_transient" (-> AnyHashMap <transient-hash-map>)))
+    (define hash-map-assoc! (world-function llhashmap "llhashmap_hash_map_assoc_mut" (-> <transient-hash-map> <any> <any> <unit>)))
+    (define hash-map-delete! (world-function llhashmap "llhashmap_hash_map_delete_mut" (-> <transient-hash-map> <any> <unit>)))
+    (define persistent! (world-function llhashmap "llhashmap_persistent" (-> <transient-hash-map> AnyHashMap)))
 
     (define native-hash (native-function llhashmap "llhashmap_hash" (-> <any> <native-int64> <native-uint32>) nocapture))
     (define (hash value [bound : <integer> (expt 2 32)])
@@ -223,7 +223,205 @@
   (define same-elem-vec (ping-pong (vector test-vec test-vec test-vec)))
 
   (assert-true (eqv? (vector-ref same-elem-vec 0) (vector-ref same-elem-vec 1)))
-  (assert-true (eqv? (vector-ref same-elem-vec 1) (vector-ref same-elem-vec 2)))))
+  (assert-true (eqv? (vector-ref same-elem-vec 1) (vector-ref same-elem-vec 2)))
+
+  ; Cyclic references are preserved
+  (define-record-type <cyclic-record> (cyclic-record next) cyclic-record?
+                      (next cyclic-record-next set-cyclic-record-next!))
+
+  (define test-cyclic-record (cyclic-record #f))
+  (set-cyclic-record-next! test-cyclic-record (vector test-cyclic-record))
+
+  (define cloned-cyclic-record (ping-pong test-cyclic-record))
+
+  (assert-true (eqv? cloned-cyclic-record (vector-ref (cyclic-record-next cloned-cyclic-record) 0)))
+  (assert-false (eqv? test-cyclic-record cloned-cyclic-record))))
+
+(define-test "(tell!) moves values" (expect-success
+  (import (llambda actor))
+  (import (llambda typed))
+  (import (llambda duration))
+  (import (llambda hash-map))
+
+  (define collector
+    (act (lambda ()
+           (define last-msg #f)
+
+           (lambda (msg)
+             (if (equal? 'query msg)
+               (tell (sender) last-msg)
+               (set! last-msg msg))))))
+
+  (define (tell-and-query val)
+    (tell! collector val)
+    (ask collector 'query (seconds 2)))
+
+  ; Constants aren't moved
+  (assert-equal '(a b c d e) (tell-and-query '(a b c d e)))
+
+  (define (make-test-vec)
+    (define shared-string (make-string 3 #\*))
+    (vector shared-string (list 1 2 (typeless-cell 3)) shared-string))
+
+  (define moved-vec (tell-and-query (make-test-vec)))
+  (assert-equal #("***" (1 2 3) "***") moved-vec)
+
+  ; Moving preserves (eqv?)
+  (assert-true (eqv? (vector-ref moved-vec 0) (vector-ref moved-vec 2)))
+
+  ; Hash maps
+  (define test-hash-map (alist->hash-map (list (cons 'one (make-string 1 #\1)) '(two . 2))))
+  (assert-equal (alist->hash-map '((one . "1") (two . 2))) (tell-and-query test-hash-map))
+
+  ; Values that can't be moved are cloned instead
+  (define moved-port (tell-and-query (current-output-port)))
+  (assert-equal (current-output-port) moved-port)))
+
+(define-test "(act-pool)" (expect-success
+  (import (llambda actor))
+  (import (llambda duration))
+
+  (define (self-reporter)
+    (lambda (msg)
+      (tell (sender) (self))))
+
+  ; Round robin visits every member in turn
+  (define round-robin-pool (act-pool 3 self-reporter 'round-robin))
+  (assert-true (mailbox? round-robin-pool))
+
+  (define members (map (lambda (_) (ask round-robin-pool 'report (seconds 2))) (make-list 6)))
+
+  (assert-false (equal? (list-ref members 0) (list-ref members 1)))
+  (assert-false (equal? (list-ref members 1) (list-ref members 2)))
+  (assert-false (equal? (list-ref members 0) (list-ref members 2)))
+  (assert-equal (list-ref members 0) (list-ref members 3))
+  (assert-equal (list-ref members 1) (list-ref members 4))
+  (assert-equal (list-ref members 2) (list-ref members 5))
+
+  ; Stopping the pool stops every member
+  (assert-true (graceful-stop round-robin-pool))
+  (assert-false (mailbox-open? round-robin-pool))
+  (assert-false (mailbox-open? (car members)))
+
+  ; Every message is handled with the other strategies
+  (define (doubler)
+    (lambda (msg)
+      (tell (sender) (* msg 2))))
+
+  (for-each (lambda (strategy)
+              (define pool (act-pool 4 doubler strategy))
+
+              (assert-equal '(2 4 6 8 10 12 14 16)
+                            (map (lambda (n) (ask pool n (seconds 2))) '(1 2 3 4 5 6 7 8)))
+
+              (assert-true (graceful-stop pool)))
+            '(random least-loaded))))
+
+(define-test "(act-pool) with no members fails" (expect-error range-error?
+  (import (llambda actor))
+
+  (act-pool 0 (lambda () (lambda (msg))) 'round-robin)))
+
+(define-test "(act-bounded)" (expect-success
+  (import (llambda actor))
+  (import (llambda duration))
+  (import (llambda error))
+
+  ; This stays busy on 'wait until a message has been dropped so we can reliably fill its mailbox
+  (define (summer)
+    (define sum 0)
+    (lambda (msg)
+      (cond
+        ((equal? msg 'wait)
+         (let loop ()
+           (when (zero? (mailbox-dropped-count (self)))
+             (loop))))
+        ((equal? msg 'query)
+         (tell (sender) sum))
+        (else
+          (set! sum (+ sum msg))))))
+
+  (define (fill-and-overflow actor)
+    (tell actor 'wait)
+
+    ; Wait for our actor to take the 'wait message
+    (let loop ()
+      (unless (zero? (mailbox-queue-depth actor))
+        (loop)))
+
+    (tell actor 1)
+    (tell actor 2)
+    (assert-equal 2 (mailbox-queue-depth actor))
+
+    (guard (obj
+             ((mailbox-full-error? obj) 'failed))
+           (tell actor 4)))
+
+  (define drop-newest-actor (act-bounded 2 summer 'drop-newest))
+  (assert-equal 0 (mailbox-dropped-count drop-newest-actor))
+
+  (fill-and-overflow drop-newest-actor)
+  (assert-equal 1 (mailbox-dropped-count drop-newest-actor))
+  (assert-equal 3 (ask drop-newest-actor 'query (seconds 2)))
+
+  (define drop-oldest-actor (act-bounded 2 summer 'drop-oldest))
+  (fill-and-overflow drop-oldest-actor)
+  (assert-equal 6 (ask drop-oldest-actor 'query (seconds 2)))
+
+  (define fail-actor (act-bounded 2 summer 'fail))
+  (assert-equal 'failed (fill-and-overflow fail-actor))
+  (assert-equal 1 (mailbox-dropped-count fail-actor))
+  (assert-equal 3 (ask fail-actor 'query (seconds 2)))
+
+  ; Blocking senders wait for the receiver instead of losing messages
+  (define block-actor (act-bounded 1 summer 'block))
+  (for-each (lambda (n) (tell block-actor n)) '(1 2 3 4 5))
+  (assert-equal 15 (ask block-actor 'query (seconds 2)))
+  (assert-equal 0 (mailbox-dropped-count block-actor))))
+
+(define-test "(act-bounded) with no capacity fails" (expect-error range-error?
+  (import (llambda actor))
+
+  (act-bounded 0 (lambda () (lambda (msg))) 'block)))
+
+(define-test "(act-bounded) 'drop-oldest never drops supervision messages" (expect-success
+  (import (llambda actor))
+  (import (llambda duration))
+
+  (define supervisor
+    (act-bounded 1 (lambda ()
+      (define child
+        (act (lambda ()
+               (lambda (msg)
+                 (raise "FAILURE")))))
+
+      (define strategy-called #f)
+      (define requester #f)
+
+      (set-supervisor-strategy (lambda (err)
+                                 (set! strategy-called #t)
+                                 'resume))
+
+      (lambda (msg)
+        (cond
+          ((equal? msg 'go)
+           (set! requester (sender))
+           (tell child 'fail)
+
+           ; Wait for our child's failure to be queued
+           (let loop ()
+             (when (zero? (mailbox-queue-depth (self)))
+               (loop)))
+
+           ; The failure doesn't count towards our capacity so only the first of these should be dropped
+           (tell (self) 'dropped)
+           (tell (self) 'reply))
+          ((equal? msg 'reply)
+           (tell requester strategy-called)))))
+      'drop-oldest))
+
+  (assert-equal #t (ask supervisor 'go (seconds 2)))
+  (assert-equal 1 (mailbox-dropped-count supervisor))))
 
 (define-test "concurrent actor startup and shutdown" (expect-success
   (import (llambda typed))
@@ -677,3 +875,40 @@
 
   (define result (ask test-actor 'get-result (milliseconds 250)))
   (assert-equal '(0 1 2 3 4 5) result)))
+
+(define-test "(schedule-every)" (expect-success
+  (import (llambda actor))
+  (import (llambda duration))
+
+  (define test-actor (act
+                       (lambda ()
+                         (define tick-count 0)
+                         (define cancel-results #f)
+                         (define result #f)
+                         (define result-sender #f)
+                         (define timer-id (schedule-every (milliseconds 5) (self) 'tick))
+                         (define cancelled-once-id (schedule-once (milliseconds 10) (self) 'cancelled))
+
+                         (cancel-timer cancelled-once-id)
+
+                         (lambda (msg)
+                           (cond
+                             ((equal? msg 'get-result)
+                              (if result
+                                (tell (sender) result)
+                                (set! result-sender (sender))))
+                             ((and (equal? msg 'tick) (not cancel-results))
+                              (set! tick-count (+ tick-count 1))
+                              (when (= tick-count 3)
+                                ; The second cancel should find nothing to cancel
+                                (set! cancel-results (list (cancel-timer timer-id) (cancel-timer timer-id)))
+                                ; Give any stray timers a chance to arrive
+                                (schedule-once (milliseconds 30) (self) 'done)))
+                             ((equal? msg 'cancelled)
+                              (set! tick-count -1))
+                             ((equal? msg 'done)
+                              (set! result (list tick-count cancel-results))
+                              (when result-sender
+                                (tell result-sender result))))))))
+
+  (assert-equal '(3 (#t #f)) (ask test-actor 'get-result (seconds 1)))))
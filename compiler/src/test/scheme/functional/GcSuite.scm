@@ -0,0 +1,75 @@
+(define-test "(gc-statistics)" (expect-success
+  (import (llambda gc))
+  (define stats (gc-statistics))
+
+  (assert-true (list? stats))
+
+  (for-each (lambda (entry)
+              (assert-true (symbol? (car entry)))
+              (assert-true (integer? (cdr entry)))
+              (assert-true (>= (cdr entry) 0))) stats)
+
+  (assert-true (pair? (assq 'minor-collections stats)))
+  (assert-true (pair? (assq 'full-collections stats)))
+  (assert-true (pair? (assq 'peak-heap-bytes stats)))))
+
+(define-test "(gc-statistics) counts collections" (expect-success
+  (import (llambda gc))
+
+  (define (collection-count)
+    (let ((stats (gc-statistics)))
+      (+ (cdr (assq 'minor-collections stats)) (cdr (assq 'full-collections stats)))))
+
+  (define initial-count (collection-count))
+
+  ; Allocate enough garbage to trigger a collection
+  (define total-length
+    (let loop ((i 0) (acc 0))
+      (if (< i 100)
+        (loop (+ i 1) (+ acc (length (make-list 10000))))
+        acc)))
+
+  (assert-equal 1000000 total-length)
+
+  (assert-true (> (collection-count) initial-count))))
+
+(define-test "live values survive collections in loops" (expect-success
+  (import (llambda gc))
+
+  (define (collection-count)
+    (let ((stats (gc-statistics)))
+      (+ (cdr (assq 'minor-collections stats)) (cdr (assq 'full-collections stats)))))
+
+  (define (build-structure count)
+    (let loop ((i 0) (acc '()))
+      (if (< i count)
+        (loop (+ i 1) (cons (vector i (number->string i) (list i (* i 2))) acc))
+        acc)))
+
+  (define (structure-intact? structure count)
+    (let loop ((remaining structure) (i (- count 1)))
+      (if (null? remaining)
+        (= i -1)
+        (let ((entry (car remaining)))
+          (and (= (vector-ref entry 0) i)
+               (equal? (vector-ref entry 1) (number->string i))
+               (equal? (vector-ref entry 2) (list i (* i 2)))
+               (loop (cdr remaining) (- i 1)))))))
+
+  (define initial-count (collection-count))
+
+  ; Both the structure and the loop's accumulator must stay reachable while garbage is allocated
+  (define structure (build-structure 10000))
+
+  (define total-length
+    (let loop ((i 0) (acc 0) (last-list '()))
+      (if (< i 200)
+        (let ((garbage (make-list 10000 structure)))
+          (loop (+ i 1) (+ acc (length garbage)) garbage))
+        (begin
+          (assert-true (eq? structure (car last-list)))
+          acc))))
+
+  (assert-equal 2000000 total-length)
+  (assert-true (> (collection-count) (+ initial-count 1)))
+  (assert-true (structure-intact? structure 10000))))
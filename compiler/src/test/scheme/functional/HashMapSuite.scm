@@ -201,6 +201,75 @@
   (assert-equal 4 (hash-map-size actual-hash-map))
   (assert-equal actual-hash-map expected-hash-map)))
 
+(define-test "(hash-map-merge-with)" (expect-success
+  (import (llambda hash-map))
+  (import (llambda typed))
+
+  (define source-hash-map-1 (alist->hash-map '((1 . 1) (2 . 2) (3 . 3))))
+  (define source-hash-map-2 (alist->hash-map '((1 . 10) (3 . 30) (4 . 40))))
+
+  (define actual-hash-map (hash-map-merge-with (lambda (key source-value override-value)
+                                                 (+ key source-value override-value))
+                                               source-hash-map-1 source-hash-map-2))
+
+  (assert-equal (alist->hash-map '((1 . 12) (2 . 2) (3 . 36) (4 . 40))) actual-hash-map)))
+
+(define-test "(hash-map-intersection)" (expect-success
+  (import (llambda hash-map))
+  (import (llambda typed))
+
+  (define source-hash-map (alist->hash-map '((1 . one) (2 . two) (3 . three))))
+  (define key-hash-map (alist->hash-map '((1 . #t) (3 . #t) (4 . #t))))
+
+  (define actual-hash-map (hash-map-intersection source-hash-map key-hash-map))
+  (ann actual-hash-map (HashMap <integer> <symbol>))
+
+  (assert-equal (alist->hash-map '((1 . one) (3 . three))) actual-hash-map)
+  (assert-equal (make-hash-map) (hash-map-intersection source-hash-map (make-hash-map)))))
+
+(define-test "(hash-map-difference)" (expect-success
+  (import (llambda hash-map))
+  (import (llambda typed))
+
+  (define source-hash-map (alist->hash-map '((1 . one) (2 . two) (3 . three))))
+  (define key-hash-map (alist->hash-map '((1 . #t) (3 . #t) (4 . #t))))
+
+  (define actual-hash-map (hash-map-difference source-hash-map key-hash-map))
+  (ann actual-hash-map (HashMap <integer> <symbol>))
+
+  (assert-equal (alist->hash-map '((2 . two))) actual-hash-map)
+  (assert-equal source-hash-map (hash-map-difference source-hash-map (make-hash-map)))))
+
+(define-test "transient hash maps" (expect-success
+  (import (llambda hash-map))
+  (import (llambda error))
+
+  (define source-hash-map (alist->hash-map '((1 . one) (2 . two))))
+  (define transient (hash-map-transient source-hash-map))
+
+  (assert-true (transient-hash-map? transient))
+  (assert-false (transient-hash-map? source-hash-map))
+  (assert-false (hash-map? transient))
+
+  (hash-map-assoc! transient 1 'uno)
+  (hash-map-assoc! transient 3 'tres)
+  (hash-map-delete! transient 2)
+  (hash-map-delete! transient 4)
+
+  (define result-hash-map (persistent! transient))
+
+  (assert-equal (alist->hash-map '((1 . uno) (3 . tres))) result-hash-map)
+
+  ; The source hash map should be unmodified
+  (assert-equal (alist->hash-map '((1 . one) (2 . two))) source-hash-map)
+
+  ; The transient can't be used after it's been made persistent
+  (assert-raises invalid-argument-error?
+    (hash-map-assoc! transient 5 'cinco))
+
+  (assert-raises invalid-argument-error?
+    (persistent! transient))))
+
 (define-test "(hash)" (expect-success
   (import (llambda hash-map))
   (import (llambda typed))
@@ -6,10 +6,12 @@ namespace lliby
 namespace actor
 {
 
-ActorContext::ActorContext(ActorClosureCell *closure, const std::weak_ptr<Mailbox> &supervisor) :
-	m_mailbox(std::make_shared<Mailbox>()),
+ActorContext::ActorContext(ActorClosureCell *closure, const std::weak_ptr<Mailbox> &supervisor, const std::shared_ptr<Mailbox> &mailbox,
+		std::size_t homeWorker) :
+	m_mailbox(mailbox),
 	m_closure(closure),
-	m_supervisor(supervisor)
+	m_supervisor(supervisor),
+	m_homeWorker(homeWorker)
 {
 }
 
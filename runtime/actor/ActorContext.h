@@ -2,10 +2,13 @@
 #define _LLIBY_ACTOR_ACTORCONTEXT_H
 
 #include <memory>
+#include <deque>
+#include <cstddef>
 
 #include "actor/ActorClosureCell.h"
 #include "actor/ActorBehaviourCell.h"
 #include "actor/SupervisorStrategyCell.h"
+#include "actor/Message.h"
 
 namespace lliby
 {
@@ -13,13 +16,26 @@ namespace actor
 {
 class Mailbox;
 
+/**
+ * Message received by an actor that hasn't been processed yet
+ *
+ * The message's heap has already been spliced in to the actor's world
+ */
+struct ReceivedMessage
+{
+	AnyCell *messageCell;
+	Message::Type type;
+	std::weak_ptr<Mailbox> sender;
+};
+
 /**
  * Context for a running actor
  */
 class ActorContext
 {
 public:
-	ActorContext(ActorClosureCell *closure, const std::weak_ptr<Mailbox> &supervisor);
+	ActorContext(ActorClosureCell *closure, const std::weak_ptr<Mailbox> &supervisor, const std::shared_ptr<Mailbox> &mailbox,
+			std::size_t homeWorker);
 
 	/**
 	 * Returns the current mailbox for this world
@@ -127,6 +143,24 @@ public:
 		return m_supervisor;
 	}
 
+	/**
+	 * Returns the messages received from our mailbox but not yet processed in receive order
+	 *
+	 * The message cells are rooted by the garbage collector
+	 */
+	std::deque<ReceivedMessage>& receivedMessages()
+	{
+		return m_receivedMessages;
+	}
+
+	/**
+	 * Returns the index of the dispatcher worker this actor prefers to run on
+	 */
+	std::size_t homeWorker() const
+	{
+		return m_homeWorker;
+	}
+
 private:
 	// This is lazily initialised on first use
 	mutable std::shared_ptr<actor::Mailbox> m_mailbox;
@@ -137,6 +171,10 @@ private:
 	SupervisorStrategyCell *m_supervisorStrategy = nullptr;
 
 	std::weak_ptr<actor::Mailbox> m_supervisor;
+
+	std::deque<ReceivedMessage> m_receivedMessages;
+
+	std::size_t m_homeWorker;
 };
 
 }
@@ -2,9 +2,11 @@
 
 #include <chrono>
 #include <atomic>
+#include <cassert>
 
 #include "alloc/collector.h"
 #include "core/World.h"
+#include "core/error.h"
 #include "sched/Dispatcher.h"
 #include "actor/Runner.h"
 
@@ -20,8 +22,21 @@ namespace
 #endif
 }
 
-Mailbox::Mailbox() :
-	m_requestedLifecycleAction(LifecycleAction::Resume)
+Mailbox::Mailbox(std::size_t capacity, OverflowPolicy overflowPolicy) :
+	m_inbox(nullptr),
+	m_receiveHead(nullptr),
+	m_queuedMessages(0),
+	m_queuedUserMessages(0),
+	m_capacity(capacity),
+	m_overflowPolicy(overflowPolicy),
+	m_droppedMessages(0),
+	m_blockedSenders(0),
+	m_sleepingReceiver(nullptr),
+	m_messageWaiter(false),
+	m_sleepingCollection(false),
+	m_lifecycleActionRequested(false),
+	m_requestedLifecycleAction(LifecycleAction::Resume),
+	m_state(State::Running)
 {
 #ifdef _LLIBY_CHECK_LEAKS
 	allocationCount++;
@@ -32,7 +47,7 @@ Mailbox::~Mailbox()
 {
 	// Free all of our messages. We don't need a lock here - if this isn't being called from the last reference we're
 	// in trouble
-	for(auto msg : m_messageQueue)
+	while(Message *msg = popMessageUnlocked())
 	{
 		delete msg;
 	}
@@ -42,79 +57,485 @@ Mailbox::~Mailbox()
 #endif
 }
 
-void Mailbox::tell(Message *message)
+std::shared_ptr<Mailbox> Mailbox::createRouter(RoutingStrategy strategy, const std::vector<std::shared_ptr<Mailbox>> &members)
 {
-	// Add to the queue
-	std::unique_lock<std::mutex> lock(m_mutex);
-	m_messageQueue.push_back(message);
+	auto router = std::make_shared<Mailbox>();
+	router->m_router.reset(new Router(strategy, members));
 
-	if (m_sleepingReceiver && (m_state == State::Running))
+	for(auto &member : members)
 	{
-		// We're waking the world; null out the sleeper
-		World *toWake = m_sleepingReceiver;
-		m_sleepingReceiver = nullptr;
+		member->m_pool = router;
+	}
 
-		lock.unlock();
+	return router;
+}
 
-		sched::Dispatcher::defaultInstance().dispatch([=] {
-			Runner::wake(toWake);
-		});
+std::size_t Mailbox::queuedMessages() const
+{
+	if (m_router)
+	{
+		std::size_t totalQueued = 0;
+
+		for(auto &memberRef : m_router->members())
+		{
+			if (std::shared_ptr<Mailbox> member = memberRef.lock())
+			{
+				totalQueued += member->queuedMessages();
+			}
+		}
+
+		return totalQueued;
 	}
-	else
+
+	return m_queuedMessages.load(std::memory_order_relaxed);
+}
+
+std::size_t Mailbox::droppedMessages() const
+{
+	if (m_router)
+	{
+		std::size_t totalDropped = 0;
+
+		for(auto &memberRef : m_router->members())
+		{
+			if (std::shared_ptr<Mailbox> member = memberRef.lock())
+			{
+				totalDropped += member->droppedMessages();
+			}
+		}
+
+		return totalDropped;
+	}
+
+	return m_droppedMessages.load(std::memory_order_relaxed);
+}
+
+void Mailbox::pushMessage(Message *message)
+{
+	// Unbounded mailboxes don't need to track their user messages
+	if ((m_capacity != 0) && (message->type() == Message::Type::User))
+	{
+		m_queuedUserMessages.fetch_add(1);
+	}
+
+	linkMessage(message);
+}
+
+bool Mailbox::reserveQueueSlot()
+{
+	std::size_t queuedUserMessages = m_queuedUserMessages.load();
+
+	do
+	{
+		if (queuedUserMessages >= m_capacity)
+		{
+			return false;
+		}
+	}
+	while(!m_queuedUserMessages.compare_exchange_weak(queuedUserMessages, queuedUserMessages + 1));
+
+	return true;
+}
+
+void Mailbox::linkMessage(Message *message)
+{
+	m_queuedMessages.fetch_add(1);
+
+	Message *inboxHead = m_inbox.load(std::memory_order_relaxed);
+
+	do
+	{
+		message->m_nextMessage = inboxHead;
+	}
+	while(!m_inbox.compare_exchange_weak(inboxHead, message));
+}
+
+bool Mailbox::enqueueMessage(Message *message)
+{
+	if ((m_capacity == 0) || (message->type() != Message::Type::User))
+	{
+		pushMessage(message);
+		return true;
+	}
+	else if (m_overflowPolicy == OverflowPolicy::DropOldest)
+	{
+		std::lock_guard<std::mutex> lock(m_receiveMutex);
+
+		if (m_queuedUserMessages.load() >= m_capacity)
+		{
+			if (Message *oldestMessage = unlinkOldestUserMessage())
+			{
+				delete oldestMessage;
+				m_droppedMessages.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		pushMessage(message);
+		return true;
+	}
+	else if (reserveQueueSlot())
+	{
+		linkMessage(message);
+		return true;
+	}
+
+	return enqueueOverflowingMessage(message);
+}
+
+bool Mailbox::enqueueOverflowingMessage(Message *message)
+{
+	switch(m_overflowPolicy)
+	{
+	case OverflowPolicy::Block:
+		if (message->sender().lock().get() == this)
+		{
+			// We're sending to ourselves; nobody else can make room
+			pushMessage(message);
+			return true;
+		}
+		else
+		{
+			// Our receiver may need this thread to make room
+			sched::Dispatcher::BlockingScope blockingScope;
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			m_blockedSenders++;
+
+			bool reserved = false;
+			m_capacityCond.wait(lock, [&] {
+				reserved = reserveQueueSlot();
+				return reserved || (m_state.load() == State::Stopped);
+			});
+
+			m_blockedSenders--;
+
+			if (reserved)
+			{
+				linkMessage(message);
+			}
+			else
+			{
+				// We've stopped; the message will be freed with the mailbox
+				pushMessage(message);
+			}
+
+			return true;
+		}
+
+	case OverflowPolicy::Fail:
+		delete message;
+		m_droppedMessages.fetch_add(1, std::memory_order_relaxed);
+		return false;
+
+	case OverflowPolicy::DropNewest:
+	case OverflowPolicy::DropOldest:
+		break;
+	}
+
+	delete message;
+	m_droppedMessages.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+void Mailbox::notifyBlockedSenders()
+{
+	// Senders increment the blocked count before checking for a free slot so either they'll see our pop or we'll see
+	// them
+	if (m_blockedSenders.load() > 0)
+	{
+		// Take the lock to make sure the sender is either before its check or waiting
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+		}
+
+		m_capacityCond.notify_all();
+	}
+}
+
+Message* Mailbox::popMessage()
+{
+	if (m_overflowPolicy == OverflowPolicy::DropOldest)
+	{
+		std::lock_guard<std::mutex> lock(m_receiveMutex);
+		return popMessageUnlocked();
+	}
+
+	return popMessageUnlocked();
+}
+
+Message* Mailbox::takeInbox()
+{
+	// Take every pushed message at once and reverse them in to delivery order
+	Message *pushed = m_inbox.exchange(nullptr);
+	Message *ordered = nullptr;
+
+	while(pushed != nullptr)
+	{
+		Message *next = pushed->m_nextMessage;
+
+		pushed->m_nextMessage = ordered;
+		ordered = pushed;
+
+		pushed = next;
+	}
+
+	return ordered;
+}
+
+void Mailbox::messageUnlinked(Message *message)
+{
+	if ((m_capacity != 0) && (message->type() == Message::Type::User))
+	{
+		m_queuedUserMessages.fetch_sub(1);
+	}
+
+	m_queuedMessages.fetch_sub(1);
+}
+
+Message* Mailbox::popMessageUnlocked()
+{
+	Message *receiveHead = m_receiveHead.load(std::memory_order_relaxed);
+
+	if (receiveHead == nullptr)
 	{
-		lock.unlock();
+		receiveHead = takeInbox();
+
+		if (receiveHead == nullptr)
+		{
+			return nullptr;
+		}
+	}
+
+	m_receiveHead.store(receiveHead->m_nextMessage, std::memory_order_relaxed);
+	messageUnlinked(receiveHead);
+
+	return receiveHead;
+}
+
+Message* Mailbox::unlinkOldestUserMessage()
+{
+	// Search the messages already in delivery order followed by any newly pushed messages
+	Message *prev = nullptr;
+	Message *msg = m_receiveHead.load(std::memory_order_relaxed);
+
+	for(bool tookInbox = false; ; tookInbox = true)
+	{
+		for(; msg != nullptr; prev = msg, msg = msg->m_nextMessage)
+		{
+			if (msg->type() == Message::Type::User)
+			{
+				if (prev == nullptr)
+				{
+					m_receiveHead.store(msg->m_nextMessage, std::memory_order_relaxed);
+				}
+				else
+				{
+					prev->m_nextMessage = msg->m_nextMessage;
+				}
+
+				messageUnlinked(msg);
+				return msg;
+			}
+		}
+
+		if (tookInbox)
+		{
+			return nullptr;
+		}
+
+		// Append the pushed messages after the messages we've already searched
+		msg = takeInbox();
+
+		if (prev == nullptr)
+		{
+			m_receiveHead.store(msg, std::memory_order_relaxed);
+		}
+		else
+		{
+			prev->m_nextMessage = msg;
+		}
+	}
+}
+
+World* Mailbox::claimSleepingReceiver(bool requireRunning)
+{
+	World *receiver = m_sleepingReceiver.load();
+
+	if ((receiver == nullptr) || (requireRunning && (m_state.load() != State::Running)))
+	{
+		return nullptr;
+	}
+
+	// Only one thread can clear the receiver
+	if (!m_sleepingReceiver.compare_exchange_strong(receiver, nullptr))
+	{
+		return nullptr;
+	}
+
+	return receiver;
+}
+
+bool Mailbox::sleepReceiver(World *receiver)
+{
+	assert(m_sleepingReceiver.load() == nullptr);
+	assert(receiver->actorContext());
+
+	m_sleepingReceiver.store(receiver);
+
+	// Senders push before checking for a sleeping receiver while we publish ourselves before checking for work. This
+	// means either they'll see us or we'll see their work.
+	if (m_lifecycleActionRequested.load() || ((m_state.load() == State::Running) && hasMessages()))
+	{
+		World *expectedReceiver = receiver;
+
+		if (m_sleepingReceiver.compare_exchange_strong(expectedReceiver, nullptr))
+		{
+			// Nobody else has claimed us
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void Mailbox::notifyMessageWaiter()
+{
+	if (m_messageWaiter.load())
+	{
+		// Take the lock to make sure the waiter is either before its check or waiting
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+		}
 
-		// Notify
 		m_messageQueueCond.notify_one();
 	}
 }
 
-void Mailbox::conditionalQueueWake(World *receiver)
+bool Mailbox::tell(Message *message)
 {
-	std::unique_lock<std::mutex> lock(m_mutex);
+	if (m_router)
+	{
+		if (std::shared_ptr<Mailbox> member = m_router->selectMember())
+		{
+			return member->tell(message);
+		}
+
+		delete message;
+		return true;
+	}
 
-	if (m_lifecycleActionRequested || (!m_messageQueue.empty() && (m_state == State::Running)))
+	if (!enqueueMessage(message))
 	{
-		lock.unlock();
+		return false;
+	}
 
-		sched::Dispatcher::defaultInstance().dispatch([=] {
-			Runner::wake(receiver);
-		});
+	if (World *toWake = claimSleepingReceiver(true))
+	{
+		Runner::queueWake(toWake);
 	}
 	else
 	{
-		m_sleepingReceiver = receiver;
+		notifyMessageWaiter();
 	}
+
+	return true;
 }
 
-Mailbox::ReceiveResult Mailbox::receive(World *sleepingReceiver, Message **msg, LifecycleAction *action)
+void Mailbox::conditionalQueueWake(World *receiver)
 {
-	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!sleepReceiver(receiver))
+	{
+		Runner::queueWake(receiver);
+	}
+}
 
-	if (m_lifecycleActionRequested)
+Mailbox::ReceiveResult Mailbox::receive(World *sleepingReceiver, std::vector<Message*> &messages,
+		std::size_t maxMessages, LifecycleAction *action, bool collectWhileAsleep)
+{
+	while(true)
 	{
-		*action = m_requestedLifecycleAction;
-		m_lifecycleActionRequested = false;
+		if (m_lifecycleActionRequested.load())
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			*action = m_requestedLifecycleAction;
+			m_lifecycleActionRequested.store(false);
+
+			return ReceiveResult::TookLifecycleAction;
+		}
+		else if (m_state.load() == State::Running)
+		{
+			// Only the first pop touches the inbox; it moves every pushed message to our private list at once
+			while(messages.size() < maxMessages)
+			{
+				Message *msg = popMessage();
+
+				if (msg == nullptr)
+				{
+					break;
+				}
+
+				messages.push_back(msg);
+			}
+
+			if (!messages.empty())
+			{
+				notifyBlockedSenders();
+				return ReceiveResult::PoppedMessages;
+			}
+		}
 
-		return ReceiveResult::TookLifecycleAction;
+		// Any waker must wait for our collection once we're visible as asleep
+		m_sleepingCollection.store(collectWhileAsleep);
+
+		if (sleepReceiver(sleepingReceiver))
+		{
+			return ReceiveResult::WentToSleep;
+		}
+
+		m_sleepingCollection.store(false);
 	}
-	else if ((m_state == State::Running) && !m_messageQueue.empty())
+}
+
+void Mailbox::sleepingCollectionFinished()
+{
 	{
-		*msg = m_messageQueue.front();
-		m_messageQueue.pop_front();
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_sleepingCollection.store(false);
+	}
+
+	m_sleepingCollectionCond.notify_all();
+}
 
-		return ReceiveResult::PoppedMessage;
+void Mailbox::waitForSleepingCollection()
+{
+	if (!m_sleepingCollection.load())
+	{
+		return;
 	}
 
-	assert(m_sleepingReceiver == nullptr);
-	assert(sleepingReceiver->actorContext());
+	// The collection may be queued behind us on the dispatcher
+	sched::Dispatcher::BlockingScope blockingScope;
 
-	m_sleepingReceiver = sleepingReceiver;
-	return ReceiveResult::WentToSleep;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_sleepingCollectionCond.wait(lock, [=]{return !m_sleepingCollection.load();});
 }
 
 AnyCell* Mailbox::ask(World &world, AnyCell *requestCell, std::int64_t timeoutUsecs)
 {
+	if (m_router)
+	{
+		std::shared_ptr<Mailbox> member = m_router->selectMember();
+
+		if (!member)
+		{
+			// There's nobody to reply
+			return nullptr;
+		}
+
+		return member->ask(world, requestCell, timeoutUsecs);
+	}
+
 	// Create a temporary mailbox
 	std::shared_ptr<actor::Mailbox> senderMailbox(std::make_shared<actor::Mailbox>());
 
@@ -122,38 +543,39 @@ AnyCell* Mailbox::ask(World &world, AnyCell *requestCell, std::int64_t timeoutUs
 	actor::Message *request = actor::Message::createFromCell(requestCell, senderMailbox);
 
 	// Send the request
+	if (!enqueueMessage(request))
 	{
-		std::unique_lock<std::mutex> receiverLock(m_mutex);
-
-		m_messageQueue.push_back(request);
-
-		if (m_sleepingReceiver && (m_state == State::Running))
-		{
-			World *toWake = m_sleepingReceiver;
-			m_sleepingReceiver = nullptr;
-
-			receiverLock.unlock();
+		signalError(world, ErrorCategory::MailboxFull, "(ask) on full mailbox");
+	}
 
-			// Synchronously wake our receiver in the hopes that it will reply immediately
-			Runner::wake(toWake);
-		}
-		else
-		{
-			receiverLock.unlock();
-			m_messageQueueCond.notify_one();
-		}
+	if (World *toWake = claimSleepingReceiver(true))
+	{
+		// Synchronously wake our receiver in the hopes that it will reply immediately
+		Runner::wake(toWake);
+	}
+	else
+	{
+		notifyMessageWaiter();
 	}
 
 	// Block on the sender mailbox for a reply
+	Message *reply;
+
 	{
+		// The receiver may need our dispatcher thread to reply
+		sched::Dispatcher::BlockingScope blockingScope;
 		std::unique_lock<std::mutex> senderLock(senderMailbox->m_mutex);
 
+		senderMailbox->m_messageWaiter.store(true);
+
 		// Wait for the sender mailbox to be non-empty
 		const std::chrono::microseconds timeout(timeoutUsecs);
 		bool hasMessage = senderMailbox->m_messageQueueCond.wait_for(senderLock, timeout, [=] {
-			return !senderMailbox->m_messageQueue.empty();
+			return senderMailbox->hasMessages();
 		});
 
+		senderMailbox->m_messageWaiter.store(false);
+
 		if (!hasMessage)
 		{
 			// We timed out
@@ -161,67 +583,85 @@ AnyCell* Mailbox::ask(World &world, AnyCell *requestCell, std::int64_t timeoutUs
 		}
 
 		// Get the message
-		Message *reply = senderMailbox->m_messageQueue.front();
-		senderMailbox->m_messageQueue.pop_front();
-
-		// Release the lock
-		senderLock.unlock();
+		reply = senderMailbox->popMessage();
+	}
 
-		// Take ownership of the heap
-		world.cellHeap.splice(reply->heap());
+	// Take ownership of the heap
+	world.cellHeap.splice(reply->heap());
 
-		// Grab the root cell and delete the message
-		AnyCell *msgCell = reply->messageCell();
-		delete reply;
+	// Grab the root cell and delete the message
+	AnyCell *msgCell = reply->messageCell();
+	delete reply;
 
-		return msgCell;
-	}
+	return msgCell;
 }
 
 void Mailbox::requestLifecycleAction(LifecycleAction action)
 {
-	std::unique_lock<std::mutex> lock(m_mutex);
-
-	if (m_lifecycleActionRequested && (action <= m_requestedLifecycleAction))
+	if (m_router)
 	{
-		// Nothing to do
+		for(auto &memberRef : m_router->members())
+		{
+			if (std::shared_ptr<Mailbox> member = memberRef.lock())
+			{
+				member->requestLifecycleAction(action);
+			}
+		}
+
 		return;
 	}
 
-	m_lifecycleActionRequested = true;
-	m_requestedLifecycleAction = action;
-
-	if (m_sleepingReceiver)
 	{
-		World *toWake = m_sleepingReceiver;
-		m_sleepingReceiver = nullptr;
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (m_lifecycleActionRequested.load() && (action <= m_requestedLifecycleAction))
+		{
+			// Nothing to do
+			return;
+		}
 
-		lock.unlock();
+		m_requestedLifecycleAction = action;
+		m_lifecycleActionRequested.store(true);
+	}
 
+	if (World *toWake = claimSleepingReceiver(false))
+	{
 		// Synchronously wake our receiver in the hopes that it will reply immediately
 		Runner::wake(toWake);
 	}
-	else
-	{
-		lock.unlock();
-		m_messageQueueCond.notify_one();
-	}
 }
 
 void Mailbox::setState(State state)
 {
 	{
 		std::lock_guard<std::mutex> lock(m_mutex);
-		m_state = state;
+		m_state.store(state);
 	}
 
 	m_stateCond.notify_all();
+
+	// Senders blocked on our capacity give up once we've stopped
+	m_capacityCond.notify_all();
 }
 
 void Mailbox::waitForStop()
 {
+	if (m_router)
+	{
+		for(auto &memberRef : m_router->members())
+		{
+			if (std::shared_ptr<Mailbox> member = memberRef.lock())
+			{
+				member->waitForStop();
+			}
+		}
+
+		return;
+	}
+
+	sched::Dispatcher::BlockingScope blockingScope;
 	std::unique_lock<std::mutex> lock(m_mutex);
-	m_stateCond.wait(lock, [=]{return m_state == State::Stopped;});
+	m_stateCond.wait(lock, [=]{return m_state.load() == State::Stopped;});
 }
 
 #ifdef _LLIBY_CHECK_LEAKS
@@ -4,10 +4,14 @@
 #include "binding/AnyCell.h"
 #include "actor/Message.h"
 #include "actor/LifecycleAction.h"
+#include "actor/Router.h"
 
 #include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <vector>
 #include <mutex>
-#include <deque>
 #include <condition_variable>
 
 namespace lliby
@@ -22,7 +26,20 @@ class Runner;
 /**
  * Mailbox for an actor
  *
- * This contains a thread-safe queue of messages for the actor
+ * This contains a thread-safe queue of messages for the actor. Senders push messages on to a lock-free intrusive
+ * stack which the receiver takes in a single exchange and reverses in to delivery order. The sleeping receiver is
+ * handed off through an atomic pointer; whichever sender clears it is responsible for waking the receiver.
+ *
+ * Lifecycle actions, state changes and blocking waits still use the mailbox's mutex as they're comparatively rare.
+ *
+ * Mailboxes can optionally be bounded. Once a bounded mailbox's capacity is reached its overflow policy determines
+ * what happens to new user messages. Supervision messages are never subject to the bound. Dropping the oldest message
+ * requires senders to reach in to the receiver's messages so those mailboxes serialise pushes and pops with a
+ * separate lock.
+ *
+ * A mailbox can also be the address of an actor pool. These router mailboxes have no receiver of their own; messages
+ * and lifecycle actions are passed directly to the pool's members. Each member holds a strong reference to its router
+ * so the router remains open until every member has stopped.
  */
 class Mailbox
 {
@@ -49,16 +66,116 @@ public:
 		Stopped
 	};
 
-	Mailbox();
+	/**
+	 * Action taken when a user message is sent to a bounded mailbox at capacity
+	 */
+	enum class OverflowPolicy
+	{
+		/**
+		 * Blocks the sender until the receiver has taken a message
+		 *
+		 * Actors sending to their own mailbox are never blocked as they would wait forever
+		 */
+		Block,
+
+		/**
+		 * Discards the message being sent
+		 */
+		DropNewest,
+
+		/**
+		 * Discards the oldest message in the mailbox to make room
+		 */
+		DropOldest,
+
+		/**
+		 * Discards the message being sent and fails the send
+		 */
+		Fail
+	};
+
+	/**
+	 * Creates a new mailbox
+	 *
+	 * @param  capacity        Maximum number of queued user messages or 0 for an unbounded mailbox
+	 * @param  overflowPolicy  Action to take when a user message is sent while at capacity
+	 */
+	explicit Mailbox(std::size_t capacity = 0, OverflowPolicy overflowPolicy = OverflowPolicy::Block);
 	~Mailbox();
 
+	/**
+	 * Creates a router mailbox for an actor pool
+	 *
+	 * @param  strategy  Strategy for selecting the member to receive each message
+	 * @param  members   Mailboxes of the running pool members. This must not be empty.
+	 */
+	static std::shared_ptr<Mailbox> createRouter(RoutingStrategy strategy, const std::vector<std::shared_ptr<Mailbox>> &members);
+
+	/**
+	 * Returns if this mailbox routes to the members of an actor pool
+	 */
+	bool isRouter() const
+	{
+		return m_router != nullptr;
+	}
+
+	/**
+	 * Returns the current state of the actor
+	 */
+	State state() const
+	{
+		return m_state.load();
+	}
+
+	/**
+	 * Returns the capacity of the mailbox or 0 if it's unbounded
+	 */
+	std::size_t capacity() const
+	{
+		return m_capacity;
+	}
+
+	/**
+	 * Returns the overflow policy of a bounded mailbox
+	 */
+	OverflowPolicy overflowPolicy() const
+	{
+		return m_overflowPolicy;
+	}
+
+	/**
+	 * Returns the number of messages queued for the receiver
+	 *
+	 * This is only a snapshot; the value may be stale by the time it's returned. Router mailboxes return the total for
+	 * their members.
+	 */
+	std::size_t queuedMessages() const;
+
+	/**
+	 * Returns the number of messages discarded or rejected due to the mailbox being at capacity
+	 *
+	 * Router mailboxes return the total for their members
+	 */
+	std::size_t droppedMessages() const;
+
+	/**
+	 * Returns if our receiver is asleep waiting for messages
+	 */
+	bool isReceiverAsleep() const
+	{
+		return m_sleepingReceiver.load(std::memory_order_relaxed) != nullptr;
+	}
+
 	/**
 	 * Pushes a message on the mailbox's message queue
 	 *
-	 * This is asynchronous; it will return as soon as the message is successfully enqueued. The mailbox takes
-	 * ownership of the message.
+	 * This is asynchronous unless the mailbox is bounded with the Block overflow policy; it will return as soon as the
+	 * message is successfully enqueued. The mailbox takes ownership of the message. Router mailboxes pass the message to
+	 * one of their members; if every member has stopped the message is discarded.
+	 *
+	 * @return False if the mailbox was at capacity with the Fail overflow policy. The message is discarded in this case.
 	 */
-	void tell(Message *);
+	bool tell(Message *);
 
 	/**
 	 * Asks the mailbox for a synchronous response
@@ -69,19 +186,22 @@ public:
 	 * @param  world         World to receive the response in
 	 * @param  requestCell   Message cell for the initial request
 	 * @param  timeoutUsecs  Ask timeout in microseconds
-	 * @return Response cell in the passed world or nullptr if the timeout was reached
+	 * @return Response cell in the passed world or nullptr if the timeout was reached. If the mailbox is at capacity
+	 *         with the Fail overflow policy a mailbox full error is signalled.
 	 */
 	AnyCell *ask(World &world, AnyCell *requestCell, std::int64_t timeoutUsecs);
 
 	/**
 	 * Request the actor peforms the specified lifecycle action
 	 *
-	 * This is used both for supervision and for stopping
+	 * This is used both for supervision and for stopping. Router mailboxes request the action from every member.
 	 */
 	void requestLifecycleAction(LifecycleAction action);
 
 	/**
 	 * Waits until this actor has stopped
+	 *
+	 * Router mailboxes wait for every member to stop
 	 */
 	void waitForStop();
 
@@ -97,22 +217,47 @@ protected:
 	enum class ReceiveResult
 	{
 		TookLifecycleAction,
-		PoppedMessage,
+		PoppedMessages,
 		WentToSleep
 	};
 
 	/**
-	 * Attempts to pop message from the message queue or take a lifecycle action
+	 * Attempts to pop a batch of messages from the message queue or take a lifecycle action
 	 *
-	 * This is non-blocking. If the message box is empty then nullptr is returned and the passed World is put to sleep
-	 * on the mailbox.
+	 * This is non-blocking. If the message box is empty then the passed World is put to sleep on the mailbox.
 	 *
 	 * @param  sleepingReceiver  World to put to sleep if there's nothing to receive
-	 * @param  msg               Out pointer to message if PoppedMessage is returned. The mailbox passes ownership to
-	 *                           the caller
+	 * @param  messages          Empty vector to fill with messages in delivery order if PoppedMessages is returned. The
+	 *                           mailbox passes ownership of the messages to the caller
+	 * @param  maxMessages       Maximum number of messages to pop. This must be non-zero
 	 * @param  action            Out pointer to the lifecycle action if TookLifecycleAction is returned
+	 * @param  collectWhileAsleep  If true and the World is put to sleep any attempt to wake it will block until
+	 *                             sleepingCollectionFinished() is called
+	 */
+	ReceiveResult receive(World *sleepingReceiver, std::vector<Message*> &messages, std::size_t maxMessages,
+			LifecycleAction *action, bool collectWhileAsleep = false);
+
+	/**
+	 * Returns if our receiver can process its next message
+	 *
+	 * This is false if a lifecycle action has been requested or the mailbox isn't running
+	 */
+	bool canProcessMessages() const
+	{
+		return !m_lifecycleActionRequested.load() && (m_state.load() == State::Running);
+	}
+
+	/**
+	 * Signals that the collection of our sleeping receiver has finished
+	 *
+	 * @sa receive
 	 */
-	ReceiveResult receive(World *sleepingReceiver, Message **msg, LifecycleAction *action);
+	void sleepingCollectionFinished();
+
+	/**
+	 * Blocks until any collection of our previously sleeping receiver has finished
+	 */
+	void waitForSleepingCollection();
 
 	/**
 	 * Sets the current state of the actor
@@ -127,17 +272,145 @@ protected:
 	void conditionalQueueWake(World *receiver);
 
 private:
+	/**
+	 * Pushes a message on to our inbox
+	 *
+	 * This is safe to call from any thread
+	 */
+	void pushMessage(Message *message);
+
+	/**
+	 * Pushes a message on to our inbox applying our capacity and overflow policy
+	 *
+	 * @return False if the message was rejected and destroyed due to the Fail overflow policy
+	 */
+	bool enqueueMessage(Message *message);
+
+	/**
+	 * Pushes a user message on to our inbox once our capacity has been reached
+	 */
+	bool enqueueOverflowingMessage(Message *message);
+
+	/**
+	 * Attempts to reserve a queue slot for a message
+	 *
+	 * Only user messages use queue slots.
+	 *
+	 * @return True if the reservation succeeded; the message must then be linked with linkMessage()
+	 */
+	bool reserveQueueSlot();
+
+	/**
+	 * Links a message with a reserved queue slot in to our inbox
+	 */
+	void linkMessage(Message *message);
+
+	/**
+	 * Wakes any senders blocked on our capacity
+	 */
+	void notifyBlockedSenders();
+
+	/**
+	 * Pops the next message for our receiver or returns nullptr if there are no messages
+	 *
+	 * This may only be called by our receiver
+	 */
+	Message* popMessage();
+
+	/**
+	 * Pops the next message without regard to the receive lock
+	 */
+	Message* popMessageUnlocked();
+
+	/**
+	 * Removes the oldest queued user message or returns nullptr if there are no user messages
+	 *
+	 * Supervision messages are skipped. This must be called while holding the receive lock.
+	 */
+	Message* unlinkOldestUserMessage();
+
+	/**
+	 * Takes every message pushed on to our inbox and returns them as a list in delivery order
+	 */
+	Message* takeInbox();
+
+	/**
+	 * Updates our queue counts after a message has been removed from our queue
+	 */
+	void messageUnlinked(Message *message);
+
+	/**
+	 * Returns if there are messages for our receiver
+	 *
+	 * This may only be called by our receiver
+	 */
+	bool hasMessages() const
+	{
+		return (m_receiveHead.load(std::memory_order_relaxed) != nullptr) || (m_inbox.load() != nullptr);
+	}
+
+	/**
+	 * Takes ownership of waking our sleeping receiver
+	 *
+	 * @param  requireRunning  Only take the receiver if we're in the running state
+	 * @return Receiver to wake or nullptr if there's no sleeping receiver or another thread is waking it
+	 */
+	World* claimSleepingReceiver(bool requireRunning);
+
+	/**
+	 * Puts the passed receiver to sleep on the mailbox
+	 *
+	 * This rechecks for messages and lifecycle actions that raced with going to sleep.
+	 *
+	 * @return True if the receiver is asleep or false if the receiver reclaimed itself and should continue receiving
+	 */
+	bool sleepReceiver(World *receiver);
+
+	/**
+	 * Notifies any thread blocked in ask() waiting for a message on this mailbox
+	 */
+	void notifyMessageWaiter();
+
+	// Messages pushed by senders in reverse order
+	std::atomic<Message*> m_inbox;
+	// Messages owned by our receiver in delivery order. Senders to a DropOldest mailbox also modify this while holding
+	// m_receiveMutex
+	std::atomic<Message*> m_receiveHead;
+	// Messages pushed but not yet popped by our receiver
+	std::atomic<std::size_t> m_queuedMessages;
+	// User messages included in m_queuedMessages. Only these count towards our capacity; this isn't maintained for
+	// unbounded mailboxes.
+	std::atomic<std::size_t> m_queuedUserMessages;
+
+	const std::size_t m_capacity;
+	const OverflowPolicy m_overflowPolicy;
+
+	std::atomic<std::size_t> m_droppedMessages;
+	std::mutex m_receiveMutex;
+
+	std::condition_variable m_capacityCond;
+	std::atomic<std::size_t> m_blockedSenders;
+
+	std::atomic<World*> m_sleepingReceiver;
+
 	std::mutex m_mutex;
 
 	std::condition_variable m_messageQueueCond;
-	std::deque<Message*> m_messageQueue;
-	World *m_sleepingReceiver = nullptr;
+	std::atomic<bool> m_messageWaiter;
 
-	bool m_lifecycleActionRequested = false;
+	std::condition_variable m_sleepingCollectionCond;
+	std::atomic<bool> m_sleepingCollection;
+
+	std::atomic<bool> m_lifecycleActionRequested;
 	LifecycleAction m_requestedLifecycleAction;
 
 	std::condition_variable m_stateCond;
-	State m_state = State::Running;
+	std::atomic<State> m_state;
+
+	// Member selection if we're a router mailbox
+	std::unique_ptr<Router> m_router;
+	// Router mailbox of the pool we're a member of
+	std::shared_ptr<Mailbox> m_pool;
 };
 
 }
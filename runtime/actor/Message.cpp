@@ -1,6 +1,12 @@
 #include "actor/Message.h"
 #include "actor/cloneCell.h"
 #include "alloc/Finalizer.h"
+#include "alloc/collector.h"
+
+#include "binding/PortCell.h"
+#include "binding/RecordLikeCell.h"
+
+#include "dynamic/ParameterProcedureCell.h"
 
 namespace lliby
 {
@@ -22,6 +28,45 @@ Message* Message::createFromCell(AnyCell *cell, const std::weak_ptr<Mailbox> &se
 	return msg;
 }
 
+Message* Message::createFromMovedCell(AnyCell *cell, const std::weak_ptr<Mailbox> &sender)
+{
+	Message *msg = new Message;
+
+	msg->m_type = Type::User;
+	msg->m_sender = sender;
+
+	// These are the cells cloneCell() would reject or need a dynamic state for. Leave them for it to report.
+	auto canMove = [] (AnyCell *cell)
+	{
+		if (PortCell::isInstance(cell) || dynamic::ParameterProcedureCell::isInstance(cell))
+		{
+			return false;
+		}
+		else if (auto recordLikeCell = cell_cast<RecordLikeCell>(cell))
+		{
+			return !recordLikeCell->isUndefined();
+		}
+
+		return true;
+	};
+
+	msg->m_messageCell = alloc::moveReachable(msg->m_heap, cell, canMove);
+
+	if (msg->m_messageCell == nullptr)
+	{
+		try
+		{
+			msg->m_messageCell = cloneCell(msg->m_heap, cell, nullptr);
+		}
+		catch(...)
+		{
+			delete msg;
+			throw;
+		}
+	}
+
+	return msg;
+}
 
 }
 }
@@ -21,6 +21,7 @@ class Mailbox;
  */
 class Message
 {
+	friend class Mailbox;
 public:
 	enum class Type
 	{
@@ -47,6 +48,19 @@ public:
 	 */
 	static Message *createFromCell(AnyCell *cell, const std::weak_ptr<Mailbox> &sender, Type type = Type::User);
 
+	/**
+	 * Creates a new message by moving the passed cell and its children
+	 *
+	 * This relocates the cells reachable from the message cell in to the message's heap instead of cloning them. The
+	 * caller must not reference the moved cells afterwards; any remaining references will see an opaque record. If a
+	 * cell can't be moved the message cell is cloned instead as if createFromCell() had been called. If an unclonable
+	 * cell is encountered then an UnclonableCellException will be thrown.
+	 *
+	 * @param  cell    Cell to move in to the message. This must not be shared with any other cell or root.
+	 * @param  sender  Mailbox of the sender
+	 */
+	static Message *createFromMovedCell(AnyCell *cell, const std::weak_ptr<Mailbox> &sender);
+
 	/**
 	 * Returns the type of the message
 	 */
@@ -84,6 +98,9 @@ private:
 	alloc::Heap m_heap;
 
 	std::weak_ptr<Mailbox> m_sender;
+
+	// Next message in our mailbox's queue
+	Message *m_nextMessage = nullptr;
 };
 
 }
@@ -0,0 +1,113 @@
+#include "actor/Router.h"
+
+#include <random>
+#include <limits>
+#include <cassert>
+
+#include "actor/Mailbox.h"
+
+namespace lliby
+{
+namespace actor
+{
+
+namespace
+{
+	std::minstd_rand &threadRandomEngine()
+	{
+		thread_local std::minstd_rand engine(std::random_device{}());
+		return engine;
+	}
+}
+
+Router::Router(RoutingStrategy strategy, const std::vector<std::shared_ptr<Mailbox>> &members) :
+	m_strategy(strategy),
+	m_members(members.begin(), members.end()),
+	m_nextMember(0)
+{
+	assert(!m_members.empty());
+}
+
+std::shared_ptr<Mailbox> Router::selectMember()
+{
+	switch(m_strategy)
+	{
+	case RoutingStrategy::RoundRobin:
+		return selectRoundRobin();
+	case RoutingStrategy::Random:
+		return selectRandom();
+	case RoutingStrategy::LeastLoaded:
+		return selectLeastLoaded();
+	}
+
+	return nullptr;
+}
+
+std::shared_ptr<Mailbox> Router::firstRunningMember(std::size_t startIndex)
+{
+	const std::size_t memberCount = m_members.size();
+
+	for(std::size_t i = 0; i < memberCount; i++)
+	{
+		std::shared_ptr<Mailbox> member = m_members[(startIndex + i) % memberCount].lock();
+
+		if (member && (member->state() != Mailbox::State::Stopped))
+		{
+			return member;
+		}
+	}
+
+	return nullptr;
+}
+
+std::shared_ptr<Mailbox> Router::selectRoundRobin()
+{
+	return firstRunningMember(m_nextMember.fetch_add(1, std::memory_order_relaxed));
+}
+
+std::shared_ptr<Mailbox> Router::selectRandom()
+{
+	std::uniform_int_distribution<std::size_t> distribution(0, m_members.size() - 1);
+	return firstRunningMember(distribution(threadRandomEngine()));
+}
+
+std::shared_ptr<Mailbox> Router::selectLeastLoaded()
+{
+	const std::size_t memberCount = m_members.size();
+
+	// Rotate our starting point so ties are spread between members
+	const std::size_t startIndex = m_nextMember.fetch_add(1, std::memory_order_relaxed);
+
+	std::shared_ptr<Mailbox> bestMember;
+	std::size_t bestLoad = std::numeric_limits<std::size_t>::max();
+
+	for(std::size_t i = 0; i < memberCount; i++)
+	{
+		std::shared_ptr<Mailbox> member = m_members[(startIndex + i) % memberCount].lock();
+
+		if (!member || (member->state() == Mailbox::State::Stopped))
+		{
+			continue;
+		}
+
+		// Count a member that's currently processing a message as having half a message queued
+		const std::size_t load = (member->queuedMessages() * 2) + (member->isReceiverAsleep() ? 0 : 1);
+
+		if (load < bestLoad)
+		{
+			bestMember = std::move(member);
+			bestLoad = load;
+
+			if (bestLoad == 0)
+			{
+				// Can't do better than an idle member
+				break;
+			}
+		}
+	}
+
+	return bestMember;
+}
+
+}
+}
@@ -0,0 +1,89 @@
+#ifndef _LLIBY_ACTOR_ROUTER_H
+#define _LLIBY_ACTOR_ROUTER_H
+
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace lliby
+{
+namespace actor
+{
+class Mailbox;
+
+/**
+ * Strategy a router uses to pick the member to receive each message
+ */
+enum class RoutingStrategy
+{
+	/**
+	 * Sends messages to each member in turn
+	 */
+	RoundRobin,
+
+	/**
+	 * Sends each message to a uniformly random member
+	 */
+	Random,
+
+	/**
+	 * Sends each message to the member with the fewest queued messages, preferring idle members
+	 */
+	LeastLoaded
+};
+
+/**
+ * Selects member mailboxes of an actor pool
+ *
+ * Routers hold weak references to their members. Members that have stopped are skipped.
+ */
+class Router
+{
+public:
+	Router(RoutingStrategy strategy, const std::vector<std::shared_ptr<Mailbox>> &members);
+
+	/**
+	 * Returns the routing strategy
+	 */
+	RoutingStrategy strategy() const
+	{
+		return m_strategy;
+	}
+
+	/**
+	 * Returns the member mailboxes of the pool
+	 */
+	const std::vector<std::weak_ptr<Mailbox>>& members() const
+	{
+		return m_members;
+	}
+
+	/**
+	 * Selects a member to receive the next message
+	 *
+	 * This is safe to call from any thread
+	 *
+	 * @return Member mailbox or nullptr if every member has stopped
+	 */
+	std::shared_ptr<Mailbox> selectMember();
+
+private:
+	std::shared_ptr<Mailbox> selectRoundRobin();
+	std::shared_ptr<Mailbox> selectRandom();
+	std::shared_ptr<Mailbox> selectLeastLoaded();
+
+	/**
+	 * Returns the first running member starting at the passed index
+	 */
+	std::shared_ptr<Mailbox> firstRunningMember(std::size_t startIndex);
+
+	RoutingStrategy m_strategy;
+	std::vector<std::weak_ptr<Mailbox>> m_members;
+	std::atomic<std::size_t> m_nextMember;
+};
+
+}
+}
+
+#endif
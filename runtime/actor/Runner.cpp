@@ -1,6 +1,10 @@
 #include "actor/Runner.h"
 
 #include <cassert>
+#include <algorithm>
+#include <cstdlib>
+#include <atomic>
+#include <vector>
 
 #include "actor/ActorContext.h"
 #include "actor/ActorBehaviourCell.h"
@@ -8,6 +12,7 @@
 #include "actor/PoisonPillCell.h"
 
 #include "alloc/allocator.h"
+#include "alloc/SegmentPool.h"
 
 #include "sched/Dispatcher.h"
 
@@ -23,6 +28,43 @@ namespace actor
 
 namespace
 {
+	/**
+	 * Multiple of the World's nursery trigger where a busy actor will collect before handling its next message
+	 *
+	 * Actors normally collect once they've gone to sleep. This bounds the garbage an actor with a constantly
+	 * non-empty mailbox can accumulate.
+	 */
+	const std::size_t BusyCollectionMultiplier = 4;
+
+	/**
+	 * Maximum number of messages taken from the mailbox at once
+	 *
+	 * Larger batches touch each message twice at a greater distance which defeats the cache
+	 */
+	const std::size_t MaximumBatchSize = 16;
+
+	/**
+	 * Default number of messages an actor processes before yielding its thread
+	 */
+	const std::size_t DefaultThroughputQuantum = 64;
+
+	std::size_t defaultThroughputQuantum()
+	{
+		if (const char *quantumString = getenv("LLAMBDA_ACTOR_THROUGHPUT"))
+		{
+			const std::size_t quantum = strtoull(quantumString, nullptr, 10);
+
+			if (quantum > 0)
+			{
+				return quantum;
+			}
+		}
+
+		return DefaultThroughputQuantum;
+	}
+
+	std::atomic<std::size_t> currentThroughputQuantum(defaultThroughputQuantum());
+
 	/**
 	 * Default supervisor strategy
 	 */
@@ -83,6 +125,7 @@ namespace
 			catch (dynamic::SchemeException &except)
 			{
 				// Threw an exception during restart; give up
+				actorWorld->shadowStackHead = nullptr;
 				return false;
 			}
 
@@ -92,7 +135,8 @@ namespace
 	}
 }
 
-std::shared_ptr<Mailbox> Runner::start(World &parentWorld, ActorClosureCell *closureCell)
+std::shared_ptr<Mailbox> Runner::start(World &parentWorld, ActorClosureCell *closureCell, std::size_t mailboxCapacity,
+		Mailbox::OverflowPolicy overflowPolicy)
 {
 	// Create a new world to launch
 	auto *actorWorld = new World;
@@ -110,7 +154,9 @@ std::shared_ptr<Mailbox> Runner::start(World &parentWorld, ActorClosureCell *clo
 	}
 
 	// Make the world an actor
-	ActorContext *context = new ActorContext(clonedClosureCell, supervisor);
+	auto mailbox = std::make_shared<Mailbox>(mailboxCapacity, overflowPolicy);
+	const std::size_t homeWorker = sched::Dispatcher::defaultInstance().assignHomeWorker();
+	ActorContext *context = new ActorContext(clonedClosureCell, supervisor, mailbox, homeWorker);
 	actorWorld->setActorContext(context);
 
 	// Initialise the actor's closure in its world but our thread
@@ -133,105 +179,182 @@ void Runner::wake(World *actorWorld)
 	// Pull some useful variables out of our world
 	ActorContext *context = actorWorld->actorContext();
 	const std::shared_ptr<Mailbox> &mailbox = context->mailbox();
+	std::deque<ReceivedMessage> &receivedMessages = context->receivedMessages();
+	sched::Dispatcher &dispatcher = sched::Dispatcher::defaultInstance();
 
-	while(true)
-	{
-		Message *msg;
-		LifecycleAction requestedAction;
+	// Keep our heap on our home node even if we've been stolen
+	alloc::SegmentPool::NodeScope nodeScope(dispatcher.workerNumaNode(context->homeWorker()));
 
-		// TODO: This would be better to do after we go to sleep as the actor would be otherwise idle. This is in the
-		// the critical path to run the actor. However, once we go to sleep we can be woken up again by an arbitrary
-		// thread so we'd need to block until collection completed.
-		alloc::conditionalCollection(*actorWorld);
-		Mailbox::ReceiveResult result = mailbox->receive(actorWorld, &msg, &requestedAction);
+	// We may still be collecting from the last time we went to sleep
+	mailbox->waitForSleepingCollection();
 
-		if (result == Mailbox::ReceiveResult::WentToSleep)
-		{
-			// Went to sleep - give up our thread
-			return;
-		}
-		else if (result == Mailbox::ReceiveResult::TookLifecycleAction)
+	const std::size_t quantum = throughputQuantum();
+	std::size_t processedMessages = 0;
+
+	std::vector<Message*> batch;
+
+	while(true)
+	{
+		if (processedMessages >= quantum)
 		{
-			// Have a lifecycle action
-			if (!performLifecycleAction(actorWorld, requestedAction))
+			if (!receivedMessages.empty() || mailbox->hasMessages())
 			{
-				// We were asked to die
-				break;
+				// Give other actors a chance to run. We're not visible as asleep so nothing else can wake us.
+				dispatcher.dispatchDeferredToWorker(context->homeWorker(), [=] {
+					Runner::wake(actorWorld);
+				});
+
+				return;
 			}
 
-			mailbox->setState(Mailbox::State::Running);
+			processedMessages = 0;
 		}
-		else
+
+		if (receivedMessages.empty() || !mailbox->canProcessMessages())
 		{
-			// Got a message!
-			if (msg->messageCell() == PoisonPillCell::instance())
+			LifecycleAction requestedAction;
+
+			if (alloc::collectionPending(*actorWorld, BusyCollectionMultiplier))
 			{
-				// We got a poison pill!
-				delete msg;
-				break;
+				// We haven't been idle for long enough to collect
+				alloc::conditionalCollection(*actorWorld);
 			}
 
-			// Take ownership of the heap
-			actorWorld->cellHeap.splice(msg->heap());
+			const bool collectWhileAsleep = alloc::collectionPending(*actorWorld);
+			Mailbox::ReceiveResult result = mailbox->receive(actorWorld, batch,
+					std::min(quantum - processedMessages, MaximumBatchSize),
+					&requestedAction, collectWhileAsleep);
 
-			// Grab the type and root cell
-			Message::Type type = msg->type();
-			AnyCell *msgCell = msg->messageCell();
+			if (result == Mailbox::ReceiveResult::WentToSleep)
+			{
+				if (collectWhileAsleep)
+				{
+					// Collect while we're idle instead of in the critical path of our next message. We may have been
+					// woken synchronously by another actor so collect on the dispatcher instead of the waking thread.
+					std::shared_ptr<Mailbox> sleepingMailbox(mailbox);
+					const std::size_t homeWorker = context->homeWorker();
+
+					dispatcher.dispatchToWorker(homeWorker, [=] {
+						alloc::SegmentPool::NodeScope nodeScope(sched::Dispatcher::defaultInstance().workerNumaNode(homeWorker));
+						alloc::conditionalCollection(*actorWorld);
+						sleepingMailbox->sleepingCollectionFinished();
+					});
+				}
 
-			// Update our sender
-			context->setSender(msg->sender());
+				// Went to sleep - give up our thread
+				return;
+			}
+			else if (result == Mailbox::ReceiveResult::TookLifecycleAction)
+			{
+				// Have a lifecycle action
+				if (!performLifecycleAction(actorWorld, requestedAction))
+				{
+					// We were asked to die
+					break;
+				}
 
-			// Delete the message
-			delete msg;
+				mailbox->setState(Mailbox::State::Running);
+				continue;
+			}
 
-			try
+			// Take ownership of every message's heap in one pass. The message cells are rooted by our context until
+			// they're processed.
+			for(Message *msg : batch)
 			{
-				if (type == Message::Type::SupervisedFailure)
-				{
-					LifecycleAction lifecycleAction;
+				actorWorld->cellHeap.splice(msg->heap());
+				receivedMessages.push_back(ReceivedMessage{msg->messageCell(), msg->type(), msg->sender()});
 
-					if (context->supervisorStrategy())
-					{
-						// Consult our Scheme supervisor strategy
-						SymbolCell *failureAction = context->supervisorStrategy()->apply(*actorWorld, msgCell);;
+				delete msg;
+			}
 
-						if (failureAction->byteLength() == 8)
-						{
-							// 'escalate
-							throw dynamic::SchemeException(msgCell);
-						}
+			batch.clear();
+		}
 
-						lifecycleAction = failureActionToLifecycleAction(failureAction);
-					}
-					else
-					{
-						// Use the default strategy
-						lifecycleAction = defaultSupervisorStrategy(msgCell);
-					}
+		// Process our next message
+		ReceivedMessage receivedMessage(std::move(receivedMessages.front()));
+		receivedMessages.pop_front();
+
+		AnyCell *msgCell = receivedMessage.messageCell;
+		processedMessages++;
+
+		if (msgCell == PoisonPillCell::instance())
+		{
+			// We got a poison pill!
+			break;
+		}
 
-					std::shared_ptr<Mailbox> sender(context->sender().lock());
+		// Update our sender
+		context->setSender(receivedMessage.sender);
 
-					if (sender)
+		try
+		{
+			if (receivedMessage.type == Message::Type::SupervisedFailure)
+			{
+				LifecycleAction lifecycleAction;
+
+				if (context->supervisorStrategy())
+				{
+					// Consult our Scheme supervisor strategy
+					SymbolCell *failureAction = context->supervisorStrategy()->apply(*actorWorld, msgCell);;
+
+					if (failureAction->byteLength() == 8)
 					{
-						sender->requestLifecycleAction(lifecycleAction);
+						// 'escalate
+						throw dynamic::SchemeException(msgCell);
 					}
+
+					lifecycleAction = failureActionToLifecycleAction(failureAction);
 				}
-				else if (type == Message::Type::User)
+				else
+				{
+					// Use the default strategy
+					lifecycleAction = defaultSupervisorStrategy(msgCell);
+				}
+
+				std::shared_ptr<Mailbox> sender(context->sender().lock());
+
+				if (sender)
 				{
-					context->behaviour()->apply(*actorWorld, msgCell);
+					sender->requestLifecycleAction(lifecycleAction);
 				}
 			}
-			catch (dynamic::SchemeException &except)
+			else if (receivedMessage.type == Message::Type::User)
 			{
-				handleRunningActorException(actorWorld, except);
+				context->behaviour()->apply(*actorWorld, msgCell);
 			}
 		}
+		catch (dynamic::SchemeException &except)
+		{
+			// The generated code we unwound through leaves its entries on the shadow stack. Nothing is rooted by the
+			// Runner itself.
+			actorWorld->shadowStackHead = nullptr;
+
+			handleRunningActorException(actorWorld, except);
+		}
 	}
 
 	mailbox->setState(Mailbox::State::Stopped);
 	delete actorWorld;
 }
 
+void Runner::queueWake(World *actorWorld)
+{
+	sched::Dispatcher::defaultInstance().dispatchToWorker(actorWorld->actorContext()->homeWorker(), [=] {
+		Runner::wake(actorWorld);
+	});
+}
+
+void Runner::setThroughputQuantum(std::size_t quantum)
+{
+	assert(quantum > 0);
+	currentThroughputQuantum.store(quantum, std::memory_order_relaxed);
+}
+
+std::size_t Runner::throughputQuantum()
+{
+	return currentThroughputQuantum.load(std::memory_order_relaxed);
+}
+
 void Runner::handleRunningActorException(World *actorWorld, dynamic::SchemeException &except)
 {
 	ActorContext *context = actorWorld->actorContext();
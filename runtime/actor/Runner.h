@@ -2,6 +2,7 @@
 #define _LLIBY_ACTOR_RUNNER_H
 
 #include <memory>
+#include <cstddef>
 
 #include "actor/Mailbox.h"
 #include "actor/ActorClosureCell.h"
@@ -27,17 +28,44 @@ public:
 	 *
 	 * This will run the actor's closure procedure in a new world on the current thread. It will then store the initial
 	 * behaviour and put the new actor to sleep on its mailbox.
+	 *
+	 * @param  parentWorld      World starting the actor. Its actor becomes the new actor's supervisor.
+	 * @param  closureCell      Closure returning the actor's initial behaviour
+	 * @param  mailboxCapacity  Capacity of the actor's mailbox or 0 for an unbounded mailbox
+	 * @param  overflowPolicy   Overflow policy for a bounded mailbox
 	 */
-	static std::shared_ptr<Mailbox> start(World &parentWorld, ActorClosureCell *closureCell);
+	static std::shared_ptr<Mailbox> start(World &parentWorld, ActorClosureCell *closureCell,
+			std::size_t mailboxCapacity = 0, Mailbox::OverflowPolicy overflowPolicy = Mailbox::OverflowPolicy::Block);
 
 	/**
 	 * Wakes a sleeping actor to handle any queued messages
 	 *
-	 * This will dequeue all messages from the mailbox and process it with the actor's current behaviour. Once the mailbox
-	 * is empty or the actor has been asked to stop the function will return.
+	 * This will dequeue messages from the mailbox in batches and process them with the actor's current behaviour. Once
+	 * the mailbox is empty or the actor has been asked to stop the function will return. If the actor processes its
+	 * throughput quantum of messages while more are queued it will redispatch itself and return to let other actors run.
+	 *
+	 * Segments for the actor's heap are taken from its home worker's NUMA node regardless of the thread it's woken on.
 	 */
 	static void wake(World *actorWorld);
 
+	/**
+	 * Dispatches a wake of a sleeping actor on its home worker
+	 */
+	static void queueWake(World *actorWorld);
+
+	/**
+	 * Sets the number of messages an actor processes before yielding its thread
+	 *
+	 * This defaults to the value of the LLAMBDA_ACTOR_THROUGHPUT environment variable if set or 64 otherwise. Larger
+	 * values improve the throughput of busy actors at the expense of latency for other actors.
+	 */
+	static void setThroughputQuantum(std::size_t quantum);
+
+	/**
+	 * Returns the number of messages an actor processes before yielding its thread
+	 */
+	static std::size_t throughputQuantum();
+
 private:
 	/**
 	 * Handles an exception thrown by an actor during behaviour message handling
@@ -2,7 +2,10 @@
 
 #include <cstring>
 #include <sstream>
-#include <unordered_map>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
 
 #include "alloc/Heap.h"
 #include "core/error.h"
@@ -15,6 +18,8 @@
 #include "binding/BytevectorCell.h"
 #include "binding/CharCell.h"
 #include "binding/VectorCell.h"
+#include "binding/PairCell.h"
+#include "binding/EmptyListCell.h"
 #include "binding/StringCell.h"
 #include "binding/SymbolCell.h"
 #include "binding/MailboxCell.h"
@@ -40,11 +45,107 @@ using dynamic::State;
 
 namespace
 {
+	/**
+	 * Maps source cells to their clones
+	 *
+	 * This is an open addressing hash table using linear probing. Cells are never removed so no tombstones are needed.
+	 */
+	class CloneCache
+	{
+	public:
+		CloneCache() :
+			m_slots(InitialCapacity)
+		{
+		}
+
+		/**
+		 * Returns the clone of the passed cell or nullptr if it hasn't been cloned
+		 */
+		AnyCell* find(AnyCell *sourceCell) const
+		{
+			for(std::size_t i = slotIndex(sourceCell); ; i = (i + 1) & (m_slots.size() - 1))
+			{
+				const Slot &slot = m_slots[i];
+
+				if (slot.sourceCell == sourceCell)
+				{
+					return slot.clonedCell;
+				}
+				else if (slot.sourceCell == nullptr)
+				{
+					return nullptr;
+				}
+			}
+		}
+
+		/**
+		 * Records the clone of a cell that hasn't been previously cloned
+		 */
+		void insert(AnyCell *sourceCell, AnyCell *clonedCell)
+		{
+			// Keep the load factor at or below 50%
+			if (((m_size + 1) * 2) > m_slots.size())
+			{
+				grow();
+			}
+
+			insertUnchecked(sourceCell, clonedCell);
+			m_size++;
+		}
+
+	private:
+		static const std::size_t InitialCapacity = 64;
+
+		struct Slot
+		{
+			AnyCell *sourceCell = nullptr;
+			AnyCell *clonedCell = nullptr;
+		};
+
+		std::size_t slotIndex(AnyCell *sourceCell) const
+		{
+			// Cells are aligned so the low bits carry no information. Fibonacci hashing spreads the remaining bits.
+			auto cellBits = reinterpret_cast<std::uintptr_t>(sourceCell) >> 4;
+			return static_cast<std::size_t>(cellBits * 11400714819323198485ULL) & (m_slots.size() - 1);
+		}
+
+		void insertUnchecked(AnyCell *sourceCell, AnyCell *clonedCell)
+		{
+			std::size_t i = slotIndex(sourceCell);
+
+			while(m_slots[i].sourceCell != nullptr)
+			{
+				assert(m_slots[i].sourceCell != sourceCell);
+				i = (i + 1) & (m_slots.size() - 1);
+			}
+
+			m_slots[i].sourceCell = sourceCell;
+			m_slots[i].clonedCell = clonedCell;
+		}
+
+		void grow()
+		{
+			std::vector<Slot> oldSlots(m_slots.size() * 2);
+			oldSlots.swap(m_slots);
+
+			for(const Slot &slot : oldSlots)
+			{
+				if (slot.sourceCell != nullptr)
+				{
+					insertUnchecked(slot.sourceCell, slot.clonedCell);
+				}
+			}
+		}
+
+		std::vector<Slot> m_slots;
+		std::size_t m_size = 0;
+	};
+
 	struct Context
 	{
 		// Dynamic state to resolve parameter procedures in
 		State *captureState;
-		std::unordered_map<AnyCell*, AnyCell*> clonedCells;
+		CloneCache clonedCells;
 	};
 
 	AnyCell *cachedClone(alloc::Heap &heap, AnyCell *cell, Context &context);
@@ -116,16 +217,27 @@ namespace
 
 		std::memcpy(newData, oldData, classMap->totalSize);
 
+		// Make the cell pointers safe to visit until they're cloned
+		for(std::uint32_t i = 0; i < classMap->offsetCount; i++)
+		{
+			const std::uint32_t byteOffset = classMap->offsets[i];
+			*reinterpret_cast<AnyCell**>(reinterpret_cast<char*>(newData) + byteOffset) = EmptyListCell::instance();
+		}
+
+		// Register ourselves before our fields so cycles back to us are preserved
+		context.clonedCells.insert(recordLikeCell, newRecordLikeCell);
+
 		// Clone all the cell pointers
 		for(std::uint32_t i = 0; i < classMap->offsetCount; i++)
 		{
 			const std::uint32_t byteOffset = classMap->offsets[i];
 
-			auto cellRef = reinterpret_cast<AnyCell**>(reinterpret_cast<char*>(newData) + byteOffset);
+			auto oldCellRef = reinterpret_cast<AnyCell**>(reinterpret_cast<char*>(oldData) + byteOffset);
+			auto newCellRef = reinterpret_cast<AnyCell**>(reinterpret_cast<char*>(newData) + byteOffset);
 
 			try
 			{
-				*cellRef = cachedClone(heap, *cellRef, context);
+				*newCellRef = cachedClone(heap, *oldCellRef, context);
 			}
 			catch (UnclonableCellException &)
 			{
@@ -145,64 +257,133 @@ namespace
 
 	VectorCell *cloneVectorCell(alloc::Heap &heap, VectorCell *vectorCell, Context &context)
 	{
-		AnyCell **newData = new AnyCell*[vectorCell->length()];
+		const VectorCell::LengthType length = vectorCell->length();
+		AnyCell *const *oldData = vectorCell->elements();
+
+		// Start with the vector filled with a constant so it can be safely visited until its elements are cloned
+		AnyCell **newData = new AnyCell*[length];
+		std::fill_n(newData, length, EmptyListCell::instance());
 
-		try
+		auto placement = heap.allocate();
+		auto newVectorCell = new (placement) VectorCell(newData, length);
+
+		// Register ourselves before our elements so cycles back to us are preserved
+		context.clonedCells.insert(vectorCell, newVectorCell);
+
+		// Clone the elements in a single pass. Global constants such as booleans and the empty list are shared
+		// without going through the clone cache.
+		for(VectorCell::LengthType i = 0; i < length; i++)
 		{
-			for(VectorCell::LengthType i = 0; i < vectorCell->length(); i++)
+			AnyCell *element = oldData[i];
+
+			if (!element->isGlobalConstant())
 			{
-				newData[i] = cachedClone(heap, vectorCell->elements()[i], context);
+				newData[i] = cachedClone(heap, element, context);
+			}
+			else
+			{
+				newData[i] = element;
 			}
-		}
-		catch (UnclonableCellException &)
-		{
-			delete[] newData;
-			throw;
 		}
 
-		auto placement = heap.allocate();
-		return new (placement) VectorCell(newData, vectorCell->length());
+		return newVectorCell;
 	}
 
 	PairCell *clonePair(alloc::Heap &heap, PairCell *pairCell, Context &context)
 	{
-		AnyCell *car = cachedClone(heap, pairCell->car(), context);
-		AnyCell *cdr = cachedClone(heap, pairCell->cdr(), context);
+		PairCell *headPair = nullptr;
+		PairCell *tailPair = nullptr;
 
-		auto placement = heap.allocate();
-		return new (placement) PairCell(car, cdr);
+		AnyCell *sourceCell = pairCell;
+
+		// Walk the list's spine iteratively so long lists don't exhaust the stack. Only the car is cloned recursively.
+		while(auto sourcePair = cell_cast<PairCell>(sourceCell))
+		{
+			if (sourcePair != pairCell)
+			{
+				if (sourcePair->isGlobalConstant())
+				{
+					break;
+				}
+				else if (AnyCell *cachedCell = context.clonedCells.find(sourcePair))
+				{
+					// We've joined a list we've already cloned
+					tailPair->setCdr(cachedCell);
+					return headPair;
+				}
+			}
+
+			auto placement = heap.allocate();
+			auto newPair = new (placement) PairCell(EmptyListCell::instance(), EmptyListCell::instance());
+
+			context.clonedCells.insert(sourcePair, newPair);
+
+			if (tailPair)
+			{
+				tailPair->setCdr(newPair);
+			}
+			else
+			{
+				headPair = newPair;
+			}
+
+			tailPair = newPair;
+			newPair->setCar(cachedClone(heap, sourcePair->car(), context));
+
+			sourceCell = sourcePair->cdr();
+		}
+
+		tailPair->setCdr(cachedClone(heap, sourceCell, context));
+		return headPair;
 	}
 
 	ErrorObjectCell *cloneErrorObject(alloc::Heap &heap, ErrorObjectCell *errorObjectCell, Context &context)
 	{
 		StringCell *message = errorObjectCell->message()->copy(heap);
-		auto irritants = static_cast<ProperList<AnyCell>*>(cachedClone(heap, errorObjectCell->irritants(), context));
 
 		auto placement = heap.allocate();
-		return new (placement) ErrorObjectCell(message, irritants, errorObjectCell->category());
+		auto emptyIrritants = EmptyListCell::asProperList<AnyCell>();
+		auto newErrorObjectCell = new (placement) ErrorObjectCell(message, emptyIrritants, errorObjectCell->category());
+
+		context.clonedCells.insert(errorObjectCell, newErrorObjectCell);
+
+		auto irritants = static_cast<ProperList<AnyCell>*>(cachedClone(heap, errorObjectCell->irritants(), context));
+		*newErrorObjectCell->irritantsRef() = irritants;
+
+		return newErrorObjectCell;
 	}
 
 	HashMapCell *cloneHashMap(alloc::Heap &heap, HashMapCell *hashMapCell, Context &context)
 	{
-		DatumHashTree *tree = DatumHashTree::createEmpty();
-
-		DatumHashTree::every(hashMapCell->datumHashTree(), [&] (AnyCell *key, AnyCell *value, DatumHash::ResultType hashValue)
-		{
-			AnyCell *newKey = cachedClone(heap, key, context);
-			AnyCell *newValue = cachedClone(heap, value, context);
-
-			DatumHashTree *newTree = DatumHashTree::assoc(tree, newKey, newValue, hashValue);
+		auto placement = heap.allocate();
+		auto newHashMapCell = new (placement) HashMapCell(DatumHashTree::createEmpty());
 
-			DatumHashTree::unref(tree);
-			tree = newTree;
+		context.clonedCells.insert(hashMapCell, newHashMapCell);
 
-			return true;
+		// Mirror the source tree instead of rebuilding it. Cloned keys are equal to their originals so the tree's
+		// stored hash values remain valid.
+		DatumHashTree *tree = DatumHashTree::copyMapped(hashMapCell->datumHashTree(), [&] (AnyCell *&key, AnyCell *&value)
+		{
+			key = cachedClone(heap, key, context);
+			value = cachedClone(heap, value, context);
 		});
 
-		auto placement = heap.allocate();
-		return new (placement) HashMapCell(tree);
+		newHashMapCell->setDatumHashTree(tree);
+		return newHashMapCell;
+	}
+
+	AnyCell *rememberClone(Context &context, AnyCell *sourceCell, AnyCell *clonedCell)
+	{
+		context.clonedCells.insert(sourceCell, clonedCell);
+		return clonedCell;
 	}
 
+	/**
+	 * Clones a cell that isn't in the clone cache and adds it to the cache
+	 *
+	 * Cells that can reference other cells add themselves to the cache before cloning their children so cycles can be
+	 * cloned. Numbers and characters are compared by value with (eqv?) so they aren't cached at all.
+	 */
 	AnyCell *uncachedClone(alloc::Heap &heap, AnyCell *cell, Context &context)
 	{
 		if (auto integerCell = cell_cast<IntegerCell>(cell))
@@ -223,7 +404,7 @@ namespace
 		else if (auto bvCell = cell_cast<BytevectorCell>(cell))
 		{
 			auto placement = heap.allocate();
-			return new (placement) BytevectorCell(bvCell->byteArray()->ref(), bvCell->length());
+			return rememberClone(context, cell, new (placement) BytevectorCell(bvCell->byteArray()->ref(), bvCell->length()));
 		}
 		else if (auto vectorCell = cell_cast<VectorCell>(cell))
 		{
@@ -231,11 +412,11 @@ namespace
 		}
 		else if (auto stringCell = cell_cast<StringCell>(cell))
 		{
-			return stringCell->copy(heap);
+			return rememberClone(context, cell, stringCell->copy(heap));
 		}
 		else if (auto symbolCell = cell_cast<SymbolCell>(cell))
 		{
-			return symbolCell->copy(heap);
+			return rememberClone(context, cell, symbolCell->copy(heap));
 		}
 		else if (auto pairCell = cell_cast<PairCell>(cell))
 		{
@@ -244,7 +425,7 @@ namespace
 		else if (auto mailboxCell = cell_cast<MailboxCell>(cell))
 		{
 			auto placement = heap.allocate();
-			return new (placement) MailboxCell(mailboxCell->mailbox());
+			return rememberClone(context, cell, new (placement) MailboxCell(mailboxCell->mailbox()));
 		}
 		else if (auto errorObjectCell = cell_cast<ErrorObjectCell>(cell))
 		{
@@ -254,7 +435,7 @@ namespace
 		{
 			if (auto paramProcCell = cell_cast<ParameterProcedureCell>(cell))
 			{
-				return cloneParamProcCell(heap, paramProcCell, context);
+				return rememberClone(context, cell, cloneParamProcCell(heap, paramProcCell, context));
 			}
 			else if (recordLikeCell->isUndefined())
 			{
@@ -285,19 +466,14 @@ namespace
 			return cell;
 		}
 
-		auto cachedIt = context.clonedCells.find(cell);
-
-		if (cachedIt != context.clonedCells.end())
+		if (AnyCell *clonedCell = context.clonedCells.find(cell))
 		{
 			// We've already cloned this cell; return the same one to keep (eqv?)
-			return cachedIt->second;
+			return clonedCell;
 		}
 
 		// There isn't already a cloned cell; clone a new copy
-		auto clonedCell = uncachedClone(heap, cell, context);
-		context.clonedCells.emplace(cell, clonedCell);
-
-		return clonedCell;
+		return uncachedClone(heap, cell, context);
 	}
 }
 
@@ -311,7 +487,7 @@ AnyCell *cloneCell(alloc::Heap &heap, AnyCell *cell, State *captureState)
 		return cell;
 	}
 
-	// Don't bother searching for and caching the top-level cell
+	// Don't bother searching the cache for the top-level cell
 	return uncachedClone(heap, cell, context);
 }
 
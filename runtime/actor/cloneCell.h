@@ -67,6 +67,7 @@ private:
 /**
  * Creates a functionally equivalent copy of the passed cell in the passed heap
  *
+ * Cells shared within the passed cell are cloned once and remain shared in the clone, including cyclic references.
  * Certain cells cannot be cloned. An UnclonableCellException will be thrown in that case.
  *
  * @param  heap          Heap to clone the cells in to
@@ -38,6 +38,98 @@ private:
 	MemoryBlock *m_nextSegment;
 };
 
+// This is a special cell at the start of every heap segment
+//
+// Segments of heaps with precise finalization are followed by a bitmap of their cells needing finalization. Other
+// segments must have every cell checked for finalization.
+class SegmentHeaderCell : public AnyCell
+{
+public:
+	SegmentHeaderCell(std::uint32_t bitmapCellCount) :
+		AnyCell(CellTypeId::Invalid, GarbageState::SegmentHeader),
+		m_sweepsAllCells(bitmapCellCount == 0),
+		m_bitmapCellCount(bitmapCellCount)
+	{
+	}
+
+	/**
+	 * Returns the next segment in the heap or nullptr if this is the heap's last segment
+	 */
+	MemoryBlock* nextSegment() const
+	{
+		return m_nextSegment;
+	}
+
+	void setNextSegment(MemoryBlock *nextSegment)
+	{
+		m_nextSegment = nextSegment;
+	}
+
+	/**
+	 * Returns if the segment may contain cells that need finalization
+	 */
+	bool needsFinalization() const
+	{
+		return m_sweepsAllCells || (m_finalizableCellCount > 0);
+	}
+
+	/**
+	 * Returns if every cell in the segment must be checked for finalization
+	 *
+	 * This is true for any segment allocated in to without recording cells needing finalization
+	 */
+	bool sweepsAllCells() const
+	{
+		return m_sweepsAllCells;
+	}
+
+	void setSweepsAllCells()
+	{
+		m_sweepsAllCells = true;
+	}
+
+	/**
+	 * Returns the number of cells following the header reserved for the finalization bitmap
+	 */
+	std::uint32_t bitmapCellCount() const
+	{
+		return m_bitmapCellCount;
+	}
+
+	/**
+	 * Returns the number of cells marked in the finalization bitmap
+	 */
+	std::uint32_t finalizableCellCount() const
+	{
+		return m_finalizableCellCount;
+	}
+
+	/**
+	 * Returns the finalization bitmap
+	 *
+	 * Bit N of the bitmap is set if the Nth cell after the bitmap needs finalization
+	 */
+	std::uint64_t* finalizableBitmap()
+	{
+		return reinterpret_cast<std::uint64_t*>(reinterpret_cast<AllocCell*>(this) + 1);
+	}
+
+	/**
+	 * Marks the cell with the passed index as needing finalization
+	 */
+	void markFinalizable(std::size_t cellIndex)
+	{
+		finalizableBitmap()[cellIndex / 64] |= (std::uint64_t(1) << (cellIndex % 64));
+		m_finalizableCellCount++;
+	}
+
+private:
+	bool m_sweepsAllCells;
+	std::uint32_t m_bitmapCellCount;
+	std::uint32_t m_finalizableCellCount = 0;
+	MemoryBlock *m_nextSegment = nullptr;
+};
+
 // This is a special cell that terminates an entire
 class HeapTerminatorCell : public AnyCell
 {
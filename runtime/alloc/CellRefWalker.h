@@ -74,15 +74,40 @@ public:
 			rootCellRef = pairCell->cdrRef();
 			goto visitEntry;
 		}
-		else if (auto vectorCell = cell_cast<VectorCell>(*rootCellRef))
+		else
+		{
+			visitChildren(*rootCellRef, [&] (AnyCell **childCellRef) {
+				visitCell(childCellRef, visitor);
+			});
+		}
+	}
+
+	/**
+	 * Calls the visitor for each cell reference directly contained in the passed cell
+	 *
+	 * Unlike visitCell() this does not recurse in to the child cells. This allows the caller to control the order and
+	 * depth of the traversal.
+	 *
+	 * @param cell     Cell to visit the child references of
+	 * @param visitor  Function to call with a pointer to each child cell pointer. The visitor may modify the pointer.
+	 */
+	template<typename T>
+	void visitChildren(AnyCell *cell, T visitor)
+	{
+		if (auto pairCell = cell_cast<PairCell>(cell))
+		{
+			visitor(pairCell->carRef());
+			visitor(pairCell->cdrRef());
+		}
+		else if (auto vectorCell = cell_cast<VectorCell>(cell))
 		{
 			for(VectorCell::LengthType i = 0; i < vectorCell->length(); i++)
 			{
 				// Use elements instead of elementsAt to skip the range check
-				visitCell(&vectorCell->elements()[i], visitor);
+				visitor(&vectorCell->elements()[i]);
 			}
 		}
-		else if (auto recordLikeCell = cell_cast<RecordLikeCell>(*rootCellRef))
+		else if (auto recordLikeCell = cell_cast<RecordLikeCell>(cell))
 		{
 			if (!recordLikeCell->isUndefined())
 			{
@@ -93,41 +118,41 @@ public:
 					const std::uint32_t byteOffset = classMap->offsets[i];
 					auto cellRef = static_cast<std::uint8_t*>(recordLikeCell->dataBasePointer()) + byteOffset;
 
-					visitCell(reinterpret_cast<AnyCell**>(cellRef), visitor);
+					visitor(reinterpret_cast<AnyCell**>(cellRef));
 				}
 			}
 		}
-		else if (auto errorObjectCell = cell_cast<ErrorObjectCell>(*rootCellRef))
+		else if (auto errorObjectCell = cell_cast<ErrorObjectCell>(cell))
 		{
-			visitCell(reinterpret_cast<AnyCell**>(errorObjectCell->messageRef()), visitor);
-			visitCell(reinterpret_cast<AnyCell**>(errorObjectCell->irritantsRef()), visitor);
+			visitor(reinterpret_cast<AnyCell**>(errorObjectCell->messageRef()));
+			visitor(reinterpret_cast<AnyCell**>(errorObjectCell->irritantsRef()));
 		}
-		else if (auto hashMapCell = cell_cast<HashMapCell>(*rootCellRef))
+		else if (auto hashMapCell = cell_cast<HashMapCell>(cell))
 		{
 			DatumHashTree::walkCellRefs(hashMapCell->datumHashTree(), *this, [&] (AnyCell **keyRef, AnyCell **valueRef)
 			{
-				visitCell(keyRef, visitor);
-				visitCell(valueRef, visitor);
+				visitor(keyRef);
+				visitor(valueRef);
 			});
 		}
 #ifndef NDEBUG
-		else if (cell_cast<UnitCell>(*rootCellRef) ||
-			cell_cast<EmptyListCell>(*rootCellRef) ||
-			cell_cast<BooleanCell>(*rootCellRef) ||
-			cell_cast<IntegerCell>(*rootCellRef) ||
-			cell_cast<FlonumCell>(*rootCellRef) ||
-			cell_cast<StringCell>(*rootCellRef) ||
-			cell_cast<SymbolCell>(*rootCellRef) ||
-			cell_cast<BytevectorCell>(*rootCellRef) ||
-			cell_cast<CharCell>(*rootCellRef) ||
-			cell_cast<PortCell>(*rootCellRef) ||
-			cell_cast<MailboxCell>(*rootCellRef))
+		else if (cell_cast<UnitCell>(cell) ||
+			cell_cast<EmptyListCell>(cell) ||
+			cell_cast<BooleanCell>(cell) ||
+			cell_cast<IntegerCell>(cell) ||
+			cell_cast<FlonumCell>(cell) ||
+			cell_cast<StringCell>(cell) ||
+			cell_cast<SymbolCell>(cell) ||
+			cell_cast<BytevectorCell>(cell) ||
+			cell_cast<CharCell>(cell) ||
+			cell_cast<PortCell>(cell) ||
+			cell_cast<MailboxCell>(cell))
 		{
 			// No children
 		}
 		else
 		{
-			fatalError("Unknown cell type encountered attempting to visit children", *rootCellRef);
+			fatalError("Unknown cell type encountered attempting to visit children", cell);
 		}
 #endif
 	}
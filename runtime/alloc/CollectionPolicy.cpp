@@ -0,0 +1,107 @@
+#include "alloc/CollectionPolicy.h"
+
+#include <atomic>
+#include <algorithm>
+#include <limits>
+#include <cstdlib>
+
+#include "alloc/AllocCell.h"
+
+namespace lliby
+{
+namespace alloc
+{
+
+namespace
+{
+	std::size_t initialGlobalBudgetCells()
+	{
+		if (const char *budgetString = getenv("LLAMBDA_GC_BUDGET_MB"))
+		{
+			return (strtoull(budgetString, nullptr, 10) * 1024 * 1024) / sizeof(AllocCell);
+		}
+
+		return std::numeric_limits<std::size_t>::max();
+	}
+
+	std::atomic<std::size_t> globalBudgetCells(initialGlobalBudgetCells());
+	std::atomic<std::size_t> globalLiveCells(0);
+}
+
+CollectionPolicy::CollectionPolicy()
+{
+	updateNurseryTrigger();
+}
+
+CollectionPolicy::~CollectionPolicy()
+{
+	// Release our contribution to the global budget
+	globalLiveCells.fetch_sub(m_liveCells, std::memory_order_relaxed);
+}
+
+CollectionType CollectionPolicy::nextCollectionType() const
+{
+	if (globalBudgetExceeded())
+	{
+		// Reclaim tenured garbage as soon as it may exist
+		return (m_liveCells > m_lastFullLiveCells) ? CollectionType::Full : CollectionType::Minor;
+	}
+
+	const std::size_t fullTrigger = std::max(m_tunables.minimumTenuredCells,
+			static_cast<std::size_t>(m_lastFullLiveCells * m_tunables.tenuredGrowthFactor));
+
+	return (m_liveCells > fullTrigger) ? CollectionType::Full : CollectionType::Minor;
+}
+
+void CollectionPolicy::collectionFinished(CollectionType type, std::size_t promotedCells, std::size_t youngCells)
+{
+	if (type == CollectionType::Full)
+	{
+		// Full collections relocate exactly our live cells
+		m_tenuredLiveCells = promotedCells;
+		setLiveCells(promotedCells + youngCells);
+		m_lastFullLiveCells = m_liveCells;
+	}
+	else
+	{
+		// Assume tenured cells are still live. Young cells were relocated again so they replace our previous count.
+		m_tenuredLiveCells += promotedCells;
+		setLiveCells(m_tenuredLiveCells + youngCells);
+	}
+
+	updateNurseryTrigger();
+}
+
+void CollectionPolicy::setGlobalBudget(std::size_t budgetBytes)
+{
+	globalBudgetCells.store(budgetBytes / sizeof(AllocCell), std::memory_order_relaxed);
+}
+
+bool CollectionPolicy::globalBudgetExceeded()
+{
+	return globalLiveCells.load(std::memory_order_relaxed) > globalBudgetCells.load(std::memory_order_relaxed);
+}
+
+void CollectionPolicy::setLiveCells(std::size_t liveCells)
+{
+	// This wraps correctly when our live cells decrease
+	globalLiveCells.fetch_add(liveCells - m_liveCells, std::memory_order_relaxed);
+	m_liveCells = liveCells;
+}
+
+void CollectionPolicy::updateNurseryTrigger()
+{
+	if (globalBudgetExceeded())
+	{
+		m_nurseryTrigger = m_tunables.minimumNurseryCells;
+		return;
+	}
+
+	const auto proportionalCells = static_cast<std::size_t>(m_liveCells * m_tunables.nurseryLiveRatio);
+
+	m_nurseryTrigger = std::min(m_tunables.maximumNurseryCells,
+			std::max(m_tunables.minimumNurseryCells, proportionalCells));
+}
+
+}
+}
@@ -0,0 +1,135 @@
+#ifndef _LLIBY_ALLOC_COLLECTIONPOLICY_H
+#define _LLIBY_ALLOC_COLLECTIONPOLICY_H
+
+#include <cstddef>
+
+#include "alloc/allocator.h"
+
+namespace lliby
+{
+namespace alloc
+{
+
+/**
+ * Tunable parameters for a World's collection policy
+ */
+struct CollectionTunables
+{
+	/**
+	 * Minimum number of cells allocated between minor collections
+	 */
+	std::size_t minimumNurseryCells = 32 * 1024;
+
+	/**
+	 * Maximum number of cells allocated between minor collections
+	 */
+	std::size_t maximumNurseryCells = 1024 * 1024;
+
+	/**
+	 * Number of cells allocated between minor collections as a ratio of the World's live cells
+	 *
+	 * This is clamped between minimumNurseryCells and maximumNurseryCells
+	 */
+	double nurseryLiveRatio = 0.5;
+
+	/**
+	 * Factor the live cells in the World can grow by before a full collection
+	 */
+	double tenuredGrowthFactor = 2.0;
+
+	/**
+	 * Minimum number of live cells before a full collection
+	 */
+	std::size_t minimumTenuredCells = 256 * 1024;
+};
+
+/**
+ * Decides when a World should be collected based on the size of its live set
+ *
+ * The policy tracks an estimate of the World's live cells using the cells relocated by each collection. Cells promoted
+ * in to the tenured heap are assumed to stay live until the next full collection while cells that can't be tenured are
+ * counted again by every collection they survive. The nursery is sized proportionally to the live set so Worlds with large live sets amortise the cost of minor
+ * collections while small Worlds don't accumulate large amounts of garbage. Full collections happen once the live set
+ * has grown by a fixed factor since the last full collection.
+ *
+ * Every policy also contributes its live cells to a process-wide budget. While the budget is exceeded all Worlds use
+ * their minimum nursery size and perform full collections whenever their live set has grown.
+ */
+class CollectionPolicy
+{
+public:
+	CollectionPolicy();
+	~CollectionPolicy();
+
+	CollectionPolicy(const CollectionPolicy &) = delete;
+	CollectionPolicy& operator=(const CollectionPolicy &) = delete;
+
+	/**
+	 * Returns the tunables for this policy
+	 *
+	 * These may be modified at any time; they take effect from the next collection
+	 */
+	CollectionTunables& tunables()
+	{
+		return m_tunables;
+	}
+
+	/**
+	 * Returns the number of nursery allocations that should trigger a collection
+	 */
+	std::size_t nurseryTrigger() const
+	{
+		return m_nurseryTrigger;
+	}
+
+	/**
+	 * Returns the estimated number of live cells in the World
+	 */
+	std::size_t liveCells() const
+	{
+		return m_liveCells;
+	}
+
+	/**
+	 * Returns the type of collection to perform once the nursery trigger has been reached
+	 */
+	CollectionType nextCollectionType() const;
+
+	/**
+	 * Updates the policy after a collection
+	 *
+	 * @param  type           Type of the collection that was performed
+	 * @param  promotedCells  Number of cells the collection relocated in to the tenured heap
+	 * @param  youngCells     Number of cells the collection relocated in to the nursery
+	 */
+	void collectionFinished(CollectionType type, std::size_t promotedCells, std::size_t youngCells);
+
+	/**
+	 * Sets the process-wide budget for live cells across all Worlds in bytes
+	 *
+	 * By default this is read from the LLAMBDA_GC_BUDGET_MB environment variable. If that is unset the budget is
+	 * unlimited.
+	 */
+	static void setGlobalBudget(std::size_t budgetBytes);
+
+	/**
+	 * Returns if the live cells across all Worlds exceed the global budget
+	 */
+	static bool globalBudgetExceeded();
+
+private:
+	void setLiveCells(std::size_t liveCells);
+	void updateNurseryTrigger();
+
+	CollectionTunables m_tunables;
+
+	std::size_t m_liveCells = 0;
+	std::size_t m_tenuredLiveCells = 0;
+	std::size_t m_lastFullLiveCells = 0;
+	std::size_t m_nurseryTrigger;
+};
+
+}
+}
+
+#endif
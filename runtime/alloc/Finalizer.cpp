@@ -2,6 +2,7 @@
 #include "Heap.h"
 
 #include <cassert>
+#include <algorithm>
 
 #include "binding/AnyCell.h"
 
@@ -21,13 +22,21 @@ void Finalizer::finalizeHeapAsync(Heap &heap)
 		return;
 	}
 
-	terminateHeap(heap);
+	std::vector<MemoryBlock*> segments(terminateHeap(heap));
 
-	MemoryBlock *rootSegment = heap.rootSegment();
+	// Split the segments between a job per dispatcher worker
+	sched::Dispatcher &dispatcher(sched::Dispatcher::defaultInstance());
+	const std::size_t jobCount = std::min(segments.size(), dispatcher.workerCount());
+	const std::size_t segmentsPerJob = (segments.size() + jobCount - 1) / jobCount;
 
-	sched::Dispatcher::defaultInstance().dispatch([=]() {
-		finalizeSegment(rootSegment);
-	});
+	for(auto jobStart = segments.begin(); jobStart < segments.end(); jobStart += segmentsPerJob)
+	{
+		std::vector<MemoryBlock*> jobSegments(jobStart, std::min(jobStart + segmentsPerJob, segments.end()));
+
+		dispatcher.dispatch([=]() {
+			finalizeSegments(jobSegments);
+		});
+	}
 
 	// Detach all segments from the heap now that we've queued the finalization. This prevents us finalizing the heap
 	// again in its destructor
@@ -41,54 +50,92 @@ void Finalizer::finalizeHeapSync(Heap &heap)
 		return;
 	}
 
-	terminateHeap(heap);
-	finalizeSegment(heap.rootSegment());
+	finalizeSegments(terminateHeap(heap));
 
 	heap.detach();
 }
 
-void Finalizer::finalizeSegment(MemoryBlock *rootSegment)
+void Finalizer::finalizeSegments(const std::vector<MemoryBlock*> &segments)
+{
+	for(MemoryBlock *segment : segments)
+	{
+		finalizeSegment(segment);
+	}
+}
+
+void Finalizer::finalizeSegment(MemoryBlock *segment)
 {
-	auto nextCell = static_cast<AllocCell*>(rootSegment->startPointer());
+	SegmentHeaderCell *header = Heap::segmentHeader(segment);
 
-	while((nextCell->gcState() != GarbageState::HeapTerminator) &&
-			(nextCell->gcState() != GarbageState::SegmentTerminator))
+	if (header->sweepsAllCells())
 	{
-		// Make sure our garbage state is valid
-		// If a cell is written past its end it can corrupt the garbage state of the next cell
-		assert(nextCell->gcState() <= GarbageState::MaximumGarbageState);
+		AllocCell *nextCell = Heap::segmentFirstCell(segment);
 
-		if (nextCell->gcState() != GarbageState::ForwardingCell)
+		while((nextCell->gcState() != GarbageState::HeapTerminator) &&
+				(nextCell->gcState() != GarbageState::SegmentTerminator))
 		{
-			// This value is no longer referenced
-			nextCell->finalize();
-		}
+			// Make sure our garbage state is valid
+			// If a cell is written past its end it can corrupt the garbage state of the next cell
+			assert(nextCell->gcState() <= GarbageState::MaximumGarbageState);
 
-		nextCell++;
+			if (nextCell->gcState() != GarbageState::ForwardingCell)
+			{
+				// This value is no longer referenced
+				nextCell->finalize();
+			}
+
+			nextCell++;
+		}
 	}
+	else if (header->finalizableCellCount() > 0)
+	{
+		// Only visit the cells marked in the bitmap
+		AllocCell *firstCell = Heap::segmentFirstCell(segment);
+		const std::uint64_t *bitmap = header->finalizableBitmap();
 
-	MemoryBlock *nextSegment = nullptr;
+		std::uint32_t remainingCells = header->finalizableCellCount();
 
-	if (nextCell->gcState() == GarbageState::SegmentTerminator)
-	{
-		nextSegment = reinterpret_cast<SegmentTerminatorCell*>(nextCell)->nextSegment();
+		for(std::size_t wordIndex = 0; remainingCells > 0; wordIndex++)
+		{
+			std::uint64_t bitmapWord = bitmap[wordIndex];
+
+			while(bitmapWord != 0)
+			{
+				AllocCell *cell = firstCell + (wordIndex * 64) + __builtin_ctzll(bitmapWord);
+				assert(cell->gcState() <= GarbageState::MaximumGarbageState);
+
+				if (cell->gcState() != GarbageState::ForwardingCell)
+				{
+					cell->finalize();
+				}
+
+				// Clear the lowest set bit
+				bitmapWord &= bitmapWord - 1;
+				remainingCells--;
+			}
+		}
 	}
 
 	// Actually free the block
-	delete rootSegment;
-
-	if (nextSegment != nullptr)
-	{
-		finalizeSegment(nextSegment);
-	}
+	delete segment;
 }
 
-void Finalizer::terminateHeap(Heap &heap)
+std::vector<MemoryBlock*> Finalizer::terminateHeap(Heap &heap)
 {
 	if (heap.m_allocNext != nullptr)
 	{
 		new (heap.m_allocNext) HeapTerminatorCell();
 	}
+
+	// Collect the heap's segments from their headers so they can be finalized independently
+	std::vector<MemoryBlock*> segments;
+
+	for(MemoryBlock *segment = heap.rootSegment(); segment != nullptr; segment = Heap::segmentHeader(segment)->nextSegment())
+	{
+		segments.push_back(segment);
+	}
+
+	return segments;
 }
 
 }
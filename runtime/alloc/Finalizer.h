@@ -1,6 +1,8 @@
 #ifndef _LLIBY_ALLOC_FINALIZER_H
 #define _LLIBY_ALLOC_FINALIZER_H
 
+#include <vector>
+
 namespace lliby
 {
 namespace alloc
@@ -17,8 +19,9 @@ public:
 	static void finalizeHeapSync(Heap &heap);
 
 private:
-	static void finalizeSegment(MemoryBlock *rootSegment);
-	static void terminateHeap(Heap &heap);
+	static void finalizeSegment(MemoryBlock *segment);
+	static void finalizeSegments(const std::vector<MemoryBlock*> &segments);
+	static std::vector<MemoryBlock*> terminateHeap(Heap &heap);
 };
 
 }
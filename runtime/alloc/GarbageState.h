@@ -58,7 +58,25 @@ enum class GarbageState : std::uint8_t
 	 */
 	HeapTerminator = 5,
 
-	MaximumGarbageState = HeapTerminator
+	/**
+	 * Cells that have survived a garbage collection and been promoted to their World's tenured heap
+	 *
+	 * Tenured cells are only relocated or freed by full collections. Minor collections treat them as roots if they're
+	 * in their World's remembered set and otherwise skip them entirely.
+	 */
+	TenuredCell = 6,
+
+	/**
+	 * Cell at the start of every heap segment
+	 *
+	 * This links the segment to the next segment in its heap and tracks if the segment contains cells needing
+	 * finalization. This allows the finalizer to enumerate segments without walking their cells.
+	 *
+	 * These aren't actual cells; they're only used internally by the allocator
+	 */
+	SegmentHeader = 7,
+
+	MaximumGarbageState = SegmentHeader
 };
 
 }
@@ -2,6 +2,8 @@
 
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
+#include <cassert>
 
 #include "alloc/MemoryBlock.h"
 #include "alloc/Finalizer.h"
@@ -15,10 +17,22 @@ namespace
 {
 	const std::size_t SegmentGrowthFactor = 4;
 	const std::size_t SegmentMaximumSize = 1 * 1024 * 1024;
+
+	/**
+	 * Returns the number of cells needed for a finalization bitmap covering the passed number of cells
+	 */
+	std::size_t bitmapCellsFor(std::size_t cellCount)
+	{
+		const std::size_t bitmapBytes = ((cellCount + 63) / 64) * sizeof(std::uint64_t);
+		return (bitmapBytes + sizeof(AllocCell) - 1) / sizeof(AllocCell);
+	}
 }
 
-Heap::Heap(std::size_t initialSegmentSize)
-	: m_initialSegmentSize(initialSegmentSize)
+static_assert(sizeof(SegmentHeaderCell) <= sizeof(AllocCell), "SegmentHeaderCell must fit in a cell");
+
+Heap::Heap(std::size_t initialSegmentSize, bool preciseFinalization)
+	: m_initialSegmentSize(initialSegmentSize),
+	m_preciseFinalization(preciseFinalization)
 {
 	detach();
 }
@@ -33,6 +47,31 @@ void Heap::detach()
 
 	m_currentSegmentStart = nullptr;
 	m_allocationCounterBase = 0;
+
+	m_currentSegmentHeader = nullptr;
+
+	m_segmentCount = 0;
+	m_segmentBytes = 0;
+}
+
+void Heap::noteFinalizableCell()
+{
+	assert(m_preciseFinalization);
+
+	const std::size_t cellIndex = (m_allocNext - 1) - m_currentSegmentStart;
+	m_currentSegmentHeader->markFinalizable(cellIndex);
+}
+
+SegmentHeaderCell* Heap::segmentHeader(MemoryBlock *segment)
+{
+	return static_cast<SegmentHeaderCell*>(segment->startPointer());
+}
+
+AllocCell* Heap::segmentFirstCell(MemoryBlock *segment)
+{
+	// Skip the segment header and any finalization bitmap
+	SegmentHeaderCell *header = segmentHeader(segment);
+	return static_cast<AllocCell*>(segment->startPointer()) + 1 + header->bitmapCellCount();
 }
 
 Heap::~Heap()
@@ -42,7 +81,10 @@ Heap::~Heap()
 
 AllocCell* Heap::addNewSegment(std::size_t reserveCount)
 {
-	const std::size_t minimumBytes = (sizeof(AllocCell) * reserveCount) + sizeof(SegmentTerminatorCell);
+	// Leave room for our segment header and finalization bitmap. The bitmap is sized for the whole segment so allow
+	// slack for it covering itself.
+	const std::size_t overheadCells = 1 + (m_preciseFinalization ? (2 * bitmapCellsFor(reserveCount) + 1) : 0);
+	const std::size_t minimumBytes = (sizeof(AllocCell) * (reserveCount + overheadCells)) + sizeof(SegmentTerminatorCell);
 	std::size_t newSegmentSize;
 
 	if (minimumBytes > m_nextSegmentSize)
@@ -71,20 +113,36 @@ AllocCell* Heap::addNewSegment(std::size_t reserveCount)
 	{
 		// Add a pointer to this new segment at the end of the old segment
 		new (m_allocNext) SegmentTerminatorCell(newSegment);
+		m_currentSegmentHeader->setNextSegment(newSegment);
 
 		// Track the number of allocations made in the previous segment
 		m_allocationCounterBase += currentSegmentAllocations();
 	}
 
-	m_currentSegmentStart = static_cast<AllocCell*>(newSegment->startPointer());
+	const std::size_t actualSegmentSize = newSegment->size(newSegmentSize);
 
-	m_allocNext = m_currentSegmentStart + reserveCount;
+	m_segmentCount++;
+	m_segmentBytes += actualSegmentSize;
 
 	// Find the number of cells we can fit in the segment with room for a segment terminator
-	const std::size_t usableCellCount = (newSegment->size(newSegmentSize) - sizeof(SegmentTerminatorCell)) / sizeof(AllocCell);
+	const std::size_t usableCellCount = (actualSegmentSize - sizeof(SegmentTerminatorCell)) / sizeof(AllocCell);
 
+	std::size_t bitmapCellCount = 0;
+
+	if (m_preciseFinalization)
+	{
+		bitmapCellCount = bitmapCellsFor(usableCellCount - 1);
+	}
+
+	m_currentSegmentHeader = new (newSegment->startPointer()) SegmentHeaderCell(bitmapCellCount);
+	memset(m_currentSegmentHeader->finalizableBitmap(), 0, bitmapCellCount * sizeof(AllocCell));
+
+	m_currentSegmentStart = segmentFirstCell(newSegment);
+	m_allocNext = m_currentSegmentStart + reserveCount;
 	m_allocEnd = reinterpret_cast<AllocCell*>(newSegment->startPointer()) + usableCellCount;
 
+	assert(m_allocNext <= m_allocEnd);
+
 	return m_currentSegmentStart;
 }
 
@@ -106,6 +164,7 @@ void Heap::splice(Heap &other)
 	{
 		// Point the last segment of the passed heap to the beginning of our heap
 		new (other.m_allocNext) SegmentTerminatorCell(oldRoot);
+		other.m_currentSegmentHeader->setNextSegment(oldRoot);
 	}
 	else
 	{
@@ -116,8 +175,18 @@ void Heap::splice(Heap &other)
 		m_nextSegmentSize = other.m_nextSegmentSize;
 		m_currentSegmentStart = other.m_currentSegmentStart;
 		m_allocationCounterBase = -currentSegmentAllocations();
+		m_currentSegmentHeader = other.m_currentSegmentHeader;
+
+		if (!m_preciseFinalization)
+		{
+			// We'll continue allocating in to the other heap's segment without tracking finalizable cells
+			m_currentSegmentHeader->setSweepsAllCells();
+		}
 	}
 
+	m_segmentCount += other.m_segmentCount;
+	m_segmentBytes += other.m_segmentBytes;
+
 	// Destroy the other heap for safety
 	other.detach();
 }
@@ -14,6 +14,7 @@ namespace alloc
 class MemoryBlock;
 class RangeAlloc;
 class AllocCell;
+class SegmentHeaderCell;
 class Finalizer;
 
 /**
@@ -29,8 +30,13 @@ public:
 	 * Creates a new heap
 	 *
 	 * This does not allocate any memory; it initializes a completely empty heap
+	 *
+	 * @param  initialSegmentSize   Size of the first segment to allocate in bytes
+	 * @param  preciseFinalization  If true the owner of the heap will call noteFinalizableCell() for every cell
+	 *                              needing finalization it allocates. Otherwise every cell in the heap is checked for
+	 *                              finalization.
 	 */
-	Heap(std::size_t initialSegementSize);
+	Heap(std::size_t initialSegmentSize, bool preciseFinalization = false);
 
 	/**
 	 * Destroys the Heap by synchronously finalizing all cells on the heap
@@ -103,6 +109,50 @@ public:
 		return m_rootSegment;
 	}
 
+	/**
+	 * Returns the number of memory segments in the heap
+	 */
+	std::size_t segmentCount() const
+	{
+		return m_segmentCount;
+	}
+
+	/**
+	 * Returns the total size of the heap's memory segments in bytes
+	 */
+	std::size_t segmentBytes() const
+	{
+		return m_segmentBytes;
+	}
+
+	/**
+	 * Notes that the most recently allocated cell needs finalization
+	 *
+	 * This records the cell in its segment's finalization bitmap. This is only valid for heaps with precise
+	 * finalization.
+	 */
+	void noteFinalizableCell();
+
+	/**
+	 * Returns the header of the passed segment
+	 */
+	static SegmentHeaderCell* segmentHeader(MemoryBlock *segment);
+
+	/**
+	 * Returns the first allocatable cell of the passed segment
+	 */
+	static AllocCell* segmentFirstCell(MemoryBlock *segment);
+
+	/**
+	 * Returns a pointer to the next cell to be allocated in the current segment
+	 *
+	 * This is used by the collector to scan cells as they're relocated in to the heap
+	 */
+	AllocCell* allocNext() const
+	{
+		return m_allocNext;
+	}
+
 	/**
 	 * Destructively splices the contents of the passed heap in to this heap
 	 *
@@ -137,6 +187,12 @@ private:
 
 	alloc::AllocCell *m_currentSegmentStart;
 	std::size_t m_allocationCounterBase;
+
+	SegmentHeaderCell *m_currentSegmentHeader;
+	bool m_preciseFinalization;
+
+	std::size_t m_segmentCount;
+	std::size_t m_segmentBytes;
 };
 
 }
@@ -3,6 +3,8 @@
 #include <iostream>
 #include <cstdlib>
 
+#include "alloc/SegmentPool.h"
+#include "alloc/SegmentReservation.h"
 #include "platform/memory.h"
 
 namespace lliby
@@ -12,6 +14,25 @@ namespace alloc
 
 MemoryBlock* MemoryBlock::create(std::size_t size)
 {
+	if (void *pooledAlloc = SegmentPool::acquire(size))
+	{
+		return static_cast<MemoryBlock*>(pooledAlloc);
+	}
+
+	// Round up to the pool's size class so the block can be recycled once it's freed
+	size = SegmentPool::pooledSize(size);
+
+	if (SegmentReservation *reservation = SegmentReservation::defaultInstance())
+	{
+		if ((size >= SegmentPool::MinimumClassSize) && (size <= SegmentPool::MaximumClassSize))
+		{
+			if (void *reservedAlloc = reservation->allocate(size))
+			{
+				return static_cast<MemoryBlock*>(reservedAlloc);
+			}
+		}
+	}
+
 	MemoryBlock *newAlloc = static_cast<MemoryBlock*>(malloc(size));
 
 	if (newAlloc == nullptr)
@@ -23,8 +44,32 @@ MemoryBlock* MemoryBlock::create(std::size_t size)
 	return newAlloc;
 }
 
+void MemoryBlock::operator delete(void *p)
+{
+	SegmentReservation *reservation = SegmentReservation::defaultInstance();
+
+	if (reservation && reservation->contains(p))
+	{
+		if (!SegmentPool::release(p, reservation->segmentSize(p)))
+		{
+			reservation->release(p);
+		}
+	}
+	else if (!SegmentPool::release(p, platform::mallocActualSize(p, 0)))
+	{
+		free(p);
+	}
+}
+
 std::size_t MemoryBlock::size(std::size_t requestedSize) const
 {
+	SegmentReservation *reservation = SegmentReservation::defaultInstance();
+
+	if (reservation && reservation->contains(this))
+	{
+		return reservation->segmentSize(this);
+	}
+
 	return platform::mallocActualSize(const_cast<MemoryBlock*>(this), requestedSize);
 }
 
@@ -11,10 +11,10 @@ class MemoryBlock
 public:
 	static MemoryBlock* create(std::size_t size);
 
-	void operator delete(void *p)
-	{
-		free(p);
-	}
+	/**
+	 * Returns the block to the segment pool or frees it
+	 */
+	void operator delete(void *p);
 
 	void* startPointer() const
 	{
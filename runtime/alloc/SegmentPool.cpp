@@ -0,0 +1,295 @@
+#include "alloc/SegmentPool.h"
+
+#include <mutex>
+#include <algorithm>
+#include <cstdint>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "platform/topology.h"
+
+namespace lliby
+{
+namespace alloc
+{
+
+namespace
+{
+	const std::size_t SizeClassCount = SegmentPool::SizeClassCount;
+	const std::size_t SizeClassGrowthFactor = 4;
+
+	// Number of segments each thread can cache per size class
+	const std::size_t ThreadCacheSegments = 4;
+	// Larger segments are only cached in the shared pool to bound the memory stranded on idle threads
+	const std::size_t ThreadCacheMaximumClassSize = 64 * 1024;
+
+	// Bytes per size class kept resident in the shared pool
+	const std::size_t ResidentBytesPerClass = 4 * 1024 * 1024;
+	// Bytes per size class retained in the shared pool including segments returned to the kernel
+	const std::size_t RetainedBytesPerClass = 32 * 1024 * 1024;
+
+	/**
+	 * Free segment linked through its first word
+	 */
+	struct FreeSegment
+	{
+		FreeSegment *next;
+	};
+
+	struct SegmentList
+	{
+		FreeSegment *head = nullptr;
+		std::size_t count = 0;
+
+		void push(void *segment)
+		{
+			auto freeSegment = static_cast<FreeSegment*>(segment);
+
+			freeSegment->next = head;
+			head = freeSegment;
+			count++;
+		}
+
+		void* pop()
+		{
+			FreeSegment *freeSegment = head;
+
+			if (freeSegment != nullptr)
+			{
+				head = freeSegment->next;
+				count--;
+			}
+
+			return freeSegment;
+		}
+	};
+
+	struct SharedSizeClass
+	{
+		std::mutex mutex;
+
+		// Segments with their pages still resident
+		SegmentList resident;
+		// Segments with their pages returned to the kernel
+		SegmentList trimmed;
+	};
+
+	SharedSizeClass SharedClasses[SegmentPool::MaximumNodePartitions][SizeClassCount];
+
+	const std::size_t NoSelectedNode = ~std::size_t(0);
+
+	// Node selected by the innermost NodeScope on this thread
+	thread_local std::size_t SelectedNode = NoSelectedNode;
+
+	/**
+	 * Returns the shared partition to use on the current thread and if the thread's cache can be used
+	 */
+	std::size_t currentPartition(bool *useThreadCache)
+	{
+		const std::size_t runningNode = platform::currentNumaNode();
+		std::size_t node = runningNode;
+
+		if (SelectedNode != NoSelectedNode)
+		{
+			node = SelectedNode;
+		}
+
+		*useThreadCache = (node == runningNode);
+		return node % SegmentPool::MaximumNodePartitions;
+	}
+
+	/**
+	 * Returns the pages of a free segment to the kernel while preserving its free list link
+	 */
+	void trimSegment(void *segment, std::size_t size)
+	{
+		static const std::uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+
+		// Keep the page containing the link and only release whole pages within the segment
+		auto segmentStart = reinterpret_cast<std::uintptr_t>(segment);
+		const std::uintptr_t trimStart = (segmentStart + sizeof(FreeSegment) + pageSize - 1) & ~(pageSize - 1);
+		const std::uintptr_t trimEnd = (segmentStart + size) & ~(pageSize - 1);
+
+		if (trimEnd > trimStart)
+		{
+			madvise(reinterpret_cast<void*>(trimStart), trimEnd - trimStart, MADV_DONTNEED);
+		}
+	}
+
+	void* acquireShared(std::size_t partition, std::size_t sizeClass)
+	{
+		SharedSizeClass &shared = SharedClasses[partition][sizeClass];
+		std::lock_guard<std::mutex> guard(shared.mutex);
+
+		if (void *segment = shared.resident.pop())
+		{
+			return segment;
+		}
+
+		return shared.trimmed.pop();
+	}
+
+	bool releaseShared(void *segment, std::size_t partition, std::size_t sizeClass, bool force = false)
+	{
+		SharedSizeClass &shared = SharedClasses[partition][sizeClass];
+		const std::size_t size = SegmentPool::classSize(sizeClass);
+
+		std::unique_lock<std::mutex> lock(shared.mutex);
+
+		if (force || (((shared.resident.count + 1) * size) <= ResidentBytesPerClass))
+		{
+			shared.resident.push(segment);
+			return true;
+		}
+
+		if (((shared.resident.count + shared.trimmed.count + 1) * size) > RetainedBytesPerClass)
+		{
+			return false;
+		}
+
+		// Trim outside of the lock; the segment isn't visible to other threads until it's pushed
+		lock.unlock();
+		trimSegment(segment, size);
+		lock.lock();
+
+		shared.trimmed.push(segment);
+		return true;
+	}
+
+	class ThreadCache
+	{
+	public:
+		~ThreadCache()
+		{
+			// Return our segments to the shared pool so other threads can use them
+			// We don't know how the segments were allocated so we can't free them ourselves
+			bool useThreadCache;
+			const std::size_t partition = currentPartition(&useThreadCache);
+
+			for(std::size_t sizeClass = 0; sizeClass < SizeClassCount; sizeClass++)
+			{
+				while(void *segment = m_classes[sizeClass].pop())
+				{
+					releaseShared(segment, partition, sizeClass, true);
+				}
+			}
+		}
+
+		void* acquire(std::size_t sizeClass)
+		{
+			return m_classes[sizeClass].pop();
+		}
+
+		bool release(void *segment, std::size_t sizeClass)
+		{
+			SegmentList &list = m_classes[sizeClass];
+
+			if ((list.count >= ThreadCacheSegments) || (SegmentPool::classSize(sizeClass) > ThreadCacheMaximumClassSize))
+			{
+				return false;
+			}
+
+			list.push(segment);
+			return true;
+		}
+
+	private:
+		SegmentList m_classes[SizeClassCount];
+	};
+
+	thread_local ThreadCache LocalCache;
+}
+
+SegmentPool::NodeScope::NodeScope(std::size_t node) :
+	m_previousNode(SelectedNode)
+{
+	SelectedNode = node;
+}
+
+SegmentPool::NodeScope::~NodeScope()
+{
+	SelectedNode = m_previousNode;
+}
+
+std::size_t SegmentPool::classSize(std::size_t sizeClass)
+{
+	std::size_t size = MinimumClassSize;
+
+	while(sizeClass--)
+	{
+		size *= SizeClassGrowthFactor;
+	}
+
+	return size;
+}
+
+std::size_t SegmentPool::sizeClassContaining(std::size_t requestedSize)
+{
+	std::size_t sizeClass = 0;
+
+	while(classSize(sizeClass) < requestedSize)
+	{
+		sizeClass++;
+	}
+
+	return sizeClass;
+}
+
+std::size_t SegmentPool::pooledSize(std::size_t requestedSize)
+{
+	if ((requestedSize < MinimumClassSize) || (requestedSize > MaximumClassSize))
+	{
+		return requestedSize;
+	}
+
+	return classSize(sizeClassContaining(requestedSize));
+}
+
+void* SegmentPool::acquire(std::size_t requestedSize)
+{
+	if ((requestedSize < MinimumClassSize) || (requestedSize > MaximumClassSize))
+	{
+		return nullptr;
+	}
+
+	const std::size_t sizeClass = sizeClassContaining(requestedSize);
+
+	bool useThreadCache;
+	const std::size_t partition = currentPartition(&useThreadCache);
+
+	if (useThreadCache)
+	{
+		if (void *segment = LocalCache.acquire(sizeClass))
+		{
+			return segment;
+		}
+	}
+
+	return acquireShared(partition, sizeClass);
+}
+
+bool SegmentPool::release(void *segment, std::size_t actualSize)
+{
+	// Segments much larger than our largest size class are huge allocations; don't hold on to them
+	if ((actualSize < MinimumClassSize) || (actualSize >= (MaximumClassSize * 2)))
+	{
+		return false;
+	}
+
+	// Find the largest size class the segment can satisfy
+	std::size_t sizeClass = std::min(sizeClassContaining(actualSize), SizeClassCount - 1);
+
+	if (classSize(sizeClass) > actualSize)
+	{
+		sizeClass--;
+	}
+
+	bool useThreadCache;
+	const std::size_t partition = currentPartition(&useThreadCache);
+
+	return (useThreadCache && LocalCache.release(segment, sizeClass)) || releaseShared(segment, partition, sizeClass);
+}
+
+}
+}
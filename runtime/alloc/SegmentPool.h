@@ -0,0 +1,97 @@
+#ifndef _LLIBY_ALLOC_SEGMENTPOOL_H
+#define _LLIBY_ALLOC_SEGMENTPOOL_H
+
+#include <cstddef>
+
+namespace lliby
+{
+namespace alloc
+{
+
+/**
+ * Process-wide pool of recycled heap segments
+ *
+ * Segments are grouped in to power-of-4 size classes between 4KiB and 1MiB. These match the segment sizes Heap grows
+ * through so most segments can be recycled directly. Each thread keeps a small cache of segments per size class to
+ * avoid contending on the shared pool.
+ *
+ * Segments retained by the shared pool past a small resident count have their pages returned to the kernel with
+ * madvise(). This keeps their address space reserved without contributing to the process's RSS.
+ *
+ * The shared pool is partitioned by NUMA node. Segments are taken from and released to the partition for the node the
+ * current thread is running on unless a NodeScope selects another node. Freshly allocated segments are placed by the
+ * kernel on the node of the thread that first touches them.
+ */
+class SegmentPool
+{
+public:
+	static const std::size_t MinimumClassSize = 4 * 1024;
+	static const std::size_t MaximumClassSize = 1024 * 1024;
+	static const std::size_t SizeClassCount = 5;
+
+	/**
+	 * Number of NUMA nodes with their own partition of the shared pool
+	 *
+	 * Nodes beyond this share partitions
+	 */
+	static const std::size_t MaximumNodePartitions = 8;
+
+	/**
+	 * Selects the NUMA node segments are pooled on for the current thread during its lifetime
+	 *
+	 * This is used by actors stolen by a worker on another node so their heap stays on their home node. While the
+	 * selected node differs from the current thread's node the thread's segment cache is bypassed.
+	 */
+	class NodeScope
+	{
+	public:
+		explicit NodeScope(std::size_t node);
+		~NodeScope();
+
+		NodeScope(const NodeScope &) = delete;
+		NodeScope& operator=(const NodeScope &) = delete;
+
+	private:
+		std::size_t m_previousNode;
+	};
+
+	/**
+	 * Returns the size in bytes of segments in the passed size class
+	 */
+	static std::size_t classSize(std::size_t sizeClass);
+
+	/**
+	 * Returns the smallest size class that can contain a segment of the passed size
+	 *
+	 * The requested size must be between MinimumClassSize and MaximumClassSize
+	 */
+	static std::size_t sizeClassContaining(std::size_t requestedSize);
+
+	/**
+	 * Returns the pooled size for a segment of the requested size
+	 *
+	 * If the requested size is outside the pooled size classes it is returned unmodified
+	 */
+	static std::size_t pooledSize(std::size_t requestedSize);
+
+	/**
+	 * Takes a segment of pooledSize(requestedSize) bytes from the pool
+	 *
+	 * @return Segment or nullptr if no segment is available
+	 */
+	static void* acquire(std::size_t requestedSize);
+
+	/**
+	 * Returns a segment to the pool
+	 *
+	 * @param  segment     Segment to release
+	 * @param  actualSize  Usable size of the segment in bytes
+	 * @return True if the segment was pooled. If false is returned the caller retains ownership of the segment.
+	 */
+	static bool release(void *segment, std::size_t actualSize);
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,173 @@
+#include "alloc/SegmentReservation.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/mman.h>
+
+namespace lliby
+{
+namespace alloc
+{
+
+namespace
+{
+	const std::size_t DefaultReservationMegabytes = 1024;
+
+	// Regions are aligned to the size of a huge page on x86-64
+	const std::size_t RegionAlignment = 2 * 1024 * 1024;
+
+	SegmentReservation* createDefaultInstance()
+	{
+		const char *backend = getenv("LLAMBDA_HEAP_SEGMENTS");
+
+		if ((backend == nullptr) || !strcmp(backend, "malloc"))
+		{
+			return nullptr;
+		}
+
+		bool hugePages;
+
+		if (!strcmp(backend, "hugepage"))
+		{
+			hugePages = true;
+		}
+		else if (!strcmp(backend, "mmap"))
+		{
+			hugePages = false;
+		}
+		else
+		{
+			std::cerr << "Unknown LLAMBDA_HEAP_SEGMENTS backend \"" << backend << "\"; using malloc" << std::endl;
+			return nullptr;
+		}
+
+		std::size_t reservationMegabytes = DefaultReservationMegabytes;
+
+		if (const char *reservationString = getenv("LLAMBDA_HEAP_RESERVATION_MB"))
+		{
+			reservationMegabytes = strtoull(reservationString, nullptr, 10);
+		}
+
+		auto reservation = new SegmentReservation(reservationMegabytes * 1024 * 1024, hugePages);
+
+		if (!reservation->isValid())
+		{
+			std::cerr << "Unable to reserve " << reservationMegabytes << "MB for heap segments; using malloc" << std::endl;
+
+			delete reservation;
+			return nullptr;
+		}
+
+		return reservation;
+	}
+}
+
+SegmentReservation::SegmentReservation(std::size_t reservationBytes, bool hugePages)
+{
+	m_regionSize = (reservationBytes / SegmentPool::SizeClassCount) & ~(RegionAlignment - 1);
+
+	for(auto &region : m_regions)
+	{
+		region.nextOffset.store(0, std::memory_order_relaxed);
+	}
+
+	// Each region must be able to hold at least one segment of our largest size class
+	if (m_regionSize < SegmentPool::MaximumClassSize)
+	{
+		m_regionSize = 0;
+		return;
+	}
+
+	const std::size_t mappingSize = m_regionSize * SegmentPool::SizeClassCount;
+	int mapFlags = MAP_PRIVATE | MAP_ANON;
+
+#ifdef MAP_NORESERVE
+	// Don't account for pages until they're committed
+	mapFlags |= MAP_NORESERVE;
+#endif
+
+	void *mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, mapFlags, -1, 0);
+
+	if (mapping == MAP_FAILED)
+	{
+		m_regionSize = 0;
+		return;
+	}
+
+#ifdef MADV_HUGEPAGE
+	if (hugePages)
+	{
+		madvise(mapping, mappingSize, MADV_HUGEPAGE);
+	}
+#else
+	(void)hugePages;
+#endif
+
+	m_start = static_cast<char*>(mapping);
+}
+
+SegmentReservation::~SegmentReservation()
+{
+	if (m_start != nullptr)
+	{
+		munmap(m_start, m_regionSize * SegmentPool::SizeClassCount);
+	}
+}
+
+SegmentReservation* SegmentReservation::defaultInstance()
+{
+	// This is intentionally leaked; segments can be finalized while the process is exiting
+	static SegmentReservation *defaultInstance = createDefaultInstance();
+	return defaultInstance;
+}
+
+void* SegmentReservation::allocate(std::size_t requestedSize)
+{
+	const std::size_t sizeClass = SegmentPool::sizeClassContaining(requestedSize);
+	const std::size_t segmentSize = SegmentPool::classSize(sizeClass);
+	Region &region = m_regions[sizeClass];
+
+	{
+		std::lock_guard<std::mutex> guard(region.freeMutex);
+
+		if (!region.freeSegments.empty())
+		{
+			void *segment = region.freeSegments.back();
+			region.freeSegments.pop_back();
+
+			return segment;
+		}
+	}
+
+	std::size_t offset = region.nextOffset.fetch_add(segmentSize, std::memory_order_relaxed);
+
+	if ((offset + segmentSize) > m_regionSize)
+	{
+		// Region is exhausted
+		region.nextOffset.store(m_regionSize, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	return m_start + (sizeClass * m_regionSize) + offset;
+}
+
+void SegmentReservation::release(void *segment)
+{
+	Region &region = m_regions[regionIndex(segment)];
+
+	// Uncommit the segment's pages while leaving them mapped
+	madvise(segment, segmentSize(segment), MADV_DONTNEED);
+
+	std::lock_guard<std::mutex> guard(region.freeMutex);
+	region.freeSegments.push_back(segment);
+}
+
+std::size_t SegmentReservation::segmentSize(const void *segment) const
+{
+	return SegmentPool::classSize(regionIndex(segment));
+}
+
+}
+}
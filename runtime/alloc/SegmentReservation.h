@@ -0,0 +1,116 @@
+#ifndef _LLIBY_ALLOC_SEGMENTRESERVATION_H
+#define _LLIBY_ALLOC_SEGMENTRESERVATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "alloc/SegmentPool.h"
+
+namespace lliby
+{
+namespace alloc
+{
+
+/**
+ * Range of virtual memory reserved up front with mmap() that heap segments are committed from
+ *
+ * The reservation is divided in to one region per SegmentPool size class. Each region hands out segments of a single
+ * size which allows the size of any segment to be determined from its address. Pages are only committed by the
+ * kernel once they're touched.
+ *
+ * If transparent huge pages are requested the reservation is marked with MADV_HUGEPAGE. Because segments are packed
+ * contiguously within their region this lets small segments share huge pages, reducing TLB misses while collecting
+ * and finalizing large heaps.
+ */
+class SegmentReservation
+{
+public:
+	/**
+	 * Reserves a range of virtual memory
+	 *
+	 * @param  reservationBytes  Size of the range to reserve in bytes
+	 * @param  hugePages         If true the range is advised to use transparent huge pages
+	 */
+	SegmentReservation(std::size_t reservationBytes, bool hugePages);
+	~SegmentReservation();
+
+	SegmentReservation(const SegmentReservation &) = delete;
+	SegmentReservation& operator=(const SegmentReservation &) = delete;
+
+	/**
+	 * Returns the process-wide reservation or nullptr if heap segments should use malloc()
+	 *
+	 * This is configured with the following environment variables the first time it's called:
+	 *
+	 * LLAMBDA_HEAP_SEGMENTS selects the segment backend. This can be "malloc" (the default), "mmap" or "hugepage".
+	 * LLAMBDA_HEAP_RESERVATION_MB sets the size of the reservation in megabytes. This defaults to 1024.
+	 */
+	static SegmentReservation* defaultInstance();
+
+	/**
+	 * Returns if the reservation was successfully mapped
+	 */
+	bool isValid() const
+	{
+		return m_start != nullptr;
+	}
+
+	/**
+	 * Commits a segment from the reservation
+	 *
+	 * @param  requestedSize  Size of the segment in bytes. This must be between SegmentPool::MinimumClassSize and
+	 *                        SegmentPool::MaximumClassSize.
+	 * @return Segment of SegmentPool::pooledSize(requestedSize) bytes or nullptr if the region for its size class is
+	 *         exhausted
+	 */
+	void* allocate(std::size_t requestedSize);
+
+	/**
+	 * Returns a segment to the reservation
+	 *
+	 * The segment's pages are returned to the kernel but its address space remains reserved for reuse
+	 */
+	void release(void *segment);
+
+	/**
+	 * Returns if the passed pointer was allocated from the reservation
+	 */
+	bool contains(const void *pointer) const
+	{
+		auto address = reinterpret_cast<std::uintptr_t>(pointer);
+		auto start = reinterpret_cast<std::uintptr_t>(m_start);
+
+		return (address >= start) && (address < (start + m_regionSize * SegmentPool::SizeClassCount));
+	}
+
+	/**
+	 * Returns the size of a segment allocated from the reservation
+	 */
+	std::size_t segmentSize(const void *segment) const;
+
+private:
+	struct Region
+	{
+		std::atomic<std::size_t> nextOffset;
+
+		std::mutex freeMutex;
+		std::vector<void*> freeSegments;
+	};
+
+	std::size_t regionIndex(const void *segment) const
+	{
+		return (static_cast<const char*>(segment) - m_start) / m_regionSize;
+	}
+
+	char *m_start = nullptr;
+	std::size_t m_regionSize = 0;
+	Region m_regions[SegmentPool::SizeClassCount];
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,242 @@
+#include "alloc/StatisticsRecorder.h"
+
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+#include <semaphore.h>
+#include <signal.h>
+#include <unistd.h>
+
+namespace lliby
+{
+namespace alloc
+{
+
+namespace
+{
+	struct Registry
+	{
+		std::mutex mutex;
+		std::vector<StatisticsRecorder*> liveRecorders;
+
+		CollectionStatistics retiredStatistics;
+		std::uint64_t retiredWorlds = 0;
+
+		std::string destination;
+	};
+
+	Registry *registryInstance = nullptr;
+
+	// The signal handler can only post to this; the dump is written by a dedicated thread
+	sem_t dumpSemaphore;
+
+	void dumpProcessStatistics()
+	{
+		// Serialise dumps from the signal thread and process exit
+		static std::mutex dumpMutex;
+		std::lock_guard<std::mutex> guard(dumpMutex);
+
+		if (registryInstance->destination == "stderr")
+		{
+			StatisticsRecorder::writeProcessJson(std::cerr);
+		}
+		else
+		{
+			std::ofstream dumpStream(registryInstance->destination, std::ios::app);
+			StatisticsRecorder::writeProcessJson(dumpStream);
+		}
+	}
+
+	void handleDumpSignal(int)
+	{
+		sem_post(&dumpSemaphore);
+	}
+
+	Registry* createRegistry()
+	{
+		const char *destination = getenv("LLAMBDA_GC_STATS");
+
+		if ((destination == nullptr) || (*destination == 0))
+		{
+			return nullptr;
+		}
+
+		// This is intentionally leaked; statistics are dumped after static destructors may have run
+		registryInstance = new Registry;
+		registryInstance->destination = destination;
+
+		sem_init(&dumpSemaphore, 0, 0);
+
+		std::thread([] {
+			while(true)
+			{
+				if (sem_wait(&dumpSemaphore) == 0)
+				{
+					dumpProcessStatistics();
+				}
+			}
+		}).detach();
+
+		struct sigaction dumpAction;
+		memset(&dumpAction, 0, sizeof(dumpAction));
+
+		dumpAction.sa_handler = handleDumpSignal;
+		dumpAction.sa_flags = SA_RESTART;
+		sigemptyset(&dumpAction.sa_mask);
+
+		sigaction(SIGUSR1, &dumpAction, nullptr);
+		atexit(dumpProcessStatistics);
+
+		return registryInstance;
+	}
+
+	Registry* registry()
+	{
+		static Registry *instance = createRegistry();
+		return instance;
+	}
+}
+
+void CollectionStatistics::merge(const CollectionStatistics &other)
+{
+	minorCollections += other.minorCollections;
+	fullCollections += other.fullCollections;
+	totalPauseNanoseconds += other.totalPauseNanoseconds;
+	maximumPauseNanoseconds = std::max(maximumPauseNanoseconds, other.maximumPauseNanoseconds);
+	copiedCells += other.copiedCells;
+	finalizedBytes += other.finalizedBytes;
+	segmentCount += other.segmentCount;
+	heapBytes += other.heapBytes;
+	peakHeapBytes = std::max(peakHeapBytes, other.peakHeapBytes);
+}
+
+void CollectionStatistics::writeJson(std::ostream &out) const
+{
+	out << "{\"minorCollections\":" << minorCollections
+		<< ",\"fullCollections\":" << fullCollections
+		<< ",\"totalPauseNanoseconds\":" << totalPauseNanoseconds
+		<< ",\"maximumPauseNanoseconds\":" << maximumPauseNanoseconds
+		<< ",\"copiedCells\":" << copiedCells
+		<< ",\"finalizedBytes\":" << finalizedBytes
+		<< ",\"segmentCount\":" << segmentCount
+		<< ",\"heapBytes\":" << heapBytes
+		<< ",\"peakHeapBytes\":" << peakHeapBytes
+		<< "}";
+}
+
+StatisticsRecorder::StatisticsRecorder()
+{
+	Registry *processRegistry = registry();
+	m_registered = (processRegistry != nullptr);
+
+	if (m_registered)
+	{
+		std::lock_guard<std::mutex> guard(processRegistry->mutex);
+		processRegistry->liveRecorders.push_back(this);
+	}
+}
+
+StatisticsRecorder::~StatisticsRecorder()
+{
+	if (m_registered)
+	{
+		Registry *processRegistry = registry();
+		std::lock_guard<std::mutex> guard(processRegistry->mutex);
+
+		auto &liveRecorders = processRegistry->liveRecorders;
+		liveRecorders.erase(std::find(liveRecorders.begin(), liveRecorders.end(), this));
+
+		// Our heaps are being released
+		CollectionStatistics finalStatistics(statistics());
+		finalStatistics.segmentCount = 0;
+		finalStatistics.heapBytes = 0;
+
+		processRegistry->retiredStatistics.merge(finalStatistics);
+		processRegistry->retiredWorlds++;
+	}
+}
+
+void StatisticsRecorder::recordCollection(CollectionType type, std::uint64_t pauseNanoseconds, std::size_t copiedCells,
+		std::size_t finalizedBytes, std::size_t peakHeapBytes, std::size_t segmentCount, std::size_t heapBytes)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	if (type == CollectionType::Full)
+	{
+		m_statistics.fullCollections++;
+	}
+	else
+	{
+		m_statistics.minorCollections++;
+	}
+
+	m_statistics.totalPauseNanoseconds += pauseNanoseconds;
+	m_statistics.maximumPauseNanoseconds = std::max(m_statistics.maximumPauseNanoseconds, pauseNanoseconds);
+	m_statistics.copiedCells += copiedCells;
+	m_statistics.finalizedBytes += finalizedBytes;
+	m_statistics.segmentCount = segmentCount;
+	m_statistics.heapBytes = heapBytes;
+	m_statistics.peakHeapBytes = std::max<std::uint64_t>(m_statistics.peakHeapBytes, peakHeapBytes);
+}
+
+CollectionStatistics StatisticsRecorder::statistics() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_statistics;
+}
+
+void StatisticsRecorder::writeProcessJson(std::ostream &out)
+{
+	Registry *processRegistry = registry();
+
+	if (processRegistry == nullptr)
+	{
+		return;
+	}
+
+	std::vector<CollectionStatistics> liveStatistics;
+	CollectionStatistics retiredStatistics;
+	std::uint64_t retiredWorlds;
+
+	{
+		std::lock_guard<std::mutex> guard(processRegistry->mutex);
+
+		for(auto recorder : processRegistry->liveRecorders)
+		{
+			liveStatistics.push_back(recorder->statistics());
+		}
+
+		retiredStatistics = processRegistry->retiredStatistics;
+		retiredWorlds = processRegistry->retiredWorlds;
+	}
+
+	CollectionStatistics totalStatistics(retiredStatistics);
+
+	out << "{\"pid\":" << getpid() << ",\"worlds\":[";
+
+	for(std::size_t i = 0; i < liveStatistics.size(); i++)
+	{
+		if (i > 0)
+		{
+			out << ",";
+		}
+
+		liveStatistics[i].writeJson(out);
+		totalStatistics.merge(liveStatistics[i]);
+	}
+
+	out << "],\"retiredWorlds\":" << retiredWorlds << ",\"retired\":";
+	retiredStatistics.writeJson(out);
+	out << ",\"total\":";
+	totalStatistics.writeJson(out);
+	out << "}" << std::endl;
+}
+
+}
+}
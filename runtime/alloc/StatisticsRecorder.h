@@ -0,0 +1,121 @@
+#ifndef _LLIBY_ALLOC_STATISTICSRECORDER_H
+#define _LLIBY_ALLOC_STATISTICSRECORDER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <mutex>
+
+#include "alloc/allocator.h"
+
+namespace lliby
+{
+namespace alloc
+{
+
+/**
+ * Snapshot of the collection statistics for a World
+ */
+struct CollectionStatistics
+{
+	std::uint64_t minorCollections = 0;
+	std::uint64_t fullCollections = 0;
+
+	/**
+	 * Total and longest time the World was paused for collection
+	 *
+	 * This doesn't include finalization performed in the background
+	 */
+	std::uint64_t totalPauseNanoseconds = 0;
+	std::uint64_t maximumPauseNanoseconds = 0;
+
+	/**
+	 * Total number of cells relocated by the collector
+	 */
+	std::uint64_t copiedCells = 0;
+
+	/**
+	 * Total size of the heap segments handed to the finalizer in bytes
+	 */
+	std::uint64_t finalizedBytes = 0;
+
+	/**
+	 * Number and size of the World's heap segments after its last collection
+	 */
+	std::uint64_t segmentCount = 0;
+	std::uint64_t heapBytes = 0;
+
+	/**
+	 * Largest size of the World's heap segments in bytes
+	 *
+	 * This is sampled during collection when both the old and new heaps are allocated
+	 */
+	std::uint64_t peakHeapBytes = 0;
+
+	/**
+	 * Merges the statistics of another World in to this snapshot
+	 *
+	 * Counters are summed while maximums are preserved
+	 */
+	void merge(const CollectionStatistics &other);
+
+	/**
+	 * Writes the statistics as a JSON object
+	 */
+	void writeJson(std::ostream &out) const;
+};
+
+/**
+ * Records collection statistics for a World
+ *
+ * Recording is always enabled; it only costs a few arithmetic operations per collection. If the LLAMBDA_GC_STATS
+ * environment variable is set the statistics for every World are also written as a line of JSON on exit or when the
+ * process receives SIGUSR1. The variable names a file to append to or "stderr".
+ */
+class StatisticsRecorder
+{
+public:
+	StatisticsRecorder();
+	~StatisticsRecorder();
+
+	StatisticsRecorder(const StatisticsRecorder &) = delete;
+	StatisticsRecorder& operator=(const StatisticsRecorder &) = delete;
+
+	/**
+	 * Records a completed collection
+	 *
+	 * @param  type               Type of the collection
+	 * @param  pauseNanoseconds   Time the World was paused for
+	 * @param  copiedCells        Number of cells relocated by the collection
+	 * @param  finalizedBytes     Size of the heap segments handed to the finalizer
+	 * @param  peakHeapBytes      Size of the World's heap segments before finalization
+	 * @param  segmentCount       Number of segments in the World's heaps after collection
+	 * @param  heapBytes          Size of the World's heap segments after collection
+	 */
+	void recordCollection(CollectionType type, std::uint64_t pauseNanoseconds, std::size_t copiedCells,
+			std::size_t finalizedBytes, std::size_t peakHeapBytes, std::size_t segmentCount, std::size_t heapBytes);
+
+	/**
+	 * Returns a snapshot of the recorded statistics
+	 *
+	 * This is safe to call from any thread
+	 */
+	CollectionStatistics statistics() const;
+
+	/**
+	 * Writes the statistics of every World in the process as a single line of JSON
+	 *
+	 * Only Worlds created while LLAMBDA_GC_STATS is set are included
+	 */
+	static void writeProcessJson(std::ostream &out);
+
+private:
+	mutable std::mutex m_mutex;
+	CollectionStatistics m_statistics;
+	bool m_registered;
+};
+
+}
+}
+
+#endif
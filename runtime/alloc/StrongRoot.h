@@ -0,0 +1,81 @@
+#ifndef _LLIBY_ALLOC_STRONGROOT_H
+#define _LLIBY_ALLOC_STRONGROOT_H
+
+#include <cstddef>
+#include <cassert>
+#include <exception>
+
+#include "core/World.h"
+
+namespace lliby
+{
+class AnyCell;
+
+namespace alloc
+{
+
+/**
+ * Entry on a World's shadow stack of garbage collector roots
+ *
+ * Each entry roots a contiguous array of cell pointers. Entries are pushed and popped in LIFO order by the code owning
+ * the cell pointers. The collector will update the pointers in place when it relocates the referenced cells.
+ *
+ * Generated code pushes these entries directly. Any changes to the content, size or order of these fields will require
+ * codegen changes.
+ */
+struct ShadowStackEntry
+{
+	ShadowStackEntry *next;
+	AnyCell **cellRefs;
+	std::size_t cellCount;
+};
+
+/**
+ * Roots one or more cell pointers for the lifetime of the instance
+ *
+ * This allows native code to hold cell pointers across a safe-point in a non-actor World. The referenced pointers
+ * may be modified by the collector; callers must reload them after any operation that can collect garbage.
+ */
+template<class T>
+class StrongRoot
+{
+public:
+	StrongRoot(World &world, T **cellRef, std::size_t cellCount = 1) :
+		m_world(world)
+	{
+		m_entry.next = world.shadowStackHead;
+		m_entry.cellRefs = reinterpret_cast<AnyCell**>(cellRef);
+		m_entry.cellCount = cellCount;
+
+		// Our destructor unlinks m_entry before it goes out of scope. GCC can't see this once a loop is between the two
+		// and warns that the entry dangles.
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 12)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdangling-pointer"
+#endif
+		world.shadowStackHead = &m_entry;
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 12)
+#pragma GCC diagnostic pop
+#endif
+	}
+
+	~StrongRoot()
+	{
+		// Roots must be released in the reverse order they were created. Generated code doesn't pop its entries when an
+		// exception unwinds through it so restore our predecessor instead of popping the current head.
+		assert(std::uncaught_exception() || (m_world.shadowStackHead == &m_entry));
+		m_world.shadowStackHead = m_entry.next;
+	}
+
+	StrongRoot(const StrongRoot &) = delete;
+	StrongRoot& operator=(const StrongRoot &) = delete;
+
+private:
+	World &m_world;
+	ShadowStackEntry m_entry;
+};
+
+}
+}
+
+#endif
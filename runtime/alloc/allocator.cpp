@@ -1,6 +1,7 @@
 #include "alloc/allocator.h"
 
 #include <cstdlib>
+#include <chrono>
 
 #include "core/World.h"
 
@@ -8,6 +9,8 @@
 #include "alloc/RangeAlloc.h"
 #include "alloc/Finalizer.h"
 #include "alloc/collector.h"
+#include "alloc/CollectionPolicy.h"
+#include "alloc/StatisticsRecorder.h"
 
 #ifdef _LLIBY_CHECK_LEAKS
 #include <iostream>
@@ -28,9 +31,21 @@ namespace alloc
 
 namespace
 {
-#ifndef _LLIBY_ALWAYS_GC
-	const std::size_t MaxAllocBeforeForceGc = 1024 * 1024;
+	void finalizeHeap(Heap &heap)
+	{
+		/* We can normally finalize memory in a background thread for better concurrency. However,  ALWAYS_GC
+		 * immediately marks the memory as inaccessible which means the finalizer must be done with it before we return
+		 * from collection.
+		 */
+#if !defined(_LLIBY_ALWAYS_GC)
+		Finalizer::finalizeHeapAsync(heap);
+#else
+		Finalizer::finalizeHeapSync(heap);
 #endif
+
+		// The finalizer should've emptied us
+		assert(heap.isEmpty());
+	}
 }
 
 void reportGlobalLeaks()
@@ -61,7 +76,15 @@ void reportGlobalLeaks()
 
 AllocCell *allocateCells(World &world, std::size_t count)
 {
-	return static_cast<AllocCell*>(world.cellHeap.allocate(count));
+	auto allocation = static_cast<AllocCell*>(world.cellHeap.allocate(count));
+
+	// Actor worlds are only collected between messages by actor::Runner
+	if (!world.actorContext() && collectionPending(world))
+	{
+		world.gcPollRequested = true;
+	}
+
+	return allocation;
 }
 
 RangeAlloc allocateRange(World &world, std::size_t count)
@@ -72,46 +95,88 @@ RangeAlloc allocateRange(World &world, std::size_t count)
 	return RangeAlloc(start, end);
 }
 
-void conditionalCollection(World &world)
+bool collectionPending(World &world, std::size_t triggerMultiplier)
 {
 #ifndef _LLIBY_ALWAYS_GC
-	if (world.cellHeap.allocationCounter() > MaxAllocBeforeForceGc)
-	{
+	return world.cellHeap.allocationCounter() > (world.collectionPolicy().nurseryTrigger() * triggerMultiplier);
+#else
+	return true;
 #endif
-		forceCollection(world);
+}
+
+void conditionalCollection(World &world)
+{
 #ifndef _LLIBY_ALWAYS_GC
+	if (collectionPending(world))
+	{
+		forceCollection(world, world.collectionPolicy().nextCollectionType());
 	}
+#else
+	forceCollection(world);
 #endif
 }
 
-std::size_t forceCollection(World &world)
+std::size_t forceCollection(World &world, CollectionType type)
 {
+	const auto startTime = std::chrono::steady_clock::now();
+
 	// Make a new cell heap
-	Heap nextCellHeap(World::InitialHeapSegmentSize);
+	// This is only allocated in to by the collector until it's spliced in to our cell heap
+	Heap nextCellHeap(World::InitialHeapSegmentSize, true);
 
-	// Collect in to the new world
-	const std::size_t reachableCells = collect(world, nextCellHeap);
+	std::size_t relocatedCells;
+	std::size_t promotedCells;
+	std::size_t finalizedBytes = world.cellHeap.segmentBytes();
+	std::size_t peakHeapBytes;
 
-	/* We can normally finalize memory in a background thread for better concurrency. However,  ALWAYS_GC
-	 * immediately marks the memory as inaccessible which means the finalizer must be done with it before we return
-	 * from collection.
-	 */
-#if !defined(_LLIBY_ALWAYS_GC)
-	Finalizer::finalizeHeapAsync(world.cellHeap);
-#else
-	Finalizer::finalizeHeapSync(world.cellHeap);
-#endif
+	if (type == CollectionType::Full)
+	{
+		// Relocate every reachable cell in to a new tenured heap
+		Heap nextTenuredHeap(World::InitialHeapSegmentSize, true);
+		relocatedCells = collect(world, nextCellHeap, nextTenuredHeap, type);
+		promotedCells = nextTenuredHeap.allocationCounter();
+
+		finalizedBytes += world.tenuredHeap().segmentBytes();
+		peakHeapBytes = finalizedBytes + nextCellHeap.segmentBytes() + nextTenuredHeap.segmentBytes();
 
-	// The finalizer should've emptied us
-	assert(world.cellHeap.isEmpty());
+		// Splicing resets the allocation counter so it only counts promotions since this collection
+		finalizeHeap(world.tenuredHeap());
+		world.tenuredHeap().splice(nextTenuredHeap);
+	}
+	else
+	{
+		// Promote in to our existing tenured heap
+		const std::size_t tenuredCellsBefore = world.tenuredHeap().allocationCounter();
+		relocatedCells = collect(world, nextCellHeap, world.tenuredHeap(), type);
+		promotedCells = world.tenuredHeap().allocationCounter() - tenuredCellsBefore;
+		peakHeapBytes = finalizedBytes + nextCellHeap.segmentBytes() + world.tenuredHeap().segmentBytes();
+	}
+
+	finalizeHeap(world.cellHeap);
+
+	// Cells that can't be tenured survive in the nursery
+	const std::size_t youngCells = nextCellHeap.allocationCounter();
 
 	// Splice in the new cells
 	world.cellHeap.splice(nextCellHeap);
 
 	// We should have zero allocation counter now
 	assert(world.cellHeap.allocationCounter() == 0);
+	world.gcPollRequested = false;
+
+	world.collectionPolicy().collectionFinished(type, promotedCells, youngCells);
+
+	const auto pauseTime = std::chrono::steady_clock::now() - startTime;
+
+	world.statisticsRecorder().recordCollection(type,
+			std::chrono::duration_cast<std::chrono::nanoseconds>(pauseTime).count(),
+			relocatedCells,
+			finalizedBytes,
+			peakHeapBytes,
+			world.cellHeap.segmentCount() + world.tenuredHeap().segmentCount(),
+			world.cellHeap.segmentBytes() + world.tenuredHeap().segmentBytes());
 
-	return reachableCells;
+	return relocatedCells;
 }
 
 }
@@ -13,23 +13,54 @@ namespace alloc
 class AllocCell;
 class RangeAlloc;
 
+enum class CollectionType
+{
+	/**
+	 * Relocates reachable cells from the World's cell heap in to its tenured heap
+	 *
+	 * Tenured cells are only visited if they're in the World's remembered set
+	 */
+	Minor,
+
+	/**
+	 * Relocates every reachable cell in the World
+	 */
+	Full
+};
+
 void reportGlobalLeaks();
 
 /**
  * Allocator for AnyCells
+ *
+ * This sets World::gcPollRequested once a non-actor World has a collection pending
  */
 AllocCell *allocateCells(World &, std::size_t count = 1);
 RangeAlloc allocateRange(World &, std::size_t count);
 
+/**
+ * Returns if the World should be collected at its next safe-point
+ *
+ * @param  world              World to check
+ * @param  triggerMultiplier  Multiplier for the World's nursery trigger. This allows callers with a better time to
+ *                            collect to defer collection.
+ */
+bool collectionPending(World &world, std::size_t triggerMultiplier = 1);
+
 /**
  * Provide a safe-point to perform a GC allocation
+ *
+ * All live cells in the world must be reachable from its dynamic state, actor context or shadow stack. Native code
+ * holding cell pointers across a safe-point must root them with StrongRoot.
  */
 void conditionalCollection(World &world);
 
 /**
- * Forces a GC collection returning the number of reachable cells
+ * Forces a GC collection returning the number of relocated cells
+ *
+ * For full collections this is the number of reachable cells in the World
  */
-std::size_t forceCollection(World &world);
+std::size_t forceCollection(World &world, CollectionType type = CollectionType::Full);
 
 }
 }
@@ -2,6 +2,7 @@
 
 #include <cstring>
 #include <cassert>
+#include <vector>
 
 #include "core/World.h"
 
@@ -9,13 +10,21 @@
 #include "alloc/AllocCell.h"
 #include "alloc/CellRefWalker.h"
 #include "alloc/Heap.h"
+#include "alloc/MemoryBlock.h"
+#include "alloc/StrongRoot.h"
 
 #include "actor/ActorContext.h"
 
 #include "binding/AnyCell.h"
+#include "binding/VectorCell.h"
+#include "binding/RecordLikeCell.h"
+#include "binding/RecordCell.h"
+#include "binding/HashMapCell.h"
 
 #include "dynamic/State.h"
 
+#include "hash/DatumHashTree.h"
+
 namespace lliby
 {
 namespace alloc
@@ -45,15 +54,109 @@ namespace
 	private:
 		AnyCell *m_newLocation;
 	};
+
+	/**
+	 * Internal class to mark relocated cells as tenured
+	 */
+	class TenuringCell : public AnyCell
+	{
+	public:
+		static void tenure(AnyCell *cell)
+		{
+			static_cast<TenuringCell*>(cell)->setGcState(GarbageState::TenuredCell);
+		}
+
+		static void makeYoung(AnyCell *cell)
+		{
+			static_cast<TenuringCell*>(cell)->setGcState(GarbageState::HeapAllocatedCell);
+		}
+	};
+
+	/**
+	 * Returns if a cell can be promoted to the tenured heap
+	 *
+	 * Vectors and record-likes can be mutated by compiled code without a write barrier. They always remain in the cell
+	 * heap so they never need a remembered set entry.
+	 */
+	bool isTenurable(AnyCell *cell)
+	{
+		return !VectorCell::isInstance(cell) && !RecordLikeCell::isInstance(cell);
+	}
+
+	/**
+	 * Returns if a cell is allocated in a World's cell heap
+	 */
+	bool isYoung(AnyCell *cell)
+	{
+		return cell->gcState() == GarbageState::HeapAllocatedCell;
+	}
+
+	/**
+	 * Iterates over cells as they're relocated in to a heap
+	 *
+	 * This implements the scan pointer of a Cheney scan. Every cell between the scan pointer and the heap's allocation
+	 * pointer has been relocated but its children haven't been visited yet.
+	 */
+	class HeapScanner
+	{
+	public:
+		explicit HeapScanner(Heap &heap) :
+			m_heap(heap),
+			m_scanCell(heap.allocNext())
+		{
+		}
+
+		/**
+		 * Returns the next unscanned cell or nullptr if the scan has caught up with the heap's allocations
+		 */
+		AllocCell* nextCell()
+		{
+			if (m_scanCell == nullptr)
+			{
+				if (m_heap.isEmpty())
+				{
+					// Nothing has been allocated yet
+					return nullptr;
+				}
+
+				m_scanCell = Heap::segmentFirstCell(m_heap.rootSegment());
+			}
+
+			while(m_scanCell != m_heap.allocNext())
+			{
+				if (m_scanCell->gcState() == GarbageState::SegmentTerminator)
+				{
+					// Continue scanning in the next segment
+					MemoryBlock *nextSegment = reinterpret_cast<SegmentTerminatorCell*>(m_scanCell)->nextSegment();
+					m_scanCell = Heap::segmentFirstCell(nextSegment);
+
+					continue;
+				}
+
+				return m_scanCell++;
+			}
+
+			return nullptr;
+		}
+
+	private:
+		Heap &m_heap;
+		AllocCell *m_scanCell;
+	};
 }
 
-std::size_t collect(World &world, Heap &newHeap)
+std::size_t collect(World &world, Heap &newHeap, Heap &tenuredHeap, CollectionType type)
 {
-	std::size_t reachableCells = 0;
+	std::size_t relocatedCells = 0;
 
 	CellRefWalker walker;
 
-	auto rootVisitor = [&] (AnyCell **cellRef) -> bool
+	// Start our scans at the current end of each heap. For minor collections the tenured heap will already contain
+	// cells that must not be scanned.
+	HeapScanner newHeapScanner(newHeap);
+	HeapScanner tenuredHeapScanner(tenuredHeap);
+
+	auto forwardingVisitor = [&] (AnyCell **cellRef) -> bool
 	{
 		AnyCell *oldCellLocation = *cellRef;
 		GarbageState gcState = oldCellLocation->gcState();
@@ -73,50 +176,270 @@ std::size_t collect(World &world, Heap &newHeap)
 		else if (gcState == GarbageState::StackAllocatedCell)
 		{
 			// Stack allocated cells may reference heap allocated cells but they must not be relocated themselves.
-			// Visit our children but skip the below relocation logic.
+			// They will never be scanned in the new heap so visit our children directly
 			return true;
 		}
+		else if ((gcState == GarbageState::TenuredCell) && (type == CollectionType::Minor))
+		{
+			// Tenured cells only reference young cells if they're in the remembered set
+			return false;
+		}
 
-		// It must be HeapAllocatedCell otherwise we have memory corruption
-		assert(gcState == GarbageState::HeapAllocatedCell);
+		// It must be a heap allocated or tenured cell otherwise we have memory corruption
+		assert((gcState == GarbageState::HeapAllocatedCell) || (gcState == GarbageState::TenuredCell));
+
+		// Every surviving cell is promoted if possible
+		const bool tenure = isTenurable(oldCellLocation);
+		Heap &destHeap = tenure ? tenuredHeap : newHeap;
 
 		// Move the cell to the new location
-		AnyCell *newCellLocation = static_cast<AnyCell*>(newHeap.allocate(1));
+		AnyCell *newCellLocation = static_cast<AnyCell*>(destHeap.allocate(1));
 		memcpy(newCellLocation, oldCellLocation, sizeof(AllocCell));
 
+		if (tenure)
+		{
+			TenuringCell::tenure(newCellLocation);
+		}
+		else
+		{
+			// Cells that can't be tenured may have been left in the tenured heap by moveReachable()
+			TenuringCell::makeYoung(newCellLocation);
+		}
+
+		if (newCellLocation->needsFinalization())
+		{
+			destHeap.noteFinalizableCell();
+		}
+
 		// Update the reference to it
 		*cellRef = newCellLocation;
 
 		// Make the old cell a forwarding cell
 		new (oldCellLocation) ForwardingCell(newCellLocation);
 
-		// Track this as reachable
-		reachableCells++;
+		// Track this as relocated
+		relocatedCells++;
+
+		// The cell's children will be visited when its new heap is scanned
+		return false;
+	};
+
+	std::vector<AnyCell*> &rememberedCells = world.rememberedCells();
+
+	// Forwards the children of a tenured cell and adds it to the remembered set if it still references young cells
+	auto scanTenuredCell = [&] (AnyCell *cell, std::vector<AnyCell*> &newRememberedCells)
+	{
+		bool referencesYoung = false;
 
-		// Visit the cell's children
-		return true;
+		walker.visitChildren(cell, [&] (AnyCell **childCellRef) {
+			walker.visitCell(childCellRef, forwardingVisitor);
+			referencesYoung = referencesYoung || isYoung(*childCellRef);
+		});
+
+		if (referencesYoung)
+		{
+			newRememberedCells.push_back(cell);
+		}
 	};
 
+	std::vector<AnyCell*> newRememberedCells;
+
+	if (type == CollectionType::Minor)
+	{
+		// The remembered set acts as an additional set of roots
+		for(AnyCell *rememberedCell : rememberedCells)
+		{
+			scanTenuredCell(rememberedCell, newRememberedCells);
+		}
+	}
+
 	// Visit the dynamic state
-	walker.visitDynamicState(world.activeState(), rootVisitor);
+	walker.visitDynamicState(world.activeState(), forwardingVisitor);
+
+	// Visit any cells explicitly rooted by native or generated code
+	for(ShadowStackEntry *entry = world.shadowStackHead; entry != nullptr; entry = entry->next)
+	{
+		for(std::size_t i = 0; i < entry->cellCount; i++)
+		{
+			if (entry->cellRefs[i] != nullptr)
+			{
+				walker.visitCell(&entry->cellRefs[i], forwardingVisitor);
+			}
+		}
+	}
 
 	// Is this world an actor?
 	if (world.actorContext())
 	{
-		walker.visitCell(reinterpret_cast<AnyCell**>(world.actorContext()->closureRef()), rootVisitor);
+		walker.visitCell(reinterpret_cast<AnyCell**>(world.actorContext()->closureRef()), forwardingVisitor);
 
 		if (world.actorContext()->behaviour())
 		{
-			walker.visitCell(reinterpret_cast<AnyCell**>(world.actorContext()->behaviourRef()), rootVisitor);
+			walker.visitCell(reinterpret_cast<AnyCell**>(world.actorContext()->behaviourRef()), forwardingVisitor);
 		}
 
 		if (world.actorContext()->supervisorStrategy())
 		{
-			walker.visitCell(reinterpret_cast<AnyCell**>(world.actorContext()->supervisorStrategyRef()), rootVisitor);
+			walker.visitCell(reinterpret_cast<AnyCell**>(world.actorContext()->supervisorStrategyRef()), forwardingVisitor);
 		}
+
+		for(auto &receivedMessage : world.actorContext()->receivedMessages())
+		{
+			walker.visitCell(&receivedMessage.messageCell, forwardingVisitor);
+		}
+	}
+
+	// Perform a Cheney scan of both heaps. This uses the heaps themselves as a breadth-first work queue which keeps our
+	// stack depth bounded and accesses the heaps sequentially.
+	bool scannedCell;
+
+	do
+	{
+		scannedCell = false;
+
+		while(AllocCell *scanCell = newHeapScanner.nextCell())
+		{
+			walker.visitChildren(scanCell, [&] (AnyCell **childCellRef) {
+				walker.visitCell(childCellRef, forwardingVisitor);
+			});
+
+			scannedCell = true;
+		}
+
+		while(AllocCell *scanCell = tenuredHeapScanner.nextCell())
+		{
+			scanTenuredCell(scanCell, newRememberedCells);
+			scannedCell = true;
+		}
+	}
+	while(scannedCell);
+
+	rememberedCells = std::move(newRememberedCells);
+
+	return relocatedCells;
+}
+
+AnyCell* moveReachable(Heap &destHeap, AnyCell *rootCell, const std::function<bool(AnyCell*)> &canMove)
+{
+	struct MovedCell
+	{
+		AnyCell *oldLocation;
+		GarbageState oldGcState;
+	};
+
+	// Moved cells in the order they were allocated in the destination heap
+	std::vector<MovedCell> movedCells;
+	bool abandoned = false;
+
+	CellRefWalker walker;
+	HeapScanner destHeapScanner(destHeap);
+
+	auto movingVisitor = [&] (AnyCell **cellRef) -> bool
+	{
+		AnyCell *oldCellLocation = *cellRef;
+		GarbageState gcState = oldCellLocation->gcState();
+
+		if (gcState == GarbageState::GlobalConstant)
+		{
+			// Constants can be shared between worlds
+			return false;
+		}
+		else if (gcState == GarbageState::ForwardingCell)
+		{
+			// Already moved
+			*cellRef = static_cast<ForwardingCell*>(oldCellLocation)->newLocation();
+			return false;
+		}
+		else if (abandoned)
+		{
+			return false;
+		}
+		else if (((gcState != GarbageState::HeapAllocatedCell) && (gcState != GarbageState::TenuredCell)) ||
+				!canMove(oldCellLocation))
+		{
+			// Stack allocated cells can't be moved out from under their frame
+			abandoned = true;
+			return false;
+		}
+
+		AnyCell *newCellLocation = static_cast<AnyCell*>(destHeap.allocate(1));
+		memcpy(newCellLocation, oldCellLocation, sizeof(AllocCell));
+
+		// Everything in the destination heap starts young
+		TenuringCell::makeYoung(newCellLocation);
+
+		*cellRef = newCellLocation;
+		new (oldCellLocation) ForwardingCell(newCellLocation);
+
+		movedCells.push_back({oldCellLocation, gcState});
+
+		return false;
+	};
+
+	walker.visitCell(&rootCell, movingVisitor);
+
+	while(AllocCell *scanCell = destHeapScanner.nextCell())
+	{
+		if (auto hashMapCell = cell_cast<HashMapCell>(scanCell))
+		{
+			// The tree's nodes may be shared with other hash maps in the source world. Take our own copy so relocating
+			// the entries doesn't modify the other maps.
+			DatumHashTree *sharedTree = hashMapCell->datumHashTree();
+			hashMapCell->setDatumHashTree(DatumHashTree::copyMapped(sharedTree, [] (AnyCell *&, AnyCell *&) {}));
+			DatumHashTree::unref(sharedTree);
+		}
+
+		walker.visitChildren(scanCell, [&] (AnyCell **childCellRef) {
+			walker.visitCell(childCellRef, movingVisitor);
+		});
+	}
+
+	if (abandoned)
+	{
+		// Restore every moved cell and point its copy back at it
+		for(const MovedCell &movedCell : movedCells)
+		{
+			AnyCell *newCellLocation = static_cast<ForwardingCell*>(movedCell.oldLocation)->newLocation();
+
+			memcpy(movedCell.oldLocation, newCellLocation, sizeof(AllocCell));
+
+			if (movedCell.oldGcState == GarbageState::TenuredCell)
+			{
+				TenuringCell::tenure(movedCell.oldLocation);
+			}
+
+			new (newCellLocation) ForwardingCell(movedCell.oldLocation);
+		}
+
+		// Restore any references to copies. The copies are now the only forwarding cells.
+		CellRefWalker restoringWalker;
+
+		for(const MovedCell &movedCell : movedCells)
+		{
+			restoringWalker.visitChildren(movedCell.oldLocation, [&] (AnyCell **childCellRef) {
+				if ((*childCellRef)->gcState() == GarbageState::ForwardingCell)
+				{
+					*childCellRef = static_cast<ForwardingCell*>(*childCellRef)->newLocation();
+				}
+			});
+		}
+
+		return nullptr;
+	}
+
+	// Leave a harmless value behind for any remaining references in the source world. This is an empty record so any
+	// use other than an identity comparison will fail a type check.
+	for(const MovedCell &movedCell : movedCells)
+	{
+		// The placeholder occupies the moved cell's slot so it takes the state of the heap it's in. Tenured cells
+		// referencing a placeholder in the tenured heap aren't in the remembered set so it must stay tenured until the
+		// next major collection moves it to the cell heap. It has no fields so it can never reference a young cell.
+		assert((movedCell.oldGcState == GarbageState::HeapAllocatedCell) || (movedCell.oldGcState == GarbageState::TenuredCell));
+
+		new (movedCell.oldLocation) RecordCell(RecordLikeCell::EmptyRecordLikeClassId, true, nullptr, movedCell.oldGcState);
 	}
 
-	return reachableCells;
+	return rootCell;
 }
 
 }
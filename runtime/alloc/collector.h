@@ -2,16 +2,46 @@
 #define _LLIBY_ALLOC_COLLECTOR_H
 
 #include <cstddef>
+#include <functional>
+
+#include "alloc/allocator.h"
 
 namespace lliby
 {
 class World;
 class Heap;
+class AnyCell;
 
 namespace alloc
 {
 
-std::size_t collect(World &world, Heap &newHeap);
+/**
+ * Relocates the reachable cells in a World
+ *
+ * @param  world        World to collect
+ * @param  newHeap      Empty heap to relocate cells that cannot be tenured in to
+ * @param  tenuredHeap  Heap to promote surviving cells in to. For full collections this must be empty.
+ * @param  type         Type of collection to perform
+ * @return Number of relocated cells
+ */
+std::size_t collect(World &world, Heap &newHeap, Heap &tenuredHeap, CollectionType type);
+
+/**
+ * Moves the cells reachable from a root cell in to another heap
+ *
+ * This uses the same forwarding as collect() so shared and cyclic references are preserved without a lookup table.
+ * The caller must guarantee that no other cell or root in the source World references any of the moved cells. The
+ * moved cells are replaced with empty records in their original location so a broken guarantee results in type errors
+ * instead of memory corruption.
+ *
+ * @param  destHeap  Heap to move the cells in to. This must not use precise finalization.
+ * @param  rootCell  Root cell to move
+ * @param  canMove   Predicate called for each heap allocated cell before it's moved. If this returns false for any cell
+ *                   the move is abandoned.
+ * @return New location of the root cell or nullptr if the move was abandoned. When the move is abandoned every cell is
+ *         restored to its original location and the destination heap only contains unreachable cells.
+ */
+AnyCell* moveReachable(Heap &destHeap, AnyCell *rootCell, const std::function<bool(AnyCell*)> &canMove);
 
 }
 }
@@ -248,25 +248,25 @@ bool AnyCell::isEqual(const AnyCell *other) const
 	{
 		if (auto otherHashMap = cell_cast<HashMapCell>(other))
 		{
-			auto thisHashTree = thisHashMap->datumHashTree();
-			auto otherHashTree = otherHashMap->datumHashTree();
-
-			if (DatumHashTree::size(thisHashTree) != DatumHashTree::size(otherHashTree))
-			{
-				return false;
-			}
-
-			return DatumHashTree::every(thisHashTree, [=] (AnyCell *key, AnyCell *thisValue, DatumHash::ResultType hashValue)
-			{
-				AnyCell *otherValue = DatumHashTree::find(otherHashTree, key, hashValue);
-				return otherValue && thisValue->isEqual(otherValue);
-			});
+			return DatumHashTree::isEqual(thisHashMap->datumHashTree(), otherHashMap->datumHashTree());
 		}
 	}
 
 	return false;
 }
 
+bool AnyCell::needsFinalization() const
+{
+	return StringCell::isInstance(this) ||
+		SymbolCell::isInstance(this) ||
+		VectorCell::isInstance(this) ||
+		BytevectorCell::isInstance(this) ||
+		RecordLikeCell::isInstance(this) ||
+		PortCell::isInstance(this) ||
+		MailboxCell::isInstance(this) ||
+		HashMapCell::isInstance(this);
+}
+
 void AnyCell::finalize()
 {
 	if (auto thisString = cell_cast<StringCell>(this))
@@ -54,12 +54,27 @@ public:
 
 	void finalize();
 
+	/**
+	 * Returns true if finalize() needs to be called for this cell before its memory is reused
+	 */
+	bool needsFinalization() const;
+
 protected:
 	AnyCell(CellTypeId typeId, GarbageState gcState = GarbageState::HeapAllocatedCell) :
 		m_typeId(typeId),
 		m_gcState(gcState)
 	{
 	}
+
+	/**
+	 * Sets the garbage state of the cell
+	 *
+	 * This is intended for use by the garbage collector
+	 */
+	void setGcState(GarbageState gcState)
+	{
+		m_gcState = gcState;
+	}
 };
 
 template <class T>
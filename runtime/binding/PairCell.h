@@ -34,12 +34,16 @@ public:
 	void setCar(AnyCell *obj)
 	{
 		assert(!isGlobalConstant());
+
+		// Pairs are only mutated while being constructed. Tenured pairs would require a remembered set entry
+		assert(gcState() != GarbageState::TenuredCell);
 		m_car = obj;
 	}
 
 	void setCdr(AnyCell *obj)
 	{
 		assert(!isGlobalConstant());
+		assert(gcState() != GarbageState::TenuredCell);
 		m_cdr = obj;
 	}
 
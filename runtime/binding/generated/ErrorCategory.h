@@ -29,6 +29,7 @@ enum class ErrorCategory : std::uint16_t
 	ExpiredEscapeProcedure = 16,
 	AskTimeout = 17,
 	Match = 18,
+	MailboxFull = 19,
 };
 
 const char *schemeNameForErrorCategory(ErrorCategory category);
@@ -22,7 +22,8 @@ namespace lliby
 
 World::World() :
 	cellHeap(InitialHeapSegmentSize),
-	m_activeState(&sharedRootState)
+	m_activeState(&sharedRootState),
+	m_tenuredHeap(InitialHeapSegmentSize, true)
 {
 }
 
@@ -2,12 +2,15 @@
 #define _LLIBY_CORE_WORLD_H
 
 #include "alloc/Heap.h"
+#include "alloc/CollectionPolicy.h"
+#include "alloc/StatisticsRecorder.h"
 
 #include <memory>
 #include <vector>
 
 namespace lliby
 {
+class AnyCell;
 
 namespace actor
 {
@@ -20,6 +23,11 @@ namespace dynamic
 class State;
 }
 
+namespace alloc
+{
+struct ShadowStackEntry;
+}
+
 class World
 {
 public:
@@ -29,6 +37,21 @@ public:
 	// Any changes to the content, size or order of these fields will require codegen changes
 	//
 
+	/**
+	 * Head of the world's shadow stack or nullptr if no cells are explicitly rooted
+	 *
+	 * Generated code pushes an entry while it holds cell pointers across a safe-point. Native code should use
+	 * alloc::StrongRoot instead of modifying this directly.
+	 */
+	alloc::ShadowStackEntry *shadowStackHead = nullptr;
+
+	/**
+	 * Indicates generated code should call llcore_gc_poll() at its next loop back-edge
+	 *
+	 * This is set by the allocator once a collection is pending and cleared by the collector
+	 */
+	bool gcPollRequested = false;
+
 	alloc::Heap cellHeap;
 
 
@@ -91,9 +114,50 @@ public: // Normal C++ API
 	 */
 	void addChildActor(const std::weak_ptr<actor::Mailbox> &childActor);
 
+	/**
+	 * Returns the heap of cells that have survived a garbage collection
+	 *
+	 * This is intended for use by the garbage collector
+	 */
+	alloc::Heap& tenuredHeap()
+	{
+		return m_tenuredHeap;
+	}
+
+	/**
+	 * Returns the tenured cells that may reference cells in cellHeap
+	 *
+	 * This is intended for use by the garbage collector
+	 */
+	std::vector<AnyCell*>& rememberedCells()
+	{
+		return m_rememberedCells;
+	}
+
+	/**
+	 * Returns the policy deciding when the world is collected
+	 */
+	alloc::CollectionPolicy& collectionPolicy()
+	{
+		return m_collectionPolicy;
+	}
+
+	/**
+	 * Returns the recorder for the world's collection statistics
+	 */
+	alloc::StatisticsRecorder& statisticsRecorder()
+	{
+		return m_statisticsRecorder;
+	}
+
 private:
 	dynamic::State *m_activeState;
 
+	alloc::Heap m_tenuredHeap;
+	std::vector<AnyCell*> m_rememberedCells;
+	alloc::CollectionPolicy m_collectionPolicy;
+	alloc::StatisticsRecorder m_statisticsRecorder;
+
 	actor::ActorContext *m_actorContext = nullptr;
 	std::vector<std::weak_ptr<actor::Mailbox>> m_childActors;
 };
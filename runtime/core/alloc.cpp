@@ -13,4 +13,13 @@ void *llcore_alloc_cells(lliby::World &world, std::uint64_t count)
 	return lliby::alloc::allocateCells(world, count);
 }
 
+void llcore_gc_poll(lliby::World &world)
+{
+	// actor::Runner holds unrooted message cells while an actor runs so actors are only collected between messages
+	if (!world.actorContext())
+	{
+		lliby::alloc::conditionalCollection(world);
+	}
+}
+
 }
@@ -8,6 +8,8 @@
 
 #include "dynamic/SchemeException.h"
 
+#include "hash/TransientHashMapCell.h"
+
 namespace lliby
 {
 namespace
@@ -32,6 +34,7 @@ void llcore_run(void (*entryPoint)(lliby::World &), int argc, char **argv, bool
 	initArguments = {argc, argv};
 
 	dynamic::init();
+	TransientHashMapCell::registerRecordClass();
 
 	{
 		// Make sure the world is alive for the exception handler
@@ -51,6 +54,7 @@ void llcore_run(void (*entryPoint)(lliby::World &), int argc, char **argv, bool
 		{
 			// Intentionally leak all of the world's cells
 			rootWorld.cellHeap.detach();
+			rootWorld.tenuredHeap().detach();
 		}
 #endif
 	}
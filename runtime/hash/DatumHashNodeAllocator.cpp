@@ -0,0 +1,397 @@
+#include "hash/DatumHashNodeAllocator.h"
+
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+namespace lliby
+{
+
+namespace
+{
+	const std::size_t SizeClassGranularity = DatumHashNodeAllocator::SizeClassGranularity;
+	const std::size_t SizeClassCount = DatumHashNodeAllocator::SizeClassCount;
+
+	// Size and alignment of the slabs nodes are carved from. Aligning slabs to their size lets us find a node's slab by
+	// masking its address.
+	const std::size_t SlabSize = 64 * 1024;
+
+	// Number of empty slabs each heap keeps for reuse before returning them to malloc()
+	const std::size_t MaximumCachedSlabs = 16;
+
+	class ThreadHeap;
+
+	/**
+	 * Free node linked through its first word
+	 */
+	struct FreeNode
+	{
+		FreeNode *next;
+	};
+
+	/**
+	 * Header at the start of each slab
+	 *
+	 * Everything except heap is only accessed by the thread owning the heap
+	 */
+	struct Slab
+	{
+		ThreadHeap *heap;
+
+		// Neighbours in our heap's list of slabs with free nodes
+		Slab *prev;
+		Slab *next;
+
+		// Nodes freed since the slab was created
+		FreeNode *freeList;
+
+		// Start of the space that has never been allocated
+		char *unusedStart;
+
+		std::uint32_t sizeClass;
+		std::uint32_t usedCount;
+		bool hasFreeNodes;
+	};
+
+	const std::size_t SlabHeaderSize = (sizeof(Slab) + SizeClassGranularity - 1) & ~(SizeClassGranularity - 1);
+
+	std::size_t sizeClassFor(std::size_t size)
+	{
+		return (size - 1) / SizeClassGranularity;
+	}
+
+	std::size_t classSize(std::size_t sizeClass)
+	{
+		return (sizeClass + 1) * SizeClassGranularity;
+	}
+
+	Slab *slabForNode(void *node)
+	{
+		return reinterpret_cast<Slab*>(reinterpret_cast<std::uintptr_t>(node) & ~(SlabSize - 1));
+	}
+
+	/**
+	 * Set of slabs owned by a single thread
+	 *
+	 * The owning thread allocates and frees nodes without locking. Nodes freed by other threads are pushed on to a
+	 * lock-free list and returned to their slabs once the owning thread runs out of free nodes. Slabs are released as
+	 * soon as all of their nodes are free; this keeps nodes allocated together close in memory even after large trees
+	 * have been freed.
+	 */
+	class ThreadHeap
+	{
+	public:
+		void* allocate(std::size_t sizeClass)
+		{
+			Slab *slab = m_freeSlabs[sizeClass];
+
+			if (slab == nullptr)
+			{
+				// Reclaim any nodes freed by other threads before creating a new slab
+				collectRemoteFrees();
+				slab = m_freeSlabs[sizeClass];
+
+				if (slab == nullptr)
+				{
+					slab = createSlab(sizeClass);
+				}
+			}
+
+			void *node;
+			const std::size_t nodeSize = classSize(sizeClass);
+
+			if (slab->freeList != nullptr)
+			{
+				node = slab->freeList;
+				slab->freeList = slab->freeList->next;
+			}
+			else
+			{
+				node = slab->unusedStart;
+				slab->unusedStart += nodeSize;
+			}
+
+			slab->usedCount++;
+
+			if ((slab->freeList == nullptr) && !hasUnusedSpace(slab, nodeSize))
+			{
+				unlinkFreeSlab(slab);
+			}
+
+			return node;
+		}
+
+		/**
+		 * Frees a node from one of our slabs
+		 *
+		 * This must only be called on the thread owning the heap
+		 */
+		void free(Slab *slab, void *node)
+		{
+			auto freeNode = static_cast<FreeNode*>(node);
+
+			freeNode->next = slab->freeList;
+			slab->freeList = freeNode;
+
+			if (--slab->usedCount == 0)
+			{
+				if (slab->hasFreeNodes)
+				{
+					unlinkFreeSlab(slab);
+				}
+
+				releaseSlab(slab);
+			}
+			else if (!slab->hasFreeNodes)
+			{
+				linkFreeSlab(slab);
+			}
+		}
+
+		/**
+		 * Frees a node from one of our slabs on a thread not owning the heap
+		 */
+		void remoteFree(void *node)
+		{
+			auto freeNode = static_cast<FreeNode*>(node);
+			FreeNode *head = m_remoteFrees.load(std::memory_order_relaxed);
+
+			do
+			{
+				freeNode->next = head;
+			}
+			while(!m_remoteFrees.compare_exchange_weak(head, freeNode, std::memory_order_release, std::memory_order_relaxed));
+		}
+
+		ThreadHeap *nextAbandoned = nullptr;
+
+	private:
+		static bool hasUnusedSpace(Slab *slab, std::size_t nodeSize)
+		{
+			return (slab->unusedStart + nodeSize) <= (reinterpret_cast<char*>(slab) + SlabSize);
+		}
+
+		void collectRemoteFrees()
+		{
+			FreeNode *freeNode = m_remoteFrees.exchange(nullptr, std::memory_order_acquire);
+
+			while(freeNode != nullptr)
+			{
+				FreeNode *next = freeNode->next;
+				free(slabForNode(freeNode), freeNode);
+
+				freeNode = next;
+			}
+		}
+
+		Slab* createSlab(std::size_t sizeClass)
+		{
+			Slab *slab = m_cachedSlabs;
+
+			if (slab != nullptr)
+			{
+				m_cachedSlabs = slab->next;
+				m_cachedSlabCount--;
+			}
+			else
+			{
+				void *placement;
+
+				if (posix_memalign(&placement, SlabSize, SlabSize) != 0)
+				{
+					abort();
+				}
+
+				slab = static_cast<Slab*>(placement);
+			}
+
+			slab->heap = this;
+			slab->freeList = nullptr;
+			slab->unusedStart = reinterpret_cast<char*>(slab) + SlabHeaderSize;
+			slab->sizeClass = sizeClass;
+			slab->usedCount = 0;
+
+			linkFreeSlab(slab);
+			return slab;
+		}
+
+		void releaseSlab(Slab *slab)
+		{
+			if (m_cachedSlabCount < MaximumCachedSlabs)
+			{
+				slab->next = m_cachedSlabs;
+				m_cachedSlabs = slab;
+				m_cachedSlabCount++;
+			}
+			else
+			{
+				::free(slab);
+			}
+		}
+
+		void linkFreeSlab(Slab *slab)
+		{
+			Slab *&head = m_freeSlabs[slab->sizeClass];
+
+			slab->prev = nullptr;
+			slab->next = head;
+
+			if (head != nullptr)
+			{
+				head->prev = slab;
+			}
+
+			head = slab;
+			slab->hasFreeNodes = true;
+		}
+
+		void unlinkFreeSlab(Slab *slab)
+		{
+			if (slab->prev != nullptr)
+			{
+				slab->prev->next = slab->next;
+			}
+			else
+			{
+				m_freeSlabs[slab->sizeClass] = slab->next;
+			}
+
+			if (slab->next != nullptr)
+			{
+				slab->next->prev = slab->prev;
+			}
+
+			slab->hasFreeNodes = false;
+		}
+
+		Slab *m_freeSlabs[SizeClassCount] = {};
+		std::atomic<FreeNode*> m_remoteFrees{nullptr};
+
+		Slab *m_cachedSlabs = nullptr;
+		std::size_t m_cachedSlabCount = 0;
+	};
+
+	// Heaps of exited threads waiting to be adopted by new threads. Heaps are never freed as other threads may still
+	// free nodes in to them.
+	std::mutex AbandonedHeapsMutex;
+	ThreadHeap *AbandonedHeaps = nullptr;
+
+	// Heap shared by threads that have already released their own heap during thread exit
+	std::mutex ExitingThreadHeapMutex;
+	ThreadHeap ExitingThreadHeap;
+
+	// These are trivially destructible so they remain valid while other thread_local destructors run
+	thread_local ThreadHeap *LocalHeap = nullptr;
+	thread_local bool LocalHeapReleased = false;
+
+	/**
+	 * Abandons our thread's heap when the thread exits
+	 */
+	class LocalHeapOwner
+	{
+	public:
+		ThreadHeap* acquire()
+		{
+			{
+				std::lock_guard<std::mutex> guard(AbandonedHeapsMutex);
+
+				if (AbandonedHeaps != nullptr)
+				{
+					LocalHeap = AbandonedHeaps;
+					AbandonedHeaps = AbandonedHeaps->nextAbandoned;
+				}
+			}
+
+			if (LocalHeap == nullptr)
+			{
+				LocalHeap = new ThreadHeap;
+			}
+
+			return LocalHeap;
+		}
+
+		~LocalHeapOwner()
+		{
+			if (LocalHeap != nullptr)
+			{
+				std::lock_guard<std::mutex> guard(AbandonedHeapsMutex);
+
+				LocalHeap->nextAbandoned = AbandonedHeaps;
+				AbandonedHeaps = LocalHeap;
+			}
+
+			LocalHeap = nullptr;
+			LocalHeapReleased = true;
+		}
+	};
+
+	thread_local LocalHeapOwner LocalOwner;
+}
+
+void* DatumHashNodeAllocator::allocate(std::size_t size)
+{
+	if (size > MaximumClassSize)
+	{
+		return malloc(size);
+	}
+
+	ThreadHeap *heap = LocalHeap;
+
+	if (heap == nullptr)
+	{
+		if (LocalHeapReleased)
+		{
+			std::lock_guard<std::mutex> guard(ExitingThreadHeapMutex);
+			return ExitingThreadHeap.allocate(sizeClassFor(size));
+		}
+
+		heap = LocalOwner.acquire();
+	}
+
+	return heap->allocate(sizeClassFor(size));
+}
+
+void DatumHashNodeAllocator::free(void *node, std::size_t size)
+{
+	if (size > MaximumClassSize)
+	{
+		::free(node);
+		return;
+	}
+
+	Slab *slab = slabForNode(node);
+
+	if (slab->heap == LocalHeap)
+	{
+		LocalHeap->free(slab, node);
+	}
+	else
+	{
+		slab->heap->remoteFree(node);
+	}
+}
+
+void* DatumHashNodeAllocator::reallocate(void *node, std::size_t oldSize, std::size_t newSize)
+{
+	if ((oldSize > MaximumClassSize) && (newSize > MaximumClassSize))
+	{
+		return realloc(node, newSize);
+	}
+
+	if ((oldSize <= MaximumClassSize) && (newSize <= MaximumClassSize) && (sizeClassFor(oldSize) == sizeClassFor(newSize)))
+	{
+		// Already the right size
+		return node;
+	}
+
+	void *newNode = allocate(newSize);
+	memcpy(newNode, node, std::min(oldSize, newSize));
+	free(node, oldSize);
+
+	return newNode;
+}
+
+}
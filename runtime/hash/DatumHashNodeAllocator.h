@@ -0,0 +1,51 @@
+#ifndef _LLIBY_HASH_DATUMHASHNODEALLOCATOR_H
+#define _LLIBY_HASH_DATUMHASHNODEALLOCATOR_H
+
+#include <cstddef>
+
+namespace lliby
+{
+
+/**
+ * Slab allocator for DatumHashTree nodes
+ *
+ * Nodes are grouped in to size classes at 16 byte intervals up to MaximumClassSize. Each thread carves nodes of a
+ * single size class out of its own slabs without locking. Nodes freed by other threads are handed back to the owning
+ * thread. Once every node in a slab has been freed the slab is reused for any size class or returned to malloc().
+ *
+ * Nodes larger than MaximumClassSize are allocated directly with malloc().
+ */
+class DatumHashNodeAllocator
+{
+public:
+	static const std::size_t SizeClassGranularity = 16;
+	static const std::size_t MaximumClassSize = 512;
+	static const std::size_t SizeClassCount = MaximumClassSize / SizeClassGranularity;
+
+	/**
+	 * Allocates memory for a node of the passed size
+	 */
+	static void* allocate(std::size_t size);
+
+	/**
+	 * Frees a node previously allocated with allocate() or reallocate()
+	 *
+	 * @param  node  Node to free
+	 * @param  size  Size the node was allocated with
+	 */
+	static void free(void *node, std::size_t size);
+
+	/**
+	 * Resizes a node while preserving its contents
+	 *
+	 * @param  node     Node to resize
+	 * @param  oldSize  Size the node was allocated with
+	 * @param  newSize  New size for the node
+	 * @return Resized node. This may be the original node if both sizes share a size class.
+	 */
+	static void* reallocate(void *node, std::size_t oldSize, std::size_t newSize);
+};
+
+}
+
+#endif
@@ -1,9 +1,12 @@
 #include "hash/DatumHashTree.h"
+#include "hash/DatumHashNodeAllocator.h"
 #include "binding/AnyCell.h"
-
-#include "alloc/CellRefWalker.h"
+#include "sched/Dispatcher.h"
 
 #include <algorithm>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
 
 namespace lliby
 {
@@ -36,6 +39,81 @@ const std::uint32_t LevelShiftSize = 5;
  */
 const std::uint32_t LevelHashMask = (1 << LevelShiftSize) - 1;
 
+static_assert(DatumHashTree::Iterator::MaximumDepth * LevelShiftSize >= sizeof(DatumHash::ResultType) * 8,
+		"Iterator stack is too small for the maximum tree depth");
+
+/**
+ * Minimum combined size of two trees before their top-level children are combined in parallel
+ */
+const std::size_t ParallelEntryThreshold = 16 * 1024;
+
+/**
+ * Runs independent tasks on the default Dispatcher's workers and the calling thread
+ *
+ * The calling thread claims tasks alongside the dispatched jobs and then waits for the tasks claimed by other threads
+ * to finish. Jobs that start after every task has been claimed return immediately. This means the caller never waits
+ * on queued work and can safely be running on a dispatcher worker itself.
+ *
+ * @param  taskCount  Number of tasks to run
+ * @param  task       Function to run for each task index from 0 to taskCount - 1
+ */
+void runInParallel(std::size_t taskCount, const std::function<void(std::size_t)> &task)
+{
+	struct SharedState
+	{
+		SharedState(const std::function<void(std::size_t)> &task, std::size_t taskCount) :
+			task(task),
+			taskCount(taskCount),
+			nextTask(0),
+			finishedTasks(0)
+		{
+		}
+
+		void runTasks()
+		{
+			std::size_t taskIndex;
+
+			while((taskIndex = nextTask.fetch_add(1, std::memory_order_relaxed)) < taskCount)
+			{
+				task(taskIndex);
+
+				std::lock_guard<std::mutex> guard(finishedMutex);
+
+				if (++finishedTasks == taskCount)
+				{
+					finishedCond.notify_all();
+				}
+			}
+		}
+
+		// Jobs can outlive our caller so we keep our own copy of the task
+		std::function<void(std::size_t)> task;
+		const std::size_t taskCount;
+		std::atomic<std::size_t> nextTask;
+
+		std::mutex finishedMutex;
+		std::condition_variable finishedCond;
+		std::size_t finishedTasks;
+	};
+
+	auto state = std::make_shared<SharedState>(task, taskCount);
+	sched::Dispatcher &dispatcher = sched::Dispatcher::defaultInstance();
+
+	const std::size_t jobCount = std::min(dispatcher.workerCount(), taskCount) - 1;
+
+	for(std::size_t i = 0; i < jobCount; i++)
+	{
+		dispatcher.dispatch([state] {
+			state->runTasks();
+		});
+	}
+
+	state->runTasks();
+
+	std::unique_lock<std::mutex> lock(state->finishedMutex);
+	state->finishedCond.wait(lock, [&] { return state->finishedTasks == taskCount; });
+}
+
 
 template<class T, class S>
 void copyWithoutIndex(T *source, S index, S oldSize, T *dest)
@@ -64,11 +142,12 @@ public:
 	 */
 	static InternalNode* fromSingleChild(std::uint32_t childIndex, DatumHashTree *childNode)
 	{
-		void *placement = malloc(sizeForChildCount(1));
+		void *placement = DatumHashNodeAllocator::allocate(sizeForChildCount(1));
 
 		std::uint32_t childBitmap = 1 << childIndex;
 		InternalNode *newNode = new (placement) InternalNode(childBitmap);
 		newNode->m_children[0] = childNode;
+		newNode->m_entryCount = DatumHashTree::size(childNode);
 
 		return newNode;
 	}
@@ -84,7 +163,7 @@ public:
 	static InternalNode* fromTwoChildren(std::uint32_t childIndex1, DatumHashTree *childNode1, std::uint32_t childIndex2, DatumHashTree *childNode2)
 	{
 		assert(childIndex1 != childIndex2);
-		void *placement = malloc(sizeForChildCount(2));
+		void *placement = DatumHashNodeAllocator::allocate(sizeForChildCount(2));
 
 		std::uint32_t childBitmap = (1 << childIndex1) | (1 << childIndex2);
 
@@ -101,6 +180,27 @@ public:
 			newNode->m_children[1] = childNode1;
 		}
 
+		newNode->m_entryCount = DatumHashTree::size(childNode1) + DatumHashTree::size(childNode2);
+
+		return newNode;
+	}
+
+	/**
+	 * Creates a new internal node from an array of children
+	 *
+	 * @param  childBitmap  Bitmap of the child indices
+	 * @param  children     Non-empty children in index order. The new node takes ownership of their references.
+	 */
+	static InternalNode* fromChildren(std::uint32_t childBitmap, DatumHashTree*const* children)
+	{
+		InternalNode *newNode = InternalNode::createInstance(childBitmap);
+		std::copy_n(children, newNode->childCount(), newNode->m_children);
+
+		for(std::uint32_t i = 0; i < newNode->childCount(); i++)
+		{
+			newNode->m_entryCount += DatumHashTree::size(children[i]);
+		}
+
 		return newNode;
 	}
 
@@ -130,6 +230,25 @@ public:
 		return child;
 	}
 
+	/**
+	 * Returns the total number of entries in this node's subtree
+	 */
+	std::size_t entryCount() const
+	{
+		return m_entryCount;
+	}
+
+	/**
+	 * Updates our entry count after one of our children has been modified in place
+	 *
+	 * @param  oldChildEntries  Number of entries in the child before modification
+	 * @param  newChildEntries  Number of entries in the child after modification
+	 */
+	void childEntriesChanged(std::size_t oldChildEntries, std::size_t newChildEntries)
+	{
+		m_entryCount = m_entryCount - oldChildEntries + newChildEntries;
+	}
+
 	/**
 	 * Returns the number of children of this node
 	 */
@@ -138,33 +257,32 @@ public:
 		return bitmapPopCount(m_childBitmap);
 	}
 
+	/**
+	 * Returns a bitmap of the child indices containing children
+	 */
+	std::uint32_t childBitmap() const
+	{
+		return m_childBitmap;
+	}
+
 	/**
 	 * Returns a new InternalNode with the non-empty child node placed at the given index
 	 *
 	 * @param  childIndex    Index of the new child node
 	 * @param  newChildNode  Non-empty child node
-	 * @param  inPlace       Indicates if the internal node can be modified in place
 	 */
-	InternalNode *assocChild(std::uint32_t childIndex, DatumHashTree *newChildNode, bool inPlace = false)
+	InternalNode *assocChild(std::uint32_t childIndex, DatumHashTree *newChildNode)
 	{
 		std::uint32_t newChildBitmap = m_childBitmap | (1 << childIndex);
 		auto offset = childOffsetForIndex(childIndex);
 		assert(newChildNode);
 
+		InternalNode *newInternalNode = InternalNode::createInstance(newChildBitmap);
+
 		if (newChildBitmap == m_childBitmap)
 		{
 			// We are staying the same size
-			if (inPlace)
-			{
-				// We can perform this replacement in-place by replacing and unreferencing the original node.
-				DatumHashTree::unref(m_children[offset]);
-				m_children[offset] = newChildNode;
-				ref();
-				return this;
-			}
-
-			InternalNode *newInternalNode = InternalNode::createInstance(newChildBitmap);
-			std::copy_n(m_children, childCount(), newInternalNode->m_children);
+			newInternalNode->m_entryCount = m_entryCount - DatumHashTree::size(m_children[offset]) + DatumHashTree::size(newChildNode);
 
 			for(std::uint32_t i = 0; i < childCount(); i++)
 			{
@@ -174,16 +292,14 @@ public:
 				}
 				else
 				{
-					DatumHashTree::ref(newInternalNode->m_children[i]);
+					newInternalNode->m_children[i] = DatumHashTree::ref(m_children[i]);
 				}
 			}
-
-			return newInternalNode;
 		}
 		else
 		{
 			// We are adding an additional child
-			InternalNode *newInternalNode = InternalNode::createInstance(newChildBitmap);
+			newInternalNode->m_entryCount = m_entryCount + DatumHashTree::size(newChildNode);
 
 			for(std::uint32_t i = 0; i < offset; i++)
 			{
@@ -196,10 +312,75 @@ public:
 			{
 				newInternalNode->m_children[i + 1] = DatumHashTree::ref(m_children[i]);
 			}
+		}
+
+		return newInternalNode;
+	}
+
+	/**
+	 * Adds a new non-empty child node at an unused index by modifying the internal node in place
+	 *
+	 * The internal node must be exclusively owned by the caller. It may be reallocated to make room for the new child.
+	 *
+	 * @param  internalNode  Internal node to modify
+	 * @param  childIndex    Index of the new child node. This must not already contain a child.
+	 * @param  newChildNode  Non-empty child node. The internal node takes ownership of this reference.
+	 * @return Internal node with the new child
+	 */
+	static InternalNode *insertChildInPlace(InternalNode *internalNode, std::uint32_t childIndex, DatumHashTree *newChildNode)
+	{
+		assert(!internalNode->hasChildAtIndex(childIndex));
+		assert(newChildNode);
+
+		const std::uint32_t oldChildCount = internalNode->childCount();
+		const std::uint32_t offset = internalNode->childOffsetForIndex(childIndex);
+
+		internalNode = static_cast<InternalNode*>(DatumHashNodeAllocator::reallocate(internalNode, sizeForChildCount(oldChildCount), sizeForChildCount(oldChildCount + 1)));
+
+		std::copy_backward(&internalNode->m_children[offset], &internalNode->m_children[oldChildCount], &internalNode->m_children[oldChildCount + 1]);
+		internalNode->m_children[offset] = newChildNode;
+		internalNode->m_childBitmap |= (1 << childIndex);
+		internalNode->m_entryCount += DatumHashTree::size(newChildNode);
+
+		return internalNode;
+	}
+
+	/**
+	 * Removes the child at the given index by modifying the internal node in place
+	 *
+	 * The internal node must be exclusively owned by the caller and have at least two children. The removed child is
+	 * not unreferenced and its entries must have already been subtracted with childEntriesChanged(). The internal node
+	 * may be reallocated to fit its remaining children.
+	 *
+	 * @param  internalNode  Internal node to modify
+	 * @param  childIndex    Index of the child node to remove
+	 * @return Internal node without the child
+	 */
+	static InternalNode* removeChildInPlace(InternalNode *internalNode, std::uint32_t childIndex)
+	{
+		assert(internalNode->hasChildAtIndex(childIndex));
+		assert(internalNode->childCount() > 1);
+
+		const std::uint32_t oldChildCount = internalNode->childCount();
+		const std::uint32_t offset = internalNode->childOffsetForIndex(childIndex);
+
+		std::copy(&internalNode->m_children[offset + 1], &internalNode->m_children[oldChildCount], &internalNode->m_children[offset]);
+		internalNode->m_childBitmap &= ~(1 << childIndex);
+
+		return static_cast<InternalNode*>(DatumHashNodeAllocator::reallocate(internalNode, sizeForChildCount(oldChildCount), sizeForChildCount(oldChildCount - 1)));
+	}
 
-			return newInternalNode;
+	/**
+	 * Returns a pointer to the child slot at the given index or nullptr if no child exists
+	 */
+	DatumHashTree** childSlotAtIndex(std::uint32_t index)
+	{
+		if (!hasChildAtIndex(index))
+		{
+			return nullptr;
 		}
 
+		return &m_children[childOffsetForIndex(index)];
 	}
 
 	/**
@@ -220,6 +401,7 @@ public:
 		auto removedOffset = childOffsetForIndex(childIndex);
 
 		InternalNode *newInternalNode = InternalNode::createInstance(newChildBitmap);
+		newInternalNode->m_entryCount = m_entryCount - DatumHashTree::size(m_children[removedOffset]);
 
 		copyWithoutIndex(m_children, removedOffset, oldChildCount, newInternalNode->m_children);
 
@@ -241,15 +423,28 @@ public:
 		return m_children;
 	}
 
+	/**
+	 * Destroys the internal node and returns its memory to the node allocator
+	 */
+	static void destroy(InternalNode *internalNode)
+	{
+		const std::size_t size = sizeForChildCount(internalNode->childCount());
+
+		internalNode->~InternalNode();
+		DatumHashNodeAllocator::free(internalNode, size);
+	}
+
 private:
-	InternalNode(std::uint32_t childBitmap) : DatumHashTree(childBitmap)
+	InternalNode(std::uint32_t childBitmap) :
+		DatumHashTree(childBitmap),
+		m_entryCount(0)
 	{
 		assert(childBitmap != LeafNodeChildBitmap);
 	}
 
 	static InternalNode* createInstance(std::uint32_t childBitmap)
 	{
-		void *placement = malloc(sizeForBitmapIndex(childBitmap));
+		void *placement = DatumHashNodeAllocator::allocate(sizeForBitmapIndex(childBitmap));
 		return new (placement) InternalNode(childBitmap);
 	}
 
@@ -273,21 +468,18 @@ private:
 		return sizeof(InternalNode) + (sizeof(DatumHashTree*) * childCount);
 	}
 
+	std::size_t m_entryCount;
 	DatumHashTree* m_children[];
 };
 
-struct LeafNodeEntry
-{
-	AnyCell *key;
-	AnyCell *value;
-};
+using LeafNodeEntry = DatumHashTree::Entry;
 
 class LeafNode : public DatumHashTree
 {
 public:
 	static LeafNode* createInstance(DatumHash::ResultType hashValue, std::uint32_t entryCount)
 	{
-		void *placement = malloc(sizeForValueCount(entryCount));
+		void *placement = DatumHashNodeAllocator::allocate(sizeForValueCount(entryCount));
 		return new (placement) LeafNode(hashValue, entryCount);
 	}
 
@@ -342,10 +534,9 @@ public:
 	 *
 	 * @param  key      Key of the new value. If the key exists the value will be replaced.
 	 * @param  value    Value to add
-	 * @param  inPlace  Indicates if the leaf node can be modified in place
 	 * @return LeafNode instance with the new value
 	 */
-	LeafNode* assocLeaf(AnyCell *key, AnyCell *value, bool inPlace = false)
+	LeafNode* assocLeaf(AnyCell *key, AnyCell *value)
 	{
 		// Check if the key is already in the hash
 		for(std::uint32_t i = 0; i < entryCount(); i++)
@@ -360,13 +551,6 @@ public:
 					ref();
 					return this;
 				}
-				else if (inPlace)
-				{
-					entry.value = value;
-
-					ref();
-					return this;
-				}
 				else
 				{
 					// Create a new leaf node with the value replaced
@@ -389,6 +573,38 @@ public:
 		return newLeafNode;
 	}
 
+	/**
+	 * Adds a value to a leaf node by modifying it in place
+	 *
+	 * The leaf node must be exclusively owned by the caller. It may be reallocated to make room for the new value.
+	 *
+	 * @param  leafNode  Leaf node to modify
+	 * @param  key       Key of the new value. If the key exists the value will be replaced.
+	 * @param  value     Value to add
+	 * @return Leaf node with the new value
+	 */
+	static LeafNode* assocLeafInPlace(LeafNode *leafNode, AnyCell *key, AnyCell *value)
+	{
+		for(std::uint32_t i = 0; i < leafNode->entryCount(); i++)
+		{
+			LeafNodeEntry &entry = leafNode->m_entries[i];
+
+			if (key->isEqual(entry.key))
+			{
+				entry.value = value;
+				return leafNode;
+			}
+		}
+
+		const std::uint32_t oldEntryCount = leafNode->entryCount();
+
+		leafNode = static_cast<LeafNode*>(DatumHashNodeAllocator::reallocate(leafNode, sizeForValueCount(oldEntryCount), sizeForValueCount(oldEntryCount + 1)));
+		leafNode->m_entries[oldEntryCount] = {.key = key, .value = value};
+		leafNode->m_entryCount = oldEntryCount + 1;
+
+		return leafNode;
+	}
+
 	/**
 	 * Return a new leaf node without a key
 	 *
@@ -425,6 +641,51 @@ public:
 		return ref();
 	}
 
+	/**
+	 * Removes a key from a leaf node by modifying it in place
+	 *
+	 * The leaf node must be exclusively owned by the caller and have the same hash value as the key. It may be
+	 * reallocated to fit its remaining entries.
+	 *
+	 * @param  leafNode  Leaf node to modify. The caller's reference is transferred to the returned node.
+	 * @param  key       Key to remove
+	 * @return Leaf node without the key or nullptr if no entries remain
+	 */
+	static LeafNode* removeEntryInPlace(LeafNode *leafNode, AnyCell *key)
+	{
+		const std::uint32_t oldEntryCount = leafNode->entryCount();
+
+		for(std::uint32_t i = 0; i < oldEntryCount; i++)
+		{
+			if (key->isEqual(leafNode->m_entries[i].key))
+			{
+				if (oldEntryCount == 1)
+				{
+					leafNode->unref();
+					return nullptr;
+				}
+
+				std::copy(&leafNode->m_entries[i + 1], &leafNode->m_entries[oldEntryCount], &leafNode->m_entries[i]);
+				leafNode->m_entryCount = oldEntryCount - 1;
+
+				return static_cast<LeafNode*>(DatumHashNodeAllocator::reallocate(leafNode, sizeForValueCount(oldEntryCount), sizeForValueCount(oldEntryCount - 1)));
+			}
+		}
+
+		return leafNode;
+	}
+
+	/**
+	 * Destroys the leaf node and returns its memory to the node allocator
+	 */
+	static void destroy(LeafNode *leafNode)
+	{
+		const std::size_t size = sizeForValueCount(leafNode->entryCount());
+
+		leafNode->~LeafNode();
+		DatumHashNodeAllocator::free(leafNode, size);
+	}
+
 
 private:
 	LeafNode(DatumHash::ResultType hashValue, std::uint32_t entryCount) :
@@ -468,11 +729,6 @@ void* DatumHashTree::operator new(std::size_t s, void *placement)
 	return placement;
 }
 
-void DatumHashTree::operator delete(void *value)
-{
-	free(value);
-}
-
 DatumHashTree* DatumHashTree::ref(DatumHashTree *tree)
 {
 	if (tree)
@@ -510,16 +766,16 @@ void DatumHashTree::unref()
 		return;
 	}
 
-	// Make sure the memory operations from this delete are strictly after the fetch_sub
+	// Make sure the memory operations from this destroy are strictly after the fetch_sub
 	std::atomic_thread_fence(std::memory_order_acquire);
 
 	if (isLeafNode())
 	{
-		delete static_cast<LeafNode*>(this);
+		LeafNode::destroy(static_cast<LeafNode*>(this));
 	}
 	else
 	{
-		delete static_cast<InternalNode*>(this);
+		InternalNode::destroy(static_cast<InternalNode*>(this));
 	}
 }
 
@@ -537,21 +793,22 @@ bool DatumHashTree::isLeafNode() const
 	return m_childBitmap == LeafNodeChildBitmap;
 }
 
+bool DatumHashTree::isExclusive() const
+{
+	// Synchronise with any unref() from other threads so their accesses to the node happen before our modifications
+	return m_refCount.load(std::memory_order_acquire) == 1;
+}
+
 DatumHashTree* DatumHashTree::fromAssocList(ProperList<PairCell> *list)
 {
-	DatumHashTree *tree = nullptr;
-	DatumHash hasher;
+	Transient transient;
 
 	for(auto pair : *list)
 	{
-		auto hashValue = hasher(pair->car());
-		DatumHashTree *newTree = DatumHashTree::assocAtLevel(tree, 0, pair->car(), pair->cdr(), hashValue, true);
-		DatumHashTree::unref(tree);
-
-		tree = newTree;
+		transient.assoc(pair->car(), pair->cdr());
 	}
 
-	return tree;
+	return transient.persistent();
 }
 
 DatumHashTree* DatumHashTree::assoc(DatumHashTree *tree, AnyCell *key, AnyCell *value, DatumHash::ResultType hashValue)
@@ -581,86 +838,98 @@ std::size_t DatumHashTree::size(const DatumHashTree *tree)
 	}
 	else
 	{
-		std::size_t accum = 0;
-
-		const InternalNode *internalNode = static_cast<const InternalNode*>(tree);
-		for(std::uint32_t i = 0; i < internalNode->childCount(); i++)
-		{
-			accum += size(internalNode->children()[i]);
-		}
-
-		return accum;
+		return static_cast<const InternalNode*>(tree)->entryCount();
 	}
 }
 
-bool DatumHashTree::every(const DatumHashTree *tree, const std::function<bool(AnyCell*, AnyCell*, DatumHash::ResultType)> &pred)
+DatumHashTree* DatumHashTree::copyStructure(const DatumHashTree *tree)
 {
 	if (tree == nullptr)
 	{
-		return true;
+		return nullptr;
 	}
 	else if (tree->isLeafNode())
 	{
 		auto leafNode = static_cast<const LeafNode*>(tree);
 
-		for(std::uint32_t i = 0; i < leafNode->entryCount(); i++)
-		{
-			auto &entry = leafNode->entries()[i];
-			if (!pred(entry.key, entry.value, leafNode->hashValue()))
-			{
-				return false;
-			}
-		}
+		LeafNode *newLeafNode = LeafNode::createInstance(leafNode->hashValue(), leafNode->entryCount());
+		std::copy_n(leafNode->entries(), leafNode->entryCount(), newLeafNode->entries());
+
+		return newLeafNode;
 	}
 	else
 	{
 		auto internalNode = static_cast<const InternalNode*>(tree);
+		const std::uint32_t childCount = internalNode->childCount();
 
-		for(std::uint32_t i = 0; i < internalNode->childCount(); i++)
+		// Build our children first so we can allocate our node at its final size
+		DatumHashTree *newChildren[1 << LevelShiftSize];
+
+		for(std::uint32_t i = 0; i < childCount; i++)
 		{
-			if (!every(internalNode->children()[i], pred))
-			{
-				return false;
-			}
+			newChildren[i] = copyStructure(internalNode->children()[i]);
 		}
-	}
 
-	return true;
+		return InternalNode::fromChildren(internalNode->m_childBitmap, newChildren);
+	}
 }
 
-void DatumHashTree::walkCellRefs(DatumHashTree *tree, alloc::CellRefWalker &walker, const std::function<void(AnyCell**, AnyCell**)> &visitor)
+DatumHashTree::Iterator::Iterator(const DatumHashTree *tree) :
+	m_tree(DatumHashTree::ref(const_cast<DatumHashTree*>(tree)))
 {
-	if (tree == nullptr)
+	if (m_tree != nullptr)
 	{
-		return;
+		descendToLeaf(m_tree);
 	}
-	else if (tree->isLeafNode())
+}
+
+DatumHashTree::Iterator::~Iterator()
+{
+	DatumHashTree::unref(m_tree);
+}
+
+void DatumHashTree::Iterator::descendToLeaf(DatumHashTree *node)
+{
+	while(!node->isLeafNode())
 	{
-		auto leafNode = static_cast<LeafNode*>(tree);
+		auto internalNode = static_cast<InternalNode*>(node);
+		DatumHashTree *const *children = internalNode->children();
 
-		if (!walker.shouldVisitDatumHashSubtree(tree))
-		{
-			return;
-		}
+		assert(m_depth < MaximumDepth);
+		m_stack[m_depth++] = {&children[1], &children[internalNode->childCount()]};
 
-		for(std::size_t i = 0; i < leafNode->entryCount(); i++)
-		{
-			auto &entry = leafNode->entries()[i];
-			visitor(&entry.key, &entry.value);
-		}
+		node = children[0];
 	}
-	else
+
+	auto leafNode = static_cast<LeafNode*>(node);
+
+	m_leaf = leafNode;
+	m_leafHashValue = leafNode->hashValue();
+	m_entry = leafNode->entries();
+	m_leafEnd = &leafNode->entries()[leafNode->entryCount()];
+}
+
+void DatumHashTree::Iterator::enterNextLeaf()
+{
+	while(m_depth > 0)
 	{
-		auto internalNode = static_cast<const InternalNode*>(tree);
+		Frame &frame = m_stack[m_depth - 1];
 
-		for(std::uint32_t i = 0; i < internalNode->childCount(); i++)
+		if (frame.nextChild != frame.childrenEnd)
 		{
-			walkCellRefs(internalNode->children()[i], walker, visitor);
+			descendToLeaf(*(frame.nextChild++));
+			return;
 		}
+
+		m_depth--;
 	}
+
+	// Finished
+	m_leaf = nullptr;
+	m_entry = m_leafEnd = nullptr;
 }
 
-DatumHashTree* DatumHashTree::assocAtLevel(DatumHashTree *tree, std::uint32_t level, AnyCell *key, AnyCell *value, DatumHash::ResultType hashValue, bool inPlace)
+DatumHashTree* DatumHashTree::assocAtLevel(DatumHashTree *tree, std::uint32_t level, AnyCell *key, AnyCell *value, DatumHash::ResultType hashValue)
 {
 	if (tree == nullptr)
 	{
@@ -676,7 +945,7 @@ DatumHashTree* DatumHashTree::assocAtLevel(DatumHashTree *tree, std::uint32_t le
 
 		if (leafNode->hashValue() == hashValue)
 		{
-			return leafNode->assocLeaf(key, value, inPlace);
+			return leafNode->assocLeaf(key, value);
 		}
 
 		auto oldChildIndex = InternalNode::childIndex(level, leafNode->hashValue());
@@ -686,13 +955,10 @@ DatumHashTree* DatumHashTree::assocAtLevel(DatumHashTree *tree, std::uint32_t le
 		{
 			// These children would appear at the name index in the array node. In the worst case this can happen
 			// at the following levels so we can't build a final internal node directly here. Instead build an internal
-			// node with the existing leaf node and call ourselves recursively.
+			// node with the existing leaf node and add to it recursively. The new internal node is exclusively ours so
+			// it can be modified in place.
 			InternalNode *newInternalNode = InternalNode::fromSingleChild(oldChildIndex, leafNode->ref());
-
-			DatumHashTree *mergedInternalNode = assocAtLevel(newInternalNode, level, key, value, hashValue, true);
-			newInternalNode->unref();
-
-			return mergedInternalNode;
+			return transientAssocAtLevel(newInternalNode, level, key, value, hashValue);
 		}
 		else
 		{
@@ -711,7 +977,7 @@ DatumHashTree* DatumHashTree::assocAtLevel(DatumHashTree *tree, std::uint32_t le
 		auto childIndex = InternalNode::childIndex(level, hashValue);
 		DatumHashTree* childNode = internalNode->childAtIndex(childIndex);
 
-		DatumHashTree *newChildNode = assocAtLevel(childNode, level + LevelShiftSize, key, value, hashValue, inPlace);
+		DatumHashTree *newChildNode = assocAtLevel(childNode, level + LevelShiftSize, key, value, hashValue);
 
 		if (childNode == newChildNode)
 		{
@@ -722,7 +988,7 @@ DatumHashTree* DatumHashTree::assocAtLevel(DatumHashTree *tree, std::uint32_t le
 		else
 		{
 			// Allocate a new internal node
-			return internalNode->assocChild(childIndex, newChildNode, inPlace);
+			return internalNode->assocChild(childIndex, newChildNode);
 		}
 	}
 }
@@ -821,4 +1087,576 @@ DatumHashTree* DatumHashTree::withoutAtLevel(DatumHashTree *tree, std::uint32_t
 	}
 }
 
+DatumHashTree* DatumHashTree::transientAssocAtLevel(DatumHashTree *tree, std::uint32_t level, AnyCell *key, AnyCell *value, DatumHash::ResultType hashValue)
+{
+	if (tree == nullptr)
+	{
+		LeafNode *leafNode = LeafNode::createInstance(hashValue, 1);
+		leafNode->entries()[0] = {.key = key, .value = value};
+
+		return leafNode;
+	}
+	else if (tree->isLeafNode())
+	{
+		LeafNode *leafNode = static_cast<LeafNode*>(tree);
+
+		if (leafNode->hashValue() == hashValue)
+		{
+			if (leafNode->isExclusive())
+			{
+				return LeafNode::assocLeafInPlace(leafNode, key, value);
+			}
+
+			LeafNode *newLeafNode = leafNode->assocLeaf(key, value);
+			leafNode->unref();
+
+			return newLeafNode;
+		}
+
+		// Push the existing leaf node down a level. We already own its reference so it can be moved directly in to the
+		// new internal node.
+		auto oldChildIndex = InternalNode::childIndex(level, leafNode->hashValue());
+		auto newChildIndex = InternalNode::childIndex(level, hashValue);
+
+		if (oldChildIndex == newChildIndex)
+		{
+			InternalNode *newInternalNode = InternalNode::fromSingleChild(oldChildIndex, leafNode);
+			return transientAssocAtLevel(newInternalNode, level, key, value, hashValue);
+		}
+		else
+		{
+			LeafNode *newLeafNode = LeafNode::createInstance(hashValue, 1);
+			newLeafNode->entries()[0] = {.key = key, .value = value};
+
+			return InternalNode::fromTwoChildren(oldChildIndex, leafNode, newChildIndex, newLeafNode);
+		}
+	}
+	else if (!tree->isExclusive())
+	{
+		// Copy the path to the key. The copied nodes are exclusively ours for any future modifications.
+		DatumHashTree *newTree = assocAtLevel(tree, level, key, value, hashValue);
+		tree->unref();
+
+		return newTree;
+	}
+	else
+	{
+		InternalNode *internalNode = static_cast<InternalNode*>(tree);
+
+		auto childIndex = InternalNode::childIndex(level, hashValue);
+		DatumHashTree **childSlot = internalNode->childSlotAtIndex(childIndex);
+
+		if (childSlot == nullptr)
+		{
+			LeafNode *newLeafNode = LeafNode::createInstance(hashValue, 1);
+			newLeafNode->entries()[0] = {.key = key, .value = value};
+
+			return InternalNode::insertChildInPlace(internalNode, childIndex, newLeafNode);
+		}
+
+		const std::size_t oldChildEntries = size(*childSlot);
+
+		*childSlot = transientAssocAtLevel(*childSlot, level + LevelShiftSize, key, value, hashValue);
+		internalNode->childEntriesChanged(oldChildEntries, size(*childSlot));
+
+		return internalNode;
+	}
+}
+
+DatumHashTree* DatumHashTree::transientWithoutAtLevel(DatumHashTree *tree, std::uint32_t level, AnyCell *key, DatumHash::ResultType hashValue)
+{
+	if (tree == nullptr)
+	{
+		return nullptr;
+	}
+	else if (!tree->isExclusive())
+	{
+		DatumHashTree *newTree = withoutAtLevel(tree, level, key, hashValue);
+		tree->unref();
+
+		return newTree;
+	}
+	else if (tree->isLeafNode())
+	{
+		LeafNode *leafNode = static_cast<LeafNode*>(tree);
+
+		if (leafNode->hashValue() != hashValue)
+		{
+			return leafNode;
+		}
+
+		return LeafNode::removeEntryInPlace(leafNode, key);
+	}
+	else
+	{
+		InternalNode *internalNode = static_cast<InternalNode*>(tree);
+
+		auto childIndex = InternalNode::childIndex(level, hashValue);
+		DatumHashTree **childSlot = internalNode->childSlotAtIndex(childIndex);
+
+		if (childSlot == nullptr)
+		{
+			return internalNode;
+		}
+
+		const std::size_t oldChildEntries = size(*childSlot);
+		DatumHashTree *newChildNode = transientWithoutAtLevel(*childSlot, level + LevelShiftSize, key, hashValue);
+
+		if ((internalNode->childCount() == 1) && ((newChildNode == nullptr) || newChildNode->isLeafNode()))
+		{
+			// Collapse in to our remaining child. Clear our slot so freeing ourselves doesn't unref the child.
+			*childSlot = nullptr;
+			internalNode->unref();
+
+			return newChildNode;
+		}
+
+		internalNode->childEntriesChanged(oldChildEntries, size(newChildNode));
+
+		if (newChildNode == nullptr)
+		{
+			return InternalNode::removeChildInPlace(internalNode, childIndex);
+		}
+
+		*childSlot = newChildNode;
+		return internalNode;
+	}
+}
+
+/**
+ * Node by node implementation of set operations
+ *
+ * merge(), intersection() and difference() are implemented by an operation class describing how to combine a pair of
+ * subtrees where at least one subtree is empty or a leaf node. Pairs of internal nodes are combined child by child
+ * using the union of their child bitmaps. All of the functions returning trees return a new reference and leave their
+ * arguments unmodified.
+ */
+class DatumHashTree::SetOperations
+{
+public:
+	/**
+	 * Merges entries from the right tree in to the left tree
+	 */
+	class MergeOperation
+	{
+	public:
+		explicit MergeOperation(const ConflictFunction *conflict = nullptr) :
+			m_conflict(conflict)
+		{
+		}
+
+		bool parallelisable() const
+		{
+			// Conflict functions may call back in to Scheme which must happen on our thread
+			return m_conflict == nullptr;
+		}
+
+		bool sharesIdenticalSubtrees() const
+		{
+			// The conflict function needs to be called for every key
+			return m_conflict == nullptr;
+		}
+
+		DatumHashTree* leftOnly(DatumHashTree *left)
+		{
+			return left->ref();
+		}
+
+		DatumHashTree* rightOnly(DatumHashTree *right)
+		{
+			return right->ref();
+		}
+
+		DatumHashTree* identical(DatumHashTree *tree)
+		{
+			return tree->ref();
+		}
+
+		DatumHashTree* combineLeftLeaf(LeafNode *left, DatumHashTree *right, std::uint32_t level)
+		{
+			DatumHashTree *result = right->ref();
+
+			for(std::uint32_t i = 0; i < left->entryCount(); i++)
+			{
+				const LeafNodeEntry &entry = left->entries()[i];
+				AnyCell *rightValue = findAtLevel(right, level, entry.key, left->hashValue());
+
+				if (rightValue == nullptr)
+				{
+					result = transientAssocAtLevel(result, level, entry.key, entry.value, left->hashValue());
+				}
+				else if (m_conflict)
+				{
+					AnyCell *newValue = (*m_conflict)(entry.key, entry.value, rightValue);
+
+					if (newValue != rightValue)
+					{
+						result = transientAssocAtLevel(result, level, entry.key, newValue, left->hashValue());
+					}
+				}
+			}
+
+			return result;
+		}
+
+		DatumHashTree* combineRightLeaf(DatumHashTree *left, LeafNode *right, std::uint32_t level)
+		{
+			DatumHashTree *result = left->ref();
+
+			for(std::uint32_t i = 0; i < right->entryCount(); i++)
+			{
+				const LeafNodeEntry &entry = right->entries()[i];
+				AnyCell *leftValue = findAtLevel(left, level, entry.key, right->hashValue());
+				AnyCell *newValue = entry.value;
+
+				if (leftValue && m_conflict)
+				{
+					newValue = (*m_conflict)(entry.key, leftValue, entry.value);
+				}
+
+				if (newValue != leftValue)
+				{
+					result = transientAssocAtLevel(result, level, entry.key, newValue, right->hashValue());
+				}
+			}
+
+			return result;
+		}
+
+	private:
+		const ConflictFunction *m_conflict;
+	};
+
+	/**
+	 * Keeps the entries in the left tree with keys in the right tree
+	 */
+	class IntersectionOperation
+	{
+	public:
+		bool parallelisable() const
+		{
+			return true;
+		}
+
+		bool sharesIdenticalSubtrees() const
+		{
+			return true;
+		}
+
+		DatumHashTree* leftOnly(DatumHashTree *)
+		{
+			return nullptr;
+		}
+
+		DatumHashTree* rightOnly(DatumHashTree *)
+		{
+			return nullptr;
+		}
+
+		DatumHashTree* identical(DatumHashTree *tree)
+		{
+			return tree->ref();
+		}
+
+		DatumHashTree* combineLeftLeaf(LeafNode *left, DatumHashTree *right, std::uint32_t level)
+		{
+			DatumHashTree *result = left->ref();
+
+			for(std::uint32_t i = 0; i < left->entryCount(); i++)
+			{
+				const LeafNodeEntry &entry = left->entries()[i];
+
+				if (findAtLevel(right, level, entry.key, left->hashValue()) == nullptr)
+				{
+					result = transientWithoutAtLevel(result, level, entry.key, left->hashValue());
+				}
+			}
+
+			return result;
+		}
+
+		DatumHashTree* combineRightLeaf(DatumHashTree *left, LeafNode *right, std::uint32_t level)
+		{
+			DatumHashTree *result = nullptr;
+
+			for(std::uint32_t i = 0; i < right->entryCount(); i++)
+			{
+				const LeafNodeEntry &entry = right->entries()[i];
+
+				if (AnyCell *leftValue = findAtLevel(left, level, entry.key, right->hashValue()))
+				{
+					result = transientAssocAtLevel(result, level, entry.key, leftValue, right->hashValue());
+				}
+			}
+
+			return result;
+		}
+	};
+
+	/**
+	 * Removes the entries in the left tree with keys in the right tree
+	 */
+	class DifferenceOperation
+	{
+	public:
+		bool parallelisable() const
+		{
+			return true;
+		}
+
+		bool sharesIdenticalSubtrees() const
+		{
+			return true;
+		}
+
+		DatumHashTree* leftOnly(DatumHashTree *left)
+		{
+			return left->ref();
+		}
+
+		DatumHashTree* rightOnly(DatumHashTree *)
+		{
+			return nullptr;
+		}
+
+		DatumHashTree* identical(DatumHashTree *)
+		{
+			return nullptr;
+		}
+
+		DatumHashTree* combineLeftLeaf(LeafNode *left, DatumHashTree *right, std::uint32_t level)
+		{
+			DatumHashTree *result = left->ref();
+
+			for(std::uint32_t i = 0; i < left->entryCount(); i++)
+			{
+				const LeafNodeEntry &entry = left->entries()[i];
+
+				if (findAtLevel(right, level, entry.key, left->hashValue()) != nullptr)
+				{
+					result = transientWithoutAtLevel(result, level, entry.key, left->hashValue());
+				}
+			}
+
+			return result;
+		}
+
+		DatumHashTree* combineRightLeaf(DatumHashTree *left, LeafNode *right, std::uint32_t level)
+		{
+			DatumHashTree *result = left->ref();
+
+			for(std::uint32_t i = 0; i < right->entryCount(); i++)
+			{
+				const LeafNodeEntry &entry = right->entries()[i];
+				result = transientWithoutAtLevel(result, level, entry.key, right->hashValue());
+			}
+
+			return result;
+		}
+	};
+
+	template<class Op>
+	static DatumHashTree* combine(Op &op, DatumHashTree *left, DatumHashTree *right)
+	{
+		const bool parallel = op.parallelisable() &&
+			((DatumHashTree::size(left) + DatumHashTree::size(right)) >= ParallelEntryThreshold) &&
+			(sched::Dispatcher::defaultInstance().workerCount() > 1);
+
+		return combineAtLevel(op, left, right, 0, parallel);
+	}
+
+	static bool diffAtLevel(DatumHashTree *oldTree, DatumHashTree *newTree, std::uint32_t level, const DiffVisitor &visitor)
+	{
+		if (oldTree == newTree)
+		{
+			return true;
+		}
+		else if ((oldTree == nullptr) || (newTree == nullptr) || oldTree->isLeafNode() || newTree->isLeafNode())
+		{
+			// Compare entry by entry
+			return every(oldTree, [&] (AnyCell *key, AnyCell *oldValue, DatumHash::ResultType hashValue)
+			{
+				AnyCell *newValue = findAtLevel(newTree, level, key, hashValue);
+
+				if ((newValue == nullptr) || !oldValue->isEqual(newValue))
+				{
+					return visitor(key, oldValue, newValue);
+				}
+
+				return true;
+			}) &&
+			every(newTree, [&] (AnyCell *key, AnyCell *newValue, DatumHash::ResultType hashValue)
+			{
+				return findAtLevel(oldTree, level, key, hashValue) || visitor(key, nullptr, newValue);
+			});
+		}
+
+		auto oldInternalNode = static_cast<InternalNode*>(oldTree);
+		auto newInternalNode = static_cast<InternalNode*>(newTree);
+
+		const std::uint32_t childBitmap = oldInternalNode->childBitmap() | newInternalNode->childBitmap();
+
+		for(std::uint32_t childIndex = 0; childIndex <= LevelHashMask; childIndex++)
+		{
+			if ((childBitmap & (1 << childIndex)) &&
+				!diffAtLevel(oldInternalNode->childAtIndex(childIndex), newInternalNode->childAtIndex(childIndex), level + LevelShiftSize, visitor))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+private:
+	template<class Op>
+	static DatumHashTree* combineAtLevel(Op &op, DatumHashTree *left, DatumHashTree *right, std::uint32_t level, bool parallel)
+	{
+		if (left == nullptr)
+		{
+			return (right == nullptr) ? nullptr : op.rightOnly(right);
+		}
+		else if (right == nullptr)
+		{
+			return op.leftOnly(left);
+		}
+		else if ((left == right) && op.sharesIdenticalSubtrees())
+		{
+			return op.identical(left);
+		}
+		else if (left->isLeafNode())
+		{
+			return op.combineLeftLeaf(static_cast<LeafNode*>(left), right, level);
+		}
+		else if (right->isLeafNode())
+		{
+			return op.combineRightLeaf(left, static_cast<LeafNode*>(right), level);
+		}
+
+		return combineInternalNodes(op, static_cast<InternalNode*>(left), static_cast<InternalNode*>(right), level, parallel);
+	}
+
+	template<class Op>
+	static DatumHashTree* combineInternalNodes(Op &op, InternalNode *left, InternalNode *right, std::uint32_t level, bool parallel)
+	{
+		const std::uint32_t childBitmap = left->childBitmap() | right->childBitmap();
+
+		std::uint32_t childIndices[LevelHashMask + 1];
+		std::uint32_t childCount = 0;
+
+		for(std::uint32_t childIndex = 0; childIndex <= LevelHashMask; childIndex++)
+		{
+			if (childBitmap & (1 << childIndex))
+			{
+				childIndices[childCount++] = childIndex;
+			}
+		}
+
+		DatumHashTree *newChildren[LevelHashMask + 1];
+
+		auto combineChild = [&] (std::size_t i)
+		{
+			const std::uint32_t childIndex = childIndices[i];
+			newChildren[i] = combineAtLevel(op, left->childAtIndex(childIndex), right->childAtIndex(childIndex), level + LevelShiftSize, false);
+		};
+
+		if (parallel)
+		{
+			runInParallel(childCount, combineChild);
+		}
+		else
+		{
+			for(std::uint32_t i = 0; i < childCount; i++)
+			{
+				combineChild(i);
+			}
+		}
+
+		bool sameAsLeft = true;
+		bool sameAsRight = true;
+
+		std::uint32_t newChildBitmap = 0;
+		std::uint32_t newChildCount = 0;
+
+		for(std::uint32_t i = 0; i < childCount; i++)
+		{
+			const std::uint32_t childIndex = childIndices[i];
+			DatumHashTree *newChild = newChildren[i];
+
+			sameAsLeft = sameAsLeft && (newChild == left->childAtIndex(childIndex));
+			sameAsRight = sameAsRight && (newChild == right->childAtIndex(childIndex));
+
+			if (newChild != nullptr)
+			{
+				newChildBitmap |= (1 << childIndex);
+				newChildren[newChildCount++] = newChild;
+			}
+		}
+
+		if (sameAsLeft || sameAsRight)
+		{
+			// Share the existing node instead of building an identical one
+			for(std::uint32_t i = 0; i < newChildCount; i++)
+			{
+				DatumHashTree::unref(newChildren[i]);
+			}
+
+			return sameAsLeft ? left->ref() : right->ref();
+		}
+		else if (newChildCount == 0)
+		{
+			return nullptr;
+		}
+		else if ((newChildCount == 1) && newChildren[0]->isLeafNode())
+		{
+			// Single leaf node left - collapse
+			return newChildren[0];
+		}
+
+		return InternalNode::fromChildren(newChildBitmap, newChildren);
+	}
+};
+
+DatumHashTree* DatumHashTree::merge(DatumHashTree *source, DatumHashTree *override)
+{
+	SetOperations::MergeOperation op;
+	return SetOperations::combine(op, source, override);
+}
+
+DatumHashTree* DatumHashTree::merge(DatumHashTree *source, DatumHashTree *override, const ConflictFunction &conflict)
+{
+	SetOperations::MergeOperation op(&conflict);
+	return SetOperations::combine(op, source, override);
+}
+
+DatumHashTree* DatumHashTree::intersection(DatumHashTree *tree, DatumHashTree *keyTree)
+{
+	SetOperations::IntersectionOperation op;
+	return SetOperations::combine(op, tree, keyTree);
+}
+
+DatumHashTree* DatumHashTree::difference(DatumHashTree *tree, DatumHashTree *keyTree)
+{
+	SetOperations::DifferenceOperation op;
+	return SetOperations::combine(op, tree, keyTree);
+}
+
+bool DatumHashTree::diff(const DatumHashTree *oldTree, const DatumHashTree *newTree, const DiffVisitor &visitor)
+{
+	return SetOperations::diffAtLevel(const_cast<DatumHashTree*>(oldTree), const_cast<DatumHashTree*>(newTree), 0, visitor);
+}
+
+bool DatumHashTree::isEqual(const DatumHashTree *tree1, const DatumHashTree *tree2)
+{
+	if (size(tree1) != size(tree2))
+	{
+		return false;
+	}
+
+	return diff(tree1, tree2, [] (AnyCell *, AnyCell *, AnyCell *)
+	{
+		return false;
+	});
+}
+
 }
@@ -31,6 +31,18 @@ class DatumHashTree
 {
 	friend class alloc::CellRefWalker;
 public:
+	class Iterator;
+	class Transient;
+
+	/**
+	 * Key/value pair stored in the tree
+	 */
+	struct Entry
+	{
+		AnyCell *key;
+		AnyCell *value;
+	};
+
 	/**
 	 * Creates a new empty tree
 	 *
@@ -101,13 +113,16 @@ public:
 
 	/**
 	 * Returns the number of entries in the passed tree
+	 *
+	 * This is a constant time operation
 	 */
 	static std::size_t size(const DatumHashTree *tree);
 
 	/**
 	 * Calls the passed function for each {key, value} pair in the tree until it returns false
 	 *
-	 * The tree will be walked in an undefined order.
+	 * The tree will be walked in an undefined order. The predicate is called directly so it can be inlined in to the
+	 * walk.
 	 *
 	 * @param  tree  Tree to walk
 	 * @param  pred  Predicate function to call for each {key, value} pair. The third argument to this function will be
@@ -115,7 +130,94 @@ public:
 	 *               returns false the walk will be aborted and every() will return false.
 	 * @return True if the walker returned true for every {key, value} pair
 	 */
-	static bool every(const DatumHashTree *tree, const std::function<bool(AnyCell*, AnyCell*, DatumHash::ResultType)> &pred);
+	template<class P>
+	static bool every(const DatumHashTree *tree, P &&pred);
+
+	/**
+	 * Function resolving a key present in both trees passed to merge()
+	 *
+	 * This is passed the key, the source tree's value and the override tree's value and returns the merged value
+	 */
+	using ConflictFunction = std::function<AnyCell*(AnyCell *key, AnyCell *sourceValue, AnyCell *overrideValue)>;
+
+	/**
+	 * Returns a tree containing the entries of both passed trees
+	 *
+	 * The trees are combined node by node. Subtrees present in only one tree or shared by both trees are reused without
+	 * being visited. Large trees have their top-level children combined in parallel on the default Dispatcher.
+	 *
+	 * @param  source    Tree providing the initial entries. This tree will be unmodified.
+	 * @param  override  Tree whose entries replace any source entries with equal keys. This tree will be unmodified.
+	 * @return New tree with the entries of both trees
+	 */
+	static DatumHashTree* merge(DatumHashTree *source, DatumHashTree *override);
+
+	/**
+	 * Returns a tree containing the entries of both passed trees using a function to resolve conflicting keys
+	 *
+	 * This is equivalent to merge() except the value for each key in both trees is returned by the conflict function.
+	 * The conflict function is called on the calling thread so this is never parallelised.
+	 */
+	static DatumHashTree* merge(DatumHashTree *source, DatumHashTree *override, const ConflictFunction &conflict);
+
+	/**
+	 * Returns a tree containing the entries of a tree with keys in another tree
+	 *
+	 * @param  tree     Tree providing the entries. This tree will be unmodified.
+	 * @param  keyTree  Tree providing the keys to keep. The values in this tree are ignored.
+	 * @return New tree with the matching entries. Values are taken from tree.
+	 */
+	static DatumHashTree* intersection(DatumHashTree *tree, DatumHashTree *keyTree);
+
+	/**
+	 * Returns a tree containing the entries of a tree without keys in another tree
+	 *
+	 * @param  tree     Tree providing the entries. This tree will be unmodified.
+	 * @param  keyTree  Tree providing the keys to remove. The values in this tree are ignored.
+	 * @return New tree without the matching entries
+	 */
+	static DatumHashTree* difference(DatumHashTree *tree, DatumHashTree *keyTree);
+
+	/**
+	 * Function visiting a difference found by diff()
+	 *
+	 * This is passed the key and its value in each tree. Keys missing from a tree have a nullptr value. Returning false
+	 * will abort the diff.
+	 */
+	using DiffVisitor = std::function<bool(AnyCell *key, AnyCell *oldValue, AnyCell *newValue)>;
+
+	/**
+	 * Visits each key that was added, removed or had its value changed between two trees
+	 *
+	 * Values are compared with AnyCell::isEqual(). Subtrees shared by both trees are skipped without being visited which
+	 * makes comparing a tree with one derived from it proportional to the number of changes. Keys are visited in an
+	 * undefined order.
+	 *
+	 * @param  oldTree  Tree to compare from
+	 * @param  newTree  Tree to compare to
+	 * @return True if the visitor returned true for every difference
+	 */
+	static bool diff(const DatumHashTree *oldTree, const DatumHashTree *newTree, const DiffVisitor &visitor);
+
+	/**
+	 * Returns true if both trees contain equal keys with equal values
+	 */
+	static bool isEqual(const DatumHashTree *tree1, const DatumHashTree *tree2);
+
+	/**
+	 * Returns a copy of the tree with each key and value replaced by the passed function
+	 *
+	 * The copy mirrors the structure of the source tree. Every node is allocated once at its final size and the stored
+	 * hash values are reused without rehashing. This makes it much cheaper than building a new tree with assoc().
+	 *
+	 * @param  tree      Tree to copy. This tree will be unmodified.
+	 * @param  replacer  Function called with references to the key and value of each entry in the copy. Replacement
+	 *                   keys must be equal to the original keys. If this function throws any partially built copy will
+	 *                   be freed before the exception is propagated.
+	 * @return New tree with the replaced keys and values
+	 */
+	template<class R>
+	static DatumHashTree* copyMapped(const DatumHashTree *tree, R &&replacer);
 
 	/**
 	 * Increases the reference count of the passed tree and returns it
@@ -148,28 +250,289 @@ public:
 	static std::size_t instanceCount();
 
 protected:
-	static void walkCellRefs(DatumHashTree *tree, alloc::CellRefWalker &walker, const std::function<void(AnyCell**, AnyCell**)> &visitor);
+	template<class W, class V>
+	static void walkCellRefs(DatumHashTree *tree, W &walker, V &&visitor);
+
+	/**
+	 * Returns a copy of the tree's nodes sharing the original keys and values
+	 */
+	static DatumHashTree* copyStructure(const DatumHashTree *tree);
+
+	/**
+	 * Implementation of merge(), intersection(), difference() and diff()
+	 */
+	class SetOperations;
 
 protected:
 	explicit DatumHashTree(std::uint32_t bitmapIndex);
 	~DatumHashTree();
 
 	void *operator new(std::size_t s, void *placement);
-	void operator delete(void *value);
 
 	DatumHashTree* ref();
 	void unref();
 
 	bool isLeafNode() const;
+	bool isExclusive() const;
 
-	static DatumHashTree* assocAtLevel(DatumHashTree *tree, std::uint32_t level, AnyCell *key, AnyCell *value, DatumHash::ResultType hashValue, bool inPlace = false);
+	static DatumHashTree* assocAtLevel(DatumHashTree *tree, std::uint32_t level, AnyCell *key, AnyCell *value, DatumHash::ResultType hashValue);
 	static AnyCell* findAtLevel(DatumHashTree *tree, std::uint32_t level, AnyCell *key, DatumHash::ResultType hashValue);
 	static DatumHashTree* withoutAtLevel(DatumHashTree *tree, std::uint32_t level, AnyCell *key, DatumHash::ResultType hashValueg);
 
+	// These take ownership of the passed tree reference and return a reference to the modified tree
+	static DatumHashTree* transientAssocAtLevel(DatumHashTree *tree, std::uint32_t level, AnyCell *key, AnyCell *value, DatumHash::ResultType hashValue);
+	static DatumHashTree* transientWithoutAtLevel(DatumHashTree *tree, std::uint32_t level, AnyCell *key, DatumHash::ResultType hashValue);
+
 	static const std::uint32_t LeafNodeChildBitmap = 0;
 
 	std::atomic<std::uint32_t> m_refCount;
-	const std::uint32_t m_childBitmap;
+	std::uint32_t m_childBitmap;
+};
+
+/**
+ * Iterates over the entries of a DatumHashTree
+ *
+ * The iterator keeps its own stack of nodes so it never allocates and can be suspended at any point between entries.
+ * It holds a reference to the tree for its lifetime so the tree will remain valid even if all other references are
+ * released. Entries are visited in the same undefined order as every().
+ *
+ * Only moving between leaf nodes requires an out-of-line call; stepping through the entries within a leaf is inline.
+ */
+class DatumHashTree::Iterator
+{
+	friend class DatumHashTree;
+public:
+	explicit Iterator(const DatumHashTree *tree);
+	~Iterator();
+
+	Iterator(const Iterator &) = delete;
+	Iterator& operator=(const Iterator &) = delete;
+
+	/**
+	 * Returns true if every entry has been visited
+	 */
+	bool atEnd() const
+	{
+		return m_entry == m_leafEnd;
+	}
+
+	/**
+	 * Returns the key of the current entry
+	 *
+	 * This must not be called when atEnd() is true
+	 */
+	AnyCell* key() const
+	{
+		return m_entry->key;
+	}
+
+	/**
+	 * Returns the value of the current entry
+	 *
+	 * This must not be called when atEnd() is true
+	 */
+	AnyCell* value() const
+	{
+		return m_entry->value;
+	}
+
+	/**
+	 * Returns the hash value of the current entry's key
+	 *
+	 * This must not be called when atEnd() is true
+	 */
+	DatumHash::ResultType hashValue() const
+	{
+		return m_leafHashValue;
+	}
+
+	/**
+	 * Moves to the next entry
+	 *
+	 * This must not be called when atEnd() is true
+	 */
+	void advance()
+	{
+		if (++m_entry == m_leafEnd)
+		{
+			enterNextLeaf();
+		}
+	}
+
+	/**
+	 * Maximum number of internal nodes between the root and a leaf node
+	 *
+	 * Each level consumes 5 bits of the key's hash value. Keys with identical hash values share a leaf node.
+	 */
+	static const std::size_t MaximumDepth = ((sizeof(DatumHash::ResultType) * 8) + 4) / 5;
+
+private:
+	void descendToLeaf(DatumHashTree *node);
+	void enterNextLeaf();
+
+	struct Frame
+	{
+		DatumHashTree *const *nextChild;
+		DatumHashTree *const *childrenEnd;
+	};
+
+	DatumHashTree *m_tree;
+
+	const DatumHashTree *m_leaf = nullptr;
+	Entry *m_entry = nullptr;
+	Entry *m_leafEnd = nullptr;
+	DatumHash::ResultType m_leafHashValue = 0;
+
+	std::size_t m_depth = 0;
+	Frame m_stack[MaximumDepth];
+};
+
+template<class P>
+bool DatumHashTree::every(const DatumHashTree *tree, P &&pred)
+{
+	for(Iterator it(tree); !it.atEnd(); it.advance())
+	{
+		if (!pred(it.key(), it.value(), it.hashValue()))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+template<class R>
+DatumHashTree* DatumHashTree::copyMapped(const DatumHashTree *tree, R &&replacer)
+{
+	DatumHashTree *copiedTree = copyStructure(tree);
+
+	try
+	{
+		for(Iterator it(copiedTree); !it.atEnd(); it.advance())
+		{
+			replacer(it.m_entry->key, it.m_entry->value);
+		}
+	}
+	catch(...)
+	{
+		unref(copiedTree);
+		throw;
+	}
+
+	return copiedTree;
+}
+
+template<class W, class V>
+void DatumHashTree::walkCellRefs(DatumHashTree *tree, W &walker, V &&visitor)
+{
+	Iterator it(tree);
+
+	while(!it.atEnd())
+	{
+		// The iterator is always positioned at the first entry of a leaf here
+		if (walker.shouldVisitDatumHashSubtree(it.m_leaf))
+		{
+			for(Entry *entry = it.m_entry; entry != it.m_leafEnd; entry++)
+			{
+				visitor(&entry->key, &entry->value);
+			}
+		}
+
+		// Either we've visited every entry or another hash map sharing this leaf node has already visited it
+		it.enterNextLeaf();
+	}
+}
+
+/**
+ * Mutable view of a DatumHashTree for efficiently applying a batch of changes
+ *
+ * Nodes exclusively owned by the transient are modified in place instead of being copied. Nodes shared with other trees
+ * are copied the first time they're modified; the copies are then exclusively owned and can be modified in place by
+ * later changes. This makes building a tree with a transient much cheaper than building it with repeated assoc().
+ *
+ * Transients aren't thread safe. Once the batch of changes is complete persistent() returns the final tree.
+ */
+class DatumHashTree::Transient
+{
+public:
+	/**
+	 * Creates a new transient
+	 *
+	 * @param  tree  Initial tree for the transient. The transient takes ownership of this reference; callers wishing to
+	 *               keep using the tree should pass DatumHashTree::ref(tree). The tree itself will not be modified
+	 *               unless the transient holds the only reference to it.
+	 */
+	explicit Transient(DatumHashTree *tree = nullptr) :
+		m_tree(tree)
+	{
+	}
+
+	~Transient()
+	{
+		DatumHashTree::unref(m_tree);
+	}
+
+	Transient(const Transient &) = delete;
+	Transient& operator=(const Transient &) = delete;
+
+	/**
+	 * Adds a key/value pair to the transient
+	 *
+	 * If the key already exists its value will be replaced
+	 */
+	void assoc(AnyCell *key, AnyCell *value, DatumHash::ResultType hashValue)
+	{
+		m_tree = transientAssocAtLevel(m_tree, 0, key, value, hashValue);
+	}
+
+	void assoc(AnyCell *key, AnyCell *value)
+	{
+		DatumHash hasher;
+		assoc(key, value, hasher(key));
+	}
+
+	/**
+	 * Removes a key from the transient if it exists
+	 */
+	void without(AnyCell *key, DatumHash::ResultType hashValue)
+	{
+		m_tree = transientWithoutAtLevel(m_tree, 0, key, hashValue);
+	}
+
+	void without(AnyCell *key)
+	{
+		DatumHash hasher;
+		without(key, hasher(key));
+	}
+
+	/**
+	 * Finds a value associated with the specified key or nullptr if the key could not be found
+	 */
+	AnyCell* find(AnyCell *key, DatumHash::ResultType hashValue) const
+	{
+		return DatumHashTree::find(m_tree, key, hashValue);
+	}
+
+	AnyCell* find(AnyCell *key) const
+	{
+		return DatumHashTree::find(m_tree, key);
+	}
+
+	/**
+	 * Returns the transient's tree
+	 *
+	 * Ownership of the tree passes to the caller. The transient is left empty.
+	 */
+	DatumHashTree* persistent()
+	{
+		DatumHashTree *tree = m_tree;
+		m_tree = nullptr;
+
+		return tree;
+	}
+
+private:
+	DatumHashTree *m_tree;
 };
 
 
@@ -0,0 +1,107 @@
+#include "hash/TransientHashMapCell.h"
+
+#include "core/error.h"
+#include "alloc/allocator.h"
+#include "alloc/GarbageState.h"
+
+#include "binding/HashMapCell.h"
+#include "binding/EmptyListCell.h"
+
+#include "hash/DatumHashTree.h"
+
+namespace lliby
+{
+
+namespace
+{
+	// This value should blow up the GC as a sanity check that we registered our class with registerRecordClass() at
+	// startup
+	RecordLikeCell::RecordClassIdType registeredClassId = ~0;
+}
+
+TransientHashMapCell::TransientHashMapCell(HashMapCell *hashMap) :
+	RecordCell(registeredClassId, true, hashMap)
+{
+}
+
+TransientHashMapCell* TransientHashMapCell::createInstance(World &world, HashMapCell *basis)
+{
+	alloc::AllocCell *placement = alloc::allocateCells(world, 2);
+
+	auto hashMap = new (&placement[1]) HashMapCell(DatumHashTree::ref(basis->datumHashTree()));
+	return new (&placement[0]) TransientHashMapCell(hashMap);
+}
+
+bool TransientHashMapCell::isInstance(const AnyCell *cell)
+{
+	auto recordCell = cell_cast<RecordCell>(cell);
+	return recordCell && (recordCell->recordClassId() == registeredClassId);
+}
+
+HashMapCell* TransientHashMapCell::hashMap(World &world)
+{
+	auto hashMap = cell_cast<HashMapCell>(static_cast<AnyCell*>(recordData()));
+
+	if (hashMap == nullptr)
+	{
+		signalError(world, ErrorCategory::InvalidArgument, "Transient hash map used after (persistent!)", {this});
+	}
+
+	return hashMap;
+}
+
+HashMapCell* TransientHashMapCell::modifiableHashMap(World &world)
+{
+	HashMapCell *hashMap = this->hashMap(world);
+
+	if (hashMap->gcState() == GarbageState::TenuredCell)
+	{
+		// Tenured cells are only rescanned while they're in the remembered set. Modifying our tree in place could leave
+		// a tenured hash map referencing young cells without the collector knowing. Instead move our tree to a new young
+		// hash map; we're a record so we're never tenured ourselves.
+		auto youngHashMap = new (alloc::allocateCells(world)) HashMapCell(hashMap->datumHashTree());
+		hashMap->setDatumHashTree(DatumHashTree::createEmpty());
+
+		setRecordData(youngHashMap);
+		return youngHashMap;
+	}
+
+	return hashMap;
+}
+
+void TransientHashMapCell::assoc(World &world, AnyCell *key, AnyCell *value)
+{
+	HashMapCell *hashMap = modifiableHashMap(world);
+
+	DatumHashTree::Transient transient(hashMap->datumHashTree());
+	transient.assoc(key, value);
+	hashMap->setDatumHashTree(transient.persistent());
+}
+
+void TransientHashMapCell::without(World &world, AnyCell *key)
+{
+	HashMapCell *hashMap = modifiableHashMap(world);
+
+	DatumHashTree::Transient transient(hashMap->datumHashTree());
+	transient.without(key);
+	hashMap->setDatumHashTree(transient.persistent());
+}
+
+HashMapCell* TransientHashMapCell::persistent(World &world)
+{
+	HashMapCell *hashMap = this->hashMap(world);
+
+	// The empty list is a global constant so it's safe for the collector to visit
+	setRecordData(EmptyListCell::instance());
+	return hashMap;
+}
+
+void TransientHashMapCell::registerRecordClass()
+{
+	// Our only field is our hash map
+	std::vector<std::size_t> offsets = { 0 };
+
+	registeredClassId = RecordLikeCell::registerRuntimeRecordClass(sizeof(void *), offsets);
+}
+
+}
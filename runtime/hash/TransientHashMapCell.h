@@ -0,0 +1,69 @@
+#ifndef _LLIBY_HASH_TRANSIENTHASHMAPCELL_H
+#define _LLIBY_HASH_TRANSIENTHASHMAPCELL_H
+
+#include "binding/RecordCell.h"
+
+namespace lliby
+{
+class World;
+class HashMapCell;
+
+/**
+ * Record cell holding a hash map under construction
+ *
+ * The transient owns a private HashMapCell whose tree is modified in place by assoc() and without(). Once the batch of
+ * changes is complete persistent() releases the hash map and invalidates the transient.
+ */
+class TransientHashMapCell : public RecordCell
+{
+public:
+	/**
+	 * Creates a new transient with the contents of the passed hash map
+	 *
+	 * The passed hash map is unaffected by any modifications to the transient
+	 */
+	static TransientHashMapCell* createInstance(World &world, HashMapCell *basis);
+
+	/**
+	 * Returns true if the passed cell is a TransientHashMapCell
+	 */
+	static bool isInstance(const AnyCell *cell);
+
+	/**
+	 * Associates a key with a value in the transient
+	 *
+	 * This signals an error if persistent() has already been called
+	 */
+	void assoc(World &world, AnyCell *key, AnyCell *value);
+
+	/**
+	 * Removes a key from the transient
+	 *
+	 * This signals an error if persistent() has already been called
+	 */
+	void without(World &world, AnyCell *key);
+
+	/**
+	 * Returns the transient's hash map and invalidates the transient
+	 *
+	 * This signals an error if persistent() has already been called
+	 */
+	HashMapCell* persistent(World &world);
+
+	/**
+	 * Registers the record class for transient hash maps
+	 *
+	 * This is called by llcore_run() at startup; this should not be directly invoked
+	 */
+	static void registerRecordClass();
+
+private:
+	explicit TransientHashMapCell(HashMapCell *hashMap);
+
+	HashMapCell *hashMap(World &world);
+	HashMapCell *modifiableHashMap(World &world);
+};
+
+}
+
+#endif
@@ -0,0 +1,181 @@
+#include "platform/topology.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <sched.h>
+#include <pthread.h>
+#endif
+
+namespace lliby
+{
+namespace platform
+{
+
+namespace
+{
+	/**
+	 * Parses a Linux CPU or node list such as "0-3,8-11"
+	 */
+	std::vector<unsigned int> parseRangeList(const std::string &rangeList)
+	{
+		std::vector<unsigned int> values;
+		std::istringstream rangeStream(rangeList);
+		std::string range;
+
+		while(std::getline(rangeStream, range, ','))
+		{
+			const std::size_t dashIndex = range.find('-');
+
+			try
+			{
+				const unsigned int first = std::stoul(range.substr(0, dashIndex));
+				unsigned int last = first;
+
+				if (dashIndex != std::string::npos)
+				{
+					last = std::stoul(range.substr(dashIndex + 1));
+				}
+
+				for(unsigned int value = first; value <= last; value++)
+				{
+					values.push_back(value);
+				}
+			}
+			catch(std::exception &)
+			{
+				// Ignore malformed ranges
+			}
+		}
+
+		return values;
+	}
+
+	std::string readFirstLine(const std::string &path)
+	{
+		std::ifstream file(path);
+		std::string line;
+
+		std::getline(file, line);
+		return line;
+	}
+
+	struct NumaTopology
+	{
+		NumaTopology()
+		{
+#ifdef __linux__
+			for(unsigned int node : parseRangeList(readFirstLine("/sys/devices/system/node/possible")))
+			{
+				const std::string cpuListPath = "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+
+				for(unsigned int cpu : parseRangeList(readFirstLine(cpuListPath)))
+				{
+					if (cpu >= cpuNodes.size())
+					{
+						cpuNodes.resize(cpu + 1, 0);
+					}
+
+					cpuNodes[cpu] = node;
+				}
+
+				nodeCount = std::max<std::size_t>(nodeCount, node + 1);
+			}
+#endif
+		}
+
+		std::size_t nodeCount = 1;
+		std::vector<std::size_t> cpuNodes;
+	};
+
+	const NumaTopology& numaTopology()
+	{
+		static NumaTopology topology;
+		return topology;
+	}
+}
+
+std::size_t numaNodeCount()
+{
+	return numaTopology().nodeCount;
+}
+
+std::size_t numaNodeOfCpu(unsigned int cpu)
+{
+	const NumaTopology &topology = numaTopology();
+
+	if (cpu >= topology.cpuNodes.size())
+	{
+		return 0;
+	}
+
+	return topology.cpuNodes[cpu];
+}
+
+std::size_t currentNumaNode()
+{
+	if (numaNodeCount() == 1)
+	{
+		// Don't bother asking which CPU we're on
+		return 0;
+	}
+
+#ifdef __linux__
+	const int cpu = sched_getcpu();
+
+	if (cpu >= 0)
+	{
+		return numaNodeOfCpu(cpu);
+	}
+#endif
+
+	return 0;
+}
+
+std::vector<unsigned int> allowedCpus()
+{
+	std::vector<unsigned int> cpus;
+
+#ifdef __linux__
+	cpu_set_t cpuSet;
+
+	if (sched_getaffinity(0, sizeof(cpuSet), &cpuSet) == 0)
+	{
+		for(unsigned int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+		{
+			if (CPU_ISSET(cpu, &cpuSet))
+			{
+				cpus.push_back(cpu);
+			}
+		}
+	}
+#endif
+
+	return cpus;
+}
+
+bool pinCurrentThreadToCpu(unsigned int cpu)
+{
+#ifdef __linux__
+	if (cpu >= CPU_SETSIZE)
+	{
+		return false;
+	}
+
+	cpu_set_t cpuSet;
+
+	CPU_ZERO(&cpuSet);
+	CPU_SET(cpu, &cpuSet);
+
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+#else
+	(void)cpu;
+	return false;
+#endif
+}
+
+}
+}
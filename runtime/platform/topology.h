@@ -0,0 +1,50 @@
+#ifndef _LLIBY_PLATFORM_TOPOLOGY_H
+#define _LLIBY_PLATFORM_TOPOLOGY_H
+
+#include <cstddef>
+#include <vector>
+
+namespace lliby
+{
+namespace platform
+{
+
+/**
+ * Returns the number of NUMA nodes in the system
+ *
+ * On platforms without NUMA support this returns 1
+ */
+std::size_t numaNodeCount();
+
+/**
+ * Returns the NUMA node containing the passed CPU
+ *
+ * Unknown CPUs are reported as being on node 0
+ */
+std::size_t numaNodeOfCpu(unsigned int cpu);
+
+/**
+ * Returns the NUMA node of the CPU the current thread is running on
+ *
+ * The thread may be migrated to another CPU at any time unless it has been pinned
+ */
+std::size_t currentNumaNode();
+
+/**
+ * Returns the CPUs the current process is allowed to run on in ascending order
+ *
+ * If this can't be determined an empty vector is returned
+ */
+std::vector<unsigned int> allowedCpus();
+
+/**
+ * Restricts the current thread to running on the passed CPU
+ *
+ * @return True if the thread was pinned
+ */
+bool pinCurrentThreadToCpu(unsigned int cpu);
+
+}
+}
+
+#endif
@@ -1,7 +1,11 @@
 #include "sched/Dispatcher.h"
 
-#include <thread>
+#include <algorithm>
 #include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include "platform/topology.h"
 
 namespace lliby
 {
@@ -10,18 +14,110 @@ namespace sched
 
 namespace
 {
+	/**
+	 * Number of jobs a worker runs between checks of the injection queue and the oldest job in its own deque
+	 *
+	 * Workers otherwise always prefer their most recently dispatched work. This prevents older work from starving.
+	 */
+	const std::size_t FairnessInterval = 61;
+
+	/**
+	 * Time an idle spare thread waits for work before exiting
+	 */
+	const std::chrono::seconds SpareIdleTimeout(5);
+
+	std::size_t defaultWorkerCount()
+	{
+		if (const char *threadsString = getenv("LLAMBDA_DISPATCHER_THREADS"))
+		{
+			const std::size_t threads = strtoull(threadsString, nullptr, 10);
+
+			if (threads > 0)
+			{
+				return threads;
+			}
+		}
+
+		return std::max(1U, std::thread::hardware_concurrency());
+	}
+
+	bool shouldPinWorkers()
+	{
+		const char *pinString = getenv("LLAMBDA_DISPATCHER_PIN_THREADS");
+		return pinString && !strcmp(pinString, "1");
+	}
+
+	// Dispatcher and worker whose work the current thread is running
+	thread_local Dispatcher *currentDispatcher = nullptr;
+	thread_local void *currentWorker = nullptr;
+
 	Dispatcher DefaultInstance;
 }
 
-Dispatcher::Dispatcher() :
+Dispatcher::BlockingScope::BlockingScope(Dispatcher &dispatcher) :
+	m_blockedDispatcher(nullptr)
+{
+	if (dispatcher.onWorkerThread())
+	{
+		m_blockedDispatcher = &dispatcher;
+		m_blockedDispatcher->beginBlocking();
+	}
+}
+
+Dispatcher::BlockingScope::~BlockingScope()
+{
+	if (m_blockedDispatcher)
+	{
+		m_blockedDispatcher->endBlocking();
+	}
+}
+
+Dispatcher::Dispatcher(std::size_t workerCount) :
+	m_workerCount(workerCount ? workerCount : defaultWorkerCount()),
+	m_queuedJobs(0),
+	m_pendingJobs(0),
 	m_idleThreads(0),
-	m_runningThreads(0)
+	m_nextHomeWorker(0),
+	m_blockedThreads(0)
 {
 }
 
 Dispatcher::~Dispatcher()
 {
+	if (onWorkerThread())
+	{
+		// We're being destroyed by our own work, most likely because the process is exiting. We can't wait for
+		// ourselves so abandon our threads.
+		for(auto &worker : m_workers)
+		{
+			worker->thread.detach();
+			worker.release();
+		}
+
+		return;
+	}
+
 	waitForDrain();
+
+	{
+		std::lock_guard<std::mutex> lock(m_parkMutex);
+		m_shutdown = true;
+
+		for(auto &worker : m_workers)
+		{
+			worker->parkCond.notify_all();
+		}
+	}
+
+	m_parkCond.notify_all();
+
+	for(auto &worker : m_workers)
+	{
+		worker->thread.join();
+	}
+
+	std::unique_lock<std::mutex> lock(m_parkMutex);
+	m_spareExitCond.wait(lock, [=]{return m_spareThreads == 0;});
 }
 
 Dispatcher& Dispatcher::defaultInstance()
@@ -29,96 +125,478 @@ Dispatcher& Dispatcher::defaultInstance()
 	return DefaultInstance;
 }
 
+void Dispatcher::startWorkers()
+{
+	std::vector<unsigned int> pinCpus;
+
+	if (shouldPinWorkers())
+	{
+		pinCpus = platform::allowedCpus();
+	}
+
+	// Create every worker before starting any threads as they steal from each other
+	for(std::size_t i = 0; i < m_workerCount; i++)
+	{
+		auto worker = new Worker;
+
+		worker->lifoSlot.store(nullptr, std::memory_order_relaxed);
+		worker->nextVictim = i + 1;
+		worker->homeQueueSize.store(0, std::memory_order_relaxed);
+
+		if (!pinCpus.empty())
+		{
+			worker->pinnedCpu = pinCpus[i % pinCpus.size()];
+			worker->numaNode.store(platform::numaNodeOfCpu(worker->pinnedCpu), std::memory_order_relaxed);
+		}
+		else
+		{
+			worker->numaNode.store(0, std::memory_order_relaxed);
+		}
+
+		m_workers.emplace_back(worker);
+	}
+
+	for(auto &worker : m_workers)
+	{
+		worker->thread = std::thread(&Dispatcher::workerThread, this, worker.get());
+	}
+}
+
 void Dispatcher::dispatch(const WorkFunction &work)
 {
-	std::unique_lock<std::mutex> lock(m_mutex);
+	std::call_once(m_startWorkersFlag, &Dispatcher::startWorkers, this);
+
+	m_pendingJobs.fetch_add(1);
+	enqueue(new Job{work});
+}
+
+void Dispatcher::dispatchDeferred(const WorkFunction &work)
+{
+	std::call_once(m_startWorkersFlag, &Dispatcher::startWorkers, this);
+
+	m_pendingJobs.fetch_add(1);
+
+	// Workers only check the injection queue once their own work is exhausted or at their fairness interval
+	inject(new Job{work});
+}
+
+std::size_t Dispatcher::assignHomeWorker()
+{
+	return m_nextHomeWorker.fetch_add(1, std::memory_order_relaxed) % m_workerCount;
+}
 
-	if (m_idleThreads < 1)
+std::size_t Dispatcher::workerNumaNode(std::size_t workerIndex)
+{
+	return homeWorker(workerIndex)->numaNode.load(std::memory_order_relaxed);
+}
+
+Dispatcher::Worker* Dispatcher::homeWorker(std::size_t workerIndex)
+{
+	std::call_once(m_startWorkersFlag, &Dispatcher::startWorkers, this);
+	return m_workers[workerIndex % m_workers.size()].get();
+}
+
+void Dispatcher::dispatchToWorker(std::size_t workerIndex, const WorkFunction &work)
+{
+	Worker *worker = homeWorker(workerIndex);
+
+	m_pendingJobs.fetch_add(1);
+
+	if ((currentDispatcher == this) && (currentWorker == worker))
 	{
-		m_runningThreads++;
-		lock.unlock();
+		// We're already home
+		enqueue(new Job{work});
+	}
+	else
+	{
+		enqueueHome(worker, new Job{work});
+	}
+}
 
-		try
+void Dispatcher::dispatchDeferredToWorker(std::size_t workerIndex, const WorkFunction &work)
+{
+	Worker *worker = homeWorker(workerIndex);
+
+	m_pendingJobs.fetch_add(1);
+	enqueueHome(worker, new Job{work});
+}
+
+void Dispatcher::enqueue(Job *job)
+{
+	if ((currentDispatcher == this) && (currentWorker != nullptr))
+	{
+		auto worker = static_cast<Worker*>(currentWorker);
+
+		// Run this next on our worker and make the previous next job available to thieves
+		Job *previousJob = worker->lifoSlot.exchange(job, std::memory_order_acq_rel);
+
+		if (previousJob)
+		{
+			worker->deque.push(previousJob);
+		}
+
+		m_queuedJobs.fetch_add(1);
+		notifyIdleWorker();
+	}
+	else
+	{
+		inject(job);
+	}
+}
+
+void Dispatcher::inject(Job *job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_injectionMutex);
+		m_injectionQueue.push_back(job);
+	}
+
+	m_queuedJobs.fetch_add(1);
+	notifyIdleWorker();
+}
+
+void Dispatcher::enqueueHome(Worker *homeWorker, Job *job)
+{
+	{
+		std::lock_guard<std::mutex> lock(homeWorker->homeQueueMutex);
+
+		homeWorker->homeQueue.push_back(job);
+		homeWorker->homeQueueSize.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	m_queuedJobs.fetch_add(1);
+	notifyHomeWorker(homeWorker);
+}
+
+void Dispatcher::notifyIdleWorker()
+{
+	// This avoids taking the lock when every thread is busy. Parking threads increment the idle count before checking
+	// for queued jobs so either they'll see our job or we'll see them.
+	if (m_idleThreads.load() > 0)
+	{
+		std::lock_guard<std::mutex> lock(m_parkMutex);
+		wakeIdleThreadLocked();
+	}
+}
+
+void Dispatcher::notifyHomeWorker(Worker *homeWorker)
+{
+	if (m_idleThreads.load() > 0)
+	{
+		std::lock_guard<std::mutex> lock(m_parkMutex);
+
+		if (homeWorker->parked)
+		{
+			homeWorker->parkCond.notify_one();
+		}
+		else
 		{
-			// We need to launch a new thread - pass it the initial work to do to avoid queue contention
-			std::thread newThread(&Dispatcher::workerThread, this, work);
-			newThread.detach();
+			// Our home worker is busy. Let an idle thread steal the work if it has nothing better to do.
+			wakeIdleThreadLocked();
+		}
+	}
+}
 
+void Dispatcher::wakeIdleThreadLocked()
+{
+	// Prefer parked workers to spare threads. Workers stay marked as parked until they run so a burst of work wakes
+	// them one at a time instead of waking every worker for work the first will take.
+	for(auto &worker : m_workers)
+	{
+		if (worker->parked)
+		{
+			worker->parkCond.notify_one();
 			return;
 		}
-		catch(std::system_error &)
+	}
+
+	m_parkCond.notify_one();
+}
+
+Dispatcher::Job* Dispatcher::takeInjectedJob()
+{
+	std::lock_guard<std::mutex> lock(m_injectionMutex);
+
+	if (m_injectionQueue.empty())
+	{
+		return nullptr;
+	}
+
+	Job *job = m_injectionQueue.front();
+	m_injectionQueue.pop_front();
+
+	return job;
+}
+
+Dispatcher::Job* Dispatcher::takeHomeJob(Worker *worker)
+{
+	if (worker->homeQueueSize.load(std::memory_order_relaxed) == 0)
+	{
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(worker->homeQueueMutex);
+
+	if (worker->homeQueue.empty())
+	{
+		return nullptr;
+	}
+
+	Job *job = worker->homeQueue.front();
+	worker->homeQueue.pop_front();
+	worker->homeQueueSize.fetch_sub(1, std::memory_order_relaxed);
+
+	return job;
+}
+
+Dispatcher::Job* Dispatcher::stealJob(Worker *thief, std::size_t &nextVictim)
+{
+	const std::size_t workerCount = m_workers.size();
+
+	// Prefer the older work in the other workers' deques
+	for(std::size_t i = 0; i < workerCount; i++)
+	{
+		Worker *victim = m_workers[(nextVictim + i) % workerCount].get();
+
+		if (victim == thief)
+		{
+			continue;
+		}
+
+		if (Job *job = victim->deque.steal())
+		{
+			nextVictim += i;
+			return job;
+		}
+	}
+
+	// Take work a busy worker was going to run next
+	for(std::size_t i = 0; i < workerCount; i++)
+	{
+		Worker *victim = m_workers[(nextVictim + i) % workerCount].get();
+
+		if ((victim == thief) || (victim->lifoSlot.load(std::memory_order_relaxed) == nullptr))
+		{
+			continue;
+		}
+
+		if (Job *job = victim->lifoSlot.exchange(nullptr, std::memory_order_acq_rel))
 		{
-			// Failed to launch a thread. This can happen on low resource situations. Fall back to queuing
-			lock.lock();
-			m_runningThreads--;
+			nextVictim += i;
+			return job;
+		}
+	}
+
+	// Finally take work that was meant for a busy worker
+	for(std::size_t i = 0; i < workerCount; i++)
+	{
+		Worker *victim = m_workers[(nextVictim + i) % workerCount].get();
 
-			m_drainCond.notify_all();
+		if (victim == thief)
+		{
+			continue;
+		}
+
+		if (Job *job = takeHomeJob(victim))
+		{
+			nextVictim += i;
+			return job;
+		}
+	}
+
+	nextVictim++;
+	return nullptr;
+}
+
+Dispatcher::Job* Dispatcher::findJob(Worker *worker, std::size_t &nextVictim)
+{
+	Job *job = nullptr;
+
+	if (worker)
+	{
+		if ((++worker->jobsRun % FairnessInterval) == 0)
+		{
+			job = takeInjectedJob();
+
+			if (!job)
+			{
+				job = takeHomeJob(worker);
+			}
+
+			if (!job)
+			{
+				job = worker->deque.steal();
+			}
+		}
+
+		if (!job)
+		{
+			job = worker->lifoSlot.exchange(nullptr, std::memory_order_acq_rel);
+		}
+
+		if (!job)
+		{
+			job = worker->deque.pop();
+		}
+
+		if (!job)
+		{
+			job = takeHomeJob(worker);
 		}
 	}
 
-	m_workQueue.push(work);
-	lock.unlock();
+	if (!job)
+	{
+		job = takeInjectedJob();
+	}
+
+	if (!job)
+	{
+		job = stealJob(worker, nextVictim);
+	}
 
-	m_workQueueCond.notify_one();
+	if (job)
+	{
+		m_queuedJobs.fetch_sub(1);
+	}
+
+	return job;
 }
 
-void Dispatcher::workerThread(WorkFunction initialWork)
+void Dispatcher::runJob(Job *job)
 {
-	// Do our initial work
-	initialWork();
+	job->work();
+	delete job;
+
+	if (m_pendingJobs.fetch_sub(1) == 1)
+	{
+		std::lock_guard<std::mutex> lock(m_drainMutex);
+		m_drainCond.notify_all();
+	}
+}
+
+void Dispatcher::workerThread(Worker *worker)
+{
+	currentDispatcher = this;
+	currentWorker = worker;
+
+	if ((worker->pinnedCpu >= 0) && !platform::pinCurrentThreadToCpu(worker->pinnedCpu))
+	{
+		// Fall back to tracking the node we're running on
+		worker->pinnedCpu = -1;
+	}
+
+	if (worker->pinnedCpu < 0)
+	{
+		worker->numaNode.store(platform::currentNumaNode(), std::memory_order_relaxed);
+	}
 
 	while(true)
 	{
-		std::unique_lock<std::mutex> lock(m_mutex);
+		if (Job *job = findJob(worker, worker->nextVictim))
+		{
+			runJob(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_parkMutex);
 
-		// We're now idle
 		m_idleThreads++;
+		worker->parked = true;
 
-		// Wait until we we either timeout or start draining
-		std::chrono::seconds timeout(5);
-		m_workQueueCond.wait_for(lock, timeout, [=]{return m_draining || !m_workQueue.empty();});
+		worker->parkCond.wait(lock, [=]{return m_shutdown || (m_queuedJobs.load() > 0);});
 
-		// We're no longer idle
+		worker->parked = false;
 		m_idleThreads--;
 
-		if (m_workQueue.empty())
+		if (m_shutdown)
 		{
-			// Nothing to do; give up our thread
-			m_runningThreads--;
-			m_drainCond.notify_all();
-
 			return;
 		}
 
-		// Grab the work
-		WorkFunction queuedWork(m_workQueue.front());
-		m_workQueue.pop();
-
-		// Release the lock
 		lock.unlock();
 
-		// Run the queued work outside of the lock
-		queuedWork();
+		if (m_queuedJobs.load() > 1)
+		{
+			// Other wakes may have been sent to us while we were waking. Pass them along.
+			notifyIdleWorker();
+		}
+
+		if (worker->pinnedCpu < 0)
+		{
+			// We may have been migrated while parked
+			worker->numaNode.store(platform::currentNumaNode(), std::memory_order_relaxed);
+		}
 	}
 }
 
-void Dispatcher::waitForDrain()
+void Dispatcher::spareThread()
+{
+	currentDispatcher = this;
+
+	std::size_t nextVictim = 0;
+
+	while(true)
+	{
+		if (Job *job = findJob(nullptr, nextVictim))
+		{
+			runJob(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_parkMutex);
+
+		m_idleThreads++;
+		bool hasWork = m_parkCond.wait_for(lock, SpareIdleTimeout, [=]{return m_shutdown || (m_queuedJobs.load() > 0);});
+		m_idleThreads--;
+
+		if (m_shutdown || (!hasWork && (m_spareThreads > m_blockedThreads.load())))
+		{
+			// We're no longer needed
+			m_spareThreads--;
+			m_spareExitCond.notify_all();
+
+			return;
+		}
+	}
+}
+
+void Dispatcher::beginBlocking()
 {
-	std::unique_lock<std::mutex> lock(m_mutex);
+	std::lock_guard<std::mutex> lock(m_parkMutex);
 
-	// Signal that we want to drain
-	m_draining = true;
+	const std::size_t blockedThreads = ++m_blockedThreads;
 
-	// Wake up all of our worker threads so they notice we're draining
-	m_workQueueCond.notify_all();
+	// Keep a runnable thread for every worker; idle spares from earlier blocks are reused
+	if (m_spareThreads < blockedThreads)
+	{
+		try
+		{
+			std::thread(&Dispatcher::spareThread, this).detach();
+			m_spareThreads++;
+		}
+		catch(std::system_error &)
+		{
+			// Failed to launch a thread. This can happen on low resource situations. Our remaining workers will have
+			// to make progress.
+		}
+	}
+}
+
+void Dispatcher::endBlocking()
+{
+	m_blockedThreads--;
+}
 
-	// Wait for all of the threads to stop
-	m_drainCond.wait(lock, [=]{
-		return m_workQueue.empty() && m_runningThreads == 0;
-	});
+bool Dispatcher::onWorkerThread() const
+{
+	return currentDispatcher == this;
+}
 
-	// We're no longer draining
-	m_draining = false;
+void Dispatcher::waitForDrain()
+{
+	std::unique_lock<std::mutex> lock(m_drainMutex);
+	m_drainCond.wait(lock, [=]{return m_pendingJobs.load() == 0;});
 }
 
 }
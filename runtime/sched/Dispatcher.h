@@ -3,24 +3,74 @@
 
 #include <functional>
 #include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <deque>
+#include <vector>
+#include <thread>
 #include <condition_variable>
 
+#include "sched/WorkStealingDeque.h"
+
 namespace lliby
 {
 namespace sched
 {
 
+/**
+ * Work-stealing thread pool
+ *
+ * The dispatcher runs a fixed number of worker threads, by default one per hardware thread. Each worker owns a
+ * work-stealing deque and a LIFO slot. Work dispatched from a worker is placed in its LIFO slot so a chain of actor
+ * wakes runs on the same core while its data is still in cache; any work previously in the slot is pushed to the
+ * worker's deque. Idle workers steal from the other workers' deques and finally their LIFO slots. Work dispatched
+ * from outside the pool is placed on a shared injection queue.
+ *
+ * Work can also be dispatched to a specific home worker. This gives actors soft affinity to a single worker so their
+ * heaps stay in that worker's cache and NUMA node. Home work dispatched from another thread is placed on the home
+ * worker's home queue and its worker is woken if it's parked. Other workers only take home work once they have nothing
+ * else to run.
+ *
+ * If the LLAMBDA_DISPATCHER_PIN_THREADS environment variable is set to 1 each worker is pinned to a single CPU the
+ * process is allowed to run on.
+ *
+ * Work that blocks a worker on another piece of work, such as an actor asking another actor, must be wrapped in a
+ * BlockingScope. This starts a spare thread for the duration of the block so the pool can't deadlock.
+ */
 class Dispatcher
 {
 public:
 	using WorkFunction = std::function<void()>;
 
+	/**
+	 * Marks the current thread as blocked for its lifetime
+	 *
+	 * If the current thread is running work for the dispatcher a spare thread will be started if required to keep the
+	 * number of runnable threads at the worker count. This has no effect on threads outside of the dispatcher.
+	 */
+	class BlockingScope
+	{
+	public:
+		explicit BlockingScope(Dispatcher &dispatcher = Dispatcher::defaultInstance());
+		~BlockingScope();
+
+		BlockingScope(const BlockingScope &) = delete;
+		BlockingScope& operator=(const BlockingScope &) = delete;
+
+	private:
+		Dispatcher *m_blockedDispatcher;
+	};
+
 	/**
 	 * Creates a new standlone dispatcher
+	 *
+	 * @param  workerCount  Number of worker threads. If this is zero the LLAMBDA_DISPATCHER_THREADS environment
+	 *                      variable is used if set; otherwise one worker is created per hardware thread. Workers are
+	 *                      started on the first dispatch.
 	 */
-	Dispatcher();
+	explicit Dispatcher(std::size_t workerCount = 0);
 	~Dispatcher();
 
 	/**
@@ -28,34 +78,147 @@ public:
 	 */
 	static Dispatcher &defaultInstance();
 
+	/**
+	 * Returns the number of worker threads
+	 */
+	std::size_t workerCount() const
+	{
+		return m_workerCount;
+	}
+
 	/**
 	 * Dispatches work on the next available thread
 	 */
 	void dispatch(const WorkFunction &work);
 
 	/**
-	 * Waits for the scheduler to drain all queued work and all worker threads to exit
+	 * Dispatches work to run after the work already queued on the current worker
+	 *
+	 * This is intended for long-running work that yields its thread to give other work a chance to run. Unlike
+	 * dispatch() the work will not be placed in the current worker's LIFO slot.
+	 */
+	void dispatchDeferred(const WorkFunction &work);
+
+	/**
+	 * Returns a home worker for a new long-lived unit of work such as an actor
+	 *
+	 * Home workers are assigned round-robin
+	 */
+	std::size_t assignHomeWorker();
+
+	/**
+	 * Returns the NUMA node of the passed worker
+	 *
+	 * If workers aren't pinned this is the node the worker was last woken on
+	 */
+	std::size_t workerNumaNode(std::size_t workerIndex);
+
+	/**
+	 * Dispatches work to run on its home worker
+	 *
+	 * If the current thread is the home worker this is equivalent to dispatch(). Otherwise the work is placed on the
+	 * home worker's home queue. Idle workers may still steal the work if the home worker is busy.
+	 *
+	 * @param  homeWorker  Index of the home worker as returned by assignHomeWorker()
+	 * @param  work        Work to dispatch
+	 */
+	void dispatchToWorker(std::size_t homeWorker, const WorkFunction &work);
+
+	/**
+	 * Dispatches work to run on its home worker after the work already queued on that worker
+	 *
+	 * This is the home worker equivalent of dispatchDeferred()
+	 */
+	void dispatchDeferredToWorker(std::size_t homeWorker, const WorkFunction &work);
+
+	/**
+	 * Waits for the scheduler to finish all queued and running work
 	 *
 	 * Note that this does not prevent new work from being dispatched. This means this function may not make progress
 	 * when work is being concurrently dipsatched.
 	 *
 	 * This is implicitly called by the destructor but it can also be used to checkpoint a running Dispatcher. This is
-	 * fairly heavyweight so it should only be used for debugging purposes.
+	 * fairly heavyweight so it should only be used for debugging purposes. This must not be called from work running
+	 * on the dispatcher.
 	 */
 	void waitForDrain();
 
 private:
-	void workerThread(WorkFunction initialWork);
+	struct Job
+	{
+		WorkFunction work;
+	};
+
+	struct Worker
+	{
+		WorkStealingDeque<Job> deque;
+		std::atomic<Job*> lifoSlot;
+		std::thread thread;
+		std::size_t nextVictim;
+		std::size_t jobsRun = 0;
+
+		// Home work dispatched from other threads
+		std::mutex homeQueueMutex;
+		std::deque<Job*> homeQueue;
+		std::atomic<std::size_t> homeQueueSize;
+
+		// CPU the worker is pinned to or -1 if it isn't pinned
+		int pinnedCpu = -1;
+		std::atomic<std::size_t> numaNode;
+
+		// These are protected by m_parkMutex
+		bool parked = false;
+		std::condition_variable parkCond;
+	};
+
+	void startWorkers();
+	void enqueue(Job *job);
+	void inject(Job *job);
+	void enqueueHome(Worker *homeWorker, Job *job);
+	void notifyIdleWorker();
+	void notifyHomeWorker(Worker *homeWorker);
+	void wakeIdleThreadLocked();
+
+	Worker* homeWorker(std::size_t homeWorker);
+
+	Job* takeInjectedJob();
+	Job* takeHomeJob(Worker *worker);
+	Job* stealJob(Worker *thief, std::size_t &nextVictim);
+	Job* findJob(Worker *worker, std::size_t &nextVictim);
+	void runJob(Job *job);
+
+	void workerThread(Worker *worker);
+	void spareThread();
+
+	void beginBlocking();
+	void endBlocking();
+
+	bool onWorkerThread() const;
+
+	const std::size_t m_workerCount;
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	std::once_flag m_startWorkersFlag;
+
+	std::mutex m_injectionMutex;
+	std::deque<Job*> m_injectionQueue;
+
+	// Jobs that have been dispatched but not yet taken by a thread
+	std::atomic<std::size_t> m_queuedJobs;
+	// Jobs that have been dispatched but not yet finished
+	std::atomic<std::size_t> m_pendingJobs;
 
-	std::mutex m_mutex;
+	std::mutex m_parkMutex;
+	std::condition_variable m_parkCond;
+	std::atomic<std::size_t> m_idleThreads;
+	bool m_shutdown = false;
 
-	std::int32_t m_idleThreads;
-	std::int32_t m_runningThreads;
+	std::atomic<std::size_t> m_nextHomeWorker;
 
-	std::condition_variable m_workQueueCond;
-	std::queue<WorkFunction> m_workQueue;
+	std::atomic<std::size_t> m_blockedThreads;
+	std::size_t m_spareThreads = 0;
+	std::condition_variable m_spareExitCond;
 
-	bool m_draining = false;
+	std::mutex m_drainMutex;
 	std::condition_variable m_drainCond;
 };
 
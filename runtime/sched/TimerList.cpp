@@ -1,23 +1,39 @@
 #include "sched/TimerList.h"
 #include "sched/Dispatcher.h"
 
+#include <algorithm>
+#include <limits>
+
 namespace lliby
 {
 namespace sched
 {
 
-TimerList::TimerList()
+const TimerList::Clock::duration TimerList::TickDuration = std::chrono::milliseconds(1);
+
+TimerList::TimerList(Dispatcher &dispatcher) :
+	m_dispatcher(dispatcher),
+	m_epoch(Clock::now()),
+	m_wakeTick(std::numeric_limits<TimerWheel::Tick>::max())
 {
 	// Now that we're initialised start the fire thread
 	m_fireThread = std::thread(&TimerList::fireThreadLoop, this);
 }
 
+TimerList::TimerList() :
+	TimerList(Dispatcher::defaultInstance())
+{
+}
+
 TimerList::~TimerList()
 {
 	// We need to make sure our fire thread is shut down before we free ourselves
-	m_requestShutdown = true;
-	m_earlyWakeCond.notify_one();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_requestShutdown = true;
+	}
 
+	m_earlyWakeCond.notify_one();
 	m_fireThread.join();
 }
 
@@ -27,8 +43,126 @@ TimerList& TimerList::defaultInstance()
 	return instance;
 }
 
+TimerWheel::Tick TimerList::tickAtOrAfter(Clock::time_point time) const
+{
+	const Clock::duration sinceEpoch = std::max(time - m_epoch, Clock::duration::zero());
+	return (sinceEpoch + TickDuration - Clock::duration(1)) / TickDuration;
+}
+
+TimerList::TimerId TimerList::scheduleOnce(const WorkFunction &work, Clock::duration delay)
+{
+	return schedule([=] {
+		work();
+		return false;
+	}, delay, 0);
+}
+
+TimerList::TimerId TimerList::scheduleRepeating(const RepeatingWorkFunction &work, Clock::duration initialDelay, Clock::duration period)
+{
+	// Repeat at least once a tick
+	const TimerWheel::Tick periodTicks = std::max<TimerWheel::Tick>(1, (period + TickDuration - Clock::duration(1)) / TickDuration);
+	return schedule(work, initialDelay, periodTicks);
+}
+
+TimerList::TimerId TimerList::schedule(const RepeatingWorkFunction &work, Clock::duration initialDelay, TimerWheel::Tick periodTicks)
+{
+	const TimerWheel::Tick expiryTick = tickAtOrAfter(Clock::now() + initialDelay);
+
+	auto timer = new ScheduledTimer;
+	timer->work = work;
+	timer->periodTicks = periodTicks;
+
+	if (periodTicks > 0)
+	{
+		timer->finished = std::make_shared<std::atomic<bool>>(false);
+	}
+
+	bool needsEarlyWake;
+	TimerId timerId;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		timerId = m_nextTimerId++;
+		timer->id = timerId;
+
+		m_wheel.insert(timer, expiryTick);
+		m_timers.emplace(timerId, std::unique_ptr<ScheduledTimer>(timer));
+
+		// Wake the fire thread if we expire before it was going to wake
+		needsEarlyWake = timer->expiryTick() < m_wakeTick;
+	}
+
+	if (needsEarlyWake)
+	{
+		m_earlyWakeCond.notify_one();
+	}
+
+	return timerId;
+}
+
+bool TimerList::cancel(TimerId timerId)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto timerIt = m_timers.find(timerId);
+
+	if (timerIt == m_timers.end())
+	{
+		return false;
+	}
+
+	m_wheel.remove(timerIt->second.get());
+	m_timers.erase(timerIt);
+
+	return true;
+}
+
+std::size_t TimerList::scheduledTimers()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_timers.size();
+}
+
+TimerList::WorkFunction TimerList::expireTimer(ScheduledTimer *timer)
+{
+	if (timer->periodTicks == 0)
+	{
+		// Take the work and free the timer
+		RepeatingWorkFunction work(std::move(timer->work));
+		m_timers.erase(timer->id);
+
+		return [=] {
+			work();
+		};
+	}
+
+	if (timer->finished->load(std::memory_order_relaxed))
+	{
+		// Our previous run asked us to stop
+		m_timers.erase(timer->id);
+		return nullptr;
+	}
+
+	// Schedule the next run relative to this one
+	m_wheel.insert(timer, timer->expiryTick() + timer->periodTicks);
+
+	RepeatingWorkFunction work(timer->work);
+	std::shared_ptr<std::atomic<bool>> finished(timer->finished);
+
+	return [=] {
+		if (!work())
+		{
+			finished->store(true, std::memory_order_relaxed);
+		}
+	};
+}
+
 void TimerList::fireThreadLoop()
 {
+	std::vector<TimerWheel::Timer*> expiredTimers;
+	std::vector<WorkFunction> expiredWork;
+
 	std::unique_lock<std::mutex> locker(m_mutex);
 
 	while(true)
@@ -39,54 +173,49 @@ void TimerList::fireThreadLoop()
 			break;
 		}
 
-		auto now = Clock::now();
+		// Advance to the last tick that has fully elapsed
+		const TimerWheel::Tick nowTick = (Clock::now() - m_epoch) / TickDuration;
+		m_wheel.advance(nowTick, expiredTimers);
 
-		// Fire all expired timers
-		while(m_timerQueue.size() && (m_timerQueue.top().fireTime <= now))
+		for(auto expiredTimer : expiredTimers)
 		{
-			auto &toFire = m_timerQueue.top();
-
-			toFire.work();
-			m_timerQueue.pop();
+			if (WorkFunction work = expireTimer(static_cast<ScheduledTimer*>(expiredTimer)))
+			{
+				expiredWork.push_back(std::move(work));
+			}
 		}
 
-		if (!m_timerQueue.size())
-		{
-			// Nothing to wait on
-			m_earlyWakeCond.wait(locker);
-		}
-		else
+		expiredTimers.clear();
+
+		if (!expiredWork.empty())
 		{
-			m_earlyWakeCond.wait_until(locker, m_timerQueue.top().fireTime);
-		}
-	}
-}
+			// Dispatch without the lock held so scheduling and cancellation can continue
+			locker.unlock();
 
-void TimerList::enqueueDelayedWork(const WorkFunction &work, Clock::duration delay)
-{
-	bool needsEarlyWake;
-	Clock::time_point fireTime = Clock::now() + delay;
+			for(auto &work : expiredWork)
+			{
+				m_dispatcher.dispatch(work);
+			}
 
-	{
-		std::unique_lock<std::mutex> locker(m_mutex);
+			expiredWork.clear();
+			locker.lock();
+
+			continue;
+		}
 
-		if (m_timerQueue.size() == 0)
+		m_wakeTick = m_wheel.nextEventTick();
+
+		if (m_wakeTick == std::numeric_limits<TimerWheel::Tick>::max())
 		{
-			// There's no enqueued work; perform an early wakeup
-			needsEarlyWake = true;
+			// Nothing to wait on
+			m_earlyWakeCond.wait(locker);
 		}
 		else
 		{
-			// The next enqueued fire is before this fire; perform an early wakeup
-			needsEarlyWake = m_timerQueue.top().fireTime < fireTime;
+			m_earlyWakeCond.wait_until(locker, m_epoch + (TickDuration * static_cast<Clock::rep>(m_wakeTick)));
 		}
 
-		m_timerQueue.emplace(DelayedWork{work, fireTime});
-	}
-
-	if (needsEarlyWake)
-	{
-		m_earlyWakeCond.notify_one();
+		m_wakeTick = std::numeric_limits<TimerWheel::Tick>::max();
 	}
 }
 
@@ -1,23 +1,30 @@
 #ifndef _LLIBY_SCHED_TIMERLIST_H
 #define _LLIBY_SCHED_TIMERLIST_H
 
-#include <queue>
 #include <functional>
 #include <chrono>
+#include <cstdint>
+#include <memory>
 #include <mutex>
+#include <atomic>
 #include <condition_variable>
+#include <unordered_map>
 #include <vector>
 #include <thread>
 
+#include "sched/TimerWheel.h"
+
 namespace lliby
 {
 namespace sched
 {
+class Dispatcher;
 
 /**
- * Basic timer list implementation
+ * Timer list with support for cancellation and repeating timers
  *
- * This is very simple without support for repeating timers or cancellation.
+ * Timers are stored in a hierarchical timing wheel with millisecond ticks. A dedicated thread advances the wheel and
+ * hands the work of expired timers to a dispatcher. Work is never run with the timer list lock held.
  */
 class TimerList
 {
@@ -29,52 +36,123 @@ public:
 
 	using WorkFunction = std::function<void()>;
 
+	/**
+	 * Work function for repeating timers
+	 *
+	 * If this returns false the timer is cancelled
+	 */
+	using RepeatingWorkFunction = std::function<bool()>;
+
+	/**
+	 * Identifies a scheduled timer
+	 *
+	 * Timer IDs are never reused during the lifetime of a timer list. Zero is never a valid timer ID.
+	 */
+	using TimerId = std::uint64_t;
+
+	/**
+	 * Duration of each tick of the timer wheel
+	 *
+	 * Timers fire on the first tick at or after their requested time
+	 */
+	static const Clock::duration TickDuration;
+
 	/**
 	 * Creates a new timer list
 	 *
 	 * This will create a dedicated timer thread that will live for the duration of the instance.
+	 *
+	 * @param  dispatcher  Dispatcher to run timer work on
 	 */
+	explicit TimerList(Dispatcher &dispatcher);
 	TimerList();
 
 	~TimerList();
 
+	TimerList(const TimerList &) = delete;
+	TimerList& operator=(const TimerList &) = delete;
+
 	/**
 	 * Returns a shared instance of the timer list
 	 */
 	static TimerList &defaultInstance();
 
 	/**
-	 * Enqueues work to be run at a later time
+	 * Schedules work to be run once after a delay
+	 *
+	 * @param  work   Work function to be dispatched after the specified delay
+	 * @param  delay  Amount of time to delay the call of the work function for
+	 * @return ID of the timer for cancellation
+	 */
+	TimerId scheduleOnce(const WorkFunction &work, Clock::duration delay);
+
+	/**
+	 * Schedules work to be run periodically
 	 *
-	 * @param  work   Work function to be called after the specified delay. This is called in shared timer callback
-	 *                thread with the timer list lock held. For this reason any work taking more than a trivial amount
-	 *                of time should be triggered asynchronously from this function.
-	 * @param  delay  Amount of time to delay the call of the work function for.
+	 * Each run is scheduled relative to the previous scheduled time so the timer doesn't drift. If the timer falls
+	 * behind its runs are not made up.
+	 *
+	 * @param  work          Work function to be dispatched each period. If this returns false the timer is cancelled.
+	 *                       A run that was dispatched before the cancellation will still be made.
+	 * @param  initialDelay  Amount of time to delay the first call of the work function for
+	 * @param  period        Amount of time between each call of the work function
+	 * @return ID of the timer for cancellation
 	 */
-	void enqueueDelayedWork(const WorkFunction &work, Clock::duration delay);
+	TimerId scheduleRepeating(const RepeatingWorkFunction &work, Clock::duration initialDelay, Clock::duration period);
+
+	/**
+	 * Cancels a scheduled timer
+	 *
+	 * Work that has already been dispatched will still run
+	 *
+	 * @return True if the timer was cancelled or false if it had already fired or been cancelled
+	 */
+	bool cancel(TimerId timerId);
+
+	/**
+	 * Returns the number of scheduled timers
+	 */
+	std::size_t scheduledTimers();
 
 private:
-	struct DelayedWork
+	struct ScheduledTimer : public TimerWheel::Timer
 	{
-		WorkFunction work;
-		Clock::time_point fireTime;
-		std::uint64_t timerId;
-	};
+		TimerId id;
+		RepeatingWorkFunction work;
 
-	class CompareWork
-	{
-	public:
-		bool operator()(const DelayedWork &a, const DelayedWork &b)
-		{
-			// This orders the work so the next firing time is the head of the queue
-			return a.fireTime > b.fireTime;
-		}
+		// Zero for timers that only run once
+		TimerWheel::Tick periodTicks;
+
+		// Set by the dispatched work of a repeating timer that has asked to be cancelled
+		std::shared_ptr<std::atomic<bool>> finished;
 	};
 
+	TimerId schedule(const RepeatingWorkFunction &work, Clock::duration initialDelay, TimerWheel::Tick periodTicks);
+
+	/**
+	 * Returns the first tick at or after the passed time
+	 */
+	TimerWheel::Tick tickAtOrAfter(Clock::time_point time) const;
+
+	/**
+	 * Handles an expired timer and returns the work to dispatch for it
+	 *
+	 * This must be called with the lock held
+	 */
+	WorkFunction expireTimer(ScheduledTimer *timer);
+
 	void fireThreadLoop();
 
+	Dispatcher &m_dispatcher;
+	const Clock::time_point m_epoch;
+
 	std::mutex m_mutex;
-	std::priority_queue<DelayedWork, std::vector<DelayedWork>, CompareWork> m_timerQueue;
+	TimerWheel m_wheel;
+	std::unordered_map<TimerId, std::unique_ptr<ScheduledTimer>> m_timers;
+	TimerId m_nextTimerId = 1;
+
+	// Tick the fire thread will next wake at
+	TimerWheel::Tick m_wakeTick;
 	std::condition_variable m_earlyWakeCond;
 
 	bool m_requestShutdown = false;
@@ -0,0 +1,229 @@
+#include "sched/TimerWheel.h"
+
+#include <algorithm>
+#include <limits>
+#include <cassert>
+
+namespace lliby
+{
+namespace sched
+{
+
+namespace
+{
+	unsigned int levelShift(std::size_t level)
+	{
+		return level * TimerWheel::SlotBits;
+	}
+
+	/**
+	 * Returns the number of slots after startSlot until the next occupied slot
+	 *
+	 * This wraps around the level and returns SlotCount if startSlot is the only occupied slot
+	 */
+	unsigned int slotsUntilOccupied(std::uint64_t occupiedSlots, unsigned int startSlot)
+	{
+		// Rotate the slot after startSlot to bit 0
+		const unsigned int rotation = (startSlot + 1) % TimerWheel::SlotCount;
+		std::uint64_t rotated = occupiedSlots;
+
+		if (rotation != 0)
+		{
+			rotated = (occupiedSlots >> rotation) | (occupiedSlots << (TimerWheel::SlotCount - rotation));
+		}
+
+		return __builtin_ctzll(rotated) + 1;
+	}
+}
+
+TimerWheel::TimerWheel(Tick currentTick) :
+	m_currentTick(currentTick)
+{
+}
+
+void TimerWheel::insert(Timer *timer, Tick expiryTick)
+{
+	assert(!timer->isScheduled());
+
+	timer->m_expiryTick = std::max(expiryTick, m_currentTick + 1);
+
+	place(timer);
+	m_timerCount++;
+}
+
+void TimerWheel::remove(Timer *timer)
+{
+	assert(timer->isScheduled());
+
+	unlink(timer);
+	m_timerCount--;
+}
+
+void TimerWheel::place(Timer *timer)
+{
+	const Tick delta = timer->m_expiryTick - m_currentTick;
+	assert(delta > 0);
+
+	// Find the lowest level that can represent our expiry
+	std::size_t level = 0;
+
+	while((level < (LevelCount - 1)) && (delta >= (Tick(1) << levelShift(level + 1))))
+	{
+		level++;
+	}
+
+	Tick slotTick = timer->m_expiryTick;
+
+	if (delta >= (Tick(1) << levelShift(LevelCount)))
+	{
+		// Beyond the range of the wheel; wait in the furthest slot of the highest level until it comes around
+		slotTick = ((m_currentTick >> levelShift(level)) + SlotCount) << levelShift(level);
+	}
+
+	const std::uint8_t slot = (slotTick >> levelShift(level)) & (SlotCount - 1);
+	Timer *&slotHead = m_slots[level][slot];
+
+	timer->m_level = level;
+	timer->m_slot = slot;
+	timer->m_prev = nullptr;
+	timer->m_next = slotHead;
+
+	if (slotHead)
+	{
+		slotHead->m_prev = timer;
+	}
+
+	slotHead = timer;
+	m_occupiedSlots[level] |= (std::uint64_t(1) << slot);
+}
+
+void TimerWheel::unlink(Timer *timer)
+{
+	if (timer->m_prev)
+	{
+		timer->m_prev->m_next = timer->m_next;
+	}
+	else
+	{
+		Timer *&slotHead = m_slots[timer->m_level][timer->m_slot];
+		slotHead = timer->m_next;
+
+		if (slotHead == nullptr)
+		{
+			m_occupiedSlots[timer->m_level] &= ~(std::uint64_t(1) << timer->m_slot);
+		}
+	}
+
+	if (timer->m_next)
+	{
+		timer->m_next->m_prev = timer->m_prev;
+	}
+
+	timer->m_prev = nullptr;
+	timer->m_next = nullptr;
+	timer->m_level = Timer::NotScheduled;
+}
+
+TimerWheel::Tick TimerWheel::nextEventTick() const
+{
+	Tick nextTick = std::numeric_limits<Tick>::max();
+
+	for(std::size_t level = 0; level < LevelCount; level++)
+	{
+		if (m_occupiedSlots[level] == 0)
+		{
+			continue;
+		}
+
+		const Tick levelTick = m_currentTick >> levelShift(level);
+		const unsigned int currentSlot = levelTick & (SlotCount - 1);
+
+		// For the first level this is the expiry tick; for higher levels it's when the slot will cascade
+		const Tick slotTick = (levelTick + slotsUntilOccupied(m_occupiedSlots[level], currentSlot)) << levelShift(level);
+		nextTick = std::min(nextTick, slotTick);
+	}
+
+	return nextTick;
+}
+
+void TimerWheel::runCurrentTick(std::vector<Timer*> &expired)
+{
+	// Cascade from the highest level first so any timers falling to lower levels are in place before we visit them
+	for(std::size_t level = LevelCount - 1; level > 0; level--)
+	{
+		const Tick levelMask = (Tick(1) << levelShift(level)) - 1;
+
+		if ((m_currentTick & levelMask) != 0)
+		{
+			// Not at a slot boundary for this level
+			continue;
+		}
+
+		const std::uint8_t slot = (m_currentTick >> levelShift(level)) & (SlotCount - 1);
+		Timer *timer = m_slots[level][slot];
+
+		m_slots[level][slot] = nullptr;
+		m_occupiedSlots[level] &= ~(std::uint64_t(1) << slot);
+
+		while(timer)
+		{
+			Timer *next = timer->m_next;
+
+			if (timer->m_expiryTick <= m_currentTick)
+			{
+				timer->m_level = Timer::NotScheduled;
+				timer->m_prev = timer->m_next = nullptr;
+
+				expired.push_back(timer);
+				m_timerCount--;
+			}
+			else
+			{
+				place(timer);
+			}
+
+			timer = next;
+		}
+	}
+
+	const std::uint8_t slot = m_currentTick & (SlotCount - 1);
+	Timer *timer = m_slots[0][slot];
+
+	m_slots[0][slot] = nullptr;
+	m_occupiedSlots[0] &= ~(std::uint64_t(1) << slot);
+
+	while(timer)
+	{
+		Timer *next = timer->m_next;
+		assert(timer->m_expiryTick == m_currentTick);
+
+		timer->m_level = Timer::NotScheduled;
+		timer->m_prev = timer->m_next = nullptr;
+
+		expired.push_back(timer);
+		m_timerCount--;
+
+		timer = next;
+	}
+}
+
+void TimerWheel::advance(Tick toTick, std::vector<Timer*> &expired)
+{
+	while(m_currentTick < toTick)
+	{
+		// Skip directly to the next tick with work to do
+		const Tick nextTick = nextEventTick();
+
+		if (nextTick > toTick)
+		{
+			m_currentTick = toTick;
+			break;
+		}
+
+		m_currentTick = nextTick;
+		runCurrentTick(expired);
+	}
+}
+
+}
+}
@@ -0,0 +1,161 @@
+#ifndef _LLIBY_SCHED_TIMERWHEEL_H
+#define _LLIBY_SCHED_TIMERWHEEL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace lliby
+{
+namespace sched
+{
+
+/**
+ * Hierarchical timing wheel
+ *
+ * Each level of the wheel has 64 slots. Slots on the first level span a single tick while slots on each higher level
+ * span the entire range of the level below. Timers are placed on the lowest level that can represent their expiry and
+ * cascade down a level each time the wheel reaches their slot. Timers beyond the range of the highest level wait in its
+ * furthest slot and are re-placed as it comes around.
+ *
+ * Timers are intrusive doubly linked list nodes so insertion and removal are O(1). Storage for the timers is owned by
+ * the caller. This class is not thread safe.
+ */
+class TimerWheel
+{
+public:
+	using Tick = std::uint64_t;
+
+	/**
+	 * Timer node placed in the wheel
+	 *
+	 * A timer may only be in one wheel at a time
+	 */
+	class Timer
+	{
+		friend class TimerWheel;
+	public:
+		/**
+		 * Returns the tick the timer expires at
+		 */
+		Tick expiryTick() const
+		{
+			return m_expiryTick;
+		}
+
+		/**
+		 * Returns if the timer is currently in a wheel
+		 */
+		bool isScheduled() const
+		{
+			return m_level != NotScheduled;
+		}
+
+	private:
+		static const std::uint8_t NotScheduled = 0xff;
+
+		Timer *m_prev = nullptr;
+		Timer *m_next = nullptr;
+		Tick m_expiryTick = 0;
+		std::uint8_t m_level = NotScheduled;
+		std::uint8_t m_slot = 0;
+	};
+
+	/**
+	 * Number of bits of the tick used to index the slots of each level
+	 */
+	static const unsigned int SlotBits = 6;
+	static const std::size_t SlotCount = 1 << SlotBits;
+
+	/**
+	 * Number of levels in the wheel
+	 *
+	 * With millisecond ticks this directly represents timers up to 4.6 hours in the future
+	 */
+	static const std::size_t LevelCount = 4;
+
+	/**
+	 * Creates a new empty timer wheel
+	 *
+	 * @param  currentTick  Tick the wheel starts at
+	 */
+	explicit TimerWheel(Tick currentTick = 0);
+
+	TimerWheel(const TimerWheel &) = delete;
+	TimerWheel& operator=(const TimerWheel &) = delete;
+
+	/**
+	 * Returns the tick the wheel has advanced to
+	 */
+	Tick currentTick() const
+	{
+		return m_currentTick;
+	}
+
+	/**
+	 * Returns if the wheel contains no timers
+	 */
+	bool isEmpty() const
+	{
+		return m_timerCount == 0;
+	}
+
+	/**
+	 * Returns the number of timers in the wheel
+	 */
+	std::size_t size() const
+	{
+		return m_timerCount;
+	}
+
+	/**
+	 * Places a timer in the wheel
+	 *
+	 * @param  timer       Unscheduled timer to place
+	 * @param  expiryTick  Tick to expire the timer at. Timers expiring at or before the current tick expire on the next
+	 *                     tick.
+	 */
+	void insert(Timer *timer, Tick expiryTick);
+
+	/**
+	 * Removes a scheduled timer from the wheel
+	 */
+	void remove(Timer *timer);
+
+	/**
+	 * Returns the next tick where advancing the wheel will expire or cascade timers
+	 *
+	 * Timers on higher levels aren't tracked precisely so this may be before the next expiry. If the wheel is empty
+	 * this returns the maximum tick.
+	 */
+	Tick nextEventTick() const;
+
+	/**
+	 * Advances the wheel to the passed tick
+	 *
+	 * @param  toTick   Tick to advance to. If this is not after the current tick this has no effect.
+	 * @param  expired  Vector to append the expired timers to in expiry order. Expired timers are no longer scheduled.
+	 */
+	void advance(Tick toTick, std::vector<Timer*> &expired);
+
+private:
+	void place(Timer *timer);
+	void unlink(Timer *timer);
+
+	/**
+	 * Runs the events for the current tick
+	 */
+	void runCurrentTick(std::vector<Timer*> &expired);
+
+	Tick m_currentTick;
+	std::size_t m_timerCount = 0;
+
+	Timer *m_slots[LevelCount][SlotCount] = {};
+	// Bitmap of the non-empty slots on each level
+	std::uint64_t m_occupiedSlots[LevelCount] = {};
+};
+
+}
+}
+
+#endif
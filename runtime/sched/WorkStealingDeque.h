@@ -0,0 +1,199 @@
+#ifndef _LLIBY_SCHED_WORKSTEALINGDEQUE_H
+#define _LLIBY_SCHED_WORKSTEALINGDEQUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace lliby
+{
+namespace sched
+{
+
+/**
+ * Chase-Lev work-stealing deque of pointers
+ *
+ * The owning thread pushes and pops from the bottom of the deque while any other thread can steal from the top. This
+ * follows "Correct and Efficient Work-Stealing for Weak Memory Models" by Lê et al.
+ *
+ * The deque grows when full. Replaced arrays are retained until the deque is destroyed as thieves may still be reading
+ * from them.
+ */
+template<typename T>
+class WorkStealingDeque
+{
+public:
+	explicit WorkStealingDeque(std::int64_t initialCapacity = 256) :
+		m_top(0),
+		m_bottom(0)
+	{
+		m_arrays.emplace_back(new Array(initialCapacity));
+		m_array.store(m_arrays.back().get(), std::memory_order_relaxed);
+	}
+
+	WorkStealingDeque(const WorkStealingDeque &) = delete;
+	WorkStealingDeque& operator=(const WorkStealingDeque &) = delete;
+
+	/**
+	 * Pushes an item on to the bottom of the deque
+	 *
+	 * This may only be called by the owning thread
+	 */
+	void push(T *item)
+	{
+		const std::int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+		const std::int64_t top = m_top.load(std::memory_order_acquire);
+		Array *array = m_array.load(std::memory_order_relaxed);
+
+		if ((bottom - top) > (array->capacity() - 1))
+		{
+			// Full; grow the array
+			m_arrays.emplace_back(array->grow(bottom, top));
+			array = m_arrays.back().get();
+
+			m_array.store(array, std::memory_order_release);
+		}
+
+		array->put(bottom, item);
+
+		std::atomic_thread_fence(std::memory_order_release);
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+
+	/**
+	 * Pops the most recently pushed item from the bottom of the deque
+	 *
+	 * This may only be called by the owning thread
+	 *
+	 * @return Item or nullptr if the deque is empty
+	 */
+	T* pop()
+	{
+		const std::int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+		Array *array = m_array.load(std::memory_order_relaxed);
+
+		m_bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		std::int64_t top = m_top.load(std::memory_order_relaxed);
+
+		if (top > bottom)
+		{
+			// Empty
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		T *item = array->get(bottom);
+
+		if (top == bottom)
+		{
+			// This is the last item; race any thieves for it
+			if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				item = nullptr;
+			}
+
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+
+		return item;
+	}
+
+	/**
+	 * Steals the least recently pushed item from the top of the deque
+	 *
+	 * This may be called from any thread
+	 *
+	 * @return Item or nullptr if the deque is empty or we lost a race with another thread
+	 */
+	T* steal()
+	{
+		std::int64_t top = m_top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const std::int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+		if (top >= bottom)
+		{
+			return nullptr;
+		}
+
+		Array *array = m_array.load(std::memory_order_acquire);
+		T *item = array->get(top);
+
+		if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			return nullptr;
+		}
+
+		return item;
+	}
+
+	/**
+	 * Returns if the deque appeared empty at the time of the call
+	 */
+	bool isEmpty() const
+	{
+		const std::int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+		const std::int64_t top = m_top.load(std::memory_order_relaxed);
+
+		return top >= bottom;
+	}
+
+private:
+	class Array
+	{
+	public:
+		explicit Array(std::int64_t capacity) :
+			m_capacity(capacity),
+			m_slots(new std::atomic<T*>[capacity])
+		{
+		}
+
+		std::int64_t capacity() const
+		{
+			return m_capacity;
+		}
+
+		T* get(std::int64_t index) const
+		{
+			return m_slots[index & (m_capacity - 1)].load(std::memory_order_relaxed);
+		}
+
+		void put(std::int64_t index, T *item)
+		{
+			m_slots[index & (m_capacity - 1)].store(item, std::memory_order_relaxed);
+		}
+
+		Array* grow(std::int64_t bottom, std::int64_t top) const
+		{
+			auto newArray = new Array(m_capacity * 2);
+
+			for(std::int64_t i = top; i < bottom; i++)
+			{
+				newArray->put(i, get(i));
+			}
+
+			return newArray;
+		}
+
+	private:
+		std::int64_t m_capacity;
+		std::unique_ptr<std::atomic<T*>[]> m_slots;
+	};
+
+	// Thieves write to the top while the owner writes to the bottom; keep them on separate cache lines
+	std::atomic<std::int64_t> m_top;
+	char m_topPadding[64 - sizeof(std::atomic<std::int64_t>)];
+	std::atomic<std::int64_t> m_bottom;
+	std::atomic<Array*> m_array;
+
+	// Owned by the pushing thread
+	std::vector<std::unique_ptr<Array>> m_arrays;
+};
+
+}
+}
+
+#endif
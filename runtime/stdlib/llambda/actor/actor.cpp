@@ -2,10 +2,15 @@
 
 #include <thread>
 #include <chrono>
+#include <vector>
+#include <cassert>
+#include <string>
+#include <memory>
 
 #include "binding/MailboxCell.h"
 #include "binding/UnitCell.h"
 #include "binding/TypedProcedureCell.h"
+#include "binding/SymbolCell.h"
 
 #include "actor/PoisonPillCell.h"
 #include "actor/ActorContext.h"
@@ -14,6 +19,7 @@
 #include "actor/Mailbox.h"
 #include "actor/Message.h"
 #include "actor/Runner.h"
+#include "actor/Router.h"
 #include "actor/cloneCell.h"
 
 #include "sched/TimerList.h"
@@ -47,6 +53,66 @@ namespace
 			e.signalSchemeError(world, procName);
 		}
 	}
+
+	/**
+	 * Converts a routing strategy symbol to a routing strategy
+	 *
+	 * This assumes the routing strategy is defined as (U 'round-robin 'random 'least-loaded)
+	 */
+	actor::RoutingStrategy symbolToRoutingStrategy(SymbolCell *strategyName)
+	{
+		if (strategyName->byteLength() == 6)
+		{
+			// 'random
+			return actor::RoutingStrategy::Random;
+		}
+		else if (strategyName->byteLength() == 11)
+		{
+			// 'round-robin
+			return actor::RoutingStrategy::RoundRobin;
+		}
+		else
+		{
+			// 'least-loaded
+			assert(strategyName->byteLength() == 12);
+			return actor::RoutingStrategy::LeastLoaded;
+		}
+	}
+
+	/**
+	 * Converts an overflow policy symbol to an overflow policy
+	 *
+	 * This assumes the overflow policy is defined as (U 'block 'drop-newest 'drop-oldest 'fail)
+	 */
+	actor::Mailbox::OverflowPolicy symbolToOverflowPolicy(SymbolCell *policyName)
+	{
+		if (policyName->byteLength() == 4)
+		{
+			// 'fail
+			return actor::Mailbox::OverflowPolicy::Fail;
+		}
+		else if (policyName->byteLength() == 5)
+		{
+			// 'block
+			return actor::Mailbox::OverflowPolicy::Block;
+		}
+		else if (policyName->constUtf8Data()[5] == 'n')
+		{
+			// 'drop-newest
+			return actor::Mailbox::OverflowPolicy::DropNewest;
+		}
+		else
+		{
+			// 'drop-oldest
+			assert(policyName->byteLength() == 11);
+			return actor::Mailbox::OverflowPolicy::DropOldest;
+		}
+	}
+
+	void signalMailboxFull(World &world, const char *procName)
+	{
+		signalError(world, ErrorCategory::MailboxFull, std::string(procName) + " on full mailbox");
+	}
 }
 
 extern "C"
@@ -66,28 +132,116 @@ MailboxCell* llactor_act(World &world, actor::ActorClosureCell *closureProc)
 	}
 }
 
+MailboxCell* llactor_act_pool(World &world, std::int64_t memberCount, actor::ActorClosureCell *closureProc, SymbolCell *strategyName)
+{
+	if (memberCount < 1)
+	{
+		signalError(world, ErrorCategory::Range, "(act-pool) requires a positive number of members");
+	}
+
+	const actor::RoutingStrategy strategy = symbolToRoutingStrategy(strategyName);
+	std::vector<std::shared_ptr<actor::Mailbox>> members;
+
+	try
+	{
+		for(std::int64_t i = 0; i < memberCount; i++)
+		{
+			members.push_back(actor::Runner::start(world, closureProc));
+		}
+	}
+	catch(actor::UnclonableCellException &e)
+	{
+		// Don't leave the members we've already started running
+		for(auto &member : members)
+		{
+			member->requestLifecycleAction(actor::LifecycleAction::Stop);
+		}
+
+		e.signalSchemeError(world, "(act-pool)");
+	}
+
+	return MailboxCell::createInstance(world, actor::Mailbox::createRouter(strategy, members));
+}
+
+MailboxCell* llactor_act_bounded(World &world, std::int64_t capacity, actor::ActorClosureCell *closureProc, SymbolCell *policyName)
+{
+	if (capacity < 1)
+	{
+		signalError(world, ErrorCategory::Range, "(act-bounded) requires a positive mailbox capacity");
+	}
+
+	try
+	{
+		return MailboxCell::createInstance(world, actor::Runner::start(world, closureProc, capacity, symbolToOverflowPolicy(policyName)));
+	}
+	catch(actor::UnclonableCellException &e)
+	{
+		e.signalSchemeError(world, "(act-bounded)");
+	}
+}
+
 void llactor_tell(World &world, MailboxCell *destMailboxCell, AnyCell *messageCell)
 {
 	std::shared_ptr<actor::Mailbox> destMailbox(destMailboxCell->lockedMailbox());
 
 	if (destMailbox)
 	{
-		destMailbox->tell(createTellMessage(world, "(tell)", messageCell));
+		if (!destMailbox->tell(createTellMessage(world, "(tell)", messageCell)))
+		{
+			signalMailboxFull(world, "(tell)");
+		}
+	}
+}
+
+void llactor_moving_tell(World &world, MailboxCell *destMailboxCell, AnyCell *messageCell)
+{
+	std::shared_ptr<actor::Mailbox> destMailbox(destMailboxCell->lockedMailbox());
+
+	if (!destMailbox)
+	{
+		// Leave the message with the caller; there's nothing to move it to
+		return;
+	}
+
+	std::shared_ptr<actor::Mailbox> senderMailbox;
+
+	if (actor::ActorContext *context = world.actorContext())
+	{
+		senderMailbox = context->mailbox();
+	}
+
+	try
+	{
+		actor::Message *msg = actor::Message::createFromMovedCell(messageCell, senderMailbox);
+
+		if (!destMailbox->tell(msg))
+		{
+			signalMailboxFull(world, "(tell!)");
+		}
+	}
+	catch(actor::UnclonableCellException &e)
+	{
+		e.signalSchemeError(world, "(tell!)");
 	}
 }
 
-void llactor_schedule_once(World &world, std::int64_t delayUsecs, MailboxCell *destMailboxCell, AnyCell *messageCell)
+std::int64_t llactor_schedule_once(World &world, std::int64_t delayUsecs, MailboxCell *destMailboxCell, AnyCell *messageCell)
 {
 	std::weak_ptr<actor::Mailbox> mailboxRef = destMailboxCell->mailboxRef();
 
 	if (mailboxRef.expired())
 	{
 		// Already expired; skip the enqueue
-		return;
+		return 0;
 	}
 
 	const std::chrono::microseconds delay(delayUsecs);
-	actor::Message *msg = createTellMessage(world, "(schedule-once)", messageCell);
+
+	// The work function owns the message until it's sent. If the timer is cancelled the work function is destroyed
+	// without running and the message is freed with it.
+	auto pendingMsg = std::make_shared<std::unique_ptr<actor::Message>>(
+			createTellMessage(world, "(schedule-once)", messageCell)
+	);
 
 	auto workFunction = [=] ()
 	{
@@ -96,14 +250,56 @@ void llactor_schedule_once(World &world, std::int64_t delayUsecs, MailboxCell *d
 		if (!destMailbox)
 		{
 			// Expired while we were sleeping
-			delete msg;
 			return;
 		}
 
-		destMailbox->tell(msg);
+		// There's nobody to report a full mailbox to; it's reflected in the mailbox's dropped count
+		destMailbox->tell(pendingMsg->release());
+	};
+
+	return sched::TimerList::defaultInstance().scheduleOnce(workFunction, delay);
+}
+
+std::int64_t llactor_schedule_every(World &world, std::int64_t periodUsecs, MailboxCell *destMailboxCell, AnyCell *messageCell)
+{
+	if (periodUsecs <= 0)
+	{
+		signalError(world, ErrorCategory::Range, "(schedule-every) requires a positive period");
+	}
+
+	std::weak_ptr<actor::Mailbox> mailboxRef = destMailboxCell->mailboxRef();
+
+	if (mailboxRef.expired())
+	{
+		// Already expired; skip the enqueue
+		return 0;
+	}
+
+	const std::chrono::microseconds period(periodUsecs);
+
+	// Each run clones a fresh message from this template. It's freed with the last copy of the work function.
+	std::shared_ptr<actor::Message> templateMsg(createTellMessage(world, "(schedule-every)", messageCell));
+
+	auto workFunction = [=] ()
+	{
+		std::shared_ptr<actor::Mailbox> destMailbox = mailboxRef.lock();
+
+		if (!destMailbox)
+		{
+			// Stop repeating once the destination is gone
+			return false;
+		}
+
+		destMailbox->tell(actor::Message::createFromCell(templateMsg->messageCell(), templateMsg->sender()));
+		return true;
 	};
 
-	sched::TimerList::defaultInstance().enqueueDelayedWork(workFunction, delay);
+	return sched::TimerList::defaultInstance().scheduleRepeating(workFunction, period, period);
+}
+
+bool llactor_cancel_timer(std::int64_t timerId)
+{
+	return sched::TimerList::defaultInstance().cancel(timerId);
 }
 
 void llactor_forward(World &world, MailboxCell *destMailboxCell, AnyCell *messageCell)
@@ -126,7 +322,11 @@ void llactor_forward(World &world, MailboxCell *destMailboxCell, AnyCell *messag
 	try
 	{
 		actor::Message *msg = actor::Message::createFromCell(messageCell, context->sender());
-		destMailbox->tell(msg);
+
+		if (!destMailbox->tell(msg))
+		{
+			signalMailboxFull(world, "(forward)");
+		}
 	}
 	catch(actor::UnclonableCellException &e)
 	{
@@ -224,6 +424,18 @@ bool llactor_mailbox_is_open(World &world, MailboxCell *mailboxCell)
 	return !mailboxCell->mailbox().expired();
 }
 
+std::int64_t llactor_mailbox_queue_depth(MailboxCell *mailboxCell)
+{
+	std::shared_ptr<actor::Mailbox> mailbox(mailboxCell->lockedMailbox());
+	return mailbox ? mailbox->queuedMessages() : 0;
+}
+
+std::int64_t llactor_mailbox_dropped_count(MailboxCell *mailboxCell)
+{
+	std::shared_ptr<actor::Mailbox> mailbox(mailboxCell->lockedMailbox());
+	return mailbox ? mailbox->droppedMessages() : 0;
+}
+
 actor::PoisonPillCell* llactor_poison_pill_object()
 {
 	return actor::PoisonPillCell::instance();
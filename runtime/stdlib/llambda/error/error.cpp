@@ -194,4 +194,14 @@ void llerror_raise_match_error(World &world, StringCell *message, RestValues<Any
 	throw dynamic::SchemeException(ErrorObjectCell::createInstance(world, message, irritants, ErrorCategory::Match));
 }
 
+bool llerror_is_mailbox_full_error(AnyCell *obj)
+{
+	return isErrorObjectOfCategory(obj, ErrorCategory::MailboxFull);
+}
+
+void llerror_raise_mailbox_full_error(World &world, StringCell *message, RestValues<AnyCell> *irritants)
+{
+	throw dynamic::SchemeException(ErrorObjectCell::createInstance(world, message, irritants, ErrorCategory::MailboxFull));
+}
+
 }
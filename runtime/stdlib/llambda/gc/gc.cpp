@@ -0,0 +1,43 @@
+#include "core/World.h"
+
+#include "binding/ProperList.h"
+#include "binding/PairCell.h"
+#include "binding/SymbolCell.h"
+#include "binding/IntegerCell.h"
+
+#include "alloc/StatisticsRecorder.h"
+
+extern "C"
+{
+
+using namespace lliby;
+
+ProperList<PairCell> *llgc_gc_statistics(World &world)
+{
+	const alloc::CollectionStatistics statistics(world.statisticsRecorder().statistics());
+
+	const std::pair<const char*, std::uint64_t> namedValues[] = {
+		{"minor-collections", statistics.minorCollections},
+		{"full-collections", statistics.fullCollections},
+		{"total-pause-nanoseconds", statistics.totalPauseNanoseconds},
+		{"maximum-pause-nanoseconds", statistics.maximumPauseNanoseconds},
+		{"copied-cells", statistics.copiedCells},
+		{"finalized-bytes", statistics.finalizedBytes},
+		{"segment-count", statistics.segmentCount},
+		{"heap-bytes", statistics.heapBytes},
+		{"peak-heap-bytes", statistics.peakHeapBytes}
+	};
+
+	std::vector<PairCell*> assocPairs;
+
+	for(const auto &namedValue : namedValues)
+	{
+		assocPairs.push_back(PairCell::createInstance(world,
+					SymbolCell::fromUtf8StdString(world, namedValue.first),
+					IntegerCell::fromValue(world, namedValue.second)));
+	}
+
+	return ProperList<PairCell>::create(world, assocPairs);
+}
+
+}
@@ -7,6 +7,9 @@
 
 #include "hash/DatumHashTree.h"
 #include "hash/DatumHash.h"
+#include "hash/TransientHashMapCell.h"
+
+#include "alloc/StrongRoot.h"
 
 extern "C"
 {
@@ -15,6 +18,8 @@ using namespace lliby;
 
 using FoldProc = TypedProcedureCell<AnyCell*, AnyCell*, AnyCell*, AnyCell*>;
 using DefaultProc = TypedProcedureCell<AnyCell*>;
+using WalkProc = TypedProcedureCell<void, AnyCell*, AnyCell*>;
+using ConflictProc = TypedProcedureCell<AnyCell*, AnyCell*, AnyCell*, AnyCell*>;
 
 HashMapCell *llhashmap_make_hash_map(World &world)
 {
@@ -122,44 +127,103 @@ ProperList<AnyCell> *llhashmap_hash_map_values(World &world, HashMapCell *hashMa
 	return ProperList<AnyCell>::create(world, values);
 }
 
-void llhashmap_hash_map_for_each(World &world, TypedProcedureCell<void, AnyCell *, AnyCell *> *walker, HashMapCell *hashMap)
+void llhashmap_hash_map_for_each(World &world, WalkProc *walker, HashMapCell *hashMap)
 {
-	DatumHashTree::every(hashMap->datumHashTree(), [&] (AnyCell *key, AnyCell *value, DatumHash::ResultType)
+	alloc::StrongRoot<WalkProc> walkerRoot(world, &walker);
+	alloc::StrongRoot<HashMapCell> hashMapRoot(world, &hashMap);
+
+	for(DatumHashTree::Iterator it(hashMap->datumHashTree()); !it.atEnd(); it.advance())
 	{
-		walker->apply(world, key, value);
-		return true;
-	});
+		walker->apply(world, it.key(), it.value());
+	}
 }
 
 AnyCell* llhashmap_hash_map_fold(World &world, FoldProc *folder, AnyCell *initialValue, HashMapCell *hashMap)
 {
 	AnyCell *accum = initialValue;
 
-	DatumHashTree::every(hashMap->datumHashTree(), [&] (AnyCell *key, AnyCell *value, DatumHash::ResultType)
+	alloc::StrongRoot<FoldProc> folderRoot(world, &folder);
+	alloc::StrongRoot<HashMapCell> hashMapRoot(world, &hashMap);
+
+	for(DatumHashTree::Iterator it(hashMap->datumHashTree()); !it.atEnd(); it.advance())
 	{
-		accum = folder->apply(world, key, value, accum);
-		return true;
-	});
+		accum = folder->apply(world, it.key(), it.value(), accum);
+	}
 
 	return accum;
 }
 
 HashMapCell* llhashmap_hash_map_merge(World &world, HashMapCell *sourceHashMap, HashMapCell *overrideHashMap)
 {
-	DatumHashTree *resultTree = DatumHashTree::ref(sourceHashMap->datumHashTree());
 	void *placement = alloc::allocateCells(world);
+	return new (placement) HashMapCell(DatumHashTree::merge(sourceHashMap->datumHashTree(), overrideHashMap->datumHashTree()));
+}
+
+HashMapCell* llhashmap_hash_map_merge_with(World &world, ConflictProc *conflictProc, HashMapCell *sourceHashMap, HashMapCell *overrideHashMap)
+{
+	// Merge structurally with the override's values first. The conflict procedure can collect garbage so we can't call
+	// it while building the merged tree.
+	HashMapCell *conflictsHashMap = HashMapCell::createEmptyInstance(world);
+	conflictsHashMap->setDatumHashTree(DatumHashTree::intersection(sourceHashMap->datumHashTree(), overrideHashMap->datumHashTree()));
+
+	HashMapCell *mergedHashMap = HashMapCell::createEmptyInstance(world);
+	mergedHashMap->setDatumHashTree(DatumHashTree::merge(sourceHashMap->datumHashTree(), overrideHashMap->datumHashTree()));
+
+	TransientHashMapCell *resultTransient = TransientHashMapCell::createInstance(world, mergedHashMap);
 
-	DatumHashTree::every(overrideHashMap->datumHashTree(), [&] (AnyCell *key, AnyCell *value, DatumHash::ResultType hashValue)
+	alloc::StrongRoot<ConflictProc> conflictProcRoot(world, &conflictProc);
+	alloc::StrongRoot<HashMapCell> overrideRoot(world, &overrideHashMap);
+	alloc::StrongRoot<HashMapCell> conflictsRoot(world, &conflictsHashMap);
+	alloc::StrongRoot<TransientHashMapCell> resultRoot(world, &resultTransient);
+
+	// The collector updates the keys and values in the rooted trees so we re-read them from the iterator after each
+	// call to the conflict procedure
+	for(DatumHashTree::Iterator it(conflictsHashMap->datumHashTree()); !it.atEnd(); it.advance())
 	{
-		DatumHashTree *newTree = DatumHashTree::assoc(resultTree, key, value, hashValue);
-		DatumHashTree::unref(resultTree);
+		AnyCell *overrideValue = DatumHashTree::find(overrideHashMap->datumHashTree(), it.key(), it.hashValue());
+		AnyCell *newValue = conflictProc->apply(world, it.key(), it.value(), overrideValue);
 
-		resultTree = newTree;
+		resultTransient->assoc(world, it.key(), newValue);
+	}
 
-		return true;
-	});
+	return resultTransient->persistent(world);
+}
 
-	return new (placement) HashMapCell(resultTree);
+HashMapCell* llhashmap_hash_map_intersection(World &world, HashMapCell *hashMap, HashMapCell *keyHashMap)
+{
+	void *placement = alloc::allocateCells(world);
+	return new (placement) HashMapCell(DatumHashTree::intersection(hashMap->datumHashTree(), keyHashMap->datumHashTree()));
+}
+
+HashMapCell* llhashmap_hash_map_difference(World &world, HashMapCell *hashMap, HashMapCell *keyHashMap)
+{
+	void *placement = alloc::allocateCells(world);
+	return new (placement) HashMapCell(DatumHashTree::difference(hashMap->datumHashTree(), keyHashMap->datumHashTree()));
+}
+
+TransientHashMapCell* llhashmap_hash_map_transient(World &world, HashMapCell *basis)
+{
+	return TransientHashMapCell::createInstance(world, basis);
+}
+
+bool llhashmap_is_transient_hash_map(AnyCell *cell)
+{
+	return TransientHashMapCell::isInstance(cell);
+}
+
+void llhashmap_hash_map_assoc_mut(World &world, TransientHashMapCell *transient, AnyCell *key, AnyCell *value)
+{
+	transient->assoc(world, key, value);
+}
+
+void llhashmap_hash_map_delete_mut(World &world, TransientHashMapCell *transient, AnyCell *key)
+{
+	transient->without(world, key);
+}
+
+HashMapCell* llhashmap_persistent(World &world, TransientHashMapCell *transient)
+{
+	return transient->persistent(world);
 }
 
 std::uint32_t llhashmap_hash(AnyCell *datum, std::int64_t bound)
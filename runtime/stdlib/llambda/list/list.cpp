@@ -11,6 +11,8 @@
 
 #include "core/error.h"
 
+#include "alloc/StrongRoot.h"
+
 using namespace lliby;
 
 namespace
@@ -60,6 +62,8 @@ namespace
 		ProperList<AnyCell> *tail = list;
 		std::vector<AnyCell*> headElements;
 
+		alloc::StrongRoot<ProperList<AnyCell>> tailRoot(world, &tail);
+
 		while(true)
 		{
 			auto pairTail = cell_cast<PairCell>(tail);
@@ -70,12 +74,19 @@ namespace
 				break;
 			}
 
-			if (!predicate(pairTail->car()))
 			{
-				// Predicate failed
-				break;
+				alloc::StrongRoot<AnyCell> headElementsRoot(world, headElements.data(), headElements.size());
+
+				if (!predicate(pairTail->car()))
+				{
+					// Predicate failed
+					break;
+				}
 			}
 
+			// The predicate may have relocated our tail
+			pairTail = cell_unchecked_cast<PairCell>(tail);
+
 			headElements.push_back(pairTail->car());
 			tail = cell_unchecked_cast<ProperList<AnyCell>>(pairTail->cdr());
 		}
@@ -96,13 +107,14 @@ namespace
 	 * @param  world      World to apply the procedure in
 	 * @param  firstList  Reference to the first proper list of values. This will be advanced to the next element.
 	 * @param  restLists  Vector of other value proper lists. These will be advanced to their next elements.
-	 * @param  proc       Procedure to apply. This will be passed one argument from each of the input lists.
+	 * @param  proc       Reference to the procedure to apply. This will be passed one argument from each of the input
+	 *                    lists.
 	 * @param  result     Pointer to a location to store the result value. If this function returns false then the
 	 *                    result will not be written to.
 	 * @return Boolean indicating if all of the input lists were non-empty and the procedure was invoked.
 	 */
 	template<typename T>
-	bool consumeInputLists(World &world, ProperList<lliby::AnyCell>* &firstList, std::vector<AnyCell*> &restLists, TypedProcedureCell<T, AnyCell*, RestValues<AnyCell>*> *proc, T* result)
+	bool consumeInputLists(World &world, ProperList<lliby::AnyCell>* &firstList, std::vector<AnyCell*> &restLists, TypedProcedureCell<T, AnyCell*, RestValues<AnyCell>*>* &proc, T* result)
 	{
 		auto firstPair = cell_cast<PairCell>(firstList);
 
@@ -135,6 +147,11 @@ namespace
 		// Build the rest argument list
 		RestValues<AnyCell> *restArgList = RestValues<AnyCell>::create(world, restValues);
 
+		// Our caller will continue using the input lists and procedure
+		alloc::StrongRoot<ProperList<AnyCell>> firstListRoot(world, &firstList);
+		alloc::StrongRoot<AnyCell> restListsRoot(world, restLists.data(), restLists.size());
+		alloc::StrongRoot<TypedProcedureCell<T, AnyCell*, RestValues<AnyCell>*>> procRoot(world, &proc);
+
 		// Apply the function
 		*result = proc->apply(world, firstValue, restArgList);
 
@@ -196,6 +213,9 @@ AnyCell* lllist_fold(World &world, FoldProc *foldProc, AnyCell *initialValue, Pr
 	std::vector<AnyCell*> inputVector(inputListCount + 1);
 	std::vector<AnyCell*> restArgVector(inputListCount - 1);
 
+	alloc::StrongRoot<FoldProc> foldProcRoot(world, &foldProc);
+	alloc::StrongRoot<ListElementCell> inputListsRoot(world, inputLists.data(), inputListCount);
+
 	while(true)
 	{
 		// Collect our input from out input lists
@@ -232,13 +252,26 @@ PairCell* lllist_partition(World &world, PredicateProc *predicateProc, ProperLis
 	std::vector<AnyCell*> trueValues;
 	std::vector<AnyCell*> falseValues;
 
+	alloc::StrongRoot<PredicateProc> predicateProcRoot(world, &predicateProc);
+	alloc::StrongRoot<ListElementCell> listHeadRoot(world, &listHead);
+
 	while(listHead != EmptyListCell::instance())
 	{
-		// This must be a pair if we're not the empty list and the predicate hasn't been called yet
+		bool predicateResult;
+
+		{
+			alloc::StrongRoot<AnyCell> trueValuesRoot(world, trueValues.data(), trueValues.size());
+			alloc::StrongRoot<AnyCell> falseValuesRoot(world, falseValues.data(), falseValues.size());
+
+			// This must be a pair if we're not the empty list and the predicate hasn't been called yet
+			predicateResult = predicateProc->apply(world, cell_unchecked_cast<PairCell>(listHead)->car());
+		}
+
+		// Reload our pair in case the predicate relocated it
 		auto headPair = cell_unchecked_cast<PairCell>(listHead);
 		AnyCell *headValue = headPair->car();
 
-		if (predicateProc->apply(world, headValue))
+		if (predicateResult)
 		{
 			trueValues.push_back(headValue);
 		}
@@ -259,13 +292,16 @@ PairCell* lllist_partition(World &world, PredicateProc *predicateProc, ProperLis
 
 ProperList<AnyCell>* lllist_list_tabulate(World &world, std::uint32_t count, TabulateProc *initProc)
 {
-	std::vector<AnyCell*> resultVec;
+	// Null elements are skipped by the collector
+	std::vector<AnyCell*> resultVec(count, nullptr);
 
-	resultVec.reserve(count);
+	alloc::StrongRoot<TabulateProc> initProcRoot(world, &initProc);
+	alloc::StrongRoot<AnyCell> resultVecRoot(world, resultVec.data(), count);
 
 	for(std::uint32_t i = 0; i < count; i++)
 	{
-		resultVec.push_back(initProc->apply(world, i));
+		AnyCell *resultValue = initProc->apply(world, i);
+		resultVec[i] = resultValue;
 	}
 
 	return ProperList<AnyCell>::create(world, resultVec);
@@ -304,6 +340,8 @@ PairCell* lllist_split_at(World &world, AnyCell *obj, std::uint32_t count)
 
 PairCell* lllist_span(World &world, PredicateProc *predicateProc, ProperList<AnyCell> *list)
 {
+	alloc::StrongRoot<PredicateProc> predicateProcRoot(world, &predicateProc);
+
 	SpanResult result = spanList(world, "(span)", list, [&] (AnyCell *datum) {
 		return predicateProc->apply(world, datum);
 	});
@@ -313,6 +351,8 @@ PairCell* lllist_span(World &world, PredicateProc *predicateProc, ProperList<Any
 
 PairCell* lllist_break(World &world, PredicateProc *predicateProc, ProperList<AnyCell> *list)
 {
+	alloc::StrongRoot<PredicateProc> predicateProcRoot(world, &predicateProc);
+
 	SpanResult result = spanList(world, "(break)", list, [&] (AnyCell *datum) {
 		return !predicateProc->apply(world, datum);
 	});
@@ -397,9 +437,16 @@ ProperList<AnyCell>* lllist_append_map(World &world, AppendMapProc *mapProc, Pro
 
 	std::vector<AnyCell*> resultValues;
 
-	ProperList<AnyCell> *resultList;
-	while(consumeInputLists(world, firstList, restLists, mapProc, &resultList))
+	while(true)
 	{
+		alloc::StrongRoot<AnyCell> resultValuesRoot(world, resultValues.data(), resultValues.size());
+
+		ProperList<AnyCell> *resultList;
+		if (!consumeInputLists(world, firstList, restLists, mapProc, &resultList))
+		{
+			break;
+		}
+
 		// Splice this list on to the results
 		resultValues.insert(resultValues.end(), resultList->begin(), resultList->end());
 	}
@@ -413,9 +460,16 @@ ProperList<AnyCell>* lllist_filter_map(World &world, FilterMapProc *mapProc, Pro
 
 	std::vector<AnyCell*> resultValues;
 
-	AnyCell *resultValue;
-	while(consumeInputLists(world, firstList, restLists, mapProc, &resultValue))
+	while(true)
 	{
+		alloc::StrongRoot<AnyCell> resultValuesRoot(world, resultValues.data(), resultValues.size());
+
+		AnyCell *resultValue;
+		if (!consumeInputLists(world, firstList, restLists, mapProc, &resultValue))
+		{
+			break;
+		}
+
 		if (resultValue != BooleanCell::falseInstance())
 		{
 			// Add this value to the results
@@ -8,6 +8,8 @@
 #include "dynamic/State.h"
 #include "dynamic/SchemeException.h"
 
+#include "alloc/StrongRoot.h"
+
 using namespace lliby;
 
 extern "C"
@@ -19,6 +21,9 @@ AnyCell* llbase_guard_kernel(World &world, HandlerProcedureCell *guardAuxProc, T
 {
 	dynamic::State *handlerState = world.activeState();
 
+	alloc::StrongRoot<HandlerProcedureCell> guardAuxRoot(world, &guardAuxProc);
+	alloc::ShadowStackEntry *handlerShadowStackHead = world.shadowStackHead;
+
 	try
 	{
 		return thunk->apply(world);
@@ -28,6 +33,9 @@ AnyCell* llbase_guard_kernel(World &world, HandlerProcedureCell *guardAuxProc, T
 		// Switch to the guard's dynamic state
 		dynamic::State::popUntilState(world, handlerState);
 
+		// Discard any shadow stack entries left by the generated code we unwound through
+		world.shadowStackHead = handlerShadowStackHead;
+
 		// Call our guard-aux procedure
 		// This will re-throw if no match is encountered
 		return guardAuxProc->apply(world, except.object());
@@ -11,6 +11,8 @@
 
 #include "core/error.h"
 
+#include "alloc/StrongRoot.h"
+
 using namespace lliby;
 
 namespace
@@ -35,6 +37,9 @@ namespace
 		// Build our vector of input vector cells
 		std::vector<VectorCell*> restVectors(restVectorList->begin(), restVectorList->end());
 
+		alloc::StrongRoot<VectorCell> firstVectorRoot(world, &firstVector);
+		alloc::StrongRoot<VectorCell> restVectorsRoot(world, restVectors.data(), restVectors.size());
+
 		auto container = initFunc(minimumLength);
 
 		std::vector<AnyCell*> restArgVector(restVectors.size());
@@ -73,6 +78,10 @@ namespace
 
 		std::vector<AnyCell*> restArgVector(restLists.size());
 		ListElementCell *firstListHead = firstList;
+
+		alloc::StrongRoot<ListElementCell> firstListHeadRoot(world, &firstListHead);
+		alloc::StrongRoot<ListElementCell> restListsRoot(world, restLists.data(), restLists.size());
+
 		for(ProperList<AnyCell>::size_type i = 0; i < minimumLength; i++)
 		{
 			// Build the rest argument list
@@ -139,13 +148,18 @@ extern "C"
 
 VectorCell *llbase_vector_map(World &world, AnyMapProcedureCell *mapProc, VectorCell *firstVector, RestValues<VectorCell> *argHead)
 {
+	alloc::StrongRoot<AnyMapProcedureCell> mapProcRoot(world, &mapProc);
+
 	auto initFunc = [&] (VectorCell::LengthType capacity) {
 		return VectorCell::fromFill(world, capacity, UnitCell::instance());
 	};
 
-	auto iterFunc = [&] (VectorCell *outputVector, std::size_t i, AnyCell *firstArg, RestValues<AnyCell> *restArgs) {
+	auto iterFunc = [&] (VectorCell *&outputVector, std::size_t i, AnyCell *firstArg, RestValues<AnyCell> *restArgs) {
+		alloc::StrongRoot<VectorCell> outputRoot(world, &outputVector);
+		AnyCell *resultValue = mapProc->apply(world, firstArg, restArgs);
+
 		// Use elements() here to skip the bounds check that setElementAt() will perform
-		outputVector->elements()[i] = mapProc->apply(world, firstArg, restArgs);
+		outputVector->elements()[i] = resultValue;
 	};
 
 	auto finalFunc = [&] (VectorCell *outputVector) {
@@ -157,6 +171,8 @@ VectorCell *llbase_vector_map(World &world, AnyMapProcedureCell *mapProc, Vector
 
 void llbase_vector_for_each(World &world, AnyIteratorProcedureCell *iterProc, VectorCell *firstVector, RestValues<VectorCell> *argHead)
 {
+	alloc::StrongRoot<AnyIteratorProcedureCell> iterProcRoot(world, &iterProc);
+
 	auto initFunc = [&] (VectorCell::LengthType) {
 		return 0;
 	};
@@ -174,12 +190,17 @@ void llbase_vector_for_each(World &world, AnyIteratorProcedureCell *iterProc, Ve
 
 ProperList<AnyCell> *llbase_map(World &world, AnyMapProcedureCell *mapProc, ProperList<AnyCell> *firstList, RestValues<ProperList<AnyCell>>* argHead)
 {
+	alloc::StrongRoot<AnyMapProcedureCell> mapProcRoot(world, &mapProc);
+
 	auto initFunc = [&] (ProperList<AnyCell>::size_type capacity) {
 		return std::vector<AnyCell*>(capacity, nullptr);
 	};
 
 	auto iterFunc = [&] (std::vector<AnyCell*> &outputVector, std::size_t i, AnyCell *firstArg, RestValues<AnyCell> *restArgs) {
-		outputVector[i] = mapProc->apply(world, firstArg, restArgs);
+		alloc::StrongRoot<AnyCell> outputRoot(world, outputVector.data(), i);
+
+		AnyCell *resultValue = mapProc->apply(world, firstArg, restArgs);
+		outputVector[i] = resultValue;
 	};
 
 	auto finalFunc = [&] (std::vector<AnyCell*> &outputVector) {
@@ -191,6 +212,8 @@ ProperList<AnyCell> *llbase_map(World &world, AnyMapProcedureCell *mapProc, Prop
 
 void llbase_for_each(World &world, AnyIteratorProcedureCell *iterProc, ProperList<AnyCell> *firstList, RestValues<ProperList<AnyCell>>* argHead)
 {
+	alloc::StrongRoot<AnyIteratorProcedureCell> iterProcRoot(world, &iterProc);
+
 	auto initFunc = [&] (ProperList<AnyCell>::size_type) {
 		return 9;
 	};
@@ -208,6 +231,8 @@ void llbase_for_each(World &world, AnyIteratorProcedureCell *iterProc, ProperLis
 
 StringCell *llbase_string_map(World &world, StringMapProcedureCell *mapProc, StringCell *firstString, RestValues<StringCell> *argHead)
 {
+	alloc::StrongRoot<StringMapProcedureCell> mapProcRoot(world, &mapProc);
+
 	auto initFunc = [&] (std::size_t capacity) {
 		return StringCellBuilder(capacity);
 	};
@@ -225,6 +250,8 @@ StringCell *llbase_string_map(World &world, StringMapProcedureCell *mapProc, Str
 
 void llbase_string_for_each(World &world, StringIteratorProcedureCell *iterProc, StringCell *firstString, RestValues<StringCell> *argHead)
 {
+	alloc::StrongRoot<StringIteratorProcedureCell> iterProcRoot(world, &iterProc);
+
 	auto initFunc = [&] (std::size_t) {
 		return 0;
 	};
@@ -12,6 +12,8 @@
 
 #include "core/error.h"
 
+#include "alloc/StrongRoot.h"
+
 using namespace lliby;
 
 using CallWithPortProcedureCell = TypedProcedureCell<AnyCell*, PortCell*>;
@@ -129,6 +131,7 @@ PortCell* llbase_open_input_bytevector(World &world, BytevectorCell *bytevector)
 
 AnyCell* llbase_call_with_port(World &world, PortCell *portCell, CallWithPortProcedureCell *thunk)
 {
+	alloc::StrongRoot<PortCell> portCellRoot(world, &portCell);
 	AnyCell* returnValue = thunk->apply(world, portCell);
 	portCell->port()->closePort();
 
@@ -1,4 +1,6 @@
+#include <cstddef>
 #include <functional>
+#include <limits>
 
 #include "core/init.h"
 #include "core/World.h"
@@ -9,9 +11,26 @@
 #include "binding/ProperList.h"
 #include "binding/BooleanCell.h"
 #include "binding/EmptyListCell.h"
+#include "binding/PairCell.h"
+#include "binding/VectorCell.h"
+#include "binding/StringCell.h"
+#include "binding/RecordCell.h"
+#include "binding/HashMapCell.h"
+
+#include "hash/DatumHashTree.h"
 
 #include "alloc/allocator.h"
 #include "alloc/RangeAlloc.h"
+#include "alloc/StrongRoot.h"
+#include "alloc/AllocCell.h"
+#include "alloc/Heap.h"
+#include "alloc/SegmentPool.h"
+#include "alloc/SegmentReservation.h"
+#include "alloc/CollectionPolicy.h"
+#include "alloc/StatisticsRecorder.h"
+#include "alloc/collector.h"
+
+#include "platform/topology.h"
 
 namespace
 {
@@ -61,13 +80,568 @@ void testLargeNumberOfAllocations(World &world)
 	alloc::forceCollection(world);
 }
 
+void testStrongRoots(World &world)
+{
+	const std::size_t cellCount = 1024;
+
+	std::vector<AnyCell*> falseCells(cellCount, const_cast<BooleanCell*>(BooleanCell::falseInstance()));
+	ProperList<AnyCell> *rootedList = ProperList<AnyCell>::create(world, falseCells);
+	ProperList<AnyCell> *unrootedList = ProperList<AnyCell>::create(world, falseCells);
+
+	{
+		alloc::StrongRoot<ProperList<AnyCell>> listRoot(world, &rootedList);
+		ProperList<AnyCell> *originalLocation = rootedList;
+
+		// Only the rooted list should survive
+		ASSERT_EQUAL(alloc::forceCollection(world), cellCount);
+
+		// The list should have been relocated and our root updated
+		ASSERT_TRUE(rootedList != originalLocation);
+		ASSERT_EQUAL(rootedList->size(), cellCount);
+	}
+
+	(void)unrootedList;
+
+	// Nothing is rooted anymore
+	ASSERT_EQUAL(alloc::forceCollection(world), 0U);
+}
+
+void testGcPollRequests(World &world)
+{
+	alloc::forceCollection(world);
+	ASSERT_FALSE(world.gcPollRequested);
+
+#ifndef _LLIBY_ALWAYS_GC
+	// Fill our nursery without reaching the trigger
+	const std::size_t nurseryTrigger = world.collectionPolicy().nurseryTrigger();
+
+	for(std::size_t i = 0; i < nurseryTrigger; i++)
+	{
+		PairCell::createInstance(world, EmptyList, EmptyList);
+	}
+
+	ASSERT_FALSE(world.gcPollRequested);
+#endif
+
+	// This should request generated code poll at its next back-edge
+	PairCell::createInstance(world, EmptyList, EmptyList);
+	ASSERT_TRUE(world.gcPollRequested);
+
+	alloc::conditionalCollection(world);
+	ASSERT_FALSE(world.gcPollRequested);
+	ASSERT_EQUAL(world.cellHeap.allocationCounter(), 0U);
+}
+
+void testGeneratedCodeLayout(World &world)
+{
+	// These must match %world and %shadowStackEntry in the compiler's defines.ll
+	auto worldOffset = [&] (const void *field) -> std::size_t
+	{
+		return static_cast<const char*>(field) - reinterpret_cast<const char*>(&world);
+	};
+
+	ASSERT_EQUAL(worldOffset(&world.shadowStackHead), 0U);
+	ASSERT_EQUAL(worldOffset(&world.gcPollRequested), sizeof(void*));
+	ASSERT_EQUAL(worldOffset(&world.cellHeap), 2 * sizeof(void*));
+
+	// Generated code bump allocates directly from the start of our heap
+	PairCell::createInstance(world, EmptyList, EmptyList);
+	auto heapFields = reinterpret_cast<alloc::AllocCell**>(&world.cellHeap);
+	ASSERT_TRUE(heapFields[0] == world.cellHeap.allocNext());
+	ASSERT_TRUE(heapFields[0] <= heapFields[1]);
+
+	ASSERT_EQUAL(offsetof(alloc::ShadowStackEntry, next), 0U);
+	ASSERT_EQUAL(offsetof(alloc::ShadowStackEntry, cellRefs), sizeof(void*));
+	ASSERT_EQUAL(offsetof(alloc::ShadowStackEntry, cellCount), 2 * sizeof(void*));
+	ASSERT_EQUAL(sizeof(alloc::ShadowStackEntry), 3 * sizeof(void*));
+}
+
+void testDeepCarNesting(World &world)
+{
+	// This would overflow the native stack if the collector recursed on each car
+	const std::size_t nestingDepth = 4 * 1024 * 1024;
+
+	AnyCell *deepTree = EmptyList;
+
+	for(std::size_t i = 0; i < nestingDepth; i++)
+	{
+		deepTree = PairCell::createInstance(world, deepTree, EmptyList);
+	}
+
+	alloc::StrongRoot<AnyCell> treeRoot(world, &deepTree);
+	ASSERT_EQUAL(alloc::forceCollection(world), nestingDepth);
+
+	std::size_t foundDepth = 0;
+
+	while(auto pairCell = cell_cast<PairCell>(deepTree))
+	{
+		deepTree = pairCell->car();
+		foundDepth++;
+	}
+
+	ASSERT_EQUAL(foundDepth, nestingDepth);
+}
+
+void testMinorCollection(World &world)
+{
+	const std::size_t listLength = 1024;
+
+	// Vectors are never tenured so this will be referenced from the tenured list through the remembered set
+	VectorCell *youngVector = VectorCell::fromFill(world, 1, EmptyList);
+
+	std::vector<AnyCell*> listElements(listLength, youngVector);
+	ProperList<AnyCell> *tenuredList = ProperList<AnyCell>::create(world, listElements);
+
+	alloc::StrongRoot<ProperList<AnyCell>> listRoot(world, &tenuredList);
+
+	// This will tenure the list and relocate the vector
+	ASSERT_EQUAL(alloc::forceCollection(world), listLength + 1);
+	ASSERT_EQUAL(world.rememberedCells().size(), listLength);
+
+	for(int i = 0; i < 3; i++)
+	{
+		// Create some garbage
+		createListOfSize(world, listLength);
+
+		// Only the vector should be relocated by a minor collection
+		ASSERT_EQUAL(alloc::forceCollection(world, alloc::CollectionType::Minor), 1);
+		ASSERT_EQUAL(tenuredList->size(), listLength);
+
+		for(auto element : *tenuredList)
+		{
+			auto vectorElement = cell_cast<VectorCell>(element);
+
+			ASSERT_TRUE(vectorElement != nullptr);
+			ASSERT_EQUAL(vectorElement->length(), 1);
+		}
+	}
+
+	// Newly allocated cells should be promoted by minor collections
+	AnyCell *youngPair = PairCell::createInstance(world, EmptyList, EmptyList);
+	alloc::StrongRoot<AnyCell> pairRoot(world, &youngPair);
+
+	ASSERT_EQUAL(alloc::forceCollection(world, alloc::CollectionType::Minor), 2);
+	ASSERT_TRUE(youngPair->gcState() == GarbageState::TenuredCell);
+	ASSERT_EQUAL(alloc::forceCollection(world, alloc::CollectionType::Minor), 1);
+}
+
+void testSegmentPool()
+{
+	using alloc::SegmentPool;
+
+	// Segments should be rounded up to their size class
+	ASSERT_EQUAL(SegmentPool::pooledSize(128), 128);
+	ASSERT_EQUAL(SegmentPool::pooledSize(4 * 1024), 4 * 1024);
+	ASSERT_EQUAL(SegmentPool::pooledSize(8 * 1024), 16 * 1024);
+	ASSERT_EQUAL(SegmentPool::pooledSize(1024 * 1024), 1024 * 1024);
+	ASSERT_EQUAL(SegmentPool::pooledSize(1024 * 1024 + 1), 1024 * 1024 + 1);
+
+	// Small and huge segments aren't pooled
+	ASSERT_TRUE(SegmentPool::acquire(128) == nullptr);
+	ASSERT_TRUE(SegmentPool::acquire(8 * 1024 * 1024) == nullptr);
+
+	void *smallSegment = malloc(128);
+	ASSERT_FALSE(SegmentPool::release(smallSegment, 128));
+	free(smallSegment);
+
+	// Released segments should be reused by the same thread
+	void *segment = malloc(16 * 1024);
+	ASSERT_TRUE(SegmentPool::release(segment, 16 * 1024));
+	ASSERT_TRUE(SegmentPool::acquire(16 * 1024) == segment);
+	free(segment);
+
+	// Segments released for another node should only be reused for that node
+	const std::size_t otherNode = (platform::currentNumaNode() + 1) % SegmentPool::MaximumNodePartitions;
+	void *remoteSegment = malloc(16 * 1024);
+
+	{
+		SegmentPool::NodeScope nodeScope(otherNode);
+		ASSERT_TRUE(SegmentPool::release(remoteSegment, 16 * 1024));
+	}
+
+	ASSERT_TRUE(SegmentPool::acquire(16 * 1024) != remoteSegment);
+
+	{
+		SegmentPool::NodeScope nodeScope(otherNode);
+		ASSERT_TRUE(SegmentPool::acquire(16 * 1024) == remoteSegment);
+	}
+
+	free(remoteSegment);
+}
+
+void testSegmentReservation()
+{
+	alloc::SegmentReservation reservation(16 * 1024 * 1024, false);
+	ASSERT_TRUE(reservation.isValid());
+
+	void *smallSegment = reservation.allocate(8 * 1024);
+	void *largeSegment = reservation.allocate(1024 * 1024);
+
+	ASSERT_TRUE(smallSegment != nullptr);
+	ASSERT_TRUE(largeSegment != nullptr);
+
+	ASSERT_TRUE(reservation.contains(smallSegment));
+	ASSERT_TRUE(reservation.contains(largeSegment));
+	ASSERT_FALSE(reservation.contains(&reservation));
+
+	ASSERT_EQUAL(reservation.segmentSize(smallSegment), 16 * 1024);
+	ASSERT_EQUAL(reservation.segmentSize(largeSegment), 1024 * 1024);
+
+	// Released segments should be recommitted before new address space is used
+	reservation.release(smallSegment);
+	ASSERT_TRUE(reservation.allocate(16 * 1024) == smallSegment);
+
+	// Regions should be exhausted once their address space is used
+	std::size_t largeSegmentCount = 1;
+
+	while(reservation.allocate(1024 * 1024) != nullptr)
+	{
+		largeSegmentCount++;
+	}
+
+	ASSERT_EQUAL(largeSegmentCount, 2);
+}
+
+void testCollectionPolicy()
+{
+	using alloc::CollectionPolicy;
+	using alloc::CollectionType;
+
+	CollectionPolicy policy;
+	const alloc::CollectionTunables &tunables = policy.tunables();
+
+	// Empty worlds should use their minimum nursery
+	ASSERT_EQUAL(policy.nurseryTrigger(), tunables.minimumNurseryCells);
+	ASSERT_TRUE(policy.nextCollectionType() == CollectionType::Minor);
+
+	// The nursery should grow with the live set up to its maximum
+	policy.collectionFinished(CollectionType::Full, 512 * 1024, 0);
+	ASSERT_EQUAL(policy.liveCells(), 512 * 1024);
+	ASSERT_EQUAL(policy.nurseryTrigger(), 256 * 1024);
+
+	policy.collectionFinished(CollectionType::Full, 16 * 1024 * 1024, 0);
+	ASSERT_EQUAL(policy.nurseryTrigger(), tunables.maximumNurseryCells);
+
+	// Full collections should happen once the live set has doubled
+	policy.collectionFinished(CollectionType::Minor, 8 * 1024 * 1024, 0);
+	ASSERT_TRUE(policy.nextCollectionType() == CollectionType::Minor);
+
+	policy.collectionFinished(CollectionType::Minor, 8 * 1024 * 1024 + 1, 0);
+	ASSERT_TRUE(policy.nextCollectionType() == CollectionType::Full);
+
+	// Exceeding the global budget should collect eagerly
+	policy.collectionFinished(CollectionType::Full, 1024, 0);
+	CollectionPolicy::setGlobalBudget(0);
+
+	ASSERT_TRUE(CollectionPolicy::globalBudgetExceeded());
+	ASSERT_TRUE(policy.nextCollectionType() == CollectionType::Minor);
+
+	policy.collectionFinished(CollectionType::Minor, 1, 0);
+	ASSERT_EQUAL(policy.nurseryTrigger(), tunables.minimumNurseryCells);
+	ASSERT_TRUE(policy.nextCollectionType() == CollectionType::Full);
+
+	CollectionPolicy::setGlobalBudget(std::numeric_limits<std::size_t>::max());
+	ASSERT_FALSE(CollectionPolicy::globalBudgetExceeded());
+
+	// Cells that can't be tenured are relocated by every minor collection but should only be counted once
+	CollectionPolicy youngPolicy;
+	youngPolicy.collectionFinished(CollectionType::Full, 1024, 64 * 1024);
+	ASSERT_EQUAL(youngPolicy.liveCells(), 65 * 1024);
+
+	for(int i = 0; i < 16; i++)
+	{
+		youngPolicy.collectionFinished(CollectionType::Minor, 0, 64 * 1024);
+		ASSERT_EQUAL(youngPolicy.liveCells(), 65 * 1024);
+		ASSERT_TRUE(youngPolicy.nextCollectionType() == CollectionType::Minor);
+	}
+
+	// Promoted cells should still accumulate alongside them
+	youngPolicy.collectionFinished(CollectionType::Minor, 1024, 32 * 1024);
+	ASSERT_EQUAL(youngPolicy.liveCells(), 34 * 1024);
+}
+
+void testSegmentHeaders(World &world)
+{
+	// Returns the number of segments needing finalization and the total number of cells in their bitmaps
+	auto countSegments = [] (alloc::Heap &heap, std::size_t &finalizableSegments, std::size_t &bitmapCells) {
+		std::size_t segmentCount = 0;
+		finalizableSegments = 0;
+		bitmapCells = 0;
+
+		for(alloc::MemoryBlock *segment = heap.rootSegment(); segment != nullptr;)
+		{
+			alloc::SegmentHeaderCell *header = alloc::Heap::segmentHeader(segment);
+
+			segmentCount++;
+
+			if (header->needsFinalization())
+			{
+				finalizableSegments++;
+			}
+
+			bitmapCells += header->finalizableCellCount();
+			segment = header->nextSegment();
+		}
+
+		return segmentCount;
+	};
+
+	// Build a list with a long string at its head and every 4096th element
+	const std::size_t listLength = 64 * 1024;
+	const std::size_t stringInterval = 4096;
+	std::vector<AnyCell*> listElements(listLength, EmptyList);
+
+	for(std::size_t i = 0; i < listLength; i += stringInterval)
+	{
+		listElements[i] = StringCell::fromUtf8StdString(world, std::string(128, 'x'));
+	}
+
+	const std::size_t stringCount = listLength / stringInterval;
+
+	ProperList<AnyCell> *list = ProperList<AnyCell>::create(world, listElements);
+	alloc::StrongRoot<ProperList<AnyCell>> listRoot(world, &list);
+
+	ASSERT_EQUAL(alloc::forceCollection(world), listLength + stringCount);
+
+	// The tenured heap is allocated in to precisely by the collector
+	std::size_t finalizableSegments;
+	std::size_t bitmapCells;
+	ASSERT_TRUE(countSegments(world.tenuredHeap(), finalizableSegments, bitmapCells) > finalizableSegments);
+	ASSERT_TRUE(finalizableSegments > 0);
+	ASSERT_EQUAL(bitmapCells, stringCount);
+
+	// Only the strings should be finalized when the tenured heap is replaced
+	ASSERT_EQUAL(alloc::forceCollection(world), listLength + stringCount);
+	ASSERT_EQUAL(cell_cast<StringCell>(*list->begin())->charLength(), 128);
+
+	// Our cell heap must be conservative as it's allocated in to by compiled code
+	AnyCell *newString = StringCell::fromUtf8StdString(world, "Hello, again!");
+	ASSERT_TRUE(newString != nullptr);
+
+	ASSERT_EQUAL(countSegments(world.cellHeap, finalizableSegments, bitmapCells), finalizableSegments);
+	ASSERT_TRUE(finalizableSegments > 0);
+}
+
+void testStatistics(World &world)
+{
+	const alloc::CollectionStatistics initialStatistics(world.statisticsRecorder().statistics());
+
+	const std::size_t listLength = 16 * 1024;
+	std::vector<AnyCell*> listElements(listLength, EmptyList);
+
+	ProperList<AnyCell> *list = ProperList<AnyCell>::create(world, listElements);
+	alloc::StrongRoot<ProperList<AnyCell>> listRoot(world, &list);
+
+	ASSERT_EQUAL(alloc::forceCollection(world, alloc::CollectionType::Minor), listLength);
+	ASSERT_EQUAL(alloc::forceCollection(world), listLength);
+
+	const alloc::CollectionStatistics statistics(world.statisticsRecorder().statistics());
+
+	ASSERT_EQUAL(statistics.minorCollections, initialStatistics.minorCollections + 1);
+	ASSERT_EQUAL(statistics.fullCollections, initialStatistics.fullCollections + 1);
+	ASSERT_EQUAL(statistics.copiedCells, initialStatistics.copiedCells + (2 * listLength));
+	ASSERT_TRUE(statistics.totalPauseNanoseconds > initialStatistics.totalPauseNanoseconds);
+	ASSERT_TRUE(statistics.maximumPauseNanoseconds <= statistics.totalPauseNanoseconds);
+	ASSERT_TRUE(statistics.finalizedBytes > initialStatistics.finalizedBytes);
+
+	// The tenured list should be in our heaps
+	ASSERT_EQUAL(statistics.segmentCount, world.cellHeap.segmentCount() + world.tenuredHeap().segmentCount());
+	ASSERT_EQUAL(statistics.heapBytes, world.cellHeap.segmentBytes() + world.tenuredHeap().segmentBytes());
+	ASSERT_TRUE(statistics.heapBytes >= (listLength * sizeof(alloc::AllocCell)));
+	ASSERT_TRUE(statistics.peakHeapBytes >= statistics.heapBytes);
+
+	// Merging should sum counters and preserve maximums
+	alloc::CollectionStatistics mergedStatistics(statistics);
+	mergedStatistics.merge(statistics);
+
+	ASSERT_EQUAL(mergedStatistics.copiedCells, 2 * statistics.copiedCells);
+	ASSERT_EQUAL(mergedStatistics.peakHeapBytes, statistics.peakHeapBytes);
+}
+
+void testMoveReachable(World &world)
+{
+	StringCell *sharedString = StringCell::fromUtf8StdString(world, "Hello, world!");
+	ProperList<AnyCell> *tenuredList = ProperList<AnyCell>::create(world, {sharedString, EmptyList});
+
+	{
+		// Tenure the list and the string
+		alloc::StrongRoot<ProperList<AnyCell>> listRoot(world, &tenuredList);
+		alloc::forceCollection(world);
+	}
+
+	sharedString = cell_cast<StringCell>(*tenuredList->begin());
+	ASSERT_TRUE(tenuredList->gcState() == GarbageState::TenuredCell);
+
+	VectorCell *sourceVector = VectorCell::fromFill(world, 3, sharedString);
+	sourceVector->setElementAt(1, tenuredList);
+
+	auto canMoveAll = [] (AnyCell *) { return true; };
+
+	{
+		alloc::Heap destHeap(1024);
+		auto movedVector = cell_cast<VectorCell>(alloc::moveReachable(destHeap, sourceVector, canMoveAll));
+
+		ASSERT_TRUE(movedVector != nullptr);
+		ASSERT_TRUE(movedVector != sourceVector);
+		ASSERT_TRUE(movedVector->gcState() == GarbageState::HeapAllocatedCell);
+
+		// Shared references should be preserved
+		auto movedString = cell_cast<StringCell>(movedVector->elements()[0]);
+		ASSERT_TRUE(movedString != nullptr);
+		ASSERT_EQUAL(movedString, movedVector->elements()[2]);
+		ASSERT_TRUE(movedString->gcState() == GarbageState::HeapAllocatedCell);
+		ASSERT_UTF8_EQUAL(movedString, "Hello, world!");
+
+		auto movedList = cell_cast<ProperList<AnyCell>>(movedVector->elements()[1]);
+		ASSERT_TRUE(movedList != nullptr);
+		ASSERT_TRUE(movedList->gcState() == GarbageState::HeapAllocatedCell);
+		ASSERT_EQUAL(*movedList->begin(), movedString);
+
+		// The original cells should be replaced with inert records
+		ASSERT_TRUE(RecordCell::isInstance(sourceVector));
+		ASSERT_TRUE(RecordCell::isInstance(sharedString));
+		ASSERT_TRUE(RecordCell::isInstance(tenuredList));
+		ASSERT_TRUE(tenuredList->gcState() == GarbageState::TenuredCell);
+	}
+
+	// Hash map trees can be shared with other maps
+	StringCell *mapKey = StringCell::fromUtf8StdString(world, "key");
+	StringCell *mapValue = StringCell::fromUtf8StdString(world, "value");
+
+	HashMapCell *sourceMap = HashMapCell::createEmptyInstance(world);
+	sourceMap->setDatumHashTree(DatumHashTree::assoc(nullptr, mapKey, mapValue));
+
+	DatumHashTree *sharedTree = DatumHashTree::ref(sourceMap->datumHashTree());
+
+	{
+		alloc::Heap destHeap(1024);
+		auto movedMap = cell_cast<HashMapCell>(alloc::moveReachable(destHeap, sourceMap, canMoveAll));
+
+		ASSERT_TRUE(movedMap != nullptr);
+		ASSERT_TRUE(movedMap->datumHashTree() != sharedTree);
+
+		DatumHashTree::every(movedMap->datumHashTree(), [&] (AnyCell *key, AnyCell *value, DatumHash::ResultType) {
+			ASSERT_TRUE(key != mapKey);
+			ASSERT_UTF8_EQUAL(cell_cast<StringCell>(key), "key");
+			ASSERT_UTF8_EQUAL(cell_cast<StringCell>(value), "value");
+			return true;
+		});
+
+		// The shared tree should be untouched
+		DatumHashTree::every(sharedTree, [&] (AnyCell *key, AnyCell *value, DatumHash::ResultType) {
+			ASSERT_EQUAL(key, mapKey);
+			ASSERT_EQUAL(value, mapValue);
+			return true;
+		});
+	}
+
+	DatumHashTree::unref(sharedTree);
+
+	// Build a structure where the final cell can't be moved
+	StringCell *unmovableString = StringCell::fromUtf8StdString(world, "Unmovable");
+	PairCell *sourcePair = PairCell::createInstance(world, unmovableString, EmptyList);
+	sourceVector = VectorCell::fromFill(world, 2, sourcePair);
+
+	{
+		alloc::Heap destHeap(1024);
+
+		AnyCell *movedCell = alloc::moveReachable(destHeap, sourceVector, [&] (AnyCell *cell) {
+			return cell != unmovableString;
+		});
+
+		ASSERT_NULL(movedCell);
+	}
+
+	// Everything should be restored
+	ASSERT_TRUE(VectorCell::isInstance(sourceVector));
+	ASSERT_EQUAL(sourceVector->elements()[0], sourcePair);
+	ASSERT_EQUAL(sourceVector->elements()[1], sourcePair);
+	ASSERT_TRUE(PairCell::isInstance(sourcePair));
+	ASSERT_EQUAL(sourcePair->car(), unmovableString);
+	ASSERT_UTF8_EQUAL(unmovableString, "Unmovable");
+}
+
+void testMovedTenuredCell(World &world)
+{
+	StringCell *movedString = StringCell::fromUtf8StdString(world, "Moved");
+	ProperList<AnyCell> *tenuredList = ProperList<AnyCell>::create(world, {movedString});
+	alloc::StrongRoot<ProperList<AnyCell>> listRoot(world, &tenuredList);
+
+	// Tenure the list and the string
+	alloc::forceCollection(world);
+	ASSERT_TRUE(tenuredList->gcState() == GarbageState::TenuredCell);
+
+	auto canMoveAll = [] (AnyCell *) { return true; };
+	alloc::Heap destHeap(1024);
+
+	// Move the string out from under the list like (tell) would
+	AnyCell *movedCell = alloc::moveReachable(destHeap, *tenuredList->begin(), canMoveAll);
+	ASSERT_TRUE(movedCell != nullptr);
+
+	AnyCell *placeholder = *tenuredList->begin();
+	ASSERT_TRUE(RecordCell::isInstance(placeholder));
+	ASSERT_TRUE(placeholder->gcState() == GarbageState::TenuredCell);
+
+	// Records can't be tenured so a major collection should move the placeholder to the cell heap as a young cell
+	alloc::forceCollection(world);
+
+	placeholder = *tenuredList->begin();
+	ASSERT_TRUE(RecordCell::isInstance(placeholder));
+	ASSERT_TRUE(placeholder->gcState() == GarbageState::HeapAllocatedCell);
+
+	// The tenured list must now be remembered for a minor collection to relocate the placeholder
+	ASSERT_EQUAL(alloc::forceCollection(world, alloc::CollectionType::Minor), 1);
+
+	placeholder = *tenuredList->begin();
+	ASSERT_TRUE(RecordCell::isInstance(placeholder));
+	ASSERT_TRUE(placeholder->gcState() == GarbageState::HeapAllocatedCell);
+}
+
 void testAll(World &world)
 {
+	// Test segment recycling
+	testSegmentPool();
+	testSegmentReservation();
+
+	// Test collections are scheduled based on the live set
+	testCollectionPolicy();
+
 	// Test large allocations
 	testHugeRangeAlloc(world);
 
 	// Test large number of allocations
 	testLargeNumberOfAllocations(world);
+
+	// Test explicitly rooted cells survive collection
+	testStrongRoots(world);
+
+	// Test generated code is asked to poll once a collection is pending
+	testGcPollRequests(world);
+
+	// Test the fields generated code accesses are where it expects
+	testGeneratedCodeLayout(world);
+
+	// Test deeply nested structures don't exhaust the stack
+	testDeepCarNesting(world);
+
+	// Test tenured cells are skipped by minor collections
+	testMinorCollection(world);
+
+	// Test segments track if they need finalization
+	testSegmentHeaders(world);
+
+	// Test collection statistics are recorded
+	testStatistics(world);
+
+	// Test cells can be moved in to another heap
+	testMoveReachable(world);
+
+	// Test placeholders for moved tenured cells survive later collections
+	testMovedTenuredCell(world);
+
+	// Nothing should be reachable once all of our roots are released
+	ASSERT_EQUAL(alloc::forceCollection(world), 0U);
+	ASSERT_TRUE(world.rememberedCells().empty());
 }
 
 }
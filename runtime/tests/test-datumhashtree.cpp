@@ -1,11 +1,22 @@
 #include "hash/DatumHashTree.h"
 
 #include <random>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <map>
 
 #include "binding/IntegerCell.h"
 #include "binding/FlonumCell.h"
 #include "binding/StringCell.h"
 #include "binding/BooleanCell.h"
+#include "binding/HashMapCell.h"
+
+#include "hash/TransientHashMapCell.h"
+#include "alloc/allocator.h"
+#include "alloc/StrongRoot.h"
+#include "alloc/CellRefWalker.h"
+#include "dynamic/SchemeException.h"
 
 #include "writer/ExternalFormDatumWriter.cpp"
 #include "core/init.h"
@@ -50,7 +61,7 @@ void testBasicImmutable(World &world)
 		ASSERT_NULL(DatumHashTree::find(emptyTree, stringTwo));
 		ASSERT_NULL(DatumHashTree::find(emptyTree, stringThree));
 
-		DatumHashTree::every(emptyTree, [&] (AnyCell *key, AnyCell *value, DatumHash::ResultType)
+		DatumHashTree::every(emptyTree, [&] (AnyCell *, AnyCell *, DatumHash::ResultType)
 		{
 			ASSERT_TRUE(false);
 			return true;
@@ -132,7 +143,7 @@ void testBasicImmutable(World &world)
 		ASSERT_EQUAL(DatumHashTree::find(fourValueTree, stringThree), intThree);
 
 		bool seenValues[4] = {false};
-		DatumHashTree::every(fourValueTree, [&] (AnyCell *key, AnyCell *value, DatumHash::ResultType)
+		DatumHashTree::every(fourValueTree, [&] (AnyCell *, AnyCell *value, DatumHash::ResultType)
 		{
 			std::int64_t intValue = cell_cast<IntegerCell>(value)->value();
 
@@ -168,7 +179,7 @@ void testBasicImmutable(World &world)
 		ASSERT_EQUAL(DatumHashTree::find(swappedTree, stringThree), intZero);
 
 		bool seenValues[4] = {false};
-		DatumHashTree::every(fourValueTree, [&] (AnyCell *key, AnyCell *value, DatumHash::ResultType)
+		DatumHashTree::every(fourValueTree, [&] (AnyCell *, AnyCell *value, DatumHash::ResultType)
 		{
 			std::int64_t intValue = cell_cast<IntegerCell>(value)->value();
 
@@ -249,7 +260,7 @@ void testBasicImmutable(World &world)
 		ASSERT_NULL(DatumHashTree::find(fourRemovedTree, stringTwo));
 		ASSERT_NULL(DatumHashTree::find(fourRemovedTree, stringThree));
 
-		DatumHashTree::every(fourRemovedTree, [&] (AnyCell *key, AnyCell *value, DatumHash::ResultType)
+		DatumHashTree::every(fourRemovedTree, [&] (AnyCell *, AnyCell *, DatumHash::ResultType)
 		{
 			ASSERT_TRUE(false);
 			return true;
@@ -424,7 +435,7 @@ void testLargeImmutableTree(World &world)
 			}
 		}
 
-		DatumHashTree::every(removedEvenTree, [&] (AnyCell *key, AnyCell *value, DatumHash::ResultType)
+		DatumHashTree::every(removedEvenTree, [&] (AnyCell *key, AnyCell *, DatumHash::ResultType)
 		{
 			std::int64_t intValue = cell_cast<IntegerCell>(key)->value();
 			ASSERT_TRUE(intValue % 2);
@@ -454,7 +465,7 @@ void testLargeImmutableTree(World &world)
 			ASSERT_NULL(DatumHashTree::find(removedAllTree, intCell));
 		}
 
-		DatumHashTree::every(removedAllTree, [&] (AnyCell *key, AnyCell *value, DatumHash::ResultType)
+		DatumHashTree::every(removedAllTree, [&] (AnyCell *, AnyCell *, DatumHash::ResultType)
 		{
 			ASSERT_TRUE(false);
 			return true;
@@ -510,11 +521,819 @@ void testToFromAssocList(World &world)
 	ASSERT_EQUAL(DatumHashTree::instanceCount(), 0);
 }
 
+void testCopyMapped(World &world)
+{
+	static const std::size_t testIntegerCount = 2000;
+
+	std::vector<IntegerCell*> intVector;
+	intVector.reserve(testIntegerCount * 2);
+
+	std::mt19937 gen;
+	gen.seed(0);
+
+	std::uniform_int_distribution<DatumHash::ResultType> distribution;
+
+	DatumHashTree *tree = DatumHashTree::createEmpty();
+
+	for(std::size_t i = 0; i < testIntegerCount; i++)
+	{
+		auto randomNumber = distribution(gen);
+
+		// These should have colliding hash codes
+		intVector.push_back(IntegerCell::fromValue(world, randomNumber));
+		intVector.push_back(IntegerCell::fromValue(world, randomNumber + (1ULL << 32)));
+	}
+
+	for(auto intCell : intVector)
+	{
+		pivotTree(tree, DatumHashTree::assoc(tree, intCell, BooleanCell::trueInstance()));
+	}
+
+	ASSERT_NULL(DatumHashTree::copyMapped(nullptr, [] (AnyCell *&, AnyCell *&) {}));
+
+	const std::size_t sourceInstanceCount = DatumHashTree::instanceCount();
+
+	// Replace every key with an equal copy and every value with false
+	DatumHashTree *copiedTree = DatumHashTree::copyMapped(tree, [&] (AnyCell *&key, AnyCell *&value)
+	{
+		key = IntegerCell::fromValue(world, cell_cast<IntegerCell>(key)->value());
+		value = BooleanCell::falseInstance();
+	});
+
+	// The copy should have the same shape as the source
+	ASSERT_EQUAL(DatumHashTree::instanceCount(), sourceInstanceCount * 2);
+	ASSERT_EQUAL(DatumHashTree::size(copiedTree), testIntegerCount * 2);
+
+	for(auto intCell : intVector)
+	{
+		ASSERT_EQUAL(DatumHashTree::find(tree, intCell), BooleanCell::trueInstance());
+		ASSERT_EQUAL(DatumHashTree::find(copiedTree, intCell), BooleanCell::falseInstance());
+	}
+
+	DatumHashTree::every(copiedTree, [&] (AnyCell *key, AnyCell *, DatumHash::ResultType)
+	{
+		// None of the original keys should remain
+		ASSERT_TRUE(std::find(intVector.begin(), intVector.end(), key) == intVector.end());
+		return true;
+	});
+
+	// Further modifications shouldn't affect the source tree
+	pivotTree(copiedTree, DatumHashTree::without(copiedTree, intVector[0]));
+	ASSERT_EQUAL(DatumHashTree::find(tree, intVector[0]), BooleanCell::trueInstance());
+
+	DatumHashTree::unref(copiedTree);
+	ASSERT_EQUAL(DatumHashTree::instanceCount(), sourceInstanceCount);
+
+	// Throwing part of the way through the copy shouldn't leak
+	std::size_t replacedEntries = 0;
+
+	try
+	{
+		DatumHashTree::copyMapped(tree, [&] (AnyCell *&, AnyCell *&)
+		{
+			if (++replacedEntries == testIntegerCount)
+			{
+				throw replacedEntries;
+			}
+		});
+
+		ASSERT_TRUE(false);
+	}
+	catch(std::size_t)
+	{
+	}
+
+	ASSERT_EQUAL(DatumHashTree::instanceCount(), sourceInstanceCount);
+
+	DatumHashTree::unref(tree);
+	ASSERT_EQUAL(DatumHashTree::instanceCount(), 0);
+}
+
+void testTransient(World &world)
+{
+	static const std::size_t testIntegerCount = 2000;
+
+	std::vector<IntegerCell*> intVector;
+	intVector.reserve(testIntegerCount * 2);
+
+	std::mt19937 gen;
+	gen.seed(0);
+
+	std::uniform_int_distribution<DatumHash::ResultType> distribution;
+
+	for(std::size_t i = 0; i < testIntegerCount; i++)
+	{
+		auto randomNumber = distribution(gen);
+
+		// These should have colliding hash codes
+		intVector.push_back(IntegerCell::fromValue(world, randomNumber));
+		intVector.push_back(IntegerCell::fromValue(world, randomNumber + (1ULL << 32)));
+	}
+
+	// Build the first half of the keys persistently
+	DatumHashTree *sourceTree = DatumHashTree::createEmpty();
+
+	for(std::size_t i = 0; i < testIntegerCount; i++)
+	{
+		pivotTree(sourceTree, DatumHashTree::assoc(sourceTree, intVector[i], BooleanCell::trueInstance()));
+	}
+
+	const std::size_t sourceInstanceCount = DatumHashTree::instanceCount();
+
+	{
+		// Build on top of the shared source tree
+		DatumHashTree::Transient transient(DatumHashTree::ref(sourceTree));
+
+		for(auto intCell : intVector)
+		{
+			transient.assoc(intCell, BooleanCell::falseInstance());
+		}
+
+		// Remove every even key
+		for(std::size_t i = 0; i < intVector.size(); i += 2)
+		{
+			transient.without(intVector[i]);
+		}
+
+		// Removing missing keys should have no effect
+		transient.without(intVector[0]);
+		transient.without(StringCell::fromUtf8StdString(world, "not present"));
+
+		for(std::size_t i = 0; i < intVector.size(); i++)
+		{
+			if (i % 2)
+			{
+				ASSERT_EQUAL(transient.find(intVector[i]), BooleanCell::falseInstance());
+			}
+			else
+			{
+				ASSERT_NULL(transient.find(intVector[i]));
+			}
+		}
+
+		DatumHashTree *transientTree = transient.persistent();
+		ASSERT_NULL(transient.persistent());
+
+		ASSERT_EQUAL(DatumHashTree::size(transientTree), testIntegerCount);
+
+		// The source tree should be unmodified
+		ASSERT_EQUAL(DatumHashTree::size(sourceTree), testIntegerCount);
+
+		for(std::size_t i = 0; i < testIntegerCount; i++)
+		{
+			ASSERT_EQUAL(DatumHashTree::find(sourceTree, intVector[i]), BooleanCell::trueInstance());
+		}
+
+		DatumHashTree::unref(transientTree);
+		ASSERT_EQUAL(DatumHashTree::instanceCount(), sourceInstanceCount);
+	}
+
+	{
+		// Exclusively own the source tree and remove every key
+		DatumHashTree::Transient transient(sourceTree);
+
+		for(auto intCell : intVector)
+		{
+			transient.without(intCell);
+		}
+
+		ASSERT_NULL(transient.persistent());
+		ASSERT_EQUAL(DatumHashTree::instanceCount(), 0);
+	}
+
+	{
+		// Destroying an unfinished transient should free its tree
+		DatumHashTree::Transient transient;
+
+		for(auto intCell : intVector)
+		{
+			transient.assoc(intCell, intCell);
+		}
+
+		ASSERT_EQUAL(transient.find(intVector.back()), intVector.back());
+	}
+
+	ASSERT_EQUAL(DatumHashTree::instanceCount(), 0);
+}
+
+std::size_t countEntries(const DatumHashTree *tree)
+{
+	std::size_t entries = 0;
+
+	DatumHashTree::every(tree, [&] (AnyCell *, AnyCell *, DatumHash::ResultType)
+	{
+		entries++;
+		return true;
+	});
+
+	return entries;
+}
+
+void testCachedSize(World &world)
+{
+	static const std::size_t testIntegerCount = 500;
+	static const std::size_t operationCount = 20000;
+
+	std::vector<IntegerCell*> intVector;
+
+	std::mt19937 gen;
+	gen.seed(0);
+
+	std::uniform_int_distribution<DatumHash::ResultType> distribution;
+
+	for(std::size_t i = 0; i < testIntegerCount; i++)
+	{
+		auto randomNumber = distribution(gen);
+
+		// These should have colliding hash codes
+		intVector.push_back(IntegerCell::fromValue(world, randomNumber));
+		intVector.push_back(IntegerCell::fromValue(world, randomNumber + (1ULL << 32)));
+	}
+
+	std::uniform_int_distribution<std::size_t> keyDistribution(0, intVector.size() - 1);
+	std::bernoulli_distribution assocDistribution(0.6);
+
+	// Apply the same random operations persistently and through a transient
+	DatumHashTree *persistentTree = DatumHashTree::createEmpty();
+	std::unique_ptr<DatumHashTree::Transient> transient(new DatumHashTree::Transient);
+
+	for(std::size_t i = 0; i < operationCount; i++)
+	{
+		IntegerCell *key = intVector[keyDistribution(gen)];
+
+		if (assocDistribution(gen))
+		{
+			pivotTree(persistentTree, DatumHashTree::assoc(persistentTree, key, key));
+			transient->assoc(key, key);
+		}
+		else
+		{
+			pivotTree(persistentTree, DatumHashTree::without(persistentTree, key));
+			transient->without(key);
+		}
+
+		if ((i % 100) == 0)
+		{
+			ASSERT_EQUAL(DatumHashTree::size(persistentTree), countEntries(persistentTree));
+
+			// Share the transient's tree so its next modifications must copy
+			DatumHashTree *transientTree = transient->persistent();
+			ASSERT_EQUAL(DatumHashTree::size(transientTree), countEntries(transientTree));
+			ASSERT_EQUAL(DatumHashTree::size(transientTree), DatumHashTree::size(persistentTree));
+
+			transient.reset(new DatumHashTree::Transient(DatumHashTree::ref(transientTree)));
+			DatumHashTree::unref(transientTree);
+		}
+	}
+
+	DatumHashTree *transientTree = transient->persistent();
+	ASSERT_EQUAL(DatumHashTree::size(transientTree), countEntries(transientTree));
+	ASSERT_EQUAL(DatumHashTree::size(persistentTree), countEntries(persistentTree));
+
+	DatumHashTree::unref(transientTree);
+	DatumHashTree::unref(persistentTree);
+	ASSERT_EQUAL(DatumHashTree::instanceCount(), 0);
+}
+
+void testIterator(World &world)
+{
+	static const std::size_t testIntegerCount = 1000;
+
+	{
+		DatumHashTree::Iterator emptyIt(DatumHashTree::createEmpty());
+		ASSERT_TRUE(emptyIt.atEnd());
+	}
+
+	std::vector<IntegerCell*> intVector;
+
+	std::mt19937 gen;
+	gen.seed(0);
+
+	std::uniform_int_distribution<DatumHash::ResultType> distribution;
+
+	for(std::size_t i = 0; i < testIntegerCount; i++)
+	{
+		auto randomNumber = distribution(gen);
+
+		// These should have colliding hash codes
+		intVector.push_back(IntegerCell::fromValue(world, randomNumber));
+		intVector.push_back(IntegerCell::fromValue(world, randomNumber + (1ULL << 32)));
+	}
+
+	DatumHashTree::Transient transient;
+
+	for(auto intCell : intVector)
+	{
+		transient.assoc(intCell, intCell);
+	}
+
+	DatumHashTree *tree = transient.persistent();
+
+	// Collect the entries in the order every() visits them
+	std::vector<AnyCell*> everyKeys;
+
+	DatumHashTree::every(tree, [&] (AnyCell *key, AnyCell *value, DatumHash::ResultType hashValue)
+	{
+		DatumHash hasher;
+		ASSERT_EQUAL(hasher(key), hashValue);
+		ASSERT_EQUAL(key, value);
+
+		everyKeys.push_back(key);
+		return true;
+	});
+
+	ASSERT_EQUAL(everyKeys.size(), intVector.size());
+
+	// Interleave two iterators. The second starts once the first is half way through.
+	auto firstIt = std::unique_ptr<DatumHashTree::Iterator>(new DatumHashTree::Iterator(tree));
+	std::unique_ptr<DatumHashTree::Iterator> secondIt;
+
+	std::size_t firstIndex = 0;
+	std::size_t secondIndex = 0;
+
+	// The iterators should keep the tree alive
+	const std::size_t treeInstanceCount = DatumHashTree::instanceCount();
+	DatumHashTree::unref(tree);
+	ASSERT_EQUAL(DatumHashTree::instanceCount(), treeInstanceCount);
+
+	while(!firstIt->atEnd())
+	{
+		ASSERT_EQUAL(firstIt->key(), everyKeys[firstIndex++]);
+		firstIt->advance();
+
+		if (firstIndex == (everyKeys.size() / 2))
+		{
+			secondIt.reset(new DatumHashTree::Iterator(tree));
+		}
+
+		if (secondIt)
+		{
+			ASSERT_FALSE(secondIt->atEnd());
+			ASSERT_EQUAL(secondIt->key(), everyKeys[secondIndex++]);
+			secondIt->advance();
+		}
+	}
+
+	ASSERT_EQUAL(firstIndex, everyKeys.size());
+
+	firstIt.reset();
+	ASSERT_EQUAL(DatumHashTree::instanceCount(), treeInstanceCount);
+
+	// Resume the second iterator
+	while(!secondIt->atEnd())
+	{
+		ASSERT_EQUAL(secondIt->key(), everyKeys[secondIndex++]);
+		secondIt->advance();
+	}
+
+	ASSERT_EQUAL(secondIndex, everyKeys.size());
+
+	secondIt.reset();
+	ASSERT_EQUAL(DatumHashTree::instanceCount(), 0);
+}
+
+void testTransientHashMapCell(World &world)
+{
+	HashMapCell *sourceHashMap = HashMapCell::createEmptyInstance(world);
+	sourceHashMap->setDatumHashTree(DatumHashTree::assoc(nullptr, BooleanCell::trueInstance(), BooleanCell::trueInstance()));
+
+	alloc::StrongRoot<HashMapCell> sourceRoot(world, &sourceHashMap);
+
+	TransientHashMapCell *transient = TransientHashMapCell::createInstance(world, sourceHashMap);
+	alloc::StrongRoot<TransientHashMapCell> transientRoot(world, &transient);
+
+	ASSERT_TRUE(TransientHashMapCell::isInstance(transient));
+	ASSERT_FALSE(TransientHashMapCell::isInstance(sourceHashMap));
+
+	// Tenure the transient's hash map
+	alloc::forceCollection(world);
+
+	{
+		// Add a young key and value to the transient
+		AnyCell *keyValue[2] = {
+			StringCell::fromUtf8StdString(world, "key"),
+			StringCell::fromUtf8StdString(world, "value")
+		};
+
+		transient->assoc(world, keyValue[0], keyValue[1]);
+		transient->without(world, BooleanCell::trueInstance());
+	}
+
+	// A minor collection must still find the young cells
+	alloc::forceCollection(world, alloc::CollectionType::Minor);
+
+	HashMapCell *resultHashMap = transient->persistent(world);
+
+	ASSERT_EQUAL(DatumHashTree::size(resultHashMap->datumHashTree()), 1);
+	ASSERT_TRUE(DatumHashTree::find(resultHashMap->datumHashTree(), StringCell::fromUtf8StdString(world, "key"))->isEqual(
+				StringCell::fromUtf8StdString(world, "value")));
+
+	// The source should be unmodified
+	ASSERT_EQUAL(DatumHashTree::size(sourceHashMap->datumHashTree()), 1);
+	ASSERT_EQUAL(DatumHashTree::find(sourceHashMap->datumHashTree(), BooleanCell::trueInstance()), BooleanCell::trueInstance());
+
+	// The transient can't be used once it's persistent
+	try
+	{
+		transient->assoc(world, BooleanCell::falseInstance(), BooleanCell::falseInstance());
+		ASSERT_TRUE(false);
+	}
+	catch(dynamic::SchemeException &)
+	{
+	}
+}
+
+void testNodeAllocation(World &world)
+{
+	// This is enough entries for a leaf node to outgrow the node allocator's size classes
+	static const std::size_t collidingKeyCount = 64;
+	static const DatumHash::ResultType collidingHashValue = 0x12345678;
+
+	// Earlier tests can leave trees owned by uncollected hash maps
+	const std::size_t initialInstanceCount = DatumHashTree::instanceCount();
+
+	std::vector<IntegerCell*> intVector;
+
+	for(std::size_t i = 0; i < collidingKeyCount; i++)
+	{
+		intVector.push_back(IntegerCell::fromValue(world, i));
+	}
+
+	{
+		// Grow and shrink a single leaf in place
+		DatumHashTree::Transient transient;
+
+		for(auto intCell : intVector)
+		{
+			transient.assoc(intCell, intCell, collidingHashValue);
+		}
+
+		for(std::size_t i = 0; i < collidingKeyCount; i++)
+		{
+			ASSERT_EQUAL(transient.find(intVector[i], collidingHashValue), intVector[i]);
+		}
+
+		for(std::size_t i = 0; i < collidingKeyCount; i++)
+		{
+			transient.without(intVector[i], collidingHashValue);
+
+			ASSERT_NULL(transient.find(intVector[i], collidingHashValue));
+
+			if ((i + 1) < collidingKeyCount)
+			{
+				ASSERT_EQUAL(transient.find(intVector.back(), collidingHashValue), intVector.back());
+			}
+		}
+
+		ASSERT_NULL(transient.persistent());
+		ASSERT_EQUAL(DatumHashTree::instanceCount(), initialInstanceCount);
+	}
+
+	{
+		// Build a tree on a thread that exits before the tree is freed
+		DatumHashTree *threadTree = nullptr;
+
+		std::thread builderThread([&] {
+			DatumHashTree::Transient transient;
+
+			for(auto intCell : intVector)
+			{
+				transient.assoc(intCell, intCell);
+			}
+
+			threadTree = transient.persistent();
+		});
+
+		builderThread.join();
+
+		ASSERT_EQUAL(DatumHashTree::size(threadTree), collidingKeyCount);
+
+		for(auto intCell : intVector)
+		{
+			ASSERT_EQUAL(DatumHashTree::find(threadTree, intCell), intCell);
+		}
+
+		// Free it on a thread that didn't allocate it
+		std::thread([&] {
+			DatumHashTree::unref(threadTree);
+		}).join();
+
+		ASSERT_EQUAL(DatumHashTree::instanceCount(), initialInstanceCount);
+	}
+}
+
+using ExpectedEntries = std::map<std::size_t, AnyCell*>;
+
+DatumHashTree* treeFromExpected(const std::vector<IntegerCell*> &keys, const ExpectedEntries &expected)
+{
+	DatumHashTree::Transient transient;
+
+	for(auto &entry : expected)
+	{
+		transient.assoc(keys[entry.first], entry.second);
+	}
+
+	return transient.persistent();
+}
+
+void assertTreeMatches(const DatumHashTree *tree, const std::vector<IntegerCell*> &keys, const ExpectedEntries &expected)
+{
+	ASSERT_EQUAL(DatumHashTree::size(tree), expected.size());
+	ASSERT_EQUAL(countEntries(tree), expected.size());
+
+	for(auto &entry : expected)
+	{
+		ASSERT_EQUAL(DatumHashTree::find(const_cast<DatumHashTree*>(tree), keys[entry.first]), entry.second);
+	}
+}
+
+void testSetOperations(World &world)
+{
+	// This is enough for the merges to be parallelised
+	static const std::size_t testIntegerCount = 20000;
+
+	const std::size_t initialInstanceCount = DatumHashTree::instanceCount();
+
+	std::vector<IntegerCell*> keys;
+	std::vector<IntegerCell*> leftValues;
+	std::vector<IntegerCell*> rightValues;
+
+	std::mt19937 gen;
+	gen.seed(0);
+
+	std::uniform_int_distribution<DatumHash::ResultType> distribution;
+
+	for(std::size_t i = 0; i < testIntegerCount; i++)
+	{
+		auto randomNumber = distribution(gen);
+
+		// These should have colliding hash codes
+		keys.push_back(IntegerCell::fromValue(world, randomNumber));
+		keys.push_back(IntegerCell::fromValue(world, randomNumber + (1ULL << 32)));
+	}
+
+	for(std::size_t i = 0; i < keys.size(); i++)
+	{
+		leftValues.push_back(IntegerCell::fromValue(world, i));
+		rightValues.push_back(IntegerCell::fromValue(world, -static_cast<std::int64_t>(i)));
+	}
+
+	std::bernoulli_distribution presentDistribution(0.5);
+	ExpectedEntries leftEntries;
+	ExpectedEntries rightEntries;
+
+	for(std::size_t i = 0; i < keys.size(); i++)
+	{
+		if (presentDistribution(gen))
+		{
+			leftEntries[i] = leftValues[i];
+		}
+
+		if (presentDistribution(gen))
+		{
+			rightEntries[i] = rightValues[i];
+		}
+	}
+
+	DatumHashTree *leftTree = treeFromExpected(keys, leftEntries);
+	DatumHashTree *rightTree = treeFromExpected(keys, rightEntries);
+
+	{
+		ExpectedEntries expected(leftEntries);
+
+		for(auto &entry : rightEntries)
+		{
+			expected[entry.first] = entry.second;
+		}
+
+		DatumHashTree *mergedTree = DatumHashTree::merge(leftTree, rightTree);
+		assertTreeMatches(mergedTree, keys, expected);
+		DatumHashTree::unref(mergedTree);
+	}
+
+	{
+		ExpectedEntries expected(rightEntries);
+		std::size_t conflictCount = 0;
+
+		for(auto &entry : leftEntries)
+		{
+			// The conflict function will keep the left value
+			expected[entry.first] = entry.second;
+		}
+
+		DatumHashTree *mergedTree = DatumHashTree::merge(leftTree, rightTree, [&] (AnyCell *key, AnyCell *leftValue, AnyCell *rightValue)
+		{
+			const std::size_t index = cell_unchecked_cast<IntegerCell>(leftValue)->value();
+
+			ASSERT_EQUAL(key, keys[index]);
+			ASSERT_EQUAL(rightValue, rightValues[index]);
+
+			conflictCount++;
+			return leftValue;
+		});
+
+		assertTreeMatches(mergedTree, keys, expected);
+		ASSERT_EQUAL(conflictCount, leftEntries.size() + rightEntries.size() - expected.size());
+
+		DatumHashTree::unref(mergedTree);
+	}
+
+	{
+		ExpectedEntries expectedIntersection;
+		ExpectedEntries expectedDifference;
+
+		for(auto &entry : leftEntries)
+		{
+			if (rightEntries.count(entry.first))
+			{
+				expectedIntersection.insert(entry);
+			}
+			else
+			{
+				expectedDifference.insert(entry);
+			}
+		}
+
+		DatumHashTree *intersectionTree = DatumHashTree::intersection(leftTree, rightTree);
+		assertTreeMatches(intersectionTree, keys, expectedIntersection);
+		DatumHashTree::unref(intersectionTree);
+
+		DatumHashTree *differenceTree = DatumHashTree::difference(leftTree, rightTree);
+		assertTreeMatches(differenceTree, keys, expectedDifference);
+		DatumHashTree::unref(differenceTree);
+	}
+
+	{
+		// Identical and empty trees should be shared
+		DatumHashTree *mergedTree = DatumHashTree::merge(leftTree, leftTree);
+		ASSERT_EQUAL(mergedTree, leftTree);
+		DatumHashTree::unref(mergedTree);
+
+		mergedTree = DatumHashTree::merge(leftTree, nullptr);
+		ASSERT_EQUAL(mergedTree, leftTree);
+		DatumHashTree::unref(mergedTree);
+
+		DatumHashTree *intersectionTree = DatumHashTree::intersection(leftTree, leftTree);
+		ASSERT_EQUAL(intersectionTree, leftTree);
+		DatumHashTree::unref(intersectionTree);
+
+		ASSERT_NULL(DatumHashTree::intersection(leftTree, nullptr));
+		ASSERT_NULL(DatumHashTree::difference(leftTree, leftTree));
+
+		DatumHashTree *differenceTree = DatumHashTree::difference(leftTree, nullptr);
+		ASSERT_EQUAL(differenceTree, leftTree);
+		DatumHashTree::unref(differenceTree);
+	}
+
+	{
+		// Derive a tree with a few changes
+		DatumHashTree *derivedTree = DatumHashTree::ref(leftTree);
+		std::map<std::size_t, std::pair<AnyCell*, AnyCell*>> expectedChanges;
+
+		for(std::size_t i = 0; i < keys.size(); i += 997)
+		{
+			auto leftIt = leftEntries.find(i);
+			AnyCell *oldValue = (leftIt == leftEntries.end()) ? nullptr : leftIt->second;
+
+			if ((i % 3) == 0)
+			{
+				pivotTree(derivedTree, DatumHashTree::without(derivedTree, keys[i]));
+
+				if (oldValue)
+				{
+					expectedChanges[i] = {oldValue, nullptr};
+				}
+			}
+			else
+			{
+				pivotTree(derivedTree, DatumHashTree::assoc(derivedTree, keys[i], rightValues[i]));
+				expectedChanges[i] = {oldValue, rightValues[i]};
+			}
+		}
+
+		// Replacing a value with an equal value isn't a change
+		auto unchangedEntry = leftEntries.rbegin();
+
+		while(expectedChanges.count(unchangedEntry->first))
+		{
+			unchangedEntry++;
+		}
+
+		pivotTree(derivedTree, DatumHashTree::assoc(derivedTree, keys[unchangedEntry->first],
+					IntegerCell::fromValue(world, unchangedEntry->first)));
+
+		std::map<std::size_t, std::pair<AnyCell*, AnyCell*>> actualChanges;
+
+		ASSERT_TRUE(DatumHashTree::diff(leftTree, derivedTree, [&] (AnyCell *key, AnyCell *oldValue, AnyCell *newValue)
+		{
+			const std::size_t index = std::find(keys.begin(), keys.end(), key) - keys.begin();
+			actualChanges[index] = {oldValue, newValue};
+
+			return true;
+		}));
+
+		ASSERT_TRUE(actualChanges == expectedChanges);
+
+		// Stopping the diff early should return false
+		std::size_t visitedChanges = 0;
+
+		ASSERT_FALSE(DatumHashTree::diff(leftTree, derivedTree, [&] (AnyCell *, AnyCell *, AnyCell *)
+		{
+			visitedChanges++;
+			return false;
+		}));
+
+		ASSERT_EQUAL(visitedChanges, 1);
+
+		ASSERT_TRUE(DatumHashTree::isEqual(leftTree, leftTree));
+		ASSERT_FALSE(DatumHashTree::isEqual(leftTree, derivedTree));
+		ASSERT_FALSE(DatumHashTree::isEqual(leftTree, rightTree));
+		ASSERT_TRUE(DatumHashTree::isEqual(nullptr, nullptr));
+
+		// A separately built tree with equal entries should be equal
+		DatumHashTree *rebuiltTree = treeFromExpected(keys, leftEntries);
+		ASSERT_TRUE(DatumHashTree::isEqual(leftTree, rebuiltTree));
+		DatumHashTree::unref(rebuiltTree);
+
+		DatumHashTree::unref(derivedTree);
+	}
+
+	DatumHashTree::unref(leftTree);
+	DatumHashTree::unref(rightTree);
+
+	ASSERT_EQUAL(DatumHashTree::instanceCount(), initialInstanceCount);
+}
+
+void testWalkCellRefs(World &world)
+{
+	static const std::size_t collidingKeyCount = 3;
+	static const DatumHash::ResultType collidingHashValue = 0x12345678;
+
+	DatumHashTree *tree = nullptr;
+
+	for(std::size_t i = 0; i < collidingKeyCount; i++)
+	{
+		pivotTree(tree, DatumHashTree::assoc(tree, IntegerCell::fromValue(world, i), StringCell::fromUtf8StdString(world, "collision"), collidingHashValue));
+	}
+
+	// Add a non-colliding entry so the collision leaf is below an internal node
+	pivotTree(tree, DatumHashTree::assoc(tree, BooleanCell::trueInstance(), StringCell::fromUtf8StdString(world, "unique"), collidingHashValue + 1));
+
+	HashMapCell *hashMap = HashMapCell::createEmptyInstance(world);
+	hashMap->setDatumHashTree(tree);
+	alloc::StrongRoot<HashMapCell> hashMapRoot(world, &hashMap);
+
+	HashMapCell *sharingHashMap = HashMapCell::createEmptyInstance(world);
+	sharingHashMap->setDatumHashTree(DatumHashTree::ref(tree));
+	alloc::StrongRoot<HashMapCell> sharingHashMapRoot(world, &sharingHashMap);
+
+	{
+		alloc::CellRefWalker walker;
+		std::size_t visitedRefs = 0;
+
+		walker.visitChildren(hashMap, [&] (AnyCell **) {
+			visitedRefs++;
+		});
+
+		// Every key and value should be visited including each entry in the collision leaf
+		ASSERT_EQUAL(visitedRefs, (collidingKeyCount + 1) * 2);
+
+		visitedRefs = 0;
+		walker.visitChildren(sharingHashMap, [&] (AnyCell **) {
+			visitedRefs++;
+		});
+
+		// The shared leaves have already been visited
+		ASSERT_EQUAL(visitedRefs, 0);
+	}
+
+	// The collector must relocate every colliding key and value
+	alloc::forceCollection(world);
+
+	ASSERT_EQUAL(DatumHashTree::size(hashMap->datumHashTree()), collidingKeyCount + 1);
+
+	for(std::size_t i = 0; i < collidingKeyCount; i++)
+	{
+		AnyCell *value = DatumHashTree::find(hashMap->datumHashTree(), IntegerCell::fromValue(world, i), collidingHashValue);
+
+		ASSERT_TRUE(value != nullptr);
+		ASSERT_TRUE(value->isEqual(StringCell::fromUtf8StdString(world, "collision")));
+	}
+}
+
 void testAll(World &world)
 {
 	testBasicImmutable(world);
 	testLargeImmutableTree(world);
 	testToFromAssocList(world);
+	testCopyMapped(world);
+	testTransient(world);
+	testCachedSize(world);
+	testIterator(world);
+	testTransientHashMapCell(world);
+	testNodeAllocation(world);
+	testSetOperations(world);
+	testWalkCellRefs(world);
 }
 
 }
@@ -0,0 +1,240 @@
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "sched/Dispatcher.h"
+#include "sched/WorkStealingDeque.h"
+
+#include "assertions.h"
+#include "stubdefinitions.h"
+
+namespace
+{
+using namespace lliby;
+using sched::Dispatcher;
+using sched::WorkStealingDeque;
+
+void testDequeOrdering()
+{
+	WorkStealingDeque<int> deque(4);
+	std::vector<int> values(16);
+
+	ASSERT_TRUE(deque.isEmpty());
+	ASSERT_TRUE(deque.pop() == nullptr);
+	ASSERT_TRUE(deque.steal() == nullptr);
+
+	// Push past our initial capacity to force the deque to grow
+	for(auto &value : values)
+	{
+		deque.push(&value);
+	}
+
+	ASSERT_FALSE(deque.isEmpty());
+
+	// The owner pops the newest items while thieves steal the oldest
+	ASSERT_TRUE(deque.pop() == &values[15]);
+	ASSERT_TRUE(deque.steal() == &values[0]);
+	ASSERT_TRUE(deque.pop() == &values[14]);
+	ASSERT_TRUE(deque.steal() == &values[1]);
+
+	for(int i = 13; i >= 2; i--)
+	{
+		ASSERT_TRUE(deque.pop() == &values[i]);
+	}
+
+	ASSERT_TRUE(deque.isEmpty());
+	ASSERT_TRUE(deque.pop() == nullptr);
+}
+
+void testDequeConcurrentSteal()
+{
+	const int itemCount = 100000;
+	const int thiefCount = 3;
+
+	WorkStealingDeque<int> deque;
+	std::vector<int> items(itemCount);
+	std::vector<std::atomic<int>> takeCounts(itemCount);
+
+	for(auto &takeCount : takeCounts)
+	{
+		takeCount.store(0);
+	}
+
+	std::atomic<bool> ownerFinished(false);
+	std::vector<std::thread> thieves;
+
+	for(int i = 0; i < thiefCount; i++)
+	{
+		thieves.emplace_back([&] {
+			while(true)
+			{
+				const bool finished = ownerFinished.load();
+
+				if (int *item = deque.steal())
+				{
+					takeCounts[item - items.data()]++;
+				}
+				else if (finished && deque.isEmpty())
+				{
+					return;
+				}
+			}
+		});
+	}
+
+	// Interleave pushes and pops so the owner and thieves race for the last item
+	for(int i = 0; i < itemCount; i++)
+	{
+		deque.push(&items[i]);
+
+		if ((i % 3) == 0)
+		{
+			if (int *item = deque.pop())
+			{
+				takeCounts[item - items.data()]++;
+			}
+		}
+	}
+
+	ownerFinished.store(true);
+
+	for(auto &thief : thieves)
+	{
+		thief.join();
+	}
+
+	// Every item should be taken exactly once
+	for(auto &takeCount : takeCounts)
+	{
+		ASSERT_EQUAL(takeCount.load(), 1);
+	}
+}
+
+void testExternalDispatch()
+{
+	const int jobCount = 10000;
+
+	Dispatcher dispatcher(4);
+	std::atomic<int> completedJobs(0);
+
+	for(int i = 0; i < jobCount; i++)
+	{
+		dispatcher.dispatch([&] {
+			completedJobs++;
+		});
+	}
+
+	dispatcher.waitForDrain();
+	ASSERT_EQUAL(completedJobs.load(), jobCount);
+}
+
+void testRecursiveDispatch()
+{
+	// Build a binary tree of jobs from within the dispatcher
+	const int treeDepth = 14;
+
+	Dispatcher dispatcher(4);
+	std::atomic<int> completedJobs(0);
+
+	std::function<void(int)> spawnTree = [&] (int depth) {
+		completedJobs++;
+
+		if (depth > 0)
+		{
+			dispatcher.dispatch([&, depth] { spawnTree(depth - 1); });
+			dispatcher.dispatch([&, depth] { spawnTree(depth - 1); });
+		}
+	};
+
+	dispatcher.dispatch([&] { spawnTree(treeDepth); });
+	dispatcher.waitForDrain();
+
+	ASSERT_EQUAL(completedJobs.load(), (1 << (treeDepth + 1)) - 1);
+}
+
+void testHomeDispatch()
+{
+	const int jobCount = 10000;
+	const std::size_t workerCount = 4;
+
+	Dispatcher dispatcher(workerCount);
+	std::atomic<int> completedJobs(0);
+
+	// Home workers are assigned round-robin
+	for(std::size_t i = 0; i < workerCount; i++)
+	{
+		ASSERT_EQUAL(dispatcher.assignHomeWorker(), i);
+	}
+
+	ASSERT_EQUAL(dispatcher.assignHomeWorker(), 0U);
+
+	// Hop between home workers from inside and outside the pool
+	std::function<void(int)> hop = [&] (int remaining) {
+		completedJobs++;
+
+		if (remaining > 0)
+		{
+			dispatcher.dispatchToWorker(remaining, [&, remaining] { hop(remaining - 1); });
+		}
+	};
+
+	for(int i = 0; i < jobCount; i++)
+	{
+		if ((i % 2) == 0)
+		{
+			dispatcher.dispatchToWorker(i, [&] { hop(3); });
+		}
+		else
+		{
+			dispatcher.dispatchDeferredToWorker(i, [&] { hop(3); });
+		}
+	}
+
+	dispatcher.waitForDrain();
+	ASSERT_EQUAL(completedJobs.load(), jobCount * 4);
+}
+
+void testBlockingScope()
+{
+	// With a single worker the blocked job can only make progress if a spare thread runs the job it waits for
+	Dispatcher dispatcher(1);
+
+	std::mutex mutex;
+	std::condition_variable cond;
+	bool replied = false;
+
+	dispatcher.dispatch([&] {
+		dispatcher.dispatch([&] {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				replied = true;
+			}
+
+			cond.notify_all();
+		});
+
+		Dispatcher::BlockingScope blockingScope(dispatcher);
+
+		std::unique_lock<std::mutex> lock(mutex);
+		cond.wait(lock, [&]{return replied;});
+	});
+
+	dispatcher.waitForDrain();
+	ASSERT_TRUE(replied);
+}
+
+}
+
+int main()
+{
+	testDequeOrdering();
+	testDequeConcurrentSteal();
+
+	testExternalDispatch();
+	testRecursiveDispatch();
+	testHomeDispatch();
+	testBlockingScope();
+}
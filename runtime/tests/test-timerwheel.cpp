@@ -0,0 +1,235 @@
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <limits>
+
+#include "sched/TimerWheel.h"
+#include "sched/TimerList.h"
+#include "sched/Dispatcher.h"
+
+#include "assertions.h"
+#include "stubdefinitions.h"
+
+namespace
+{
+using namespace lliby;
+using sched::TimerWheel;
+using sched::TimerList;
+using sched::Dispatcher;
+
+void testEmptyWheel()
+{
+	TimerWheel wheel;
+	std::vector<TimerWheel::Timer*> expired;
+
+	ASSERT_TRUE(wheel.isEmpty());
+	ASSERT_EQUAL(wheel.nextEventTick(), std::numeric_limits<TimerWheel::Tick>::max());
+
+	wheel.advance(1000000, expired);
+
+	ASSERT_TRUE(expired.empty());
+	ASSERT_EQUAL(wheel.currentTick(), 1000000);
+}
+
+void testExpiryOrder()
+{
+	TimerWheel wheel;
+	std::vector<TimerWheel::Timer> timers(5);
+	std::vector<TimerWheel::Timer*> expired;
+
+	// Cover the first three levels of the wheel
+	const TimerWheel::Tick expiryTicks[] = {50, 1, 70, 5000, 4096};
+
+	for(std::size_t i = 0; i < timers.size(); i++)
+	{
+		wheel.insert(&timers[i], expiryTicks[i]);
+		ASSERT_TRUE(timers[i].isScheduled());
+	}
+
+	ASSERT_EQUAL(wheel.size(), 5);
+	ASSERT_EQUAL(wheel.nextEventTick(), 1);
+
+	wheel.advance(1, expired);
+	ASSERT_EQUAL(expired.size(), 1);
+	ASSERT_TRUE(expired[0] == &timers[1]);
+	ASSERT_FALSE(timers[1].isScheduled());
+
+	// Advancing to just before an expiry shouldn't expire it
+	expired.clear();
+	wheel.advance(49, expired);
+	ASSERT_TRUE(expired.empty());
+
+	wheel.advance(10000, expired);
+	ASSERT_EQUAL(expired.size(), 4);
+	ASSERT_TRUE(expired[0] == &timers[0]);
+	ASSERT_TRUE(expired[1] == &timers[2]);
+	ASSERT_TRUE(expired[2] == &timers[4]);
+	ASSERT_TRUE(expired[3] == &timers[3]);
+
+	ASSERT_TRUE(wheel.isEmpty());
+}
+
+void testExactExpiry()
+{
+	TimerWheel wheel(12345);
+	std::vector<TimerWheel::Timer*> expired;
+
+	// Step a tick at a time so cascaded timers must land in exactly the right slot
+	for(TimerWheel::Tick delay : {1, 63, 64, 65, 4095, 4096, 4097, 300000})
+	{
+		TimerWheel::Timer timer;
+		wheel.insert(&timer, wheel.currentTick() + delay);
+
+		const TimerWheel::Tick expiryTick = timer.expiryTick();
+
+		while(expired.empty())
+		{
+			wheel.advance(wheel.currentTick() + 1, expired);
+		}
+
+		ASSERT_EQUAL(expired.size(), 1);
+		ASSERT_EQUAL(wheel.currentTick(), expiryTick);
+
+		expired.clear();
+	}
+}
+
+void testBeyondRange()
+{
+	TimerWheel wheel;
+	TimerWheel::Timer timer;
+	std::vector<TimerWheel::Timer*> expired;
+
+	const TimerWheel::Tick wheelRange = TimerWheel::Tick(1) << (TimerWheel::SlotBits * TimerWheel::LevelCount);
+	const TimerWheel::Tick expiryTick = (wheelRange * 3) + 17;
+
+	wheel.insert(&timer, expiryTick);
+
+	wheel.advance(expiryTick - 1, expired);
+	ASSERT_TRUE(expired.empty());
+	ASSERT_TRUE(timer.isScheduled());
+
+	wheel.advance(expiryTick, expired);
+	ASSERT_EQUAL(expired.size(), 1);
+	ASSERT_FALSE(timer.isScheduled());
+}
+
+void testRemove()
+{
+	TimerWheel wheel;
+	std::vector<TimerWheel::Timer> timers(3);
+	std::vector<TimerWheel::Timer*> expired;
+
+	// Put all of our timers in the same slot
+	for(auto &timer : timers)
+	{
+		wheel.insert(&timer, 10);
+	}
+
+	wheel.remove(&timers[1]);
+	ASSERT_FALSE(timers[1].isScheduled());
+	ASSERT_EQUAL(wheel.size(), 2);
+
+	wheel.remove(&timers[0]);
+	wheel.remove(&timers[2]);
+	ASSERT_TRUE(wheel.isEmpty());
+	ASSERT_EQUAL(wheel.nextEventTick(), std::numeric_limits<TimerWheel::Tick>::max());
+
+	wheel.advance(100, expired);
+	ASSERT_TRUE(expired.empty());
+}
+
+void testPastExpiry()
+{
+	TimerWheel wheel(500);
+	TimerWheel::Timer timer;
+	std::vector<TimerWheel::Timer*> expired;
+
+	// Timers in the past expire on the next tick
+	wheel.insert(&timer, 20);
+	ASSERT_EQUAL(timer.expiryTick(), 501);
+
+	wheel.advance(501, expired);
+	ASSERT_EQUAL(expired.size(), 1);
+}
+
+void testTimerList()
+{
+	Dispatcher dispatcher(2);
+
+	std::mutex mutex;
+	std::condition_variable cond;
+	int onceRuns = 0;
+	int repeatingRuns = 0;
+
+	{
+		TimerList timerList(dispatcher);
+
+		auto signalRun = [&] (int &counter) {
+			int runs;
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				runs = ++counter;
+			}
+
+			cond.notify_all();
+			return runs;
+		};
+
+		TimerList::TimerId onceId = timerList.scheduleOnce([&] { signalRun(onceRuns); }, std::chrono::milliseconds(5));
+		TimerList::TimerId cancelledId = timerList.scheduleOnce([&] { signalRun(onceRuns); }, std::chrono::hours(1));
+
+		ASSERT_TRUE(onceId != 0);
+		ASSERT_TRUE(onceId != cancelledId);
+		ASSERT_TRUE(timerList.cancel(cancelledId));
+		ASSERT_FALSE(timerList.cancel(cancelledId));
+
+		// Stop repeating after the third run. A fourth run may already be dispatched by then; ignore it.
+		std::atomic<int> repeatingCalls(0);
+
+		timerList.scheduleRepeating([&] {
+			if (++repeatingCalls > 3)
+			{
+				return false;
+			}
+
+			return signalRun(repeatingRuns) < 3;
+		}, std::chrono::milliseconds(1), std::chrono::milliseconds(2));
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cond.wait(lock, [&] { return (onceRuns == 1) && (repeatingRuns == 3); });
+		}
+
+		// Wait for the repeating timer to notice it was finished
+		while(timerList.scheduledTimers() > 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		ASSERT_FALSE(timerList.cancel(onceId));
+	}
+
+	dispatcher.waitForDrain();
+
+	ASSERT_EQUAL(onceRuns, 1);
+	ASSERT_EQUAL(repeatingRuns, 3);
+}
+
+}
+
+int main()
+{
+	testEmptyWheel();
+	testExpiryOrder();
+	testExactExpiry();
+	testBeyondRange();
+	testRemove();
+	testPastExpiry();
+
+	testTimerList();
+}
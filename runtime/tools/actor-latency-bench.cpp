@@ -0,0 +1,141 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <thread>
+
+#include "core/World.h"
+#include "core/init.h"
+#include "../tests/stubdefinitions.h"
+
+#include "binding/PairCell.h"
+#include "binding/IntegerCell.h"
+#include "binding/EmptyListCell.h"
+
+#include "actor/ActorContext.h"
+#include "actor/ActorClosureCell.h"
+#include "actor/Mailbox.h"
+#include "actor/Message.h"
+#include "actor/Runner.h"
+
+#include "alloc/allocator.h"
+
+namespace
+{
+	using namespace lliby;
+
+	const std::size_t LiveSetCells = 128 * 1024;
+	const std::size_t WorkingSetCellsPerMessage = 4 * 1024;
+	const int PingCount = 500;
+	// Idle time between pings for the ponger to collect in
+	const std::chrono::milliseconds InterPingDelay(10);
+	const std::int64_t AskTimeoutUsecs = 60 * 1000 * 1000;
+
+	// Power-of-two microsecond buckets
+	const int HistogramBuckets = 24;
+
+	RecordLikeCell::RecordClassIdType pongRecordClass;
+
+	AnyCell *buildList(World &world, std::size_t length)
+	{
+		AnyCell *list = EmptyListCell::instance();
+
+		for(std::size_t i = 0; i < length; i++)
+		{
+			list = PairCell::createInstance(world, IntegerCell::fromValue(world, i), list);
+		}
+
+		return list;
+	}
+
+	void pongBehaviour(World &world, ProcedureCell *self, AnyCell *msgCell)
+	{
+		// Keep our working set alive until the next message so it's promoted by any collection
+		auto fields = static_cast<AnyCell**>(self->recordData());
+		fields[1] = buildList(world, WorkingSetCellsPerMessage / 2);
+
+		actor::ActorContext *context = world.actorContext();
+		std::shared_ptr<actor::Mailbox> sender(context->sender().lock());
+
+		if (sender)
+		{
+			sender->tell(actor::Message::createFromCell(msgCell, context->mailbox()));
+		}
+	}
+
+	actor::ActorBehaviourCell *pongClosure(World &world, ProcedureCell *)
+	{
+		// Collect fully after a small amount of promotion so full collections are on the critical path
+		alloc::CollectionTunables &tunables = world.collectionPolicy().tunables();
+		tunables.tenuredGrowthFactor = 1.05;
+		tunables.minimumTenuredCells = 0;
+
+		// Keep a large live set and our working set referenced from our behaviour
+		auto fields = static_cast<AnyCell**>(RecordLikeCell::allocateRecordData(sizeof(AnyCell*) * 2));
+		fields[0] = buildList(world, LiveSetCells / 2);
+		fields[1] = EmptyListCell::instance();
+
+		return actor::ActorBehaviourCell::createInstance(world, pongRecordClass, false, fields, pongBehaviour);
+	}
+
+	void benchmarkPingPong(World &world)
+	{
+		pongRecordClass = ProcedureCell::registerRuntimeRecordClass(sizeof(AnyCell*) * 2, {0, sizeof(AnyCell*)});
+
+		auto closure = actor::ActorClosureCell::createInstance(world, ProcedureCell::EmptyRecordLikeClassId, true, nullptr, pongClosure);
+		std::shared_ptr<actor::Mailbox> ponger = actor::Runner::start(world, closure);
+
+		std::vector<std::size_t> histogram(HistogramBuckets, 0);
+		std::chrono::steady_clock::duration maxLatency(0);
+
+		for(int i = 0; i < PingCount; i++)
+		{
+			auto startTime = std::chrono::steady_clock::now();
+			ponger->ask(world, IntegerCell::fromValue(world, i), AskTimeoutUsecs);
+			auto latency = std::chrono::steady_clock::now() - startTime;
+
+			maxLatency = std::max(maxLatency, latency);
+
+			auto latencyUsecs = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+			int bucket = 0;
+
+			while((bucket < (HistogramBuckets - 1)) && ((1 << (bucket + 1)) <= latencyUsecs))
+			{
+				bucket++;
+			}
+
+			histogram[bucket]++;
+
+			alloc::conditionalCollection(world);
+			std::this_thread::sleep_for(InterPingDelay);
+		}
+
+		std::size_t cumulativeCount = 0;
+
+		std::cout << "Round-trip latency for " << PingCount << " pings:" << std::endl;
+
+		for(int bucket = 0; bucket < HistogramBuckets; bucket++)
+		{
+			if (histogram[bucket] == 0)
+			{
+				continue;
+			}
+
+			cumulativeCount += histogram[bucket];
+
+			std::cout << std::setw(10) << (bucket ? (1 << bucket) : 0) << "us: "
+				<< std::setw(8) << histogram[bucket] << " "
+				<< std::fixed << std::setprecision(3) << (100.0 * cumulativeCount / PingCount) << "%" << std::endl;
+		}
+
+		std::cout << "max: " << std::chrono::duration_cast<std::chrono::microseconds>(maxLatency).count() << "us" << std::endl;
+
+		ponger->requestLifecycleAction(actor::LifecycleAction::Stop);
+		ponger->waitForStop();
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	llcore_run(benchmarkPingPong, argc, argv);
+}
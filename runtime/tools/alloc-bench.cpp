@@ -0,0 +1,73 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "core/World.h"
+#include "core/init.h"
+#include "../tests/stubdefinitions.h"
+
+#include "binding/PairCell.h"
+#include "binding/IntegerCell.h"
+#include "binding/EmptyListCell.h"
+
+#include "alloc/allocator.h"
+
+namespace
+{
+	using namespace lliby;
+
+	const char *Backends[] = {"malloc", "mmap", "hugepage"};
+
+	const int BuildRuns = 32;
+	const std::size_t ListLength = 256 * 1024;
+
+	void benchmarkListBuilding(World &world)
+	{
+		auto startTime = std::chrono::steady_clock::now();
+
+		for(int i = 0; i < BuildRuns; i++)
+		{
+			AnyCell *list = EmptyListCell::instance();
+
+			for(std::size_t j = 0; j < ListLength; j++)
+			{
+				list = PairCell::createInstance(world, IntegerCell::fromValue(world, j), list);
+			}
+
+			// Release the list so its segments are recycled
+			alloc::forceCollection(world);
+		}
+
+		auto elapsed = std::chrono::steady_clock::now() - startTime;
+
+		using std::chrono::milliseconds;
+		using std::chrono::duration_cast;
+
+		std::cout << getenv("LLAMBDA_HEAP_SEGMENTS") << ": "
+			<< BuildRuns << " lists of " << ListLength << " integers in "
+			<< duration_cast<milliseconds>(elapsed).count() << "ms" << std::endl;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	// The segment backend is fixed once the first segment is allocated so run each backend in its own process
+	for(const char *backend : Backends)
+	{
+		pid_t child = fork();
+
+		if (child == 0)
+		{
+			setenv("LLAMBDA_HEAP_SEGMENTS", backend, 1);
+			llcore_run(benchmarkListBuilding, argc, argv);
+
+			return 0;
+		}
+
+		waitpid(child, nullptr, 0);
+	}
+}
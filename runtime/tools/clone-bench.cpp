@@ -0,0 +1,131 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <functional>
+
+#include "core/World.h"
+#include "core/init.h"
+#include "../tests/stubdefinitions.h"
+
+#include "binding/PairCell.h"
+#include "binding/VectorCell.h"
+#include "binding/StringCell.h"
+#include "binding/IntegerCell.h"
+#include "binding/HashMapCell.h"
+#include "binding/EmptyListCell.h"
+
+#include "hash/DatumHashTree.h"
+
+#include "alloc/Heap.h"
+#include "alloc/StrongRoot.h"
+
+#include "actor/cloneCell.h"
+
+namespace
+{
+	using namespace lliby;
+
+	const int CloneRuns = 10;
+	const std::size_t ElementCount = 100000;
+
+	StringCell *elementString(World &world, std::size_t index)
+	{
+		return StringCell::fromUtf8StdString(world, "element " + std::to_string(index));
+	}
+
+	/**
+	 * Builds a list of distinct strings
+	 */
+	AnyCell *buildList(World &world)
+	{
+		AnyCell *list = EmptyListCell::instance();
+		alloc::StrongRoot<AnyCell> listRoot(world, &list);
+
+		for(std::size_t i = 0; i < ElementCount; i++)
+		{
+			StringCell *element = elementString(world, i);
+			list = PairCell::createInstance(world, element, list);
+		}
+
+		return list;
+	}
+
+	/**
+	 * Builds a vector of pairs that all share the same string in their car
+	 */
+	AnyCell *buildVector(World &world)
+	{
+		VectorCell *vector = VectorCell::fromFill(world, ElementCount);
+		alloc::StrongRoot<VectorCell> vectorRoot(world, &vector);
+
+		StringCell *sharedString = elementString(world, 0);
+		alloc::StrongRoot<StringCell> sharedStringRoot(world, &sharedString);
+
+		for(std::size_t i = 0; i < ElementCount; i++)
+		{
+			PairCell *element = PairCell::createInstance(world, sharedString, EmptyListCell::instance());
+			vector->elements()[i] = element;
+		}
+
+		return vector;
+	}
+
+	/**
+	 * Builds a hash map from strings to integers
+	 */
+	AnyCell *buildHashMap(World &world)
+	{
+		HashMapCell *hashMap = HashMapCell::createEmptyInstance(world);
+		alloc::StrongRoot<HashMapCell> hashMapRoot(world, &hashMap);
+
+		for(std::size_t i = 0; i < ElementCount; i++)
+		{
+			StringCell *key = elementString(world, i);
+			alloc::StrongRoot<StringCell> keyRoot(world, &key);
+
+			IntegerCell *value = IntegerCell::fromValue(world, i);
+
+			DatumHashTree *oldTree = hashMap->datumHashTree();
+			hashMap->setDatumHashTree(DatumHashTree::assoc(oldTree, key, value));
+			DatumHashTree::unref(oldTree);
+		}
+
+		return hashMap;
+	}
+
+	void benchmarkClone(World &world, const char *name, const std::function<AnyCell*(World &)> &buildCell)
+	{
+		AnyCell *cell = buildCell(world);
+		alloc::StrongRoot<AnyCell> cellRoot(world, &cell);
+
+		std::chrono::steady_clock::duration totalTime(0);
+
+		for(int i = 0; i < CloneRuns; i++)
+		{
+			// Cloned cells are discarded with their heap
+			alloc::Heap heap(4096);
+
+			auto startTime = std::chrono::steady_clock::now();
+			actor::cloneCell(heap, cell, nullptr);
+			totalTime += std::chrono::steady_clock::now() - startTime;
+		}
+
+		using std::chrono::microseconds;
+		using std::chrono::duration_cast;
+
+		std::cout << name << " of " << ElementCount << " elements: mean clone "
+			<< duration_cast<microseconds>(totalTime).count() / CloneRuns << "us" << std::endl;
+	}
+
+	void benchmarkAll(World &world)
+	{
+		benchmarkClone(world, "list", buildList);
+		benchmarkClone(world, "vector", buildVector);
+		benchmarkClone(world, "hash map", buildHashMap);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	llcore_run(benchmarkAll, argc, argv);
+}
@@ -0,0 +1,100 @@
+#include <iostream>
+#include <chrono>
+#include <atomic>
+#include <functional>
+
+#include "sched/Dispatcher.h"
+#include "../tests/stubdefinitions.h"
+
+namespace
+{
+	using namespace lliby;
+
+	const int ExternalJobCount = 1000000;
+	const int FanOutDepth = 20;
+	const int ChainCount = 64;
+	const int ChainLength = 16 * 1024;
+
+	void reportThroughput(const char *name, std::size_t jobCount, std::chrono::steady_clock::duration elapsed)
+	{
+		using namespace std::chrono;
+		const double elapsedSeconds = duration_cast<duration<double>>(elapsed).count();
+
+		std::cout << name << ": " << jobCount << " jobs in " << duration_cast<milliseconds>(elapsed).count() << "ms ("
+			<< static_cast<std::size_t>(jobCount / elapsedSeconds) << " jobs/s)" << std::endl;
+	}
+
+	// Dispatches a burst of work from outside the dispatcher
+	void benchmarkExternalBurst(sched::Dispatcher &dispatcher)
+	{
+		std::atomic<std::size_t> completedJobs(0);
+		auto startTime = std::chrono::steady_clock::now();
+
+		for(int i = 0; i < ExternalJobCount; i++)
+		{
+			dispatcher.dispatch([&] {
+				completedJobs.fetch_add(1, std::memory_order_relaxed);
+			});
+		}
+
+		dispatcher.waitForDrain();
+		reportThroughput("external burst", completedJobs.load(), std::chrono::steady_clock::now() - startTime);
+	}
+
+	// Each job dispatches two more jobs like an actor telling two other sleeping actors
+	void benchmarkFanOut(sched::Dispatcher &dispatcher)
+	{
+		std::atomic<std::size_t> completedJobs(0);
+
+		std::function<void(int)> spawnTree = [&] (int depth) {
+			completedJobs.fetch_add(1, std::memory_order_relaxed);
+
+			if (depth > 0)
+			{
+				dispatcher.dispatch([&, depth] { spawnTree(depth - 1); });
+				dispatcher.dispatch([&, depth] { spawnTree(depth - 1); });
+			}
+		};
+
+		auto startTime = std::chrono::steady_clock::now();
+
+		dispatcher.dispatch([&] { spawnTree(FanOutDepth); });
+		dispatcher.waitForDrain();
+
+		reportThroughput("fan-out", completedJobs.load(), std::chrono::steady_clock::now() - startTime);
+	}
+
+	// Independent chains of jobs each dispatching their successor like a pipeline of actors
+	void benchmarkChains(sched::Dispatcher &dispatcher)
+	{
+		std::atomic<std::size_t> completedJobs(0);
+
+		std::function<void(int)> continueChain = [&] (int remaining) {
+			completedJobs.fetch_add(1, std::memory_order_relaxed);
+
+			if (remaining > 0)
+			{
+				dispatcher.dispatch([&, remaining] { continueChain(remaining - 1); });
+			}
+		};
+
+		auto startTime = std::chrono::steady_clock::now();
+
+		for(int i = 0; i < ChainCount; i++)
+		{
+			dispatcher.dispatch([&] { continueChain(ChainLength - 1); });
+		}
+
+		dispatcher.waitForDrain();
+		reportThroughput("chains", completedJobs.load(), std::chrono::steady_clock::now() - startTime);
+	}
+}
+
+int main()
+{
+	sched::Dispatcher &dispatcher(sched::Dispatcher::defaultInstance());
+
+	benchmarkExternalBurst(dispatcher);
+	benchmarkFanOut(dispatcher);
+	benchmarkChains(dispatcher);
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "core/World.h"
+#include "core/init.h"
+#include "../tests/stubdefinitions.h"
+
+#include "binding/EmptyListCell.h"
+
+#include "actor/ActorContext.h"
+#include "actor/ActorClosureCell.h"
+#include "actor/Mailbox.h"
+#include "actor/Message.h"
+#include "actor/Runner.h"
+
+namespace
+{
+	using namespace lliby;
+
+	const int ProducerCounts[] = {1, 2, 4, 8};
+	const std::size_t MessagesPerProducer = 200000;
+
+	std::atomic<std::size_t> receivedMessages;
+	std::size_t expectedMessages;
+
+	std::mutex finishedMutex;
+	std::condition_variable finishedCond;
+
+	void countBehaviour(World &, ProcedureCell *, AnyCell *)
+	{
+		if ((receivedMessages.fetch_add(1, std::memory_order_relaxed) + 1) == expectedMessages)
+		{
+			std::lock_guard<std::mutex> lock(finishedMutex);
+			finishedCond.notify_all();
+		}
+	}
+
+	actor::ActorBehaviourCell *countClosure(World &world, ProcedureCell *)
+	{
+		return actor::ActorBehaviourCell::createInstance(world, ProcedureCell::EmptyRecordLikeClassId, true, nullptr, countBehaviour);
+	}
+
+	void benchmarkFanIn(World &world, int producerCount)
+	{
+		auto closure = actor::ActorClosureCell::createInstance(world, ProcedureCell::EmptyRecordLikeClassId, true, nullptr, countClosure);
+		std::shared_ptr<actor::Mailbox> consumer = actor::Runner::start(world, closure);
+
+		receivedMessages.store(0);
+		expectedMessages = producerCount * MessagesPerProducer;
+
+		auto startTime = std::chrono::steady_clock::now();
+		std::vector<std::thread> producers;
+
+		for(int i = 0; i < producerCount; i++)
+		{
+			producers.emplace_back([=] {
+				const std::weak_ptr<actor::Mailbox> noSender;
+
+				for(std::size_t j = 0; j < MessagesPerProducer; j++)
+				{
+					consumer->tell(actor::Message::createFromCell(EmptyListCell::instance(), noSender));
+				}
+			});
+		}
+
+		for(auto &producer : producers)
+		{
+			producer.join();
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(finishedMutex);
+			finishedCond.wait(lock, [] { return receivedMessages.load() == expectedMessages; });
+		}
+
+		auto elapsed = std::chrono::steady_clock::now() - startTime;
+
+		using namespace std::chrono;
+		const double elapsedSeconds = duration_cast<duration<double>>(elapsed).count();
+
+		std::cout << producerCount << " producers: " << expectedMessages << " messages in "
+			<< duration_cast<milliseconds>(elapsed).count() << "ms ("
+			<< static_cast<std::size_t>(expectedMessages / elapsedSeconds) << " messages/s)" << std::endl;
+
+		consumer->requestLifecycleAction(actor::LifecycleAction::Stop);
+		consumer->waitForStop();
+	}
+
+	void benchmarkAll(World &world)
+	{
+		for(int producerCount : ProducerCounts)
+		{
+			benchmarkFanIn(world, producerCount);
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	llcore_run(benchmarkAll, argc, argv);
+}
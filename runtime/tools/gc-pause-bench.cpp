@@ -0,0 +1,103 @@
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <functional>
+
+#include "core/World.h"
+#include "core/init.h"
+#include "../tests/stubdefinitions.h"
+
+#include "binding/PairCell.h"
+#include "binding/VectorCell.h"
+#include "binding/IntegerCell.h"
+#include "binding/EmptyListCell.h"
+
+#include "alloc/allocator.h"
+#include "alloc/StrongRoot.h"
+
+namespace
+{
+	using namespace lliby;
+
+	const int CollectionRuns = 10;
+
+	/**
+	 * Builds a tree nested through its car with the passed depth
+	 */
+	AnyCell *buildDeepGraph(World &world, std::size_t depth)
+	{
+		AnyCell *tree = EmptyListCell::instance();
+
+		for(std::size_t i = 0; i < depth; i++)
+		{
+			tree = PairCell::createInstance(world, tree, EmptyListCell::instance());
+		}
+
+		return tree;
+	}
+
+	/**
+	 * Builds a vector containing the passed number of integer lists
+	 */
+	AnyCell *buildWideGraph(World &world, std::size_t width, std::size_t listLength)
+	{
+		VectorCell *vector = VectorCell::fromFill(world, width);
+
+		for(std::size_t i = 0; i < width; i++)
+		{
+			AnyCell *list = EmptyListCell::instance();
+
+			for(std::size_t j = 0; j < listLength; j++)
+			{
+				list = PairCell::createInstance(world, IntegerCell::fromValue(world, j), list);
+			}
+
+			vector->elements()[i] = list;
+		}
+
+		return vector;
+	}
+
+	void benchmarkGraph(World &world, const char *name, const std::function<AnyCell*()> &buildGraph)
+	{
+		AnyCell *root = buildGraph();
+		alloc::StrongRoot<AnyCell> graphRoot(world, &root);
+
+		std::chrono::steady_clock::duration totalPause(0);
+		std::chrono::steady_clock::duration maxPause(0);
+		std::size_t reachableCells = 0;
+
+		for(int i = 0; i < CollectionRuns; i++)
+		{
+			auto startTime = std::chrono::steady_clock::now();
+			reachableCells = alloc::forceCollection(world);
+			auto pause = std::chrono::steady_clock::now() - startTime;
+
+			totalPause += pause;
+			maxPause = std::max(maxPause, pause);
+		}
+
+		using std::chrono::microseconds;
+		using std::chrono::duration_cast;
+
+		std::cout << name << ": " << reachableCells << " cells, "
+			<< "mean pause " << duration_cast<microseconds>(totalPause).count() / CollectionRuns << "us, "
+			<< "max pause " << duration_cast<microseconds>(maxPause).count() << "us" << std::endl;
+	}
+
+	void benchmarkAll(World &world)
+	{
+		benchmarkGraph(world, "deep", [&] {
+			return buildDeepGraph(world, 2 * 1024 * 1024);
+		});
+
+		benchmarkGraph(world, "wide", [&] {
+			return buildWideGraph(world, 64 * 1024, 16);
+		});
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	llcore_run(benchmarkAll, argc, argv);
+}
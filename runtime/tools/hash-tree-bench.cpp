@@ -0,0 +1,248 @@
+#include <iostream>
+#include <chrono>
+#include <functional>
+
+#include "core/World.h"
+#include "core/init.h"
+#include "../tests/stubdefinitions.h"
+
+#include "binding/VectorCell.h"
+#include "binding/IntegerCell.h"
+#include "binding/BooleanCell.h"
+
+#include "hash/DatumHashTree.h"
+
+#include "alloc/StrongRoot.h"
+
+namespace
+{
+	using namespace lliby;
+
+	const int BuildRuns = 5;
+	const int WalkRuns = 2000;
+	const int MergeRuns = 5;
+	const std::size_t KeyCount = 1000000;
+
+	// This is small enough for the walked tree to stay in cache
+	const std::size_t WalkKeyCount = 10000;
+
+	/**
+	 * Builds a tree by replacing it with a new persistent tree for every key
+	 */
+	DatumHashTree *buildPersistent(VectorCell *keys)
+	{
+		DatumHashTree *tree = DatumHashTree::createEmpty();
+
+		for(VectorCell::LengthType i = 0; i < keys->length(); i++)
+		{
+			DatumHashTree *newTree = DatumHashTree::assoc(tree, keys->elements()[i], BooleanCell::trueInstance());
+			DatumHashTree::unref(tree);
+
+			tree = newTree;
+		}
+
+		return tree;
+	}
+
+	/**
+	 * Builds a tree using a transient
+	 */
+	DatumHashTree *buildTransient(VectorCell *keys)
+	{
+		DatumHashTree::Transient transient;
+
+		for(VectorCell::LengthType i = 0; i < keys->length(); i++)
+		{
+			transient.assoc(keys->elements()[i], BooleanCell::trueInstance());
+		}
+
+		return transient.persistent();
+	}
+
+	void benchmarkBuild(VectorCell *keys, const char *name, const std::function<DatumHashTree*(VectorCell *)> &buildTree)
+	{
+		std::chrono::steady_clock::duration totalTime(0);
+
+		for(int i = 0; i < BuildRuns; i++)
+		{
+			auto startTime = std::chrono::steady_clock::now();
+			DatumHashTree *tree = buildTree(keys);
+			totalTime += std::chrono::steady_clock::now() - startTime;
+
+			DatumHashTree::unref(tree);
+		}
+
+		using std::chrono::nanoseconds;
+		using std::chrono::duration_cast;
+
+		std::cout << name << " build of " << keys->length() << " keys: "
+			<< duration_cast<nanoseconds>(totalTime).count() / (BuildRuns * keys->length()) << "ns per key" << std::endl;
+	}
+
+	void benchmarkWalk(const DatumHashTree *tree, const char *name, const std::function<std::size_t(const DatumHashTree *)> &walkTree)
+	{
+		std::chrono::steady_clock::duration totalTime(0);
+		std::size_t visitedEntries = 0;
+
+		for(int i = 0; i < WalkRuns; i++)
+		{
+			auto startTime = std::chrono::steady_clock::now();
+			visitedEntries += walkTree(tree);
+			totalTime += std::chrono::steady_clock::now() - startTime;
+		}
+
+		using std::chrono::nanoseconds;
+		using std::chrono::duration_cast;
+
+		std::cout << name << " walk: " << static_cast<double>(duration_cast<nanoseconds>(totalTime).count()) / visitedEntries
+			<< "ns per entry" << std::endl;
+	}
+
+	void benchmarkMerge(DatumHashTree *source, DatumHashTree *override, const char *name, const std::function<DatumHashTree*(DatumHashTree *, DatumHashTree *)> &mergeTrees)
+	{
+		std::chrono::steady_clock::duration totalTime(0);
+
+		for(int i = 0; i < MergeRuns; i++)
+		{
+			auto startTime = std::chrono::steady_clock::now();
+			DatumHashTree *tree = mergeTrees(source, override);
+			totalTime += std::chrono::steady_clock::now() - startTime;
+
+			DatumHashTree::unref(tree);
+		}
+
+		using std::chrono::microseconds;
+		using std::chrono::duration_cast;
+
+		std::cout << name << " merge: mean " << duration_cast<microseconds>(totalTime).count() / MergeRuns << "us" << std::endl;
+	}
+
+	/**
+	 * Merges by associating each override entry with a transient of the source
+	 */
+	DatumHashTree* mergeByAssoc(DatumHashTree *source, DatumHashTree *override)
+	{
+		DatumHashTree::Transient transient(DatumHashTree::ref(source));
+
+		DatumHashTree::every(override, [&] (AnyCell *key, AnyCell *value, DatumHash::ResultType hashValue)
+		{
+			transient.assoc(key, value, hashValue);
+			return true;
+		});
+
+		return transient.persistent();
+	}
+
+	void benchmarkAllMerges(VectorCell *keys)
+	{
+		DatumHashTree::Transient sourceTransient;
+		DatumHashTree::Transient overrideTransient;
+
+		for(VectorCell::LengthType i = 0; i < keys->length(); i++)
+		{
+			if ((i % 2) == 0)
+			{
+				sourceTransient.assoc(keys->elements()[i], BooleanCell::trueInstance());
+			}
+
+			if ((i % 3) == 0)
+			{
+				overrideTransient.assoc(keys->elements()[i], BooleanCell::falseInstance());
+			}
+		}
+
+		DatumHashTree *source = sourceTransient.persistent();
+		DatumHashTree *override = overrideTransient.persistent();
+
+		benchmarkMerge(source, override, "assoc", mergeByAssoc);
+		benchmarkMerge(source, override, "structural", [] (DatumHashTree *source, DatumHashTree *override) {
+			return DatumHashTree::merge(source, override);
+		});
+
+		// Merge a tree derived from the source with a small number of changes
+		DatumHashTree::Transient derivedTransient(DatumHashTree::ref(source));
+
+		for(VectorCell::LengthType i = 0; i < keys->length(); i += keys->length() / 100)
+		{
+			derivedTransient.assoc(keys->elements()[i], BooleanCell::falseInstance());
+		}
+
+		DatumHashTree *derived = derivedTransient.persistent();
+
+		benchmarkMerge(source, derived, "derived assoc", mergeByAssoc);
+		benchmarkMerge(source, derived, "derived structural", [] (DatumHashTree *source, DatumHashTree *override) {
+			return DatumHashTree::merge(source, override);
+		});
+
+		DatumHashTree::unref(derived);
+		DatumHashTree::unref(override);
+		DatumHashTree::unref(source);
+	}
+
+	void benchmarkAll(World &world)
+	{
+		VectorCell *keys = VectorCell::fromFill(world, KeyCount);
+		alloc::StrongRoot<VectorCell> keysRoot(world, &keys);
+
+		for(std::size_t i = 0; i < KeyCount; i++)
+		{
+			IntegerCell *key = IntegerCell::fromValue(world, i * 7919);
+			keys->elements()[i] = key;
+		}
+
+		// Nothing below allocates cells so the keys can't move while they're in a tree
+		benchmarkBuild(keys, "persistent", buildPersistent);
+		benchmarkBuild(keys, "transient", buildTransient);
+
+		DatumHashTree::Transient walkTransient;
+
+		for(std::size_t i = 0; i < WalkKeyCount; i++)
+		{
+			walkTransient.assoc(keys->elements()[i], BooleanCell::trueInstance());
+		}
+
+		DatumHashTree *tree = walkTransient.persistent();
+
+		benchmarkWalk(tree, "type-erased every()", [] (const DatumHashTree *tree) {
+			std::size_t entries = 0;
+			std::function<bool(AnyCell*, AnyCell*, DatumHash::ResultType)> pred = [&] (AnyCell *, AnyCell *, DatumHash::ResultType) {
+				entries++;
+				return true;
+			};
+
+			DatumHashTree::every(tree, pred);
+			return entries;
+		});
+
+		benchmarkWalk(tree, "inlined every()", [] (const DatumHashTree *tree) {
+			std::size_t entries = 0;
+
+			DatumHashTree::every(tree, [&] (AnyCell *, AnyCell *, DatumHash::ResultType) {
+				entries++;
+				return true;
+			});
+
+			return entries;
+		});
+
+		benchmarkWalk(tree, "iterator", [] (const DatumHashTree *tree) {
+			std::size_t entries = 0;
+
+			for(DatumHashTree::Iterator it(tree); !it.atEnd(); it.advance())
+			{
+				entries++;
+			}
+
+			return entries;
+		});
+
+		DatumHashTree::unref(tree);
+
+		benchmarkAllMerges(keys);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	llcore_run(benchmarkAll, argc, argv);
+}